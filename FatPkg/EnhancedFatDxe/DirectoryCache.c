@@ -24,6 +24,19 @@ FatFreeODir (
 {
   FAT_DIRENT  *DirEnt;
 
+  if (ODir->DirEntCount >= FAT_DIR_STATISTICS_MIN_ENTRIES) {
+    DEBUG ((
+      DEBUG_INFO,
+      "FAT directory: %d entries, %d buckets after %d grows, %ld lookups visited %ld hash nodes, %d bytes\n",
+      (UINT32) ODir->DirEntCount,
+      ODir->HashTableMask + 1,
+      (UINT32) ODir->HashTableGrows,
+      ODir->HashLookups,
+      ODir->HashProbes,
+      (UINT32) ODir->MemorySize
+      ));
+  }
+
   //
   // Release Directory Entry Nodes
   //
@@ -37,6 +50,7 @@ FatFreeODir (
     FatFreeDirEnt (DirEnt);
   }
 
+  FatFreeHashTable (ODir);
   FreePool (ODir);
 }
 
@@ -63,6 +77,11 @@ FatAllocateODir (
     ODir->Signature = FAT_ODIR_SIGNATURE;
     InitializeListHead (&ODir->ChildList);
     ODir->CurrentCursor = &ODir->ChildList;
+    ODir->MemorySize    = sizeof (FAT_ODIR);
+    if (EFI_ERROR (FatCreateHashTable (ODir))) {
+      FreePool (ODir);
+      ODir = NULL;
+    }
   }
 
   return ODir;
@@ -72,6 +91,9 @@ FatAllocateODir (
 
   Discard the directory structure when an OFile will be freed.
   Volume will cache this directory if the OFile does not represent a deleted file.
+  The least recently used directories are evicted while the cache holds more than
+  PcdFatDirCacheMaxCount directories or more than PcdFatDirCacheMaxSize bytes; the
+  directory just discarded is kept even if it alone exceeds the memory budget.
 
   @param  OFile                 - The OFile whose directory structure is to be discarded.
 
@@ -93,24 +115,24 @@ FatDiscardODir (
     //
     ODir->DirCacheTag = OFile->FileCluster;
     InsertHeadList (&Volume->DirCacheList, &ODir->DirCacheLink);
-    if (Volume->DirCacheCount == FAT_MAX_DIR_CACHE_COUNT) {
-      //
-      // Replace the least recent used directory
-      //
+    Volume->DirCacheCount++;
+    Volume->DirCacheSize += ODir->MemorySize;
+    //
+    // Replace the least recent used directories
+    //
+    while (Volume->DirCacheCount > PcdGet32 (PcdFatDirCacheMaxCount) ||
+           (Volume->DirCacheCount > 1 && Volume->DirCacheSize > PcdGet32 (PcdFatDirCacheMaxSize))) {
       ODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
       RemoveEntryList (&ODir->DirCacheLink);
-    } else {
-      //
-      // No need to find a replace
-      //
-      Volume->DirCacheCount++;
-      ODir = NULL;
+      Volume->DirCacheCount--;
+      Volume->DirCacheSize -= ODir->MemorySize;
+      Volume->IoStatistics.DirCacheEvictions++;
+      FatFreeODir (ODir);
     }
-  }
-  //
-  // Release ODir Structure
-  //
-  if (ODir != NULL) {
+  } else {
+    //
+    // Release ODir Structure
+    //
     FatFreeODir (ODir);
   }
 }
@@ -147,6 +169,7 @@ FatRequestODir (
     if (CurrentODir->DirCacheTag == DirCacheTag) {
       RemoveEntryList (&CurrentODir->DirCacheLink);
       Volume->DirCacheCount--;
+      Volume->DirCacheSize -= CurrentODir->MemorySize;
       ODir = CurrentODir;
       break;
     }
@@ -156,7 +179,10 @@ FatRequestODir (
     //
     // This directory is not cached, then allocate a new one
     //
+    Volume->IoStatistics.DirCacheMisses++;
     ODir = FatAllocateODir (OFile);
+  } else {
+    Volume->IoStatistics.DirCacheHits++;
   }
 
   OFile->ODir = ODir;
@@ -181,4 +207,6 @@ FatCleanupODirCache (
     FatFreeODir (ODir);
     Volume->DirCacheCount--;
   }
+
+  Volume->DirCacheSize = 0;
 }
@@ -152,12 +152,102 @@ FatExchangeCachePage (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Load a cache page for reading, together with the pages that follow it when
+  the reader is sequential.
+
+  The read-ahead window doubles every time the reader misses exactly on the
+  page after the last loaded window, up to FAT_READ_AHEAD_MAX_PAGES, and drops
+  back to a single page on any other miss. The window is cut short where the
+  cache groups wrap, at a dirty or already cached page, and at the end of the
+  cached region, so it is always loaded with one disk read.
+
+  @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  PageNo                - PageNo to load.
+
+  @retval EFI_SUCCESS           - The cache pages are loaded.
+  @return other                 - An error occurred when reading the disk.
+
+**/
+STATIC
+EFI_STATUS
+FatReadAheadCachePages (
+  IN FAT_VOLUME         *Volume,
+  IN CACHE_DATA_TYPE    CacheDataType,
+  IN UINTN              PageNo
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *CacheTag;
+  UINTN       GroupNo;
+  UINTN       Count;
+  UINTN       Index;
+  UINT64      EntryPos;
+  UINT8       PageAlignment;
+
+  DiskCache     = &Volume->DiskCache[CacheDataType];
+  PageAlignment = DiskCache->PageAlignment;
+  GroupNo       = PageNo & DiskCache->GroupMask;
+  EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
+
+  if (PageNo == DiskCache->NextPageNo) {
+    DiskCache->ReadAheadPages = MIN (MAX (DiskCache->ReadAheadPages, 1) * 2, FAT_READ_AHEAD_MAX_PAGES);
+  } else {
+    DiskCache->ReadAheadPages = 1;
+  }
+
+  for (Count = 1; Count < DiskCache->ReadAheadPages; Count++) {
+    if (GroupNo + Count > DiskCache->GroupMask) {
+      break;
+    }
+
+    CacheTag = &DiskCache->CacheTag[GroupNo + Count];
+    if (CacheTag->RealSize > 0 && (CacheTag->Dirty || CacheTag->PageNo == PageNo + Count)) {
+      break;
+    }
+
+    if (EntryPos + LShiftU64 (Count + 1, PageAlignment) > DiskCache->LimitAddress) {
+      break;
+    }
+  }
+
+  DiskCache->NextPageNo = PageNo + Count;
+  CacheTag              = &DiskCache->CacheTag[GroupNo];
+  CacheTag->PageNo      = PageNo;
+  if (Count == 1) {
+    return FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  }
+
+  Status = FatDiskIo (
+             Volume,
+             ReadDisk,
+             EntryPos,
+             Count << PageAlignment,
+             DiskCache->CacheBase + (GroupNo << PageAlignment),
+             NULL
+             );
+  Volume->IoStatistics.ReadAheadReads++;
+  Volume->IoStatistics.ReadAheadPages += Count;
+  for (Index = 0; Index < Count; Index++) {
+    CacheTag           = &DiskCache->CacheTag[GroupNo + Index];
+    CacheTag->PageNo   = PageNo + Index;
+    CacheTag->Dirty    = FALSE;
+    CacheTag->RealSize = EFI_ERROR (Status) ? 0 : ((UINTN)1 << PageAlignment);
+  }
+
+  return Status;
+}
+
 /**
 
   Get one cache page by specified PageNo.
 
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  IoMode                - Indicate whether the page is read or written.
   @param  PageNo                - PageNo to match with the cache.
   @param  CacheTag              - The Cache Tag for the current cache page.
 
@@ -170,6 +260,7 @@ EFI_STATUS
 FatGetCachePage (
   IN FAT_VOLUME         *Volume,
   IN CACHE_DATA_TYPE    CacheDataType,
+  IN IO_MODE            IoMode,
   IN UINTN              PageNo,
   IN CACHE_TAG          *CacheTag
   )
@@ -197,6 +288,10 @@ FatGetCachePage (
   //
   // Load new data from disk;
   //
+  if (IoMode == ReadDisk) {
+    return FatReadAheadCachePages (Volume, CacheDataType, PageNo);
+  }
+
   CacheTag->PageNo  = PageNo;
   Status            = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
 
@@ -242,7 +337,7 @@ FatAccessUnalignedCachePage (
   DiskCache = &Volume->DiskCache[CacheDataType];
   GroupNo   = PageNo & DiskCache->GroupMask;
   CacheTag  = &DiskCache->CacheTag[GroupNo];
-  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, CacheTag);
+  Status    = FatGetCachePage (Volume, CacheDataType, IoMode, PageNo, CacheTag);
   if (!EFI_ERROR (Status)) {
     Source      = DiskCache->CacheBase + (GroupNo << DiskCache->PageAlignment) + Offset;
     Destination = Buffer;
@@ -259,6 +354,125 @@ FatAccessUnalignedCachePage (
   return Status;
 }
 
+/**
+
+  Access a range of the data region directly on the disk.
+
+  Cached pages that overlap the range are kept coherent with the disk: after a
+  blocking read, dirty cache contents are copied over the buffer; after a
+  blocking write, fully covered pages are invalidated and partially covered
+  pages get the new data. A non-blocking write updates every overlapped page,
+  because the disk holds the old data until it completes. A non-blocking read
+  completes after this function returns, so the dirty pages it overlaps are
+  written back before the read is queued instead.
+
+  @param  Volume                - FAT file system volume.
+  @param  IoMode                - Indicate the type of disk access.
+  @param  Offset                - The starting byte offset to read from.
+  @param  BufferSize            - Size of Buffer.
+  @param  Buffer                - Buffer containing the data.
+  @param  Task                    point to task instance.
+
+  @retval EFI_SUCCESS           - The data was accessed correctly.
+  @return Others                - An error occurred when accessing the disk.
+
+**/
+STATIC
+EFI_STATUS
+FatAccessDataDirect (
+  IN     FAT_VOLUME         *Volume,
+  IN     IO_MODE            IoMode,
+  IN     UINT64             Offset,
+  IN     UINTN              BufferSize,
+  IN OUT UINT8              *Buffer,
+  IN     FAT_TASK           *Task
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *CacheTag;
+  UINTN       PageNo;
+  UINTN       EndPageNo;
+  UINTN       GroupNo;
+  UINTN       PageSize;
+  UINTN       Length;
+  UINT64      EntryPos;
+  UINT64      PagePos;
+  UINT64      Start;
+  UINT64      End;
+  UINT8       *CacheAddress;
+  UINT8       PageAlignment;
+
+  DiskCache     = &Volume->DiskCache[CacheData];
+  PageAlignment = DiskCache->PageAlignment;
+  PageSize      = (UINTN)1 << PageAlignment;
+  EntryPos      = Offset - DiskCache->BaseAddress;
+  EndPageNo     = (UINTN) RShiftU64 (EntryPos + BufferSize - 1, PageAlignment);
+
+  if (Task != NULL && IoMode == ReadDisk) {
+    for (PageNo = (UINTN) RShiftU64 (EntryPos, PageAlignment); PageNo <= EndPageNo; PageNo++) {
+      CacheTag = &DiskCache->CacheTag[PageNo & DiskCache->GroupMask];
+      if (CacheTag->RealSize > 0 && CacheTag->PageNo == PageNo && CacheTag->Dirty) {
+        Status = FatExchangeCachePage (Volume, CacheData, WriteDisk, CacheTag, NULL);
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+      }
+    }
+  }
+
+  Status = FatDiskIo (Volume, IoMode, Offset, BufferSize, Buffer, Task);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (IoMode == ReadDisk) {
+    Volume->IoStatistics.DirectReads++;
+  } else {
+    Volume->IoStatistics.DirectWrites++;
+  }
+  Volume->IoStatistics.DirectBytes += BufferSize;
+
+  for (PageNo = (UINTN) RShiftU64 (EntryPos, PageAlignment); PageNo <= EndPageNo; PageNo++) {
+    GroupNo   = PageNo & DiskCache->GroupMask;
+    CacheTag  = &DiskCache->CacheTag[GroupNo];
+    if (CacheTag->RealSize == 0 || CacheTag->PageNo != PageNo) {
+      continue;
+    }
+
+    //
+    // Get the part of the page inside the accessed range
+    //
+    PagePos       = LShiftU64 (PageNo, PageAlignment);
+    Start         = MAX (PagePos, EntryPos);
+    End           = MIN (PagePos + PageSize, EntryPos + BufferSize);
+    Length        = (UINTN) (End - Start);
+    CacheAddress  = DiskCache->CacheBase + (GroupNo << PageAlignment) + (UINTN) (Start - PagePos);
+
+    if (IoMode == ReadDisk) {
+      if (CacheTag->Dirty) {
+        CopyMem (Buffer + (UINTN) (Start - EntryPos), CacheAddress, Length);
+      }
+    } else if (Length == PageSize && Task == NULL) {
+      CacheTag->RealSize = 0;
+    } else {
+      //
+      // Until a non-blocking write completes the disk still holds the old
+      // data, so keep the page cached with the new contents. Mark it dirty so
+      // that it is written back rather than dropped and read again from the
+      // disk before the write has completed.
+      //
+      CopyMem (CacheAddress, Buffer + (UINTN) (Start - EntryPos), Length);
+      if (Task != NULL) {
+        CacheTag->Dirty  = TRUE;
+        DiskCache->Dirty = TRUE;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
 
   Read BufferSize bytes from the position of Offset into Buffer,
@@ -274,6 +488,8 @@ FatAccessUnalignedCachePage (
      The access data will be divided into UnderRun data, Aligned data and OverRun data;
      The UnderRun data and OverRun data will be accessed by the Data cache,
      but the Aligned data will be accessed with disk directly.
+     A non-blocking access, and a blocking access of at least one cache page that
+     is aligned to the media block size, bypass the Data cache as a whole.
 
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The type of cache: CACHE_DATA or CACHE_FAT.
@@ -311,6 +527,7 @@ FatAccessCache (
   DISK_CACHE  *DiskCache;
   UINT64      EntryPos;
   UINT8       PageAlignment;
+  UINT32      BlockSize;
 
   ASSERT (Volume->CacheBuffer != NULL);
 
@@ -322,6 +539,21 @@ FatAccessCache (
   PageNo        = (UINTN) RShiftU64 (EntryPos, PageAlignment);
   UnderRun      = ((UINTN) EntryPos) & (PageSize - 1);
 
+  if (CacheDataType == CacheData) {
+    //
+    // A non-blocking access never waits for a cache page to be loaded; the
+    // whole range is queued to the disk so that it overlaps with the caller.
+    //
+    if (Task != NULL) {
+      return FatAccessDataDirect (Volume, IoMode, Offset, BufferSize, Buffer, Task);
+    }
+
+    BlockSize = Volume->BlockIo->Media->BlockSize;
+    if (BufferSize >= PageSize && ModU64x32 (Offset, BlockSize) == 0 && (BufferSize % BlockSize) == 0) {
+      return FatAccessDataDirect (Volume, IoMode, Offset, BufferSize, Buffer, NULL);
+    }
+  }
+
   if (UnderRun > 0) {
     Length = PageSize - UnderRun;
     if (Length > BufferSize) {
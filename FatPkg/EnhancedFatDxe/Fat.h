@@ -84,6 +84,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define FAT_FATCACHE_GROUP_MIN_COUNT      1
 #define FAT_FATCACHE_GROUP_MAX_COUNT      16
 
+//
+// Maximum number of cache pages loaded by one sequential read-ahead
+//
+#define FAT_READ_AHEAD_MAX_PAGES          16
+
+//
+// The free cluster bitmap is built by reading the FAT in chunks of this size
+//
+#define FAT_FREE_BITMAP_SCAN_SIZE         0x10000
+
 //
 // Used in 8.3 generation algorithm
 //
@@ -104,7 +114,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define LC_ISO_639_2_ENTRY_SIZE 3
 #define MAX_LANG_CODE_SIZE      100
 
-#define FAT_MAX_DIR_CACHE_COUNT 8
+#define FAT_CLUSTER_RUN_CACHE_SIZE 16
 #define FAT_MAX_DIRENTRY_COUNT  0xFFFF
 typedef CHAR8                   LC_ISO_639_2;
 
@@ -156,14 +166,23 @@ typedef struct {
   BOOLEAN   Dirty;
   UINT8     PageAlignment;
   UINTN     GroupMask;
+  UINTN     NextPageNo;       // Page a sequential reader will miss on next
+  UINTN     ReadAheadPages;   // Current read-ahead window in pages
   CACHE_TAG CacheTag[FAT_DATACACHE_GROUP_COUNT];
 } DISK_CACHE;
 
 //
-// Hash table size
+// Hash table size; each directory starts with the minimum and doubles
+// whenever it holds more entries than buckets
 //
-#define HASH_TABLE_SIZE  0x400
-#define HASH_TABLE_MASK  (HASH_TABLE_SIZE - 1)
+#define HASH_TABLE_MIN_SIZE  0x40
+#define HASH_TABLE_MAX_SIZE  0x10000
+
+//
+// Hash lookup counters are reported when a directory with at least this many
+// entries is freed
+//
+#define FAT_DIR_STATISTICS_MIN_ENTRIES  0x400
 
 //
 // The directory entry for opened directory
@@ -183,6 +202,8 @@ struct _FAT_DIRENT {
   FAT_OFILE           *OFile;                 // The OFile of the corresponding directory entry
   FAT_DIRENT          *ShortNameForwardLink;  // Hash successor link for short filename
   FAT_DIRENT          *LongNameForwardLink;   // Hash successor link for long filename
+  UINT32              ShortNameHash;          // Full hash value of the short filename
+  UINT32              LongNameHash;           // Full hash value of the long filename
   LIST_ENTRY          Link;                   // Connection of every directory entry
   FAT_DIRECTORY_ENTRY Entry;                  // The physical directory entry stored in disk
 };
@@ -196,8 +217,14 @@ struct _FAT_ODIR {
   BOOLEAN             EndOfDir;               // Indicate whether we have reached the end of the directory
   LIST_ENTRY          DirCacheLink;           // Linked in Volume->DirCacheList when discarded
   UINTN               DirCacheTag;            // The identification of the directory when in directory cache
-  FAT_DIRENT          *LongNameHashTable[HASH_TABLE_SIZE];
-  FAT_DIRENT          *ShortNameHashTable[HASH_TABLE_SIZE];
+  UINTN               DirEntCount;            // Count of directory entries in the hash tables
+  UINTN               MemorySize;             // Pool bytes held by this directory and its entries
+  UINT32              HashTableMask;          // Count of hash table buckets minus one
+  UINTN               HashTableGrows;         // Times the hash tables were doubled
+  UINT64              HashLookups;            // Name lookups in the hash tables
+  UINT64              HashProbes;             // Hash chain nodes visited by those lookups
+  FAT_DIRENT          **LongNameHashTable;
+  FAT_DIRENT          **ShortNameHashTable;
 };
 
 typedef struct {
@@ -229,6 +256,33 @@ typedef struct {
   LIST_ENTRY          Link;
 } FAT_SUBTASK;
 
+//
+// Counters of the disk cache, cluster chain and directory cache optimizations
+// of a volume, reported when the volume is freed
+//
+typedef struct {
+  UINT64              ReadAheadReads;         // Disk reads that loaded more than one cache page
+  UINT64              ReadAheadPages;         // Cache pages loaded by those reads
+  UINT64              DirectReads;            // Data reads that bypassed the data cache
+  UINT64              DirectWrites;           // Data writes that bypassed the data cache
+  UINT64              DirectBytes;            // Bytes transferred by those reads and writes
+  UINT64              ClusterRunHits;         // Seeks served by the cluster run cache
+  UINT64              ClusterRunMisses;       // Seeks that walked the FAT
+  UINT64              FatLookupsSaved;        // FAT entry reads replaced by a known run
+  UINT64              DirCacheHits;           // Directories reopened from the directory cache
+  UINT64              DirCacheMisses;         // Directories parsed from the disk again
+  UINT64              DirCacheEvictions;      // Directories evicted from the directory cache
+} FAT_IO_STATISTICS;
+
+//
+// A run of consecutive clusters in a file's cluster chain
+//
+typedef struct {
+  UINTN               FileIndex;              // Index of the first cluster within the file
+  UINTN               Cluster;                // First cluster of the run on the volume
+  UINTN               Length;                 // Number of clusters in the run
+} FAT_CLUSTER_RUN;
+
 //
 // FAT_OFILE - Each opened file
 //
@@ -272,6 +326,14 @@ struct _FAT_OFILE {
   UINT64              PosDisk;  // on the disk
   UINTN               PosRem;   // remaining in this disk run
   //
+  // The runs of the cluster chain walked so far. They describe the first
+  // ClusterRunCovered clusters of the chain starting at ClusterRunHead.
+  //
+  UINTN               ClusterRunHead;
+  UINTN               ClusterRunCovered;
+  UINTN               ClusterRunCount;
+  FAT_CLUSTER_RUN     ClusterRuns[FAT_CLUSTER_RUN_CACHE_SIZE];
+  //
   // The opened parent, full path length and currently opened child files
   //
   FAT_OFILE           *Parent;
@@ -335,6 +397,8 @@ struct _FAT_VOLUME {
   FAT_INFO_SECTOR                 FatInfoSector;  // Free cluster info
   UINTN                           FreeInfoPos;    // Pos with the free cluster info
   BOOLEAN                         FreeInfoValid;  // If free cluster info is valid
+  UINT8                           *FreeBitmap;    // One bit per cluster, set if free. NULL until built
+  BOOLEAN                         FreeBitmapFailed; // If the free cluster bitmap could not be built
   //
   // Unpacked Fat BPB info
   //
@@ -369,12 +433,15 @@ struct _FAT_VOLUME {
   //
   LIST_ENTRY                      DirCacheList;
   UINTN                           DirCacheCount;
+  UINTN                           DirCacheSize;
 
   //
   // Disk Cache for this volume
   //
   VOID                            *CacheBuffer;
   DISK_CACHE                      DiskCache[CacheMaxType];
+
+  FAT_IO_STATISTICS               IoStatistics;
 };
 
 //
@@ -1759,6 +1826,33 @@ FatSetVolumeEntry (
 //
 // Hash.c
 //
+/**
+
+  Allocate the initial hash tables of the directory.
+
+  @param  ODir                  - The directory whose hash tables are allocated.
+
+  @retval EFI_SUCCESS           - The hash tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory to allocate the hash tables.
+
+**/
+EFI_STATUS
+FatCreateHashTable (
+  IN FAT_ODIR           *ODir
+  );
+
+/**
+
+  Free the hash tables of the directory.
+
+  @param  ODir                  - The directory whose hash tables are freed.
+
+**/
+VOID
+FatFreeHashTable (
+  IN FAT_ODIR           *ODir
+  );
+
 /**
 
   Search the long name hash table for the directory entry.
@@ -10,6 +10,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "Fat.h"
 
+#define FAT_FREE_BITMAP_TEST(Bitmap, Cluster)  (((Bitmap)[(Cluster) / 8] & (1 << ((Cluster) % 8))) != 0)
+#define FAT_FREE_BITMAP_SET(Bitmap, Cluster)   ((Bitmap)[(Cluster) / 8] |= (UINT8) (1 << ((Cluster) % 8)))
+#define FAT_FREE_BITMAP_CLEAR(Bitmap, Cluster) ((Bitmap)[(Cluster) / 8] &= (UINT8) ~(1 << ((Cluster) % 8)))
 
 /**
 
@@ -121,6 +124,126 @@ FatGetFatEntry (
   return Accum;
 }
 
+/**
+
+  Build the in-memory bitmap of free clusters from the FAT.
+
+  FAT16 and FAT32 tables are read in large chunks through the FAT cache instead
+  of entry by entry. The free cluster info of the volume is recomputed from the
+  same pass, so this also serves as FatComputeFreeInfo.
+
+  @param  Volume                - FAT file system volume.
+
+  @retval EFI_SUCCESS           - The bitmap is built.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory for the bitmap.
+  @retval EFI_DEVICE_ERROR      - An error occurred when reading the FAT.
+
+**/
+STATIC
+EFI_STATUS
+FatBuildFreeBitmap (
+  IN FAT_VOLUME       *Volume
+  )
+{
+  UINT8       *Bitmap;
+  UINT8       *Buffer;
+  UINTN       EntrySize;
+  UINTN       Index;
+  UINTN       Count;
+  UINTN       Cluster;
+  UINTN       FreeCount;
+  UINTN       NextFree;
+  UINTN       Entry;
+  EFI_STATUS  Status;
+
+  if (Volume->FreeBitmap != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Bitmap = AllocateZeroPool ((Volume->MaxCluster + 2 + 7) / 8);
+  if (Bitmap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status    = EFI_SUCCESS;
+  FreeCount = 0;
+  NextFree  = Volume->MaxCluster + 2;
+
+  if (Volume->FatType == Fat12) {
+    //
+    // FAT12 entries straddle byte boundaries and the whole FAT is only a few KB,
+    // so decode it entry by entry.
+    //
+    for (Cluster = FAT_MIN_CLUSTER; Cluster <= Volume->MaxCluster + 1; Cluster++) {
+      if (Volume->DiskError) {
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      if (FatGetFatEntry (Volume, Cluster) == FAT_CLUSTER_FREE) {
+        FAT_FREE_BITMAP_SET (Bitmap, Cluster);
+        FreeCount++;
+        NextFree = MIN (NextFree, Cluster);
+      }
+    }
+  } else {
+    Buffer = AllocatePool (FAT_FREE_BITMAP_SCAN_SIZE);
+    if (Buffer == NULL) {
+      FreePool (Bitmap);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    EntrySize = (Volume->FatType == Fat16) ? sizeof (UINT16) : sizeof (UINT32);
+    Cluster   = FAT_MIN_CLUSTER;
+    while (Cluster <= Volume->MaxCluster + 1) {
+      Count  = MIN (FAT_FREE_BITMAP_SCAN_SIZE / EntrySize, Volume->MaxCluster + 2 - Cluster);
+      Status = FatDiskIo (
+                 Volume,
+                 ReadFat,
+                 Volume->FatPos + MultU64x32 (Cluster, (UINT32) EntrySize),
+                 Count * EntrySize,
+                 Buffer,
+                 NULL
+                 );
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      for (Index = 0; Index < Count; Index++) {
+        if (EntrySize == sizeof (UINT16)) {
+          Entry = ((UINT16 *) Buffer)[Index];
+        } else {
+          Entry = ((UINT32 *) Buffer)[Index] & FAT_CLUSTER_MASK_FAT32;
+        }
+
+        if (Entry == FAT_CLUSTER_FREE) {
+          FAT_FREE_BITMAP_SET (Bitmap, Cluster + Index);
+          FreeCount++;
+          NextFree = MIN (NextFree, Cluster + Index);
+        }
+      }
+
+      Cluster += Count;
+    }
+
+    FreePool (Buffer);
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreePool (Bitmap);
+    return Status;
+  }
+
+  Volume->FreeBitmap                           = Bitmap;
+  Volume->FreeInfoValid                        = TRUE;
+  Volume->FatInfoSector.FreeInfo.ClusterCount  = (UINT32) FreeCount;
+  Volume->FatInfoSector.FreeInfo.NextCluster   = (UINT32) NextFree;
+  Volume->FatInfoSector.Signature              = FAT_INFO_SIGNATURE;
+  Volume->FatInfoSector.InfoBeginSignature     = FAT_INFO_BEGIN_SIGNATURE;
+  Volume->FatInfoSector.InfoEndSignature       = FAT_INFO_END_SIGNATURE;
+  return EFI_SUCCESS;
+}
+
 /**
 
   Set the FAT entry value of the volume, which is identified with the Index.
@@ -160,10 +283,16 @@ FatSetFatEntry (
     if (Index < Volume->FatInfoSector.FreeInfo.NextCluster) {
       Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) Index;
     }
+    if (Volume->FreeBitmap != NULL && Index <= Volume->MaxCluster + 1) {
+      FAT_FREE_BITMAP_SET (Volume->FreeBitmap, Index);
+    }
   } else if (Value != FAT_CLUSTER_FREE && OriginalVal == FAT_CLUSTER_FREE) {
     if (Volume->FatInfoSector.FreeInfo.ClusterCount != 0) {
       Volume->FatInfoSector.FreeInfo.ClusterCount -= 1;
     }
+    if (Volume->FreeBitmap != NULL && Index <= Volume->MaxCluster + 1) {
+      FAT_FREE_BITMAP_CLEAR (Volume->FreeBitmap, Index);
+    }
   }
   //
   // Make sure the entry is in memory
@@ -258,17 +387,199 @@ FatFreeClusters (
 
 /**
 
-  Allocate a free cluster and return the cluster index.
+  Count the free clusters in the bitmap starting at the given cluster.
 
   @param  Volume                - FAT file system volume.
+  @param  Cluster               - The first cluster of the run.
+  @param  Wanted                - Stop counting once this many clusters are found.
 
-  @return The index of the free cluster
+  @return The number of consecutive free clusters starting at Cluster.
+
+**/
+STATIC
+UINTN
+FatFreeRunLength (
+  IN FAT_VOLUME   *Volume,
+  IN UINTN        Cluster,
+  IN UINTN        Wanted
+  )
+{
+  UINTN Length;
+  UINTN End;
+
+  End    = Volume->MaxCluster + 2;
+  Length = 0;
+  while (Cluster + Length < End && Length < Wanted) {
+    //
+    // Step over fully free bytes at once
+    //
+    if (((Cluster + Length) % 8) == 0 && Cluster + Length + 8 <= End && Length + 8 <= Wanted &&
+        Volume->FreeBitmap[(Cluster + Length) / 8] == 0xFF) {
+      Length += 8;
+      continue;
+    }
+
+    if (!FAT_FREE_BITMAP_TEST (Volume->FreeBitmap, Cluster + Length)) {
+      break;
+    }
+
+    Length++;
+  }
+
+  return Length;
+}
+
+/**
+
+  Search the bitmap for a run of free clusters in the range [From, To).
+
+  @param  Volume                - FAT file system volume.
+  @param  From                  - The first cluster to search.
+  @param  To                    - The cluster after the last one to search.
+  @param  Wanted                - The number of clusters wanted.
+  @param  FirstFit              - Accept the first free run whatever its length.
+  @param  BestStart             - The start of the longest run found so far.
+  @param  BestLength            - The length of the longest run found so far.
+
+  @retval TRUE                  - A run satisfying the request is returned in BestStart.
+  @retval FALSE                 - BestStart holds the longest run found, which is too short.
+
+**/
+STATIC
+BOOLEAN
+FatSearchFreeRun (
+  IN     FAT_VOLUME   *Volume,
+  IN     UINTN        From,
+  IN     UINTN        To,
+  IN     UINTN        Wanted,
+  IN     BOOLEAN      FirstFit,
+  IN OUT UINTN        *BestStart,
+  IN OUT UINTN        *BestLength
+  )
+{
+  UINTN Cluster;
+  UINTN Length;
+
+  Cluster = From;
+  while (Cluster < To) {
+    //
+    // Skip fully allocated bytes at once
+    //
+    if (Volume->FreeBitmap[Cluster / 8] == 0) {
+      Cluster = (Cluster | 7) + 1;
+      continue;
+    }
+
+    if (!FAT_FREE_BITMAP_TEST (Volume->FreeBitmap, Cluster)) {
+      Cluster++;
+      continue;
+    }
+
+    Length = FatFreeRunLength (Volume, Cluster, Wanted);
+    if (FirstFit || Length >= Wanted) {
+      *BestStart  = Cluster;
+      *BestLength = Length;
+      return TRUE;
+    }
+
+    if (Length > *BestLength) {
+      *BestStart  = Cluster;
+      *BestLength = Length;
+    }
+
+    Cluster += Length;
+  }
+
+  return FALSE;
+}
+
+/**
+
+  Allocate a run of free clusters from the free cluster bitmap.
+
+  The clusters right after LastCluster are tried first so that a growing file
+  is extended in place. Otherwise the first run that covers the whole request
+  is used, searching from the free cluster hint and wrapping around once. If
+  no run is long enough, the longest free run is returned.
+
+  @param  Volume                - FAT file system volume.
+  @param  LastCluster           - The current last cluster of the file, or FAT_CLUSTER_FREE.
+  @param  Wanted                - The number of clusters wanted.
+  @param  FirstFit              - Accept the first free run whatever its length.
+  @param  RunLength             - The number of clusters in the returned run.
+
+  @return The first cluster of the run, or FAT_CLUSTER_LAST if the volume is full.
+
+**/
+STATIC
+UINTN
+FatAllocateClusterRun (
+  IN  FAT_VOLUME   *Volume,
+  IN  UINTN        LastCluster,
+  IN  UINTN        Wanted,
+  IN  BOOLEAN      FirstFit,
+  OUT UINTN        *RunLength
+  )
+{
+  UINTN Hint;
+  UINTN BestStart;
+  UINTN BestLength;
+
+  *RunLength = 0;
+  if (Volume->FatInfoSector.FreeInfo.ClusterCount == 0) {
+    return (UINTN) FAT_CLUSTER_LAST;
+  }
+
+  if (LastCluster >= FAT_MIN_CLUSTER && LastCluster <= Volume->MaxCluster &&
+      FAT_FREE_BITMAP_TEST (Volume->FreeBitmap, LastCluster + 1)) {
+    BestStart  = LastCluster + 1;
+    BestLength = FatFreeRunLength (Volume, BestStart, Wanted);
+  } else {
+    Hint = Volume->FatInfoSector.FreeInfo.NextCluster;
+    if (Hint < FAT_MIN_CLUSTER || Hint > Volume->MaxCluster + 1) {
+      Hint = FAT_MIN_CLUSTER;
+    }
+
+    BestStart  = (UINTN) FAT_CLUSTER_LAST;
+    BestLength = 0;
+    if (!FatSearchFreeRun (Volume, Hint, Volume->MaxCluster + 2, Wanted, FirstFit, &BestStart, &BestLength)) {
+      FatSearchFreeRun (Volume, FAT_MIN_CLUSTER, Hint, Wanted, FirstFit, &BestStart, &BestLength);
+    }
+
+    if (BestLength == 0) {
+      return (UINTN) FAT_CLUSTER_LAST;
+    }
+  }
+
+  Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) (BestStart + BestLength);
+  *RunLength = BestLength;
+  return BestStart;
+}
+
+/**
+
+  Allocate free clusters and return the index of the first one.
+
+  When the free cluster bitmap is available a run of consecutive clusters is
+  returned, otherwise a single cluster is found by walking the FAT.
+
+  @param  Volume                - FAT file system volume.
+  @param  LastCluster           - The current last cluster of the file, or FAT_CLUSTER_FREE.
+  @param  Wanted                - The number of clusters wanted.
+  @param  FirstFit              - Accept the first free run whatever its length.
+  @param  RunLength             - The number of consecutive clusters allocated.
+
+  @return The index of the first free cluster
 
 **/
 STATIC
 UINTN
 FatAllocateCluster (
-  IN FAT_VOLUME   *Volume
+  IN  FAT_VOLUME   *Volume,
+  IN  UINTN        LastCluster,
+  IN  UINTN        Wanted,
+  IN  BOOLEAN      FirstFit,
+  OUT UINTN        *RunLength
   )
 {
   UINTN Cluster;
@@ -280,6 +591,19 @@ FatAllocateCluster (
     return (UINTN) FAT_CLUSTER_LAST;
   }
 
+  //
+  // Build the free cluster bitmap on first use. If it cannot be built,
+  // fall back to searching the FAT.
+  //
+  if (Volume->FreeBitmap == NULL && !Volume->FreeBitmapFailed) {
+    Volume->FreeBitmapFailed = EFI_ERROR (FatBuildFreeBitmap (Volume));
+  }
+
+  if (Volume->FreeBitmap != NULL) {
+    return FatAllocateClusterRun (Volume, LastCluster, Wanted, FirstFit, RunLength);
+  }
+
+  *RunLength = 1;
   for (;;) {
     //
     // If the end of the list, return no available cluster
@@ -404,6 +728,11 @@ FatShrinkEof (
   OFile->FileLastCluster    = LastCluster;
   OFile->Dirty              = TRUE;
   //
+  // The freed clusters may be reused for a different chain with the same head
+  //
+  OFile->ClusterRunCovered  = 0;
+  OFile->ClusterRunCount    = 0;
+  //
   // Free the remaining cluster chain
   //
   return FatFreeClusters (Volume, Cluster);
@@ -436,6 +765,8 @@ FatGrowEof (
   UINTN       LastCluster;
   UINTN       NewCluster;
   UINTN       ClusterCount;
+  UINTN       RunLength;
+  BOOLEAN     FirstFit;
 
   //
   // For FAT file system, the max file is 4GB.
@@ -490,9 +821,10 @@ FatGrowEof (
     // Loop until we've allocated enough space
     //
     LastCluster = OFile->FileLastCluster;
+    FirstFit    = FALSE;
 
     while (CurSize < NewSize) {
-      NewCluster = FatAllocateCluster (Volume);
+      NewCluster = FatAllocateCluster (Volume, LastCluster, NewSize - CurSize, FirstFit, &RunLength);
       if (FAT_END_OF_FAT_CHAIN (NewCluster)) {
         if (LastCluster != FAT_CLUSTER_FREE) {
           FatSetFatEntry (Volume, LastCluster, (UINTN) FAT_CLUSTER_LAST);
@@ -503,25 +835,35 @@ FatGrowEof (
         goto Done;
       }
 
-      if (NewCluster < FAT_MIN_CLUSTER || NewCluster > Volume->MaxCluster + 1) {
+      if (NewCluster < FAT_MIN_CLUSTER || NewCluster + RunLength > Volume->MaxCluster + 2) {
         Status = EFI_VOLUME_CORRUPTED;
         goto Done;
       }
 
-      if (LastCluster != 0) {
-        FatSetFatEntry (Volume, LastCluster, NewCluster);
-      } else {
-        OFile->FileCluster        = NewCluster;
-        OFile->FileCurrentCluster = NewCluster;
+      //
+      // Once the free space cannot satisfy the rest of the request with one
+      // run, take free runs as they come instead of searching for the longest.
+      //
+      if (RunLength < NewSize - CurSize) {
+        FirstFit = TRUE;
       }
 
-      LastCluster = NewCluster;
-      CurSize += 1;
+      for (ClusterCount = 0; ClusterCount < RunLength; ClusterCount++, NewCluster++) {
+        if (LastCluster != 0) {
+          FatSetFatEntry (Volume, LastCluster, NewCluster);
+        } else {
+          OFile->FileCluster        = NewCluster;
+          OFile->FileCurrentCluster = NewCluster;
+        }
+
+        LastCluster = NewCluster;
+        CurSize += 1;
+      }
 
       //
       // Terminate the cluster list
       //
-      // Note that we must do this EVERY time we allocate a cluster, because
+      // Note that we must do this EVERY time we allocate a cluster run, because
       // FatAllocateCluster scans the FAT looking for a free cluster and
       // "LastCluster" is no longer free!  Usually, FatAllocateCluster will
       // start looking with the cluster after "LastCluster"; however, when
@@ -543,6 +885,108 @@ Done:
   return Status;
 }
 
+/**
+
+  Record the cluster at the given index of the file in the cluster run cache.
+
+  Only the cluster right after the covered part of the chain is recorded, so
+  the runs always describe a prefix of the chain. Recording stops once the
+  run array is full.
+
+  @param  OFile                 - The open file.
+  @param  FileIndex             - The index of the cluster within the file.
+  @param  Cluster               - The cluster at FileIndex.
+
+**/
+STATIC
+VOID
+FatRecordClusterRun (
+  IN FAT_OFILE            *OFile,
+  IN UINTN                FileIndex,
+  IN UINTN                Cluster
+  )
+{
+  FAT_CLUSTER_RUN *Run;
+
+  if (OFile->ClusterRunHead != OFile->FileCluster) {
+    OFile->ClusterRunHead    = OFile->FileCluster;
+    OFile->ClusterRunCovered = 0;
+    OFile->ClusterRunCount   = 0;
+  }
+
+  if (FileIndex != OFile->ClusterRunCovered ||
+      Cluster < FAT_MIN_CLUSTER || Cluster > OFile->Volume->MaxCluster + 1) {
+    return;
+  }
+
+  if (OFile->ClusterRunCount > 0) {
+    Run = &OFile->ClusterRuns[OFile->ClusterRunCount - 1];
+    if (Run->Cluster + Run->Length == Cluster) {
+      Run->Length++;
+      OFile->ClusterRunCovered++;
+      return;
+    }
+  }
+
+  if (OFile->ClusterRunCount == FAT_CLUSTER_RUN_CACHE_SIZE) {
+    return;
+  }
+
+  Run            = &OFile->ClusterRuns[OFile->ClusterRunCount++];
+  Run->FileIndex = FileIndex;
+  Run->Cluster   = Cluster;
+  Run->Length    = 1;
+  OFile->ClusterRunCovered++;
+}
+
+/**
+
+  Find the cluster at the given index of the file in the cluster run cache.
+
+  @param  OFile                 - The open file.
+  @param  FileIndex             - The index of the cluster within the file.
+  @param  Cluster               - The cluster at FileIndex.
+  @param  RunLeft               - The number of clusters from FileIndex to the end of its run.
+
+  @retval TRUE                  - The cluster is in the cache.
+  @retval FALSE                 - The cluster is not in the cache.
+
+**/
+STATIC
+BOOLEAN
+FatLookupClusterRun (
+  IN  FAT_OFILE           *OFile,
+  IN  UINTN               FileIndex,
+  OUT UINTN               *Cluster,
+  OUT UINTN               *RunLeft
+  )
+{
+  FAT_CLUSTER_RUN *Run;
+  UINTN           Low;
+  UINTN           High;
+  UINTN           Middle;
+
+  if (OFile->ClusterRunHead != OFile->FileCluster || FileIndex >= OFile->ClusterRunCovered) {
+    return FALSE;
+  }
+
+  Low  = 0;
+  High = OFile->ClusterRunCount - 1;
+  while (Low < High) {
+    Middle = (Low + High + 1) / 2;
+    if (OFile->ClusterRuns[Middle].FileIndex <= FileIndex) {
+      Low = Middle;
+    } else {
+      High = Middle - 1;
+    }
+  }
+
+  Run      = &OFile->ClusterRuns[Low];
+  *Cluster = Run->Cluster + (FileIndex - Run->FileIndex);
+  *RunLeft = Run->Length - (FileIndex - Run->FileIndex);
+  return TRUE;
+}
+
 /**
 
   Seek OFile to requested position, and calculate the number of
@@ -568,6 +1012,9 @@ FatOFilePosition (
   UINTN       Cluster;
   UINTN       StartPos;
   UINTN       Run;
+  UINTN       FileIndex;
+  UINTN       RunCluster;
+  UINTN       RunLeft;
 
   Volume      = OFile->Volume;
   ClusterSize = Volume->ClusterSize;
@@ -599,6 +1046,25 @@ FatOFilePosition (
     if (Position < StartPos || OFile->FileCluster == Cluster) {
       StartPos  = 0;
       Cluster   = OFile->FileCluster;
+      FatRecordClusterRun (OFile, 0, Cluster);
+    }
+
+    //
+    // Jump to the cluster if the cluster run cache knows it, or else to the
+    // end of the cached part of the chain if that is nearer.
+    //
+    FileIndex = Position >> Volume->ClusterAlignment;
+    if (FatLookupClusterRun (OFile, FileIndex, &RunCluster, &RunLeft)) {
+      Volume->IoStatistics.ClusterRunHits++;
+      StartPos = FileIndex << Volume->ClusterAlignment;
+      Cluster  = RunCluster;
+    } else {
+      Volume->IoStatistics.ClusterRunMisses++;
+      if (FatLookupClusterRun (OFile, OFile->ClusterRunCovered - 1, &RunCluster, &RunLeft) &&
+          ((OFile->ClusterRunCovered - 1) << Volume->ClusterAlignment) > StartPos) {
+        StartPos = (OFile->ClusterRunCovered - 1) << Volume->ClusterAlignment;
+        Cluster  = RunCluster;
+      }
     }
 
     while (StartPos + ClusterSize <= Position) {
@@ -609,6 +1075,7 @@ FatOFilePosition (
       }
 
       Cluster = FatGetFatEntry (Volume, Cluster);
+      FatRecordClusterRun (OFile, StartPos >> Volume->ClusterAlignment, Cluster);
     }
 
     if (Cluster < FAT_MIN_CLUSTER || Cluster > Volume->MaxCluster + 1) {
@@ -626,9 +1093,25 @@ FatOFilePosition (
     //
     Run = StartPos + ClusterSize - Position;
     if (!FAT_END_OF_FAT_CHAIN (Cluster)) {
+      //
+      // Clusters the run cache knows to be consecutive need no FAT lookup
+      //
+      FileIndex = StartPos >> Volume->ClusterAlignment;
+      if (FatLookupClusterRun (OFile, FileIndex, &RunCluster, &RunLeft) && RunCluster == Cluster) {
+        while (RunLeft > 1 && Run < PosLimit) {
+          Run     += ClusterSize;
+          Cluster += 1;
+          FileIndex++;
+          RunLeft--;
+          Volume->IoStatistics.FatLookupsSaved++;
+        }
+      }
+
       while ((FatGetFatEntry (Volume, Cluster) == Cluster + 1) && Run < PosLimit) {
         Run     += ClusterSize;
         Cluster += 1;
+        FileIndex++;
+        FatRecordClusterRun (OFile, FileIndex, Cluster);
       }
     }
   }
@@ -723,6 +1206,16 @@ FatComputeFreeInfo (
   // If we don't have valid info, compute it now
   //
   if (!Volume->FreeInfoValid) {
+    //
+    // Building the free cluster bitmap computes the free cluster info
+    // with a single pass over the FAT.
+    //
+    if (Volume->FreeBitmap == NULL && !Volume->FreeBitmapFailed) {
+      Volume->FreeBitmapFailed = EFI_ERROR (FatBuildFreeBitmap (Volume));
+      if (!Volume->FreeBitmapFailed) {
+        return;
+      }
+    }
 
     Volume->FreeInfoValid                        = TRUE;
     Volume->FatInfoSector.FreeInfo.ClusterCount  = 0;
@@ -14,7 +14,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
   @param  LongNameString        - The long name string to be hashed.
 
-  @return HashValue.
+  @return The full 32-bit hash value; callers mask it down to a bucket index.
 
 **/
 STATIC
@@ -33,7 +33,7 @@ FatHashLongName (
     );
   FatStrUpr (UpCasedLongFileName);
   gBS->CalculateCrc32 (UpCasedLongFileName, StrSize (UpCasedLongFileName), &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  return HashValue;
 }
 
 /**
@@ -42,7 +42,7 @@ FatHashLongName (
 
   @param  ShortNameString       - The short name string to be hashed.
 
-  @return HashValue
+  @return The full 32-bit hash value; callers mask it down to a bucket index.
 
 **/
 STATIC
@@ -53,7 +53,119 @@ FatHashShortName (
 {
   UINT32  HashValue;
   gBS->CalculateCrc32 (ShortNameString, FAT_NAME_LEN, &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  return HashValue;
+}
+
+/**
+
+  Allocate the initial hash tables of the directory.
+
+  @param  ODir                  - The directory whose hash tables are allocated.
+
+  @retval EFI_SUCCESS           - The hash tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory to allocate the hash tables.
+
+**/
+EFI_STATUS
+FatCreateHashTable (
+  IN FAT_ODIR       *ODir
+  )
+{
+  ODir->LongNameHashTable   = AllocateZeroPool (HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *));
+  ODir->ShortNameHashTable  = AllocateZeroPool (HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *));
+  if (ODir->LongNameHashTable == NULL || ODir->ShortNameHashTable == NULL) {
+    FatFreeHashTable (ODir);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ODir->HashTableMask = HASH_TABLE_MIN_SIZE - 1;
+  ODir->MemorySize   += 2 * HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Free the hash tables of the directory.
+
+  @param  ODir                  - The directory whose hash tables are freed.
+
+**/
+VOID
+FatFreeHashTable (
+  IN FAT_ODIR       *ODir
+  )
+{
+  if (ODir->LongNameHashTable != NULL) {
+    FreePool (ODir->LongNameHashTable);
+    ODir->LongNameHashTable = NULL;
+  }
+
+  if (ODir->ShortNameHashTable != NULL) {
+    FreePool (ODir->ShortNameHashTable);
+    ODir->ShortNameHashTable = NULL;
+  }
+}
+
+/**
+
+  Double the bucket count of the directory's hash tables and redistribute the
+  entries. The full hash values kept in each entry make this a pure relink;
+  no name is hashed again. If memory runs out the old tables are kept, which
+  only lengthens the chains.
+
+  @param  ODir                  - The directory whose hash tables are grown.
+
+**/
+STATIC
+VOID
+FatGrowHashTable (
+  IN FAT_ODIR       *ODir
+  )
+{
+  FAT_DIRENT  **LongNameHashTable;
+  FAT_DIRENT  **ShortNameHashTable;
+  FAT_DIRENT  *DirEnt;
+  FAT_DIRENT  *NextDirEnt;
+  UINT32      OldSize;
+  UINT32      NewMask;
+  UINT32      Index;
+
+  OldSize             = ODir->HashTableMask + 1;
+  NewMask             = OldSize * 2 - 1;
+  LongNameHashTable   = AllocateZeroPool (OldSize * 2 * sizeof (FAT_DIRENT *));
+  ShortNameHashTable  = AllocateZeroPool (OldSize * 2 * sizeof (FAT_DIRENT *));
+  if (LongNameHashTable == NULL || ShortNameHashTable == NULL) {
+    if (LongNameHashTable != NULL) {
+      FreePool (LongNameHashTable);
+    }
+
+    if (ShortNameHashTable != NULL) {
+      FreePool (ShortNameHashTable);
+    }
+
+    return;
+  }
+
+  for (Index = 0; Index < OldSize; Index++) {
+    for (DirEnt = ODir->LongNameHashTable[Index]; DirEnt != NULL; DirEnt = NextDirEnt) {
+      NextDirEnt                  = DirEnt->LongNameForwardLink;
+      DirEnt->LongNameForwardLink = LongNameHashTable[DirEnt->LongNameHash & NewMask];
+      LongNameHashTable[DirEnt->LongNameHash & NewMask] = DirEnt;
+    }
+
+    for (DirEnt = ODir->ShortNameHashTable[Index]; DirEnt != NULL; DirEnt = NextDirEnt) {
+      NextDirEnt                    = DirEnt->ShortNameForwardLink;
+      DirEnt->ShortNameForwardLink  = ShortNameHashTable[DirEnt->ShortNameHash & NewMask];
+      ShortNameHashTable[DirEnt->ShortNameHash & NewMask] = DirEnt;
+    }
+  }
+
+  FatFreeHashTable (ODir);
+  ODir->LongNameHashTable   = LongNameHashTable;
+  ODir->ShortNameHashTable  = ShortNameHashTable;
+  ODir->HashTableMask       = NewMask;
+  ODir->HashTableGrows++;
+  ODir->MemorySize         += 2 * OldSize * sizeof (FAT_DIRENT *);
 }
 
 /**
@@ -73,11 +185,17 @@ FatLongNameHashSearch (
   )
 {
   FAT_DIRENT  **PreviousHashNode;
-  for (PreviousHashNode   = &ODir->LongNameHashTable[FatHashLongName (LongNameString)];
+  UINT32      HashValue;
+
+  HashValue = FatHashLongName (LongNameString);
+  ODir->HashLookups++;
+  for (PreviousHashNode   = &ODir->LongNameHashTable[HashValue & ODir->HashTableMask];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->LongNameForwardLink
       ) {
-    if (FatStriCmp (LongNameString, (*PreviousHashNode)->FileString) == 0) {
+    ODir->HashProbes++;
+    if ((*PreviousHashNode)->LongNameHash == HashValue &&
+        FatStriCmp (LongNameString, (*PreviousHashNode)->FileString) == 0) {
       break;
     }
   }
@@ -102,11 +220,17 @@ FatShortNameHashSearch (
   )
 {
   FAT_DIRENT  **PreviousHashNode;
-  for (PreviousHashNode   = &ODir->ShortNameHashTable[FatHashShortName (ShortNameString)];
+  UINT32      HashValue;
+
+  HashValue = FatHashShortName (ShortNameString);
+  ODir->HashLookups++;
+  for (PreviousHashNode   = &ODir->ShortNameHashTable[HashValue & ODir->HashTableMask];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->ShortNameForwardLink
       ) {
-    if (CompareMem (ShortNameString, (*PreviousHashNode)->Entry.FileName, FAT_NAME_LEN) == 0) {
+    ODir->HashProbes++;
+    if ((*PreviousHashNode)->ShortNameHash == HashValue &&
+        CompareMem (ShortNameString, (*PreviousHashNode)->Entry.FileName, FAT_NAME_LEN) == 0) {
       break;
     }
   }
@@ -134,17 +258,25 @@ FatInsertToHashTable (
   //
   // Insert hash table index for short name
   //
-  HashTableIndex                = FatHashShortName (DirEnt->Entry.FileName);
+  DirEnt->ShortNameHash         = FatHashShortName (DirEnt->Entry.FileName);
+  HashTableIndex                = DirEnt->ShortNameHash & ODir->HashTableMask;
   HashTable                     = ODir->ShortNameHashTable;
   DirEnt->ShortNameForwardLink  = HashTable[HashTableIndex];
   HashTable[HashTableIndex]     = DirEnt;
   //
   // Insert hash table index for long name
   //
-  HashTableIndex                = FatHashLongName (DirEnt->FileString);
+  DirEnt->LongNameHash          = FatHashLongName (DirEnt->FileString);
+  HashTableIndex                = DirEnt->LongNameHash & ODir->HashTableMask;
   HashTable                     = ODir->LongNameHashTable;
   DirEnt->LongNameForwardLink   = HashTable[HashTableIndex];
   HashTable[HashTableIndex]     = DirEnt;
+
+  ODir->DirEntCount++;
+  ODir->MemorySize += sizeof (FAT_DIRENT) + StrSize (DirEnt->FileString);
+  if (ODir->DirEntCount > ODir->HashTableMask + 1 && ODir->HashTableMask + 1 < HASH_TABLE_MAX_SIZE) {
+    FatGrowHashTable (ODir);
+  }
 }
 
 /**
@@ -161,6 +293,31 @@ FatDeleteFromHashTable (
   IN FAT_DIRENT   *DirEnt
   )
 {
-  *FatShortNameHashSearch (ODir, DirEnt->Entry.FileName) = DirEnt->ShortNameForwardLink;
-  *FatLongNameHashSearch (ODir, DirEnt->FileString)      = DirEnt->LongNameForwardLink;
+  FAT_DIRENT  **PreviousHashNode;
+
+  //
+  // Unlink the node itself rather than the first node with the same name
+  //
+  PreviousHashNode = &ODir->ShortNameHashTable[DirEnt->ShortNameHash & ODir->HashTableMask];
+  while (*PreviousHashNode != NULL && *PreviousHashNode != DirEnt) {
+    PreviousHashNode = &(*PreviousHashNode)->ShortNameForwardLink;
+  }
+
+  ASSERT (*PreviousHashNode == DirEnt);
+  if (*PreviousHashNode != NULL) {
+    *PreviousHashNode = DirEnt->ShortNameForwardLink;
+  }
+
+  PreviousHashNode = &ODir->LongNameHashTable[DirEnt->LongNameHash & ODir->HashTableMask];
+  while (*PreviousHashNode != NULL && *PreviousHashNode != DirEnt) {
+    PreviousHashNode = &(*PreviousHashNode)->LongNameForwardLink;
+  }
+
+  ASSERT (*PreviousHashNode == DirEnt);
+  if (*PreviousHashNode != NULL) {
+    *PreviousHashNode = DirEnt->LongNameForwardLink;
+  }
+
+  ODir->DirEntCount--;
+  ODir->MemorySize -= sizeof (FAT_DIRENT) + StrSize (DirEnt->FileString);
 }
@@ -458,6 +458,26 @@ FatFreeVolume (
   IN FAT_VOLUME       *Volume
   )
 {
+  DEBUG ((
+    DEBUG_INFO,
+    "FAT volume: read-ahead %ld reads/%ld pages, direct I/O %ld reads/%ld writes/%ld bytes, "
+    "cluster runs %ld hits/%ld misses/%ld FAT lookups saved\n",
+    Volume->IoStatistics.ReadAheadReads,
+    Volume->IoStatistics.ReadAheadPages,
+    Volume->IoStatistics.DirectReads,
+    Volume->IoStatistics.DirectWrites,
+    Volume->IoStatistics.DirectBytes,
+    Volume->IoStatistics.ClusterRunHits,
+    Volume->IoStatistics.ClusterRunMisses,
+    Volume->IoStatistics.FatLookupsSaved
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "FAT volume: directory cache %ld hits/%ld misses/%ld evictions\n",
+    Volume->IoStatistics.DirCacheHits,
+    Volume->IoStatistics.DirCacheMisses,
+    Volume->IoStatistics.DirCacheEvictions
+    ));
   //
   // Free disk cache
   //
@@ -465,6 +485,12 @@ FatFreeVolume (
     FreePool (Volume->CacheBuffer);
   }
   //
+  // Free free cluster bitmap
+  //
+  if (Volume->FreeBitmap != NULL) {
+    FreePool (Volume->FreeBitmap);
+  }
+  //
   // Free directory cache
   //
   FatCleanupODirCache (Volume);
@@ -51,6 +51,9 @@ FatGetPosition (
 
   Set the file's position of the file.
 
+  Non-blocking requests take their position when they are queued, so the
+  position is moved without waiting for them to complete.
+
   @param  FHand                 - The handle of file.
   @param  Position              - The file's position of the file.
 
@@ -76,8 +79,6 @@ FatSetPosition (
     return EFI_DEVICE_ERROR;
   }
 
-  FatWaitNonblockingTask (IFile);
-
   //
   // If this is a directory, we can only set back to position 0
   //
@@ -564,6 +564,38 @@ DumpSmiChildContext (
   }
 }
 
+/**
+  Get the timing record of a SMI handler.
+
+  @param HandlerType      SMI handler type
+  @param HandlerCategory  SMI handler category
+  @param Handler          SMI handler address
+
+  @return SMI handler timing structure, NULL if the timing is not recorded.
+**/
+SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE *
+GetSmiHandlerTiming (
+  IN EFI_GUID          *HandlerType,
+  IN UINT32            HandlerCategory,
+  IN PHYSICAL_ADDRESS  Handler
+  )
+{
+  SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE  *TimingStruct;
+
+  TimingStruct = (VOID *)mSmiHandlerProfileDatabase;
+  while ((UINTN)TimingStruct < (UINTN)mSmiHandlerProfileDatabase + mSmiHandlerProfileDatabaseSize) {
+    if ((TimingStruct->Header.Signature == SMM_CORE_SMI_HANDLER_TIMING_SIGNATURE) &&
+        (TimingStruct->HandlerCategory == HandlerCategory) &&
+        (TimingStruct->Handler == Handler) &&
+        CompareGuid (&TimingStruct->HandlerType, HandlerType)) {
+      return TimingStruct;
+    }
+    TimingStruct = (VOID *)((UINTN)TimingStruct + TimingStruct->Header.Length);
+  }
+
+  return NULL;
+}
+
 /**
   Dump SMI handler in HandlerCategory.
 
@@ -578,6 +610,7 @@ DumpSmiHandler(
   SMM_CORE_SMI_HANDLER_STRUCTURE     *SmiHandlerStruct;
   UINTN                              Index;
   SMM_CORE_IMAGE_DATABASE_STRUCTURE  *ImageStruct;
+  SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE *TimingStruct;
   CHAR8                              *NameString;
 
   SmiStruct = (VOID *)mSmiHandlerProfileDatabase;
@@ -612,6 +645,10 @@ DumpSmiHandler(
           Print(L"         <RVA>0x%x</RVA>\n", (UINTN) (SmiHandlerStruct->CallerAddr - ImageStruct->ImageBase));
         }
         Print(L"      </Caller>\n", SmiHandlerStruct->Handler);
+        TimingStruct = GetSmiHandlerTiming (&SmiStruct->HandlerType, HandlerCategory, SmiHandlerStruct->Handler);
+        if ((TimingStruct != NULL) && (TimingStruct->InvocationCount != 0)) {
+          Print(L"      <Timing Invocations=\"%ld\" TotalTicks=\"%ld\" MaxTicks=\"%ld\" />\n", TimingStruct->InvocationCount, TimingStruct->TotalTicks, TimingStruct->MaxTicks);
+        }
         SmiHandlerStruct = (VOID *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length);
         Print(L"    </SmiHandler>\n");
       }
@@ -1228,28 +1228,25 @@ AhciStopCommand (
 }
 
 /**
-  Start command for give slot on specific port.
+  Start the command list DMA engine of specific port.
 
   @param  PciIo              The PCI IO protocol instance.
   @param  Port               The number of port.
-  @param  CommandSlot        The number of Command Slot.
   @param  Timeout            The timeout value of start, uses 100ns as a unit.
 
-  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_DEVICE_ERROR   The port start unsuccessfully.
   @retval EFI_TIMEOUT        The operation is time out.
-  @retval EFI_SUCCESS        The command start successfully.
+  @retval EFI_SUCCESS        The port start successfully.
 
 **/
 EFI_STATUS
 EFIAPI
-AhciStartCommand (
+AhciStartPort (
   IN  EFI_PCI_IO_PROTOCOL       *PciIo,
   IN  UINT8                     Port,
-  IN  UINT8                     CommandSlot,
   IN  UINT64                    Timeout
   )
 {
-  UINT32     CmdSlotBit;
   EFI_STATUS Status;
   UINT32     PortStatus;
   UINT32     StartCmd;
@@ -1262,8 +1259,6 @@ AhciStartCommand (
   //
   Capability = AhciReadReg(PciIo, EFI_AHCI_CAPABILITY_OFFSET);
 
-  CmdSlotBit = (UINT32) (1 << CommandSlot);
-
   AhciClearPortStatus (
     PciIo,
     Port
@@ -1310,6 +1305,42 @@ AhciStartCommand (
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   AhciOrReg (PciIo, Offset, EFI_AHCI_PORT_CMD_ST | StartCmd);
 
+  return EFI_SUCCESS;
+}
+
+/**
+  Start command for give slot on specific port.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  CommandSlot        The number of Command Slot.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The command start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartCommand (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT8                     CommandSlot,
+  IN  UINT64                    Timeout
+  )
+{
+  UINT32     CmdSlotBit;
+  EFI_STATUS Status;
+  UINT32     Offset;
+
+  CmdSlotBit = (UINT32) (1 << CommandSlot);
+
+  Status = AhciStartPort (PciIo, Port, Timeout);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   //
   // Setting the command
   //
@@ -1860,6 +1891,89 @@ AhciPacketCommandExecute (
   return Status;
 }
 
+/**
+  Allocate the per command slot tables used by native command queuing.
+
+  @param  PciIo                 The PCI IO protocol instance.
+  @param  AhciRegisters         The pointer to the EFI_AHCI_REGISTERS.
+  @param  Support64Bit          Whether the HBA supports 64-bit addressing.
+
+  @retval EFI_SUCCESS           The tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  The tables can't be allocated or mapped.
+  @retval EFI_DEVICE_ERROR      The tables are mapped above 4G but the HBA
+                                doesn't support 64-bit addressing.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciCreateNcqCommandTable (
+  IN     EFI_PCI_IO_PROTOCOL    *PciIo,
+  IN OUT EFI_AHCI_REGISTERS     *AhciRegisters,
+  IN     BOOLEAN                Support64Bit
+  )
+{
+  EFI_STATUS            Status;
+  UINTN                 Bytes;
+  VOID                  *Buffer;
+  UINT64                MaxNcqCommandTableSize;
+  EFI_PHYSICAL_ADDRESS  AhciNcqCommandTablePciAddr;
+
+  Buffer = NULL;
+  MaxNcqCommandTableSize = AhciRegisters->MaxCommandSlotNumber * sizeof (EFI_AHCI_NCQ_COMMAND_TABLE);
+
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    EFI_SIZE_TO_PAGES ((UINTN) MaxNcqCommandTableSize),
+                    &Buffer,
+                    0
+                    );
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem (Buffer, (UINTN)MaxNcqCommandTableSize);
+  Bytes  = (UINTN)MaxNcqCommandTableSize;
+
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Buffer,
+                    &Bytes,
+                    &AhciNcqCommandTablePciAddr,
+                    &AhciRegisters->MapNcqCommandTable
+                    );
+  if (EFI_ERROR (Status) || (Bytes != MaxNcqCommandTableSize)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Error2;
+  }
+
+  if ((!Support64Bit) && (AhciNcqCommandTablePciAddr > 0x100000000ULL)) {
+    Status = EFI_DEVICE_ERROR;
+    goto Error1;
+  }
+
+  AhciRegisters->AhciNcqCommandTable        = Buffer;
+  AhciRegisters->AhciNcqCommandTablePciAddr = (EFI_AHCI_NCQ_COMMAND_TABLE *)(UINTN)AhciNcqCommandTablePciAddr;
+  AhciRegisters->MaxNcqCommandTableSize     = MaxNcqCommandTableSize;
+  return EFI_SUCCESS;
+
+Error1:
+  PciIo->Unmap (
+           PciIo,
+           AhciRegisters->MapNcqCommandTable
+           );
+Error2:
+  PciIo->FreeBuffer (
+           PciIo,
+           EFI_SIZE_TO_PAGES ((UINTN) MaxNcqCommandTableSize),
+           Buffer
+           );
+  AhciRegisters->MapNcqCommandTable = NULL;
+  return Status;
+}
+
 /**
   Allocate transfer-related data struct which is used at AHCI mode.
 
@@ -2067,6 +2181,18 @@ AhciCreateTransferDescriptor (
   }
   AhciRegisters->AhciCommandTablePciAddr = (EFI_AHCI_COMMAND_TABLE *)(UINTN)AhciCommandTablePciAddr;
 
+  //
+  // Native command queuing needs a command table for every command slot. It is
+  // optional, so the HBA is still usable without it if the allocation fails.
+  //
+  AhciRegisters->MaxCommandSlotNumber = MaxCommandSlotNumber;
+  if ((Capability & EFI_AHCI_CAP_SNCQ) != 0) {
+    Status = AhciCreateNcqCommandTable (PciIo, AhciRegisters, Support64Bit);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_WARN, "AhciCreateTransferDescriptor: NCQ disabled - %r\n", Status));
+    }
+  }
+
   return EFI_SUCCESS;
   //
   // Map error or unable to map the whole CmdList buffer into a contiguous region.
@@ -2169,6 +2295,576 @@ AhciReadLogExt (
            );
 }
 
+/**
+  Issue a native command queuing command on specific port.
+
+  A free command slot is taken, its command table and command list entry are
+  built and the command is issued by setting PxSACT and PxCI. The port command
+  engine is started if no other queued command is outstanding on the port.
+
+  @param[in]   PciIo              The PCI IO protocol instance.
+  @param[in]   AhciRegisters      The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]   Port               The number of port.
+  @param[in]   PortMultiplier     The number of port multiplier.
+  @param[in]   Read               The transfer direction.
+  @param[in]   AtaCommandBlock    The EFI_ATA_COMMAND_BLOCK data.
+  @param[in]   MemoryAddr         The pointer to the data buffer.
+  @param[in]   DataCount          The data count to be transferred.
+  @param[in]   Timeout            The timeout value of start, uses 100ns as a unit.
+  @param[out]  CommandSlot        The command slot used by the command.
+  @param[out]  Map                The mapping of the data buffer.
+
+  @retval EFI_NOT_READY           No command slot is free.
+  @retval EFI_BAD_BUFFER_SIZE     The data buffer can't be mapped.
+  @retval EFI_SUCCESS             The command is issued.
+  @retval Others                  The port can't be started.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqIssue (
+  IN     EFI_PCI_IO_PROTOCOL        *PciIo,
+  IN OUT EFI_AHCI_REGISTERS         *AhciRegisters,
+  IN     UINT8                      Port,
+  IN     UINT8                      PortMultiplier,
+  IN     BOOLEAN                    Read,
+  IN     EFI_ATA_COMMAND_BLOCK      *AtaCommandBlock,
+  IN     VOID                       *MemoryAddr,
+  IN     UINT32                     DataCount,
+  IN     UINT64                     Timeout,
+  OUT    UINT8                      *CommandSlot,
+  OUT    VOID                       **Map
+  )
+{
+  EFI_STATUS                    Status;
+  UINT32                        FreeSlots;
+  UINT8                         Slot;
+  UINT32                        SlotBit;
+  EFI_PHYSICAL_ADDRESS          PhyAddr;
+  UINTN                         MapLength;
+  EFI_PCI_IO_PROTOCOL_OPERATION Flag;
+  EFI_AHCI_COMMAND_FIS          CFis;
+  EFI_AHCI_NCQ_COMMAND_TABLE    *CommandTable;
+  EFI_AHCI_COMMAND_LIST         *CommandList;
+  UINT32                        PrdtNumber;
+  UINT32                        PrdtIndex;
+  UINTN                         RemainedData;
+  UINTN                         MemAddr;
+  DATA_64                       Data64;
+  UINT32                        Offset;
+  EFI_TPL                       OldTpl;
+
+  //
+  // Blocking callers and the non-blocking task timer both issue commands.
+  // Stay at TPL_NOTIFY from taking the slot until PxSACT and PxCI are set, so
+  // that no other issue picks the same slot or sees the port idle while it is
+  // being started.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  //
+  // The slot number is the queue tag, so it has to stay below the queue depth
+  // of the device.
+  //
+  FreeSlots = ~AhciRegisters->NcqActiveSlots;
+  if (AhciRegisters->NcqDepth[Port] < EFI_AHCI_MAX_COMMAND_SLOTS) {
+    FreeSlots &= (((UINT32) BIT0) << AhciRegisters->NcqDepth[Port]) - 1;
+  }
+  if (FreeSlots == 0) {
+    gBS->RestoreTPL (OldTpl);
+    return EFI_NOT_READY;
+  }
+
+  Slot    = (UINT8) LowBitSet32 (FreeSlots);
+  SlotBit = ((UINT32) BIT0) << Slot;
+
+  if (Read) {
+    Flag = EfiPciIoOperationBusMasterWrite;
+  } else {
+    Flag = EfiPciIoOperationBusMasterRead;
+  }
+
+  MapLength = DataCount;
+  Status = PciIo->Map (
+                    PciIo,
+                    Flag,
+                    MemoryAddr,
+                    &MapLength,
+                    &PhyAddr,
+                    Map
+                    );
+  if (EFI_ERROR (Status) || (DataCount != MapLength)) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, *Map);
+    }
+    gBS->RestoreTPL (OldTpl);
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  //
+  // The queue tag goes into bits 7:3 of the Count field, the sector count of
+  // FPDMA commands is carried in the Features field.
+  //
+  AhciBuildCommandFis (&CFis, AtaCommandBlock);
+  CFis.AhciCFisPmNum    = PortMultiplier;
+  CFis.AhciCFisSecCount = (UINT8) (Slot << 3);
+  CFis.AhciCFisDevHead  = (UINT8) ((AtaCommandBlock->AtaDeviceHead & BIT7) | BIT6);
+
+  CommandTable = &AhciRegisters->AhciNcqCommandTable[Slot];
+  ZeroMem (CommandTable, sizeof (EFI_AHCI_NCQ_COMMAND_TABLE));
+  CopyMem (&CommandTable->CommandFis, &CFis, sizeof (EFI_AHCI_COMMAND_FIS));
+
+  PrdtNumber   = (DataCount + EFI_AHCI_MAX_DATA_PER_PRDT - 1) / EFI_AHCI_MAX_DATA_PER_PRDT;
+  RemainedData = (UINTN) DataCount;
+  MemAddr      = (UINTN) PhyAddr;
+  for (PrdtIndex = 0; PrdtIndex < PrdtNumber; PrdtIndex++) {
+    if (RemainedData < EFI_AHCI_MAX_DATA_PER_PRDT) {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
+    } else {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
+    }
+
+    Data64.Uint64 = (UINT64)MemAddr;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
+    RemainedData -= EFI_AHCI_MAX_DATA_PER_PRDT;
+    MemAddr      += EFI_AHCI_MAX_DATA_PER_PRDT;
+  }
+  CommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
+
+  CommandList = &AhciRegisters->AhciCmdList[Slot];
+  ZeroMem (CommandList, sizeof (EFI_AHCI_COMMAND_LIST));
+  CommandList->AhciCmdCfl   = EFI_AHCI_FIS_REGISTER_H2D_LENGTH / 4;
+  CommandList->AhciCmdW     = Read ? 0 : 1;
+  CommandList->AhciCmdPmp   = PortMultiplier;
+  CommandList->AhciCmdPrdtl = PrdtNumber;
+
+  Data64.Uint64 = (UINT64)(UINTN) &AhciRegisters->AhciNcqCommandTablePciAddr[Slot];
+  CommandList->AhciCmdCtba  = Data64.Uint32.Lower32;
+  CommandList->AhciCmdCtbau = Data64.Uint32.Upper32;
+
+  //
+  // Start the port if this is the first queued command on it. PxSACT may only
+  // be set while PxCMD.ST is set, and has to be set before PxCI.
+  //
+  if (AhciRegisters->NcqPortSlots[Port] == 0) {
+    ZeroMem ((UINT8 *) AhciRegisters->AhciRFis + sizeof (EFI_AHCI_RECEIVED_FIS) * Port, sizeof (EFI_AHCI_RECEIVED_FIS));
+
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
+    AhciAndReg (PciIo, Offset, (UINT32)~(EFI_AHCI_PORT_CMD_DLAE | EFI_AHCI_PORT_CMD_ATAPI));
+
+    Status = AhciStartPort (PciIo, Port, Timeout);
+    if (EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, *Map);
+      gBS->RestoreTPL (OldTpl);
+      return Status;
+    }
+  }
+
+  AhciRegisters->NcqActiveSlots     |= SlotBit;
+  AhciRegisters->NcqPortSlots[Port] |= SlotBit;
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+  AhciWriteReg (PciIo, Offset, SlotBit);
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+  AhciWriteReg (PciIo, Offset, SlotBit);
+  gBS->RestoreTPL (OldTpl);
+
+  *CommandSlot = Slot;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether a native command queuing command has completed.
+
+  @param[in]  PciIo              The PCI IO protocol instance.
+  @param[in]  Port               The number of port.
+  @param[in]  CommandSlot        The command slot used by the command.
+
+  @retval EFI_SUCCESS            The command completed successfully.
+  @retval EFI_NOT_READY          The command is still outstanding.
+  @retval EFI_DEVICE_ERROR       The device reported an error, which aborts all
+                                 queued commands outstanding on the port.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqCheck (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT8                     CommandSlot
+  )
+{
+  UINT32     SlotBit;
+  UINT32     Offset;
+  UINT32     Value;
+
+  SlotBit = ((UINT32) BIT0) << CommandSlot;
+
+  //
+  // The device clears the PxSACT bit with a Set Device Bits FIS when the
+  // command completes successfully.
+  //
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+  Value  = AhciReadReg (PciIo, Offset);
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+  Value |= AhciReadReg (PciIo, Offset);
+  if ((Value & SlotBit) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+  if ((AhciReadReg (PciIo, Offset) & EFI_AHCI_PORT_IS_TFES) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+  if ((AhciReadReg (PciIo, Offset) & EFI_AHCI_PORT_TFD_ERR) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_NOT_READY;
+}
+
+/**
+  Release the command slot of a native command queuing command. The port is
+  stopped once no queued command is outstanding on it any more.
+
+  @param[in]  PciIo              The PCI IO protocol instance.
+  @param[in]  AhciRegisters      The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]  Port               The number of port.
+  @param[in]  CommandSlot        The command slot used by the command.
+  @param[in]  Timeout            The timeout value of stop, uses 100ns as a unit.
+
+**/
+VOID
+EFIAPI
+AhciNcqReleaseSlot (
+  IN     EFI_PCI_IO_PROTOCOL        *PciIo,
+  IN OUT EFI_AHCI_REGISTERS         *AhciRegisters,
+  IN     UINT8                      Port,
+  IN     UINT8                      CommandSlot,
+  IN     UINT64                     Timeout
+  )
+{
+  UINT32     SlotBit;
+  EFI_TPL    OldTpl;
+
+  SlotBit = ((UINT32) BIT0) << CommandSlot;
+
+  //
+  // Pairs with AhciNcqIssue(): the slot masks and the port state change
+  // together at TPL_NOTIFY.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  AhciRegisters->NcqActiveSlots     &= ~SlotBit;
+  AhciRegisters->NcqPortSlots[Port] &= ~SlotBit;
+
+  if (AhciRegisters->NcqPortSlots[Port] == 0) {
+    AhciStopCommand (
+      PciIo,
+      Port,
+      Timeout
+      );
+
+    AhciDisableFisReceive (
+      PciIo,
+      Port,
+      Timeout
+      );
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Take a device out of the NCQ error state.
+
+  After reporting an error for a queued command the device rejects new queued
+  commands until the NCQ Command Error log is read. All queued commands must
+  have been aborted and the port stopped before calling this function.
+
+  @param[in]  PciIo              The PCI IO protocol instance.
+  @param[in]  AhciRegisters      The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]  Port               The number of port.
+
+**/
+VOID
+EFIAPI
+AhciNcqRecover (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  EFI_AHCI_REGISTERS        *AhciRegisters,
+  IN  UINT8                     Port
+  )
+{
+  EFI_STATUS Status;
+  UINT32     Offset;
+  UINT8      LogData[512];
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+  if ((AhciReadReg (PciIo, Offset) & EFI_AHCI_PORT_TFD_ERR) == 0) {
+    return;
+  }
+
+  AhciClearPortStatus (PciIo, Port);
+  Status = AhciReadLogExt (PciIo, AhciRegisters, Port, 0, LogData, 0x10, 0);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Port [%d] NCQ error recovery, read NCQ error log - %r\n", Port, Status));
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Port [%d] NCQ error recovery, NCQ error log tag 0x%x\n",
+    Port,
+    LogData[0] & 0x1F
+    ));
+}
+
+/**
+  Start a native command queuing (READ/WRITE FPDMA QUEUED) transfer on specific
+  port.
+
+  Queued commands on the same or other ports may be outstanding at the same
+  time, each in its own command slot. In non-blocking mode the first call issues
+  the command and later calls poll it for completion.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The number of port multiplier.
+  @param[in]       Read                The transfer direction.
+  @param[in]       AtaCommandBlock     The EFI_ATA_COMMAND_BLOCK data.
+  @param[in, out]  AtaStatusBlock      The EFI_ATA_STATUS_BLOCK data.
+  @param[in, out]  MemoryAddr          The pointer to the data buffer.
+  @param[in]       DataCount           The data count to be transferred.
+  @param[in]       Timeout             The timeout value of data transfer, uses 100ns as a unit.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_DEVICE_ERROR    The queued transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_NOT_READY       Non-blocking mode only. The command is still in
+                              flight, or no command slot is free to issue it.
+  @retval EFI_UNSUPPORTED     The device on the port doesn't support NCQ.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer is too large or can't be mapped.
+  @retval EFI_SUCCESS         The queued transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     EFI_AHCI_REGISTERS           *AhciRegisters,
+  IN     UINT8                        Port,
+  IN     UINT8                        PortMultiplier,
+  IN     BOOLEAN                      Read,
+  IN     EFI_ATA_COMMAND_BLOCK        *AtaCommandBlock,
+  IN OUT EFI_ATA_STATUS_BLOCK         *AtaStatusBlock,
+  IN OUT VOID                         *MemoryAddr,
+  IN     UINT32                       DataCount,
+  IN     UINT64                       Timeout,
+  IN     ATA_NONBLOCK_TASK            *Task
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_PCI_IO_PROTOCOL           *PciIo;
+  EFI_TPL                       OldTpl;
+  UINT8                         Slot;
+  VOID                          *Map;
+  UINT64                        Delay;
+
+  PciIo = Instance->PciIo;
+
+  if (PciIo == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (AhciRegisters->NcqDepth[Port] == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((DataCount == 0) || (DataCount > EFI_AHCI_NCQ_MAX_PRDT * EFI_AHCI_MAX_DATA_PER_PRDT)) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  //
+  // Before starting the Blocking BlockIO operation, push to finish all non-blocking
+  // BlockIO tasks.
+  // Delay 100us to simulate the blocking time out checking.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  while ((Task == NULL) && (!IsListEmpty (&Instance->NonBlockingTaskList))) {
+    AsyncNonBlockingTransferRoutine (NULL, Instance);
+    //
+    // Stall for 100us.
+    //
+    MicroSecondDelay (100);
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if ((Task == NULL) || !Task->IsStart) {
+    Status = AhciNcqIssue (
+               PciIo,
+               AhciRegisters,
+               Port,
+               PortMultiplier,
+               Read,
+               AtaCommandBlock,
+               MemoryAddr,
+               DataCount,
+               Timeout,
+               &Slot,
+               &Map
+               );
+    if (EFI_ERROR (Status)) {
+      //
+      // EFI_NOT_READY leaves the task unstarted, it is issued again once a
+      // command slot is released.
+      //
+      return Status;
+    }
+
+    if (Task != NULL) {
+      Task->IsStart = TRUE;
+      Task->NcqSlot = Slot;
+      Task->Map     = Map;
+    }
+  } else {
+    Slot = Task->NcqSlot;
+    Map  = Task->Map;
+  }
+
+  if (Task != NULL) {
+    //
+    // For Non-blocking
+    //
+    Task->RetryTimes--;
+    Status = AhciNcqCheck (PciIo, Port, Slot);
+    if (Status == EFI_NOT_READY) {
+      if (Task->InfiniteWait || (Task->RetryTimes != 0)) {
+        return EFI_NOT_READY;
+      }
+      Status = EFI_TIMEOUT;
+    }
+
+    if (EFI_ERROR (Status)) {
+      //
+      // The other queued commands on the port are aborted as well. Leave the
+      // slot and the mapping to AhciNcqAbort(), which the caller runs for all
+      // of them.
+      //
+      Task->Packet->Asb->AtaStatus = 0x01;
+      AhciDumpPortStatus (PciIo, AhciRegisters, Port, AtaStatusBlock);
+      return Status;
+    }
+  } else {
+    Delay = DivU64x32 (Timeout, 1000) + 1;
+    do {
+      Status = AhciNcqCheck (PciIo, Port, Slot);
+      if (Status != EFI_NOT_READY) {
+        break;
+      }
+
+      //
+      // Stall for 100 microseconds.
+      //
+      MicroSecondDelay (100);
+
+      Delay--;
+    } while ((Timeout == 0) || (Delay > 0));
+
+    if (Status == EFI_NOT_READY) {
+      Status = EFI_TIMEOUT;
+    }
+
+    if (EFI_ERROR (Status)) {
+      AhciStopCommand (PciIo, Port, Timeout);
+    }
+  }
+
+  AhciNcqReleaseSlot (PciIo, AhciRegisters, Port, Slot, Timeout);
+
+  PciIo->Unmap (PciIo, Map);
+  if (Task != NULL) {
+    Task->Map = NULL;
+  }
+
+  AhciDumpPortStatus (PciIo, AhciRegisters, Port, AtaStatusBlock);
+
+  if (EFI_ERROR (Status) && (AhciRegisters->NcqActiveSlots == 0)) {
+    AhciNcqRecover (PciIo, AhciRegisters, Port);
+  }
+
+  return Status;
+}
+
+/**
+  Abort all native command queuing commands in flight.
+
+  The ports with queued commands outstanding are stopped, the data buffers of
+  the in-flight non-blocking tasks are unmapped and the devices that reported
+  an error are taken out of the NCQ error state. The tasks themselves stay in
+  the non-blocking task list for the caller to fail.
+
+  @param[in]  Instance    A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqAbort (
+  IN ATA_ATAPI_PASS_THRU_INSTANCE *Instance
+  )
+{
+  EFI_PCI_IO_PROTOCOL          *PciIo;
+  EFI_AHCI_REGISTERS           *AhciRegisters;
+  LIST_ENTRY                   *Entry;
+  ATA_NONBLOCK_TASK            *Task;
+  UINT32                       AbortedPorts;
+  UINT8                        Port;
+  EFI_TPL                      OldTpl;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (AhciRegisters->NcqActiveSlots == 0) {
+    gBS->RestoreTPL (OldTpl);
+    return;
+  }
+
+  //
+  // Stopping the port clears PxSACT and PxCI, after that the HBA doesn't touch
+  // the data buffers of the queued commands any more.
+  //
+  AbortedPorts = 0;
+  for (Port = 0; Port < EFI_AHCI_MAX_PORTS; Port++) {
+    if (AhciRegisters->NcqPortSlots[Port] != 0) {
+      AbortedPorts |= ((UINT32) BIT0) << Port;
+      AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+      AhciDisableFisReceive (PciIo, Port, ATA_ATAPI_TIMEOUT);
+      AhciRegisters->NcqPortSlots[Port] = 0;
+    }
+  }
+  AhciRegisters->NcqActiveSlots = 0;
+
+  for (Entry = GetFirstNode (&Instance->NonBlockingTaskList);
+       !IsNull (&Instance->NonBlockingTaskList, Entry);
+       Entry = GetNextNode (&Instance->NonBlockingTaskList, Entry)) {
+    Task = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    if ((Task->Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) && Task->IsStart && (Task->Map != NULL)) {
+      PciIo->Unmap (PciIo, Task->Map);
+      Task->Map = NULL;
+    }
+  }
+
+  for (Port = 0; Port < EFI_AHCI_MAX_PORTS; Port++) {
+    if ((AbortedPorts & (((UINT32) BIT0) << Port)) != 0) {
+      AhciNcqRecover (PciIo, AhciRegisters, Port);
+    }
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
 /**
   Enable DEVSLP of the disk if supported.
 
@@ -2780,6 +3476,18 @@ AhciModeInitialization (
         continue;
       }
 
+      //
+      // Record the NCQ queue depth of a hard disk. Word 76 bit 8 reports NCQ
+      // support and word 75 the maximum queue depth minus one.
+      //
+      AhciRegisters->NcqDepth[Port] = 0;
+      if ((DeviceType == EfiIdeHarddisk) && (AhciRegisters->AhciNcqCommandTable != NULL) &&
+          (Buffer.AtaData.serial_ata_capabilities != 0xFFFF) &&
+          ((Buffer.AtaData.serial_ata_capabilities & BIT8) != 0)) {
+        AhciRegisters->NcqDepth[Port] = (UINT8) MIN ((Buffer.AtaData.queue_depth & 0x1F) + 1, AhciRegisters->MaxCommandSlotNumber);
+        DEBUG ((DEBUG_INFO, "Port [%d] NCQ queue depth %d\n", Port, AhciRegisters->NcqDepth[Port]));
+      }
+
       //
       // Found a ATA or ATAPI device, add it into the device list.
       //
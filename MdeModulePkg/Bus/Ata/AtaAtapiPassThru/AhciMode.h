@@ -13,6 +13,7 @@
 #define EFI_AHCI_CAPABILITY_OFFSET             0x0000
 #define   EFI_AHCI_CAP_SAM                     BIT18
 #define   EFI_AHCI_CAP_SSS                     BIT27
+#define   EFI_AHCI_CAP_SNCQ                    BIT30
 #define   EFI_AHCI_CAP_S64A                    BIT31
 #define EFI_AHCI_GHC_OFFSET                    0x0004
 #define   EFI_AHCI_GHC_RESET                   BIT0
@@ -22,6 +23,7 @@
 #define EFI_AHCI_PI_OFFSET                     0x000C
 
 #define EFI_AHCI_MAX_PORTS                     32
+#define EFI_AHCI_MAX_COMMAND_SLOTS             32
 
 #define AHCI_CAPABILITY2_OFFSET                0x0024
 #define   AHCI_CAP2_SDS                        BIT3
@@ -272,6 +274,20 @@ typedef struct {
   EFI_AHCI_COMMAND_PRDT     PrdtTable[65535];     // The scatter/gather list for data transfer
 } EFI_AHCI_COMMAND_TABLE;
 
+//
+// Command table used by a native command queuing (NCQ) command slot.
+// 64 PRDT entries of 4M bytes cover the largest 48-bit transfer even with
+// 4K logical blocks, and keep every table 128 bytes aligned in the array.
+//
+#define EFI_AHCI_NCQ_MAX_PRDT                  64
+
+typedef struct {
+  EFI_AHCI_COMMAND_FIS      CommandFis;       // A software constructed FIS.
+  EFI_AHCI_ATAPI_COMMAND    AtapiCmd;         // 12 or 16 bytes ATAPI cmd.
+  UINT8                     Reserved[0x30];
+  EFI_AHCI_COMMAND_PRDT     PrdtTable[EFI_AHCI_NCQ_MAX_PRDT];
+} EFI_AHCI_NCQ_COMMAND_TABLE;
+
 //
 // Received FIS structure
 //
@@ -311,6 +327,21 @@ typedef struct {
   VOID                      *MapRFis;
   VOID                      *MapCmdList;
   VOID                      *MapCommandTable;
+  //
+  // One command table per command slot for native command queuing. The command
+  // list is shared by all ports, so command slots are handed out controller wide:
+  // NcqActiveSlots holds the slots in use and NcqPortSlots the ones outstanding
+  // on each port. NcqDepth is the queue depth usable on a port, 0 if the device
+  // or the HBA doesn't support NCQ.
+  //
+  EFI_AHCI_NCQ_COMMAND_TABLE *AhciNcqCommandTable;
+  EFI_AHCI_NCQ_COMMAND_TABLE *AhciNcqCommandTablePciAddr;
+  UINT64                    MaxNcqCommandTableSize;
+  VOID                      *MapNcqCommandTable;
+  UINT8                     MaxCommandSlotNumber;
+  UINT32                    NcqActiveSlots;
+  UINT32                    NcqPortSlots[EFI_AHCI_MAX_PORTS];
+  UINT8                     NcqDepth[EFI_AHCI_MAX_PORTS];
 } EFI_AHCI_REGISTERS;
 
 /**
@@ -338,6 +369,26 @@ AhciPacketCommandExecute (
   IN  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET    *Packet
   );
 
+/**
+  Start the command list DMA engine of specific port.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The port start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The port start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartPort (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT64                    Timeout
+  );
+
 /**
   Start command for give slot on specific port.
 
@@ -367,6 +367,37 @@ AtaPassThruPassThruExecute (
                      Task
                      );
           break;
+        case EFI_ATA_PASS_THRU_PROTOCOL_FPDMA:
+          if (Packet->InTransferLength != 0) {
+            Status = AhciNcqTransfer (
+                       Instance,
+                       &Instance->AhciRegisters,
+                       (UINT8)Port,
+                       (UINT8)PortMultiplierPort,
+                       TRUE,
+                       Packet->Acb,
+                       Packet->Asb,
+                       Packet->InDataBuffer,
+                       Packet->InTransferLength,
+                       Packet->Timeout,
+                       Task
+                       );
+          } else {
+            Status = AhciNcqTransfer (
+                       Instance,
+                       &Instance->AhciRegisters,
+                       (UINT8)Port,
+                       (UINT8)PortMultiplierPort,
+                       FALSE,
+                       Packet->Acb,
+                       Packet->Asb,
+                       Packet->OutDataBuffer,
+                       Packet->OutTransferLength,
+                       Packet->Timeout,
+                       Task
+                       );
+          }
+          break;
         default :
           return EFI_UNSUPPORTED;
       }
@@ -400,19 +431,23 @@ AsyncNonBlockingTransferRoutine (
   ATA_NONBLOCK_TASK            *Task;
   EFI_STATUS                   Status;
   ATA_ATAPI_PASS_THRU_INSTANCE *Instance;
+  BOOLEAN                      IsQueued;
 
   Instance   = (ATA_ATAPI_PASS_THRU_INSTANCE *) Context;
   EntryHeader = &Instance->NonBlockingTaskList;
   //
   // Get the Taks from the Taks List and execute it, until there is
   // no task in the list or the device is busy with task (EFI_NOT_READY).
-  //
-  while (TRUE) {
-    if (!IsListEmpty (EntryHeader)) {
-      Entry = GetFirstNode (EntryHeader);
-      Task  = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
-    } else {
-      return;
+  // Queued (FPDMA) commands don't wait for the queued commands ahead of them,
+  // so keep walking the list while only queued commands are in flight. Any
+  // other command only runs once it is at the head of the list.
+  //
+  Entry = GetFirstNode (EntryHeader);
+  while (!IsNull (EntryHeader, Entry)) {
+    Task     = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    IsQueued = (BOOLEAN) (Task->Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA);
+    if (!IsQueued && (Entry != GetFirstNode (EntryHeader))) {
+      break;
     }
 
     Status = AtaPassThruPassThruExecute (
@@ -428,6 +463,9 @@ AsyncNonBlockingTransferRoutine (
     // associated with one task from Ata Bus and signal the event with error status.
     //
     if ((Status != EFI_NOT_READY) && (Status != EFI_SUCCESS)) {
+      if (Instance->Mode == EfiAtaAhciMode) {
+        AhciNcqAbort (Instance);
+      }
       DestroyAsynTaskList (Instance, TRUE);
       break;
     }
@@ -435,10 +473,16 @@ AsyncNonBlockingTransferRoutine (
     //
     // For Non blocking mode, the Status of EFI_NOT_READY means the operation
     // is not finished yet. Otherwise the operation is successful.
+    // A queued command in flight lets the commands behind it proceed, a queued
+    // command that didn't get a free command slot doesn't.
     //
     if (Status == EFI_NOT_READY) {
-      break;
+      if (!IsQueued || !Task->IsStart) {
+        break;
+      }
+      Entry = GetNextNode (EntryHeader, Entry);
     } else {
+      Entry = GetNextNode (EntryHeader, Entry);
       RemoveEntryList (&Task->Link);
       gBS->SignalEvent (Task->Event);
       FreePool (Task);
@@ -917,6 +961,9 @@ AtaAtapiPassThruStop (
     gBS->CloseEvent (Instance->TimerEvent);
     Instance->TimerEvent = NULL;
   }
+  if (Instance->Mode == EfiAtaAhciMode) {
+    AhciNcqAbort (Instance);
+  }
   DestroyAsynTaskList (Instance, FALSE);
   //
   // Free allocated resource
@@ -941,6 +988,17 @@ AtaAtapiPassThruStop (
   //
   if (Instance->Mode == EfiAtaAhciMode) {
     AhciRegisters = &Instance->AhciRegisters;
+    if (AhciRegisters->AhciNcqCommandTable != NULL) {
+      PciIo->Unmap (
+               PciIo,
+               AhciRegisters->MapNcqCommandTable
+               );
+      PciIo->FreeBuffer (
+               PciIo,
+               EFI_SIZE_TO_PAGES ((UINTN) AhciRegisters->MaxNcqCommandTableSize),
+               AhciRegisters->AhciNcqCommandTable
+               );
+    }
     PciIo->Unmap (
              PciIo,
              AhciRegisters->MapCommandTable
@@ -138,6 +138,7 @@ struct _ATA_NONBLOCK_TASK {
   VOID                              *TableMap;       // Pointer to PRD table map.
   EFI_ATA_DMA_PRD                   *MapBaseAddress; //  Pointer to range Base address for Map.
   UINTN                             PageCount;       //  The page numbers used by PCIO freebuffer.
+  UINT8                             NcqSlot;         //  The command slot used by a queued (FPDMA) command.
 };
 
 //
@@ -1149,6 +1150,69 @@ AhciDmaTransfer (
   IN     ATA_NONBLOCK_TASK            *Task
   );
 
+/**
+  Start a native command queuing (READ/WRITE FPDMA QUEUED) transfer on specific
+  port.
+
+  Queued commands on the same or other ports may be outstanding at the same
+  time, each in its own command slot. In non-blocking mode the first call issues
+  the command and later calls poll it for completion.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The number of port multiplier.
+  @param[in]       Read                The transfer direction.
+  @param[in]       AtaCommandBlock     The EFI_ATA_COMMAND_BLOCK data.
+  @param[in, out]  AtaStatusBlock      The EFI_ATA_STATUS_BLOCK data.
+  @param[in, out]  MemoryAddr          The pointer to the data buffer.
+  @param[in]       DataCount           The data count to be transferred.
+  @param[in]       Timeout             The timeout value of data transfer, uses 100ns as a unit.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_DEVICE_ERROR    The queued transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_NOT_READY       Non-blocking mode only. The command is still in
+                              flight, or no command slot is free to issue it.
+  @retval EFI_UNSUPPORTED     The device on the port doesn't support NCQ.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer is too large or can't be mapped.
+  @retval EFI_SUCCESS         The queued transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     EFI_AHCI_REGISTERS           *AhciRegisters,
+  IN     UINT8                        Port,
+  IN     UINT8                        PortMultiplier,
+  IN     BOOLEAN                      Read,
+  IN     EFI_ATA_COMMAND_BLOCK        *AtaCommandBlock,
+  IN OUT EFI_ATA_STATUS_BLOCK         *AtaStatusBlock,
+  IN OUT VOID                         *MemoryAddr,
+  IN     UINT32                       DataCount,
+  IN     UINT64                       Timeout,
+  IN     ATA_NONBLOCK_TASK            *Task
+  );
+
+/**
+  Abort all native command queuing commands in flight.
+
+  The ports with queued commands outstanding are stopped, the data buffers of
+  the in-flight non-blocking tasks are unmapped and the devices that reported
+  an error are taken out of the NCQ error state. The tasks themselves stay in
+  the non-blocking task list for the caller to fail.
+
+  @param[in]  Instance    A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqAbort (
+  IN ATA_ATAPI_PASS_THRU_INSTANCE *Instance
+  );
+
 /**
   Start a PIO data transfer on specific port.
 
@@ -78,6 +78,7 @@ ATA_DEVICE gAtaDeviceTemplate = {
   NULL,                        // Asb
   FALSE,                       // UdmaValid
   FALSE,                       // Lba48Bit
+  FALSE,                       // NcqValid
   NULL,                        // IdentifyData
   NULL,                        // ControllerNameTable
   {L'\0', },                   // ModelName
@@ -304,6 +305,11 @@ RegisterAtaDevice (
     goto Done;
   }
 
+  //
+  // Use native command queuing for the data transfers when it works.
+  //
+  ProbeAtaNcq (AtaDevice);
+
   //
   // Build controller name for Component Name (2) protocol.
   //
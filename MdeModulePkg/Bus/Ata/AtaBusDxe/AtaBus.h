@@ -115,6 +115,11 @@ typedef struct {
 
   BOOLEAN                               UdmaValid;
   BOOLEAN                               Lba48Bit;
+  //
+  // The device and the pass thru driver accept READ/WRITE FPDMA QUEUED, so
+  // several non-blocking transfers can be in flight at the same time.
+  //
+  BOOLEAN                               NcqValid;
 
   //
   // Cached data for ATA identify data
@@ -253,6 +258,21 @@ DiscoverAtaDevice (
   IN OUT ATA_DEVICE                 *AtaDevice
   );
 
+/**
+  Probe whether native command queuing can be used with the ATA device.
+
+  This function issues one READ FPDMA QUEUED command through the ATA pass through
+  protocol if the device reports NCQ support, and sets AtaDevice->NcqValid if the
+  command completes successfully.
+
+  @param  AtaDevice         The ATA child device involved for the operation.
+
+**/
+VOID
+ProbeAtaNcq (
+  IN OUT ATA_DEVICE                 *AtaDevice
+  );
+
 /**
   Read or write a number of blocks from ATA device.
 
@@ -25,6 +25,9 @@
 #define ATA_CMD_TRUST_SEND        0x5E
 #define ATA_CMD_TRUST_SEND_DMA    0x5F
 
+#define ATA_CMD_READ_FPDMA_QUEUED   0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED  0x61
+
 //
 // Look up table (UdmaValid, IsWrite) for EFI_ATA_PASS_THRU_CMD_PROTOCOL
 //
@@ -80,6 +83,14 @@ UINT8 mAtaTrustCommands[2][2] = {
 };
 
 
+//
+// Look up table (IsWrite) for native command queuing ATA_CMD
+//
+UINT8 mAtaNcqCommands[2] = {
+  ATA_CMD_READ_FPDMA_QUEUED,          // Queued DMA read
+  ATA_CMD_WRITE_FPDMA_QUEUED          // Queued DMA write
+};
+
 //
 // Look up table (Lba48Bit) for maximum transfer block number
 //
@@ -491,7 +502,22 @@ TransferAtaDevice (
   Acb->AtaCylinderHigh = (UINT8) RShiftU64 (StartLba, 16);
   Acb->AtaDeviceHead = (UINT8) (BIT7 | BIT6 | BIT5 | (AtaDevice->PortMultiplierPort == 0xFFFF ? 0 : (AtaDevice->PortMultiplierPort << 4)));
   Acb->AtaSectorCount = (UINT8) TransferLength;
-  if (AtaDevice->Lba48Bit) {
+  if (AtaDevice->NcqValid) {
+    //
+    // READ/WRITE FPDMA QUEUED always use 48-bit addressing and carry the sector
+    // count in the Features register. The queue tag in the Sector Count register
+    // is filled in by the ATA pass through driver. BIT7 of the Device register is
+    // FUA for these commands, so only the LBA bit is set.
+    //
+    Acb->AtaCommand         = mAtaNcqCommands[IsWrite];
+    Acb->AtaDeviceHead      = BIT6;
+    Acb->AtaSectorCount     = 0;
+    Acb->AtaFeatures        = (UINT8) TransferLength;
+    Acb->AtaFeaturesExp     = (UINT8) (TransferLength >> 8);
+    Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
+    Acb->AtaCylinderLowExp  = (UINT8) RShiftU64 (StartLba, 32);
+    Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
+  } else if (AtaDevice->Lba48Bit) {
     Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
     Acb->AtaCylinderLowExp = (UINT8) RShiftU64 (StartLba, 32);
     Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
@@ -518,6 +544,9 @@ TransferAtaDevice (
   }
 
   Packet->Protocol = mAtaPassThruCmdProtocols[AtaDevice->UdmaValid][IsWrite];
+  if (AtaDevice->NcqValid) {
+    Packet->Protocol = EFI_ATA_PASS_THRU_PROTOCOL_FPDMA;
+  }
   Packet->Length = EFI_ATA_PASS_THRU_LENGTH_SECTOR_COUNT;
   //
   // |------------------------|-----------------|------------------------|-----------------|
@@ -555,6 +584,60 @@ TransferAtaDevice (
   return AtaDevicePassThru (AtaDevice, TaskPacket, Event);
 }
 
+/**
+  Probe whether native command queuing can be used with the ATA device.
+
+  This function issues one READ FPDMA QUEUED command through the ATA pass through
+  protocol if the device reports NCQ support, and sets AtaDevice->NcqValid if the
+  command completes successfully.
+
+  @param  AtaDevice         The ATA child device involved for the operation.
+
+**/
+VOID
+ProbeAtaNcq (
+  IN OUT ATA_DEVICE                 *AtaDevice
+  )
+{
+  EFI_STATUS                        Status;
+  ATA_IDENTIFY_DATA                 *IdentifyData;
+  VOID                              *Buffer;
+  UINT32                            BlockSize;
+
+  AtaDevice->NcqValid = FALSE;
+
+  //
+  // Word 76 bit 8 reports NCQ support; 0x0000 and 0xFFFF mean the word isn't
+  // reported at all. Queued commands are DMA commands.
+  //
+  IdentifyData = AtaDevice->IdentifyData;
+  if (!AtaDevice->UdmaValid ||
+      (IdentifyData->serial_ata_capabilities == 0xFFFF) ||
+      ((IdentifyData->serial_ata_capabilities & BIT8) == 0)) {
+    return;
+  }
+
+  BlockSize = AtaDevice->BlockMedia.BlockSize;
+  Buffer    = AllocateAlignedBuffer (AtaDevice, BlockSize);
+  if (Buffer == NULL) {
+    return;
+  }
+
+  //
+  // The ATA pass through driver returns EFI_UNSUPPORTED when it (or its current
+  // mode) can't queue commands, so read the first block with NCQ and only keep
+  // using it if that works.
+  //
+  AtaDevice->NcqValid = TRUE;
+  Status = TransferAtaDevice (AtaDevice, NULL, Buffer, 0, 1, FALSE, NULL);
+  if (EFI_ERROR (Status)) {
+    AtaDevice->NcqValid = FALSE;
+  }
+  DEBUG ((EFI_D_INFO, "AtaBus - NCQ on Port %x PortMultiplierPort %x: %r\n", AtaDevice->Port, AtaDevice->PortMultiplierPort, Status));
+
+  FreeAlignedBuffer (Buffer, BlockSize);
+}
+
 /**
   Free SubTask.
 
@@ -807,7 +890,12 @@ AccessAtaDevice(
   if ((Token != NULL) && (Token->Event != NULL)) {
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
 
-    if (!IsListEmpty (&AtaDevice->AtaSubTaskList)) {
+    //
+    // Without native command queuing the requests are executed one after the
+    // other. With it, every request is passed down at once and the device keeps
+    // up to its queue depth of them in flight.
+    //
+    if (!AtaDevice->NcqValid && !IsListEmpty (&AtaDevice->AtaSubTaskList)) {
       AtaTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_TASK));
       if (AtaTask == NULL) {
         gBS->RestoreTPL (OldTpl);
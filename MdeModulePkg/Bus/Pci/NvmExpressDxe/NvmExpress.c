@@ -539,9 +539,6 @@ ProcessAsyncTaskList (
   EFI_STATUS                           Status;
 
   Private    = (NVME_CONTROLLER_PRIVATE_DATA*)Context;
-  QueueId    = 2;
-  Cq         = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
-  HasNewItem = FALSE;
   PciIo      = Private->PciIo;
 
   //
@@ -615,81 +612,90 @@ ProcessAsyncTaskList (
     }
   }
 
-  while (Cq->Pt != Private->Pt[QueueId]) {
-    ASSERT (Cq->Sqid == QueueId);
+  //
+  // Reap the completions of every asynchronous I/O queue pair.
+  //
+  for (QueueId = NVME_ASYNC_QUEUE_BASE;
+       QueueId < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueuePairs;
+       QueueId++) {
+    Cq         = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
+    HasNewItem = FALSE;
 
-    HasNewItem = TRUE;
+    while (Cq->Pt != Private->Pt[QueueId]) {
+      ASSERT (Cq->Sqid == QueueId);
 
-    //
-    // Find the command with given Command Id.
-    //
-    for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
-         !IsNull (&Private->AsyncPassThruQueue, Link);
-         Link = NextLink) {
-      NextLink = GetNextNode (&Private->AsyncPassThruQueue, Link);
-      AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
-      if (AsyncRequest->CommandId == Cq->Cid) {
-        //
-        // Copy the Respose Queue entry for this command to the callers
-        // response buffer.
-        //
-        CopyMem (
-          AsyncRequest->Packet->NvmeCompletion,
-          Cq,
-          sizeof(EFI_NVM_EXPRESS_COMPLETION)
-          );
+      HasNewItem = TRUE;
 
-        //
-        // Free the resources allocated before cmd submission
-        //
-        if (AsyncRequest->MapData != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapData);
-        }
-        if (AsyncRequest->MapMeta != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
-        }
-        if (AsyncRequest->MapPrpList != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
-        }
-        if (AsyncRequest->PrpListHost != NULL) {
-          PciIo->FreeBuffer (
-                   PciIo,
-                   AsyncRequest->PrpListNo,
-                   AsyncRequest->PrpListHost
-                   );
-        }
+      //
+      // Find the command with given Command Id.
+      //
+      for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
+           !IsNull (&Private->AsyncPassThruQueue, Link);
+           Link = NextLink) {
+        NextLink = GetNextNode (&Private->AsyncPassThruQueue, Link);
+        AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
+        if ((AsyncRequest->QueueId == QueueId) &&
+            (AsyncRequest->CommandId == Cq->Cid)) {
+          //
+          // Copy the Respose Queue entry for this command to the callers
+          // response buffer.
+          //
+          CopyMem (
+            AsyncRequest->Packet->NvmeCompletion,
+            Cq,
+            sizeof(EFI_NVM_EXPRESS_COMPLETION)
+            );
 
-        RemoveEntryList (Link);
-        gBS->SignalEvent (AsyncRequest->CallerEvent);
-        FreePool (AsyncRequest);
+          //
+          // Free the resources allocated before cmd submission
+          //
+          if (AsyncRequest->MapData != NULL) {
+            PciIo->Unmap (PciIo, AsyncRequest->MapData);
+          }
+          if (AsyncRequest->MapMeta != NULL) {
+            PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
+          }
+          if (AsyncRequest->PrpListHost != NULL) {
+            NvmeFreePrpList (
+              Private,
+              AsyncRequest->PrpListHost,
+              AsyncRequest->PrpListNo,
+              AsyncRequest->MapPrpList
+              );
+          }
+
+          RemoveEntryList (Link);
+          gBS->SignalEvent (AsyncRequest->CallerEvent);
+          FreePool (AsyncRequest);
+
+          //
+          // Update submission queue head.
+          //
+          Private->AsyncSqHead[QueueId] = Cq->Sqhd;
+          break;
+        }
+      }
 
-        //
-        // Update submission queue head.
-        //
-        Private->AsyncSqHead = Cq->Sqhd;
-        break;
+      Private->CqHdbl[QueueId].Cqh++;
+      if (Private->CqHdbl[QueueId].Cqh > Private->AsyncCqSize) {
+        Private->CqHdbl[QueueId].Cqh = 0;
+        Private->Pt[QueueId] ^= 1;
       }
-    }
 
-    Private->CqHdbl[QueueId].Cqh++;
-    if (Private->CqHdbl[QueueId].Cqh > NVME_ASYNC_CCQ_SIZE) {
-      Private->CqHdbl[QueueId].Cqh = 0;
-      Private->Pt[QueueId] ^= 1;
+      Cq = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
     }
 
-    Cq = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
-  }
-
-  if (HasNewItem) {
-    Data  = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[QueueId]);
-    PciIo->Mem.Write (
-                 PciIo,
-                 EfiPciIoWidthUint32,
-                 NVME_BAR,
-                 NVME_CQHDBL_OFFSET(QueueId, Private->Cap.Dstrd),
-                 1,
-                 &Data
-                 );
+    if (HasNewItem) {
+      Data  = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[QueueId]);
+      PciIo->Mem.Write (
+                   PciIo,
+                   EfiPciIoWidthUint32,
+                   NVME_BAR,
+                   NVME_CQHDBL_OFFSET(QueueId, Private->Cap.Dstrd),
+                   1,
+                   &Data
+                   );
+    }
   }
 }
 
@@ -950,21 +956,22 @@ NvmExpressDriverBindingStart (
     }
 
     //
-    // 6 x 4kB aligned buffers will be carved out of this buffer.
+    // NVME_BUFFER_PAGES x 4kB aligned buffers will be carved out of this buffer.
     // 1st 4kB boundary is the start of the admin submission queue.
     // 2nd 4kB boundary is the start of the admin completion queue.
     // 3rd 4kB boundary is the start of I/O submission queue #1.
     // 4th 4kB boundary is the start of I/O completion queue #1.
-    // 5th 4kB boundary is the start of I/O submission queue #2.
-    // 6th 4kB boundary is the start of I/O completion queue #2.
+    // Each asynchronous I/O queue pair follows, submission queue first.
+    // The PRP list pool takes the last NVME_PRP_LIST_POOL_PAGES pages.
     //
-    // Allocate 6 pages of memory, then map it for bus master read and write.
+    // Allocate NVME_BUFFER_PAGES pages of memory, then map it for bus master
+    // read and write.
     //
     Status = PciIo->AllocateBuffer (
                       PciIo,
                       AllocateAnyPages,
                       EfiBootServicesData,
-                      6,
+                      NVME_BUFFER_PAGES,
                       (VOID**)&Private->Buffer,
                       0
                       );
@@ -972,7 +979,7 @@ NvmExpressDriverBindingStart (
       goto Exit;
     }
 
-    Bytes = EFI_PAGES_TO_SIZE (6);
+    Bytes = EFI_PAGES_TO_SIZE (NVME_BUFFER_PAGES);
     Status = PciIo->Map (
                       PciIo,
                       EfiPciIoOperationBusMasterCommonBuffer,
@@ -982,7 +989,7 @@ NvmExpressDriverBindingStart (
                       &Private->Mapping
                       );
 
-    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (6))) {
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (NVME_BUFFER_PAGES))) {
       goto Exit;
     }
 
@@ -1093,7 +1100,7 @@ Exit:
   }
 
   if ((Private != NULL) && (Private->Buffer != NULL)) {
-    PciIo->FreeBuffer (PciIo, 6, Private->Buffer);
+    PciIo->FreeBuffer (PciIo, NVME_BUFFER_PAGES, Private->Buffer);
   }
 
   if ((Private != NULL) && (Private->ControllerData != NULL)) {
@@ -1216,7 +1223,7 @@ NvmExpressDriverBindingStop (
       }
 
       if (Private->Buffer != NULL) {
-        Private->PciIo->FreeBuffer (Private->PciIo, 6, Private->Buffer);
+        Private->PciIo->FreeBuffer (Private->PciIo, NVME_BUFFER_PAGES, Private->Buffer);
       }
 
       FreePool (Private->ControllerData);
@@ -40,6 +40,7 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/ReportStatusCodeLib.h>
+#include <Library/PcdLib.h>
 
 typedef struct _NVME_CONTROLLER_PRIVATE_DATA NVME_CONTROLLER_PRIVATE_DATA;
 typedef struct _NVME_DEVICE_PRIVATE_DATA     NVME_DEVICE_PRIVATE_DATA;
@@ -64,16 +65,40 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 
 //
 // Number of asynchronous I/O submission queue entries, which is 0-based.
-// The asynchronous I/O submission queue size is 4kB in total.
+// The asynchronous I/O submission queue size is 16kB in total.
 //
-#define NVME_ASYNC_CSQ_SIZE                       63
+#define NVME_ASYNC_CSQ_SIZE                       255
 //
 // Number of asynchronous I/O completion queue entries, which is 0-based.
 // The asynchronous I/O completion queue size is 4kB in total.
 //
 #define NVME_ASYNC_CCQ_SIZE                       255
 
-#define NVME_MAX_QUEUES                           3     // Number of queues supported by the driver
+#define NVME_ASYNC_CSQ_PAGES                      EFI_SIZE_TO_PAGES ((NVME_ASYNC_CSQ_SIZE + 1) * sizeof (NVME_SQ))
+#define NVME_ASYNC_CCQ_PAGES                      EFI_SIZE_TO_PAGES ((NVME_ASYNC_CCQ_SIZE + 1) * sizeof (NVME_CQ))
+
+//
+// Non-blocking I/O is spread over up to NVME_ASYNC_QUEUE_PAIRS I/O queue
+// pairs, starting at queue ID NVME_ASYNC_QUEUE_BASE. Queue 0 is the admin
+// queue and queue 1 serves blocking I/O.
+//
+#define NVME_ASYNC_QUEUE_BASE                     2
+#define NVME_ASYNC_QUEUE_PAIRS                    4
+
+#define NVME_MAX_QUEUES                           (NVME_ASYNC_QUEUE_BASE + NVME_ASYNC_QUEUE_PAIRS)  // Number of queues supported by the driver
+
+//
+// Number of one-page PRP lists kept mapped for the lifetime of the controller,
+// so that most transfers don't allocate and map a PRP list on every command.
+// The pool is tracked by a UINT64 bitmap, so it can't exceed 64 pages.
+//
+#define NVME_PRP_LIST_POOL_PAGES                  64
+
+//
+// Size of the common buffer holding the admin queues, the blocking I/O queues,
+// the asynchronous I/O queues and the PRP list pool.
+//
+#define NVME_BUFFER_PAGES                         (4 + NVME_ASYNC_QUEUE_PAIRS * (NVME_ASYNC_CSQ_PAGES + NVME_ASYNC_CCQ_PAGES) + NVME_PRP_LIST_POOL_PAGES)
 
 #define NVME_CONTROLLER_ID                        0
 
@@ -83,9 +108,10 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 #define NVME_GENERIC_TIMEOUT                      EFI_TIMER_PERIOD_SECONDS (5)
 
 //
-// Nvme async transfer timer interval, set by experience.
+// Nvme async transfer timer interval. The driver doesn't use interrupts, so
+// this is the rate at which the asynchronous completion queues are polled.
 //
-#define NVME_HC_ASYNC_TIMER                       EFI_TIMER_PERIOD_MILLISECONDS (1)
+#define NVME_HC_ASYNC_TIMER                       EFI_TIMER_PERIOD_MICROSECONDS (PcdGet32 (PcdNvmeAsyncPollInterval))
 
 //
 // Unique signature for private data structure.
@@ -116,13 +142,13 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   NVME_ADMIN_CONTROLLER_DATA          *ControllerData;
 
   //
-  // 6 x 4kB aligned buffers will be carved out of this buffer.
+  // NVME_BUFFER_PAGES x 4kB aligned buffers will be carved out of this buffer.
   // 1st 4kB boundary is the start of the admin submission queue.
   // 2nd 4kB boundary is the start of the admin completion queue.
   // 3rd 4kB boundary is the start of I/O submission queue #1.
   // 4th 4kB boundary is the start of I/O completion queue #1.
-  // 5th 4kB boundary is the start of I/O submission queue #2.
-  // 6th 4kB boundary is the start of I/O completion queue #2.
+  // Each asynchronous I/O queue pair follows, submission queue first.
+  // The PRP list pool takes the last NVME_PRP_LIST_POOL_PAGES pages.
   //
   UINT8                               *Buffer;
   UINT8                               *BufferPciAddr;
@@ -140,7 +166,23 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   //
   NVME_SQTDBL                         SqTdbl[NVME_MAX_QUEUES];
   NVME_CQHDBL                         CqHdbl[NVME_MAX_QUEUES];
-  UINT16                              AsyncSqHead;
+  UINT16                              AsyncSqHead[NVME_MAX_QUEUES];
+
+  //
+  // Asynchronous I/O queue pairs actually created, their 0-based sizes, and
+  // the pair the next non-blocking command is placed on.
+  //
+  UINT16                              AsyncQueuePairs;
+  UINT16                              AsyncSqSize;
+  UINT16                              AsyncCqSize;
+  UINT16                              NextAsyncQueue;
+
+  //
+  // Preallocated PRP list pages and the bitmap of the ones in use.
+  //
+  UINT8                               *PrpListPool;
+  UINT8                               *PrpListPoolPciAddr;
+  UINT64                              PrpListPoolBitmap;
 
   //
   // Flag to indicate internal IO queue creation.
@@ -292,6 +334,7 @@ typedef struct {
   LIST_ENTRY                               Link;
 
   EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET *Packet;
+  UINT16                                   QueueId;
   UINT16                                   CommandId;
   VOID                                     *MapPrpList;
   UINTN                                    PrpListNo;
@@ -722,6 +765,24 @@ NvmeDumpStatus (
   IN NVME_CQ             *Cq
   );
 
+/**
+  Release the PRP lists created by NvmeCreatePrpList().
+
+  @param[in] Private        The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in] PrpListHost    The host base address of the PRP lists.
+  @param[in] PrpListNo      The number of PRP lists.
+  @param[in] Mapping        The mapping value returned from PciIo.Map(), or NULL
+                            if the PRP list was taken from the PRP list pool.
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private,
+  IN VOID                            *PrpListHost,
+  IN UINTN                           PrpListNo,
+  IN VOID                            *Mapping
+  );
+
 /**
   Register the shutdown notification through the ResetNotification protocol.
 
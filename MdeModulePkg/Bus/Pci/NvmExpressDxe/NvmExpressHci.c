@@ -563,6 +563,71 @@ NvmeIdentifyNamespace (
   return Status;
 }
 
+/**
+  Request the I/O queues used by the driver with the Number of Queues feature,
+  and work out how many asynchronous I/O queue pairs may be created.
+
+  @param  Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+  @return EFI_SUCCESS      Private->AsyncQueuePairs is set up. If the controller
+                           rejects the feature, a single asynchronous queue pair
+                           is used.
+
+**/
+EFI_STATUS
+NvmeSetNumberOfQueues (
+  IN NVME_CONTROLLER_PRIVATE_DATA      *Private
+  )
+{
+  EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET CommandPacket;
+  EFI_NVM_EXPRESS_COMMAND                  Command;
+  EFI_NVM_EXPRESS_COMPLETION               Completion;
+  NVME_ADMIN_SET_FEATURES                  SetFeatures;
+  EFI_STATUS                               Status;
+  UINT32                                   Allocated;
+
+  ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
+  ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
+  ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
+  ZeroMem (&SetFeatures, sizeof(NVME_ADMIN_SET_FEATURES));
+
+  CommandPacket.NvmeCmd        = &Command;
+  CommandPacket.NvmeCompletion = &Completion;
+
+  Command.Cdw0.Opcode = NVME_ADMIN_SET_FEATURES_CMD;
+  CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
+  CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
+
+  //
+  // Both counts are 0-based and exclude the admin queue pair.
+  //
+  SetFeatures.Fid = NVME_FEATURE_NUMBER_OF_QUEUES;
+  CopyMem (&CommandPacket.NvmeCmd->Cdw10, &SetFeatures, sizeof (NVME_ADMIN_SET_FEATURES));
+  CommandPacket.NvmeCmd->Cdw11 = ((NVME_MAX_QUEUES - 2) << 16) | (NVME_MAX_QUEUES - 2);
+  CommandPacket.NvmeCmd->Flags = CDW10_VALID | CDW11_VALID;
+
+  Status = Private->Passthru.PassThru (
+                               &Private->Passthru,
+                               0,
+                               &CommandPacket,
+                               NULL
+                               );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "NvmeSetNumberOfQueues: Set Features failed (%r), using one async queue pair\n", Status));
+    Private->AsyncQueuePairs = 1;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // DW0 returns the 0-based number of submission (bits 15:0) and completion
+  // (bits 31:16) queues allocated. One pair goes to blocking I/O.
+  //
+  Allocated = MIN (Completion.DW0 & 0xFFFF, Completion.DW0 >> 16);
+  Private->AsyncQueuePairs = (UINT16)MAX (1, MIN (Allocated, NVME_ASYNC_QUEUE_PAIRS));
+
+  return EFI_SUCCESS;
+}
+
 /**
   Create io completion queue.
 
@@ -588,7 +653,7 @@ NvmeCreateIoCompletionQueue (
   Status = EFI_SUCCESS;
   Private->CreateIoQueue = TRUE;
 
-  for (Index = 1; Index < NVME_MAX_QUEUES; Index++) {
+  for (Index = 1; Index < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueuePairs; Index++) {
     ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
     ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
     ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
@@ -606,11 +671,7 @@ NvmeCreateIoCompletionQueue (
     if (Index == 1) {
       QueueSize = NVME_CCQ_SIZE;
     } else {
-      if (Private->Cap.Mqes > NVME_ASYNC_CCQ_SIZE) {
-        QueueSize = NVME_ASYNC_CCQ_SIZE;
-      } else {
-        QueueSize = Private->Cap.Mqes;
-      }
+      QueueSize = Private->AsyncCqSize;
     }
 
     CrIoCq.Qid   = Index;
@@ -660,7 +721,7 @@ NvmeCreateIoSubmissionQueue (
   Status = EFI_SUCCESS;
   Private->CreateIoQueue = TRUE;
 
-  for (Index = 1; Index < NVME_MAX_QUEUES; Index++) {
+  for (Index = 1; Index < NVME_ASYNC_QUEUE_BASE + Private->AsyncQueuePairs; Index++) {
     ZeroMem (&CommandPacket, sizeof(EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
     ZeroMem (&Command, sizeof(EFI_NVM_EXPRESS_COMMAND));
     ZeroMem (&Completion, sizeof(EFI_NVM_EXPRESS_COMPLETION));
@@ -678,11 +739,7 @@ NvmeCreateIoSubmissionQueue (
     if (Index == 1) {
       QueueSize = NVME_CSQ_SIZE;
     } else {
-      if (Private->Cap.Mqes > NVME_ASYNC_CSQ_SIZE) {
-        QueueSize = NVME_ASYNC_CSQ_SIZE;
-      } else {
-        QueueSize = Private->Cap.Mqes;
-      }
+      QueueSize = Private->AsyncSqSize;
     }
 
     CrIoSq.Qid   = Index;
@@ -731,6 +788,8 @@ NvmeControllerInit (
   NVME_ACQ                        Acq;
   UINT8                           Sn[21];
   UINT8                           Mn[41];
+  UINTN                           Offset;
+  UINT32                          Index;
   //
   // Save original PCI attributes and enable this controller.
   //
@@ -799,19 +858,18 @@ NvmeControllerInit (
   //
   ASSERT ((Private->Cap.Mpsmin + 12) <= EFI_PAGE_SHIFT);
 
-  Private->Cid[0] = 0;
-  Private->Cid[1] = 0;
-  Private->Cid[2] = 0;
-  Private->Pt[0]  = 0;
-  Private->Pt[1]  = 0;
-  Private->Pt[2]  = 0;
-  Private->SqTdbl[0].Sqt = 0;
-  Private->SqTdbl[1].Sqt = 0;
-  Private->SqTdbl[2].Sqt = 0;
-  Private->CqHdbl[0].Cqh = 0;
-  Private->CqHdbl[1].Cqh = 0;
-  Private->CqHdbl[2].Cqh = 0;
-  Private->AsyncSqHead   = 0;
+  ZeroMem (Private->Cid, sizeof (Private->Cid));
+  ZeroMem (Private->Pt, sizeof (Private->Pt));
+  ZeroMem (Private->SqTdbl, sizeof (Private->SqTdbl));
+  ZeroMem (Private->CqHdbl, sizeof (Private->CqHdbl));
+  ZeroMem (Private->AsyncSqHead, sizeof (Private->AsyncSqHead));
+  Private->NextAsyncQueue = 0;
+
+  //
+  // Use the deepest asynchronous I/O queues the controller allows.
+  //
+  Private->AsyncSqSize = (UINT16)MIN (NVME_ASYNC_CSQ_SIZE, Private->Cap.Mqes);
+  Private->AsyncCqSize = (UINT16)MIN (NVME_ASYNC_CCQ_SIZE, Private->Cap.Mqes);
 
   Status = NvmeDisableController (Private);
 
@@ -840,7 +898,7 @@ NvmeControllerInit (
   //
   // Address of I/O submission & completion queue.
   //
-  ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (6));
+  ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (NVME_BUFFER_PAGES));
   Private->SqBuffer[0]        = (NVME_SQ *)(UINTN)(Private->Buffer);
   Private->SqBufferPciAddr[0] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr);
   Private->CqBuffer[0]        = (NVME_CQ *)(UINTN)(Private->Buffer + 1 * EFI_PAGE_SIZE);
@@ -849,10 +907,23 @@ NvmeControllerInit (
   Private->SqBufferPciAddr[1] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 2 * EFI_PAGE_SIZE);
   Private->CqBuffer[1]        = (NVME_CQ *)(UINTN)(Private->Buffer + 3 * EFI_PAGE_SIZE);
   Private->CqBufferPciAddr[1] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 3 * EFI_PAGE_SIZE);
-  Private->SqBuffer[2]        = (NVME_SQ *)(UINTN)(Private->Buffer + 4 * EFI_PAGE_SIZE);
-  Private->SqBufferPciAddr[2] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 4 * EFI_PAGE_SIZE);
-  Private->CqBuffer[2]        = (NVME_CQ *)(UINTN)(Private->Buffer + 5 * EFI_PAGE_SIZE);
-  Private->CqBufferPciAddr[2] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 5 * EFI_PAGE_SIZE);
+
+  Offset = 4 * EFI_PAGE_SIZE;
+  for (Index = NVME_ASYNC_QUEUE_BASE; Index < NVME_MAX_QUEUES; Index++) {
+    Private->SqBuffer[Index]        = (NVME_SQ *)(UINTN)(Private->Buffer + Offset);
+    Private->SqBufferPciAddr[Index] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + Offset);
+    Offset += EFI_PAGES_TO_SIZE (NVME_ASYNC_CSQ_PAGES);
+    Private->CqBuffer[Index]        = (NVME_CQ *)(UINTN)(Private->Buffer + Offset);
+    Private->CqBufferPciAddr[Index] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + Offset);
+    Offset += EFI_PAGES_TO_SIZE (NVME_ASYNC_CCQ_PAGES);
+  }
+
+  //
+  // The PRP lists handed out from the pool are released by the requests that
+  // own them, so only the pool location is (re)established here.
+  //
+  Private->PrpListPool        = Private->Buffer + Offset;
+  Private->PrpListPoolPciAddr = Private->BufferPciAddr + Offset;
 
   DEBUG ((EFI_D_INFO, "Private->Buffer = [%016X]\n", (UINT64)(UINTN)Private->Buffer));
   DEBUG ((EFI_D_INFO, "Admin     Submission Queue size (Aqa.Asqs) = [%08X]\n", Aqa.Asqs));
@@ -861,8 +932,11 @@ NvmeControllerInit (
   DEBUG ((EFI_D_INFO, "Admin     Completion Queue (CqBuffer[0]) = [%016X]\n", Private->CqBuffer[0]));
   DEBUG ((EFI_D_INFO, "Sync  I/O Submission Queue (SqBuffer[1]) = [%016X]\n", Private->SqBuffer[1]));
   DEBUG ((EFI_D_INFO, "Sync  I/O Completion Queue (CqBuffer[1]) = [%016X]\n", Private->CqBuffer[1]));
-  DEBUG ((EFI_D_INFO, "Async I/O Submission Queue (SqBuffer[2]) = [%016X]\n", Private->SqBuffer[2]));
-  DEBUG ((EFI_D_INFO, "Async I/O Completion Queue (CqBuffer[2]) = [%016X]\n", Private->CqBuffer[2]));
+  for (Index = NVME_ASYNC_QUEUE_BASE; Index < NVME_MAX_QUEUES; Index++) {
+    DEBUG ((EFI_D_INFO, "Async I/O Submission Queue (SqBuffer[%d]) = [%016X]\n", Index, Private->SqBuffer[Index]));
+    DEBUG ((EFI_D_INFO, "Async I/O Completion Queue (CqBuffer[%d]) = [%016X]\n", Index, Private->CqBuffer[Index]));
+  }
+  DEBUG ((EFI_D_INFO, "PRP List Pool                            = [%016X]\n", Private->PrpListPool));
 
   //
   // Program admin queue attributes.
@@ -939,8 +1013,18 @@ NvmeControllerInit (
   DEBUG ((EFI_D_INFO, "    NN        : 0x%x\n", Private->ControllerData->Nn));
 
   //
-  // Create two I/O completion queues.
-  // One for blocking I/O, one for non-blocking I/O.
+  // Ask for one I/O queue pair for blocking I/O and NVME_ASYNC_QUEUE_PAIRS
+  // pairs for non-blocking I/O.
+  //
+  Status = NvmeSetNumberOfQueues (Private);
+  if (EFI_ERROR(Status)) {
+   return Status;
+  }
+  DEBUG ((EFI_D_INFO, "    Async I/O queue pairs : %d, depth : %d\n", Private->AsyncQueuePairs, Private->AsyncSqSize + 1));
+
+  //
+  // Create the I/O completion queues.
+  // One for blocking I/O, the others for non-blocking I/O.
   //
   Status = NvmeCreateIoCompletionQueue (Private);
   if (EFI_ERROR(Status)) {
@@ -948,8 +1032,8 @@ NvmeControllerInit (
   }
 
   //
-  // Create two I/O Submission queues.
-  // One for blocking I/O, one for non-blocking I/O.
+  // Create the I/O Submission queues.
+  // One for blocking I/O, the others for non-blocking I/O.
   //
   Status = NvmeCreateIoSubmissionQueue (Private);
 
@@ -18,6 +18,11 @@
 //
 #define NVME_ASQ_BUF_OFFSET                  EFI_PAGE_SIZE
 
+//
+// Feature Identifier of the Number of Queues feature.
+//
+#define NVME_FEATURE_NUMBER_OF_QUEUES        0x07
+
 /**
   Initialize the Nvm Express controller.
 
@@ -195,20 +195,23 @@ NvmeDumpStatus (
 /**
   Create PRP lists for data transfer which is larger than 2 memory pages.
   Note here we calcuate the number of required PRP lists and allocate them at one time.
+  A single PRP list is taken from the controller's PRP list pool when a page is free,
+  so that only very large transfers allocate and map PRP lists on the fly.
 
-  @param[in]     PciIo               A pointer to the EFI_PCI_IO_PROTOCOL instance.
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
   @param[in]     PhysicalAddr        The physical base address of data buffer.
   @param[in]     Pages               The number of pages to be transfered.
   @param[out]    PrpListHost         The host base address of PRP lists.
   @param[in,out] PrpListNo           The number of PRP List.
-  @param[out]    Mapping             The mapping value returned from PciIo.Map().
+  @param[out]    Mapping             The mapping value returned from PciIo.Map(), or NULL
+                                     if the PRP list was taken from the pool.
 
   @retval The pointer to the first PRP List of the PRP lists.
 
 **/
 VOID*
 NvmeCreatePrpList (
-  IN     EFI_PCI_IO_PROTOCOL          *PciIo,
+  IN     NVME_CONTROLLER_PRIVATE_DATA *Private,
   IN     EFI_PHYSICAL_ADDRESS         PhysicalAddr,
   IN     UINTN                        Pages,
      OUT VOID                         **PrpListHost,
@@ -216,6 +219,7 @@ NvmeCreatePrpList (
      OUT VOID                         **Mapping
   )
 {
+  EFI_PCI_IO_PROTOCOL         *PciIo;
   UINTN                       PrpEntryNo;
   UINT64                      PrpListBase;
   UINTN                       PrpListIndex;
@@ -223,8 +227,14 @@ NvmeCreatePrpList (
   UINT64                      Remainder;
   EFI_PHYSICAL_ADDRESS        PrpListPhyAddr;
   UINTN                       Bytes;
+  INTN                        Slot;
+  EFI_TPL                     OldTpl;
   EFI_STATUS                  Status;
 
+  PciIo        = Private->PciIo;
+  *PrpListHost = NULL;
+  *Mapping     = NULL;
+
   //
   // The number of Prp Entry in a memory page.
   //
@@ -244,39 +254,56 @@ NvmeCreatePrpList (
     Remainder = PrpEntryNo - 1;
   }
 
-  Status = PciIo->AllocateBuffer (
-                    PciIo,
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    *PrpListNo,
-                    PrpListHost,
-                    0
-                    );
-
-  if (EFI_ERROR (Status)) {
-    return NULL;
+  Slot = -1;
+  if (*PrpListNo == 1) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    Slot   = LowBitSet64 (~Private->PrpListPoolBitmap);
+    if (Slot >= 0) {
+      Private->PrpListPoolBitmap |= LShiftU64 (1, (UINTN)Slot);
+    }
+    gBS->RestoreTPL (OldTpl);
   }
 
-  Bytes = EFI_PAGES_TO_SIZE (*PrpListNo);
-  Status = PciIo->Map (
-                    PciIo,
-                    EfiPciIoOperationBusMasterCommonBuffer,
-                    *PrpListHost,
-                    &Bytes,
-                    &PrpListPhyAddr,
-                    Mapping
-                    );
-
-  if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (*PrpListNo))) {
-    DEBUG ((EFI_D_ERROR, "NvmeCreatePrpList: create PrpList failure!\n"));
-    goto EXIT;
+  if (Slot >= 0) {
+    *PrpListHost   = Private->PrpListPool + EFI_PAGES_TO_SIZE ((UINTN)Slot);
+    PrpListPhyAddr = (EFI_PHYSICAL_ADDRESS)(UINTN)(Private->PrpListPoolPciAddr + EFI_PAGES_TO_SIZE ((UINTN)Slot));
+    Bytes          = EFI_PAGE_SIZE;
+  } else {
+    Status = PciIo->AllocateBuffer (
+                      PciIo,
+                      AllocateAnyPages,
+                      EfiBootServicesData,
+                      *PrpListNo,
+                      PrpListHost,
+                      0
+                      );
+
+    if (EFI_ERROR (Status)) {
+      *PrpListHost = NULL;
+      return NULL;
+    }
+
+    Bytes = EFI_PAGES_TO_SIZE (*PrpListNo);
+    Status = PciIo->Map (
+                      PciIo,
+                      EfiPciIoOperationBusMasterCommonBuffer,
+                      *PrpListHost,
+                      &Bytes,
+                      &PrpListPhyAddr,
+                      Mapping
+                      );
+
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (*PrpListNo))) {
+      DEBUG ((EFI_D_ERROR, "NvmeCreatePrpList: create PrpList failure!\n"));
+      goto EXIT;
+    }
   }
   //
   // Fill all PRP lists except of last one.
   //
   ZeroMem (*PrpListHost, Bytes);
   for (PrpListIndex = 0; PrpListIndex < *PrpListNo - 1; ++PrpListIndex) {
-    PrpListBase = *(UINT64*)PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
+    PrpListBase = (UINTN)*PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
 
     for (PrpEntryIndex = 0; PrpEntryIndex < PrpEntryNo; ++PrpEntryIndex) {
       if (PrpEntryIndex != PrpEntryNo - 1) {
@@ -296,7 +323,7 @@ NvmeCreatePrpList (
   //
   // Fill last PRP list.
   //
-  PrpListBase = *(UINT64*)PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
+  PrpListBase = (UINTN)*PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
   for (PrpEntryIndex = 0; PrpEntryIndex < Remainder; ++PrpEntryIndex) {
     *((UINT64*)(UINTN)PrpListBase + PrpEntryIndex) = PhysicalAddr;
     PhysicalAddr += EFI_PAGE_SIZE;
@@ -305,10 +332,51 @@ NvmeCreatePrpList (
   return (VOID*)(UINTN)PrpListPhyAddr;
 
 EXIT:
+  if (*Mapping != NULL) {
+    PciIo->Unmap (PciIo, *Mapping);
+    *Mapping = NULL;
+  }
   PciIo->FreeBuffer (PciIo, *PrpListNo, *PrpListHost);
+  *PrpListHost = NULL;
   return NULL;
 }
 
+/**
+  Release the PRP lists created by NvmeCreatePrpList().
+
+  @param[in] Private        The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in] PrpListHost    The host base address of the PRP lists.
+  @param[in] PrpListNo      The number of PRP lists.
+  @param[in] Mapping        The mapping value returned from PciIo.Map(), or NULL
+                            if the PRP list was taken from the PRP list pool.
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private,
+  IN VOID                            *PrpListHost,
+  IN UINTN                           PrpListNo,
+  IN VOID                            *Mapping
+  )
+{
+  UINTN                       Slot;
+  EFI_TPL                     OldTpl;
+
+  if (((UINT8 *)PrpListHost >= Private->PrpListPool) &&
+      ((UINT8 *)PrpListHost < Private->PrpListPool + EFI_PAGES_TO_SIZE (NVME_PRP_LIST_POOL_PAGES))) {
+    Slot   = EFI_SIZE_TO_PAGES ((UINTN)((UINT8 *)PrpListHost - Private->PrpListPool));
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    Private->PrpListPoolBitmap &= ~LShiftU64 (1, Slot);
+    gBS->RestoreTPL (OldTpl);
+    return;
+  }
+
+  if (Mapping != NULL) {
+    Private->PciIo->Unmap (Private->PciIo, Mapping);
+  }
+  Private->PciIo->FreeBuffer (Private->PciIo, PrpListNo, PrpListHost);
+}
+
 
 /**
   Aborts the asynchronous PassThru requests.
@@ -375,15 +443,13 @@ AbortAsyncPassThruTasks (
     if (AsyncRequest->MapMeta != NULL) {
       PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
     }
-    if (AsyncRequest->MapPrpList != NULL) {
-      PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
-    }
     if (AsyncRequest->PrpListHost != NULL) {
-      PciIo->FreeBuffer (
-               PciIo,
-               AsyncRequest->PrpListNo,
-               AsyncRequest->PrpListHost
-               );
+      NvmeFreePrpList (
+        Private,
+        AsyncRequest->PrpListHost,
+        AsyncRequest->PrpListNo,
+        AsyncRequest->MapPrpList
+        );
     }
 
     RemoveEntryList (Link);
@@ -468,6 +534,7 @@ NvmExpressPassThru (
   UINT32                         IoAlign;
   UINT32                         MaxTransLen;
   UINT32                         Data;
+  UINT16                         Index;
   NVME_PASS_THRU_ASYNC_REQ       *AsyncRequest;
   EFI_TPL                        OldTpl;
 
@@ -539,32 +606,57 @@ NvmExpressPassThru (
   PrpListNo   = 0;
   Prp         = NULL;
   TimerEvent  = NULL;
+  AsyncRequest = NULL;
   Status      = EFI_SUCCESS;
 
+  if (Packet->NvmeCmd->Nsid != NamespaceId) {
+    return EFI_INVALID_PARAMETER;
+  }
+
   if (Packet->QueueType == NVME_ADMIN_QUEUE) {
     QueueId = 0;
   } else {
     if (Event == NULL) {
       QueueId = 1;
     } else {
-      QueueId = 2;
+      AsyncRequest = AllocateZeroPool (sizeof (NVME_PASS_THRU_ASYNC_REQ));
+      if (AsyncRequest == NULL) {
+        return EFI_DEVICE_ERROR;
+      }
 
       //
-      // Submission queue full check.
+      // The queue choice, the submission queue tail and the command id are
+      // shared with ProcessAsyncTaskList(), which submits BlockIo2 subtasks
+      // at TPL_NOTIFY. Stay at TPL_NOTIFY until the command is rung in and
+      // on AsyncPassThruQueue, so that no other submission takes the same
+      // entry and the completion cannot be reaped before it is tracked.
+      //
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
       //
-      if ((Private->SqTdbl[QueueId].Sqt + 1) % (NVME_ASYNC_CSQ_SIZE + 1) ==
-          Private->AsyncSqHead) {
-        return EFI_NOT_READY;
+      // Spread the non-blocking commands over the asynchronous queue pairs in
+      // round-robin order, skipping the ones whose submission queue is full.
+      //
+      QueueId = NVME_ASYNC_QUEUE_BASE;
+      for (Index = 0; Index < Private->AsyncQueuePairs; Index++) {
+        QueueId = (UINT16)(NVME_ASYNC_QUEUE_BASE +
+                           (Private->NextAsyncQueue + Index) % Private->AsyncQueuePairs);
+        if ((Private->SqTdbl[QueueId].Sqt + 1) % (Private->AsyncSqSize + 1) !=
+            Private->AsyncSqHead[QueueId]) {
+          break;
+        }
       }
+
+      if (Index == Private->AsyncQueuePairs) {
+        Status = EFI_NOT_READY;
+        goto EXIT;
+      }
+      Private->NextAsyncQueue = (UINT16)((QueueId - NVME_ASYNC_QUEUE_BASE + 1) % Private->AsyncQueuePairs);
     }
   }
   Sq  = Private->SqBuffer[QueueId] + Private->SqTdbl[QueueId].Sqt;
   Cq  = Private->CqBuffer[QueueId] + Private->CqHdbl[QueueId].Cqh;
 
-  if (Packet->NvmeCmd->Nsid != NamespaceId) {
-    return EFI_INVALID_PARAMETER;
-  }
-
   ZeroMem (Sq, sizeof (NVME_SQ));
   Sq->Opc  = (UINT8)Packet->NvmeCmd->Cdw0.Opcode;
   Sq->Fuse = (UINT8)Packet->NvmeCmd->Cdw0.FusedOperation;
@@ -577,7 +669,8 @@ NvmExpressPassThru (
   ASSERT (Sq->Psdt == 0);
   if (Sq->Psdt != 0) {
     DEBUG ((EFI_D_ERROR, "NvmExpressPassThru: doesn't support SGL mechanism\n"));
-    return EFI_UNSUPPORTED;
+    Status = EFI_UNSUPPORTED;
+    goto EXIT;
   }
 
   Sq->Prp[0] = (UINT64)(UINTN)Packet->TransferBuffer;
@@ -600,7 +693,8 @@ NvmExpressPassThru (
     //
     if (((Packet->TransferLength != 0) && (Packet->TransferBuffer == NULL)) ||
         ((Packet->TransferLength == 0) && (Packet->TransferBuffer != NULL))) {
-      return EFI_INVALID_PARAMETER;
+      Status = EFI_INVALID_PARAMETER;
+      goto EXIT;
     }
 
     if ((Sq->Opc & BIT0) != 0) {
@@ -620,7 +714,8 @@ NvmExpressPassThru (
                         &MapData
                         );
       if (EFI_ERROR (Status) || (Packet->TransferLength != MapLength)) {
-        return EFI_OUT_OF_RESOURCES;
+        Status = EFI_OUT_OF_RESOURCES;
+        goto EXIT;
       }
 
       Sq->Prp[0] = PhyAddr;
@@ -638,12 +733,8 @@ NvmExpressPassThru (
                         &MapMeta
                         );
       if (EFI_ERROR (Status) || (Packet->MetadataLength != MapLength)) {
-        PciIo->Unmap (
-                 PciIo,
-                 MapData
-                 );
-
-        return EFI_OUT_OF_RESOURCES;
+        Status = EFI_OUT_OF_RESOURCES;
+        goto EXIT;
       }
       Sq->Mptr = PhyAddr;
     }
@@ -660,7 +751,7 @@ NvmExpressPassThru (
     // Create PrpList for remaining data buffer.
     //
     PhyAddr = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
-    Prp = NvmeCreatePrpList (PciIo, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
+    Prp = NvmeCreatePrpList (Private, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
     if (Prp == NULL) {
       Status = EFI_OUT_OF_RESOURCES;
       goto EXIT;
@@ -701,7 +792,7 @@ NvmExpressPassThru (
   //
   if ((Event != NULL) && (QueueId != 0)) {
     Private->SqTdbl[QueueId].Sqt =
-      (Private->SqTdbl[QueueId].Sqt + 1) % (NVME_ASYNC_CSQ_SIZE + 1);
+      (Private->SqTdbl[QueueId].Sqt + 1) % (Private->AsyncSqSize + 1);
   } else {
     Private->SqTdbl[QueueId].Sqt ^= 1;
   }
@@ -723,15 +814,10 @@ NvmExpressPassThru (
   // For non-blocking requests, return directly if the command is placed
   // in the submission queue.
   //
-  if ((Event != NULL) && (QueueId != 0)) {
-    AsyncRequest = AllocateZeroPool (sizeof (NVME_PASS_THRU_ASYNC_REQ));
-    if (AsyncRequest == NULL) {
-      Status = EFI_DEVICE_ERROR;
-      goto EXIT;
-    }
-
+  if (AsyncRequest != NULL) {
     AsyncRequest->Signature     = NVME_PASS_THRU_ASYNC_REQ_SIG;
     AsyncRequest->Packet        = Packet;
+    AsyncRequest->QueueId       = QueueId;
     AsyncRequest->CommandId     = Sq->Cid;
     AsyncRequest->CallerEvent   = Event;
     AsyncRequest->MapData       = MapData;
@@ -740,7 +826,6 @@ NvmExpressPassThru (
     AsyncRequest->PrpListNo     = PrpListNo;
     AsyncRequest->PrpListHost   = PrpListHost;
 
-    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     InsertTailList (&Private->AsyncPassThruQueue, &AsyncRequest->Link);
     gBS->RestoreTPL (OldTpl);
 
@@ -876,20 +961,18 @@ EXIT:
              );
   }
 
-  if (MapPrpList != NULL) {
-    PciIo->Unmap (
-             PciIo,
-             MapPrpList
-             );
-  }
-
-  if (Prp != NULL) {
-    PciIo->FreeBuffer (PciIo, PrpListNo, PrpListHost);
+  if (PrpListHost != NULL) {
+    NvmeFreePrpList (Private, PrpListHost, PrpListNo, MapPrpList);
   }
 
   if (TimerEvent != NULL) {
     gBS->CloseEvent (TimerEvent);
   }
+
+  if (AsyncRequest != NULL) {
+    FreePool (AsyncRequest);
+    gBS->RestoreTPL (OldTpl);
+  }
   return Status;
 }
 
@@ -1786,6 +1786,7 @@ XhcCreateUsbHc (
   // Be caution that the Offset passed to XhcReadCapReg() should be Dword align
   //
   Xhc->CapLength        = XhcReadCapReg8 (Xhc, XHC_CAPLENGTH_OFFSET);
+  Xhc->HcVersion        = (UINT16) (XhcReadCapReg (Xhc, XHC_CAPLENGTH_OFFSET) >> 16);
   Xhc->HcSParams1.Dword = XhcReadCapReg (Xhc, XHC_HCSPARAMS1_OFFSET);
   Xhc->HcSParams2.Dword = XhcReadCapReg (Xhc, XHC_HCSPARAMS2_OFFSET);
   Xhc->HcCParams.Dword  = XhcReadCapReg (Xhc, XHC_HCCPARAMS_OFFSET);
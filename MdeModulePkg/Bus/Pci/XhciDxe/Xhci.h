@@ -76,6 +76,12 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 #define ERST_NUMBER                  0x01
 #define EVENT_RING_TRB_NUMBER        0x200
 
+//
+// Size of the buffer that bulk transfers bounce through when the controller
+// can't reach the caller's buffer. It covers the largest mass storage command.
+//
+#define XHC_BULK_BOUNCE_SIZE         SIZE_1MB
+
 #define CMD_INTER                    0
 #define CTRL_INTER                   1
 #define BULK_INTER                   2
@@ -219,6 +225,7 @@ struct _USB_XHCI_INSTANCE {
   LIST_ENTRY                AsyncIntTransfers;
 
   UINT8                     CapLength;    ///< Capability Register Length
+  UINT16                    HcVersion;    ///< Interface Version Number
   XHC_HCSPARAMS1            HcSParams1;   ///< Structural Parameters 1
   XHC_HCSPARAMS2            HcSParams2;   ///< Structural Parameters 2
   XHC_HCCPARAMS             HcCParams;    ///< Capability Parameters
@@ -258,6 +265,14 @@ struct _USB_XHCI_INSTANCE {
   USB_DEV_CONTEXT           UsbDevContext[256];
 
   BOOLEAN                   Support64BitDma; // Whether 64 bit DMA may be used with this device
+
+  //
+  // Bulk bounce buffer, allocated on first use
+  //
+  VOID                      *BulkBounce;
+  EFI_PHYSICAL_ADDRESS      BulkBouncePhy;
+  VOID                      *BulkBounceMap;
+  BOOLEAN                   BulkBounceBusy;
 };
 
 
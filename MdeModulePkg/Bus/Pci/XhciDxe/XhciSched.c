@@ -200,9 +200,104 @@ XhcFreeUrb (
     Xhc->PciIo->Unmap (Xhc->PciIo, Urb->DataMap);
   }
 
+  if (Urb->DataBounced) {
+    if (((UINT8) (Urb->Ep.Direction)) == EfiUsbDataIn) {
+      CopyMem (Urb->Data, Xhc->BulkBounce, Urb->Completed);
+    }
+    Xhc->BulkBounceBusy = FALSE;
+  }
+
   FreePool (Urb);
 }
 
+/**
+  Calculate the TD Size field of a Normal TRB, that is the number of packets
+  still to be transferred by the TD after this TRB. [xHCI 1.1 - 4.11.2.4]
+
+  @param  Xhc             The XHCI Instance.
+  @param  Urb             The URB the TRB belongs to.
+  @param  Transferred     The data length queued ahead of this TRB.
+  @param  TrbLength       The data length of this TRB.
+
+  @return The value of the TD Size field.
+
+**/
+UINT32
+XhcGetTdSize (
+  IN USB_XHCI_INSTANCE          *Xhc,
+  IN URB                        *Urb,
+  IN UINTN                      Transferred,
+  IN UINTN                      TrbLength
+  )
+{
+  UINTN                         Remainder;
+
+  if (Xhc->HcVersion < 0x100) {
+    //
+    // xHCI 0.96 counts the remaining bytes in 1KB units instead.
+    //
+    Remainder = (Urb->DataLen - Transferred) >> 10;
+  } else if (Transferred + TrbLength >= Urb->DataLen) {
+    Remainder = 0;
+  } else {
+    Remainder = (Urb->DataLen + Urb->Ep.MaxPacket - 1) / Urb->Ep.MaxPacket -
+                (Transferred + TrbLength) / Urb->Ep.MaxPacket;
+  }
+
+  return (UINT32) MIN (Remainder, 31);
+}
+
+/**
+  Route the data of a bulk transfer through the bulk bounce buffer if the
+  controller can't reach the caller's buffer.
+
+  Without 64-bit DMA, mapping a buffer above 4GB makes PciIo allocate and free
+  a bounce buffer below 4GB for every transfer. The bulk bounce buffer is
+  allocated once and reused instead. Only the bytes actually received are
+  copied back.
+
+  @param  Xhc     The XHCI Instance.
+  @param  Urb     The URB whose data is to be transferred.
+
+**/
+VOID
+XhcBounceBulkData (
+  IN USB_XHCI_INSTANCE          *Xhc,
+  IN URB                        *Urb
+  )
+{
+  EFI_STATUS                    Status;
+
+  if ((Urb->Ep.Type != XHC_BULK_TRANSFER) || Xhc->Support64BitDma ||
+      Xhc->BulkBounceBusy || (Urb->DataLen > XHC_BULK_BOUNCE_SIZE) ||
+      ((UINT64)(UINTN) Urb->Data + Urb->DataLen <= SIZE_4GB)) {
+    return;
+  }
+
+  if (Xhc->BulkBounce == NULL) {
+    Status = UsbHcAllocateAlignedPages (
+               Xhc->PciIo,
+               EFI_SIZE_TO_PAGES (XHC_BULK_BOUNCE_SIZE),
+               EFI_PAGE_SIZE,
+               &Xhc->BulkBounce,
+               &Xhc->BulkBouncePhy,
+               &Xhc->BulkBounceMap
+               );
+    if (EFI_ERROR (Status)) {
+      Xhc->BulkBounce = NULL;
+      return;
+    }
+  }
+
+  if (((UINT8) (Urb->Ep.Direction)) == EfiUsbDataOut) {
+    CopyMem (Xhc->BulkBounce, Urb->Data, Urb->DataLen);
+  }
+
+  Xhc->BulkBounceBusy = TRUE;
+  Urb->DataPhy        = (VOID *) ((UINTN) Xhc->BulkBouncePhy);
+  Urb->DataBounced    = TRUE;
+}
+
 /**
   Create a transfer TRB.
 
@@ -254,10 +349,14 @@ XhcCreateTransferTrb (
     EPType  = (UINT8) ((DEVICE_CONTEXT_64 *)OutputContext)->EP[Dci-1].EPType;
   }
 
+  if ((Urb->Data != NULL) && (Urb->DataMap == NULL) && !Urb->DataBounced) {
+    XhcBounceBulkData (Xhc, Urb);
+  }
+
   //
   // No need to remap.
   //
-  if ((Urb->Data != NULL) && (Urb->DataMap == NULL)) {
+  if ((Urb->Data != NULL) && (Urb->DataMap == NULL) && !Urb->DataBounced) {
     if (((UINT8) (Urb->Ep.Direction)) == EfiUsbDataIn) {
       MapOp = EfiPciIoOperationBusMasterWrite;
     } else {
@@ -371,30 +470,48 @@ XhcCreateTransferTrb (
 
     case ED_BULK_OUT:
     case ED_BULK_IN:
+      //
+      // Queue the whole transfer as a single TD by chaining the Normal TRBs,
+      // so the xHC raises one Transfer Event for the last TRB (or for a short
+      // packet) instead of one event per TRB. A TRB data buffer may not cross
+      // a 64KB boundary. [xHCI 1.1 - 4.11.7.1]
+      //
       TotalLen = 0;
       Len      = 0;
       TrbNum   = 0;
       TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
       while (TotalLen < Urb->DataLen) {
-        if ((TotalLen + 0x10000) >= Urb->DataLen) {
+        Len = 0x10000 - (((UINTN) Urb->DataPhy + TotalLen) & 0xFFFF);
+        if (Len > Urb->DataLen - TotalLen) {
           Len = Urb->DataLen - TotalLen;
-        } else {
-          Len = 0x10000;
         }
         TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
         TrbStart->TrbNormal.TRBPtrLo  = XHC_LOW_32BIT((UINT8 *) Urb->DataPhy + TotalLen);
         TrbStart->TrbNormal.TRBPtrHi  = XHC_HIGH_32BIT((UINT8 *) Urb->DataPhy + TotalLen);
         TrbStart->TrbNormal.Length    = (UINT32) Len;
-        TrbStart->TrbNormal.TDSize    = 0;
+        TrbStart->TrbNormal.TDSize    = XhcGetTdSize (Xhc, Urb, TotalLen, Len);
         TrbStart->TrbNormal.IntTarget = 0;
         TrbStart->TrbNormal.ISP       = 1;
-        TrbStart->TrbNormal.IOC       = 1;
         TrbStart->TrbNormal.Type      = TRB_TYPE_NORMAL;
+        if (TotalLen + Len < Urb->DataLen) {
+          TrbStart->TrbNormal.CH      = 1;
+          TrbStart->TrbNormal.IOC     = 0;
+        } else {
+          TrbStart->TrbNormal.CH      = 0;
+          TrbStart->TrbNormal.IOC     = 1;
+        }
         //
         // Update the cycle bit
         //
         TrbStart->TrbNormal.CycleBit = EPRing->RingPCS & BIT0;
 
+        //
+        // A Link TRB inside a TD must carry the chain bit. [xHCI 1.1 - 4.11.5.1]
+        //
+        if ((UINT8) ((TRB_TEMPLATE *) TrbStart + 1)->Type == TRB_TYPE_LINK) {
+          ((LINK_TRB *) ((TRB_TEMPLATE *) TrbStart + 1))->CH = TrbStart->TrbNormal.CH;
+        }
+
         XhcSyncTrsRing (Xhc, EPRing);
         TrbNum++;
         TotalLen += Len;
@@ -971,6 +1088,12 @@ XhcFreeSched (
 
   XhcFreeEventRing (Xhc,&Xhc->EventRing);
 
+  if (Xhc->BulkBounce != NULL) {
+    UsbHcFreeAlignedPages (Xhc->PciIo, Xhc->BulkBounce, EFI_SIZE_TO_PAGES (XHC_BULK_BOUNCE_SIZE), Xhc->BulkBounceMap);
+    Xhc->BulkBounce     = NULL;
+    Xhc->BulkBounceBusy = FALSE;
+  }
+
   if (Xhc->DCBAA != NULL) {
     UsbHcFreeMem (Xhc->MemPool, Xhc->DCBAA, (Xhc->MaxSlotsEn + 1) * sizeof(UINT64));
     Xhc->DCBAA = NULL;
@@ -1029,6 +1152,48 @@ IsTransferRingTrb (
   return FALSE;
 }
 
+/**
+  Sum up the data length of the TRBs of the URB, from its first TRB up to
+  and including the given TRB.
+
+  @param Xhc    The XHCI Instance.
+  @param Trb    The last TRB to be counted.
+  @param Urb    The URB owning the TRBs.
+
+  @return The total data length of the counted TRBs.
+
+**/
+UINTN
+XhcGetTrbsLength (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  TRB_TEMPLATE        *Trb,
+  IN  URB                 *Urb
+  )
+{
+  LINK_TRB      *LinkTrb;
+  TRB_TEMPLATE  *CheckedTrb;
+  UINTN         Index;
+  UINTN         Length;
+  EFI_PHYSICAL_ADDRESS PhyAddr;
+
+  Length     = 0;
+  CheckedTrb = Urb->TrbStart;
+  for (Index = 0; Index < Urb->TrbNum; Index++) {
+    Length += ((TRANSFER_TRB_NORMAL *) CheckedTrb)->Length;
+    if (Trb == CheckedTrb) {
+      break;
+    }
+    CheckedTrb++;
+    if (CheckedTrb->Type == TRB_TYPE_LINK) {
+      LinkTrb = (LINK_TRB *) CheckedTrb;
+      PhyAddr = (EFI_PHYSICAL_ADDRESS)(LinkTrb->PtrLo | LShiftU64 ((UINT64) LinkTrb->PtrHi, 32));
+      CheckedTrb = (TRB_TEMPLATE *)(UINTN) UsbHcGetHostAddrForPciAddr (Xhc->MemPool, (VOID *)(UINTN) PhyAddr, sizeof (TRB_TEMPLATE));
+    }
+  }
+
+  return Length;
+}
+
 /**
   Check if the Trb is a transaction of the URBs in XHCI's asynchronous transfer list.
 
@@ -1191,9 +1356,21 @@ XhcCheckUrbResult (
         }
 
         TRBType = (UINT8) (TRBPtr->Type);
-        if ((TRBType == TRB_TYPE_DATA_STAGE) ||
-            (TRBType == TRB_TYPE_NORMAL) ||
-            (TRBType == TRB_TYPE_ISOCH)) {
+        if ((CheckedUrb->Ep.Type == XHC_BULK_TRANSFER) && (TRBType == TRB_TYPE_NORMAL)) {
+          //
+          // The bulk TRBs form one TD, which reports a single event for its
+          // last TRB or for the TRB a short packet ends it on. Some xHCs also
+          // report the last TRB after a short packet, so ignore that one.
+          //
+          if (CheckedUrb->Finished) {
+            continue;
+          }
+          CheckedUrb->Completed = XhcGetTrbsLength (Xhc, TRBPtr, CheckedUrb) - EvtTrb->Length;
+          CheckedUrb->StartDone = TRUE;
+          CheckedUrb->EndDone   = TRUE;
+        } else if ((TRBType == TRB_TYPE_DATA_STAGE) ||
+                   (TRBType == TRB_TYPE_NORMAL) ||
+                   (TRBType == TRB_TYPE_ISOCH)) {
           CheckedUrb->Completed += (((TRANSFER_TRB_NORMAL*)TRBPtr)->Length - EvtTrb->Length);
         }
 
@@ -170,6 +170,7 @@ typedef struct _URB {
   UINTN                           DataLen;
   VOID                            *DataPhy;
   VOID                            *DataMap;
+  BOOLEAN                         DataBounced;
   EFI_ASYNC_USB_TRANSFER_CALLBACK Callback;
   VOID                            *Context;
   //
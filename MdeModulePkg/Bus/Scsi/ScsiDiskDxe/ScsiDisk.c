@@ -249,6 +249,8 @@ ScsiDiskDriverBindingStart (
   ScsiDiskDevice->BlockLimitsVpdSupported           = FALSE;
   ScsiDiskDevice->Handle                            = Controller;
   InitializeListHead (&ScsiDiskDevice->AsyncTaskQueue);
+  InitializeListHead (&ScsiDiskDevice->AsyncRequestPool);
+  InitializeListHead (&ScsiDiskDevice->PendingReadQueue);
 
   ScsiIo->GetDeviceType (ScsiIo, &(ScsiDiskDevice->DeviceType));
   switch (ScsiDiskDevice->DeviceType) {
@@ -836,7 +838,9 @@ ScsiDiskWriteBlocks (
   //
   // if all the parameters are valid, then perform read sectors command
   // to transfer data from device to host.
+  // Send the held back reads first, so that they do not see the new data.
   //
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, TRUE);
   Status = ScsiDiskWriteSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
 
 Done:
@@ -1079,13 +1083,17 @@ ScsiDiskReadBlocksEx (
   //
   if ((Token != NULL) && (Token->Event != NULL)) {
     Token->TransactionStatus = EFI_SUCCESS;
-    Status = ScsiDiskAsyncReadSectors (
-               ScsiDiskDevice,
-               Buffer,
-               Lba,
-               NumberOfBlocks,
-               Token
-               );
+    if (ScsiDiskDeferAsyncRead (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks, Token)) {
+      Status = EFI_SUCCESS;
+    } else {
+      Status = ScsiDiskAsyncReadSectors (
+                 ScsiDiskDevice,
+                 Buffer,
+                 Lba,
+                 NumberOfBlocks,
+                 Token
+                 );
+    }
   } else {
     Status = ScsiDiskReadSectors (
                ScsiDiskDevice,
@@ -1257,7 +1265,10 @@ ScsiDiskWriteBlocksEx (
   //
   // if all the parameters are valid, then perform write sectors command
   // to transfer data from device to host.
+  // Send the held back reads first, so that they do not see the new data.
   //
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, TRUE);
+
   if ((Token != NULL) && (Token->Event != NULL)) {
     Token->TransactionStatus = EFI_SUCCESS;
     Status = ScsiDiskAsyncWriteSectors (
@@ -1784,6 +1795,11 @@ ScsiDiskEraseBlocks (
     goto Done;
   }
 
+  //
+  // Send the held back reads first, so that they do not see the erased data.
+  //
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, TRUE);
+
   if ((Token != NULL) && (Token->Event != NULL)) {
     Status = ScsiDiskUnmap (ScsiDiskDevice, Lba, NumberOfBlocks, Token);
   } else {
@@ -2578,6 +2594,18 @@ ScsiDiskInquiryDevice (
               (BlockLimits->OptimalTransferLengthGranularity2 << 8) |
                BlockLimits->OptimalTransferLengthGranularity1;
 
+            ScsiDiskDevice->MaxTransferBlocks =
+              (BlockLimits->MaximumTransferLength4 << 24) |
+              (BlockLimits->MaximumTransferLength3 << 16) |
+              (BlockLimits->MaximumTransferLength2 << 8)  |
+              BlockLimits->MaximumTransferLength1;
+            DEBUG ((
+              DEBUG_INFO,
+              "ScsiDisk: Maximum transfer length %d blocks, granularity %d blocks\n",
+              ScsiDiskDevice->MaxTransferBlocks,
+              ScsiDiskDevice->BlkIo.Media->OptimalTransferLengthGranularity
+              ));
+
             ScsiDiskDevice->UnmapInfo.MaxLbaCnt =
               (BlockLimits->MaximumUnmapLbaCount4 << 24) |
               (BlockLimits->MaximumUnmapLbaCount3 << 16) |
@@ -3387,13 +3415,9 @@ ScsiDiskReadSectors (
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
 
   //
-  // limit the data bytes that can be transferred by one Read(10) or Read(16) Command
+  // Limit the data bytes that can be transferred by one command
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
-  }
+  MaxBlock = ScsiDiskGetMaxTransferBlocks (ScsiDiskDevice);
 
   PtrBuffer = Buffer;
 
@@ -3501,8 +3525,12 @@ ScsiDiskReadSectors (
     }
 
     //
-    // actual transferred sectors
+    // actual transferred sectors, fewer than asked for if the device needed
+    // shorter transfers
     //
+    if (ByteCount / BlockSize < SectorCount) {
+      ScsiDiskLimitTransferBlocks (ScsiDiskDevice, ByteCount / BlockSize);
+    }
     SectorCount = ByteCount / BlockSize;
 
     Lba += SectorCount;
@@ -3552,13 +3580,9 @@ ScsiDiskWriteSectors (
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
 
   //
-  // limit the data bytes that can be transferred by one Read(10) or Read(16) Command
+  // Limit the data bytes that can be transferred by one command
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
-  }
+  MaxBlock = ScsiDiskGetMaxTransferBlocks (ScsiDiskDevice);
 
   PtrBuffer = Buffer;
 
@@ -3664,8 +3688,12 @@ ScsiDiskWriteSectors (
       return EFI_DEVICE_ERROR;
     }
     //
-    // actual transferred sectors
+    // actual transferred sectors, fewer than asked for if the device needed
+    // shorter transfers
     //
+    if (ByteCount / BlockSize < SectorCount) {
+      ScsiDiskLimitTransferBlocks (ScsiDiskDevice, ByteCount / BlockSize);
+    }
     SectorCount = ByteCount / BlockSize;
 
     Lba += SectorCount;
@@ -3708,6 +3736,7 @@ ScsiDiskAsyncReadSectors (
   UINT32                SectorCount;
   UINT64                Timeout;
   SCSI_BLKIO2_REQUEST   *BlkIo2Req;
+  BOOLEAN               Shortened;
   EFI_STATUS            Status;
   EFI_TPL               OldTpl;
 
@@ -3724,6 +3753,7 @@ ScsiDiskAsyncReadSectors (
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   InsertTailList (&ScsiDiskDevice->AsyncTaskQueue, &BlkIo2Req->Link);
+  ScsiDiskDevice->BlkIo2RequestCount++;
   gBS->RestoreTPL (OldTpl);
 
   InitializeListHead (&BlkIo2Req->ScsiRWQueue);
@@ -3734,14 +3764,10 @@ ScsiDiskAsyncReadSectors (
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
 
   //
-  // Limit the data bytes that can be transferred by one Read(10) or Read(16)
-  // Command
+  // Limit the data bytes that can be transferred by one command
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
-  }
+  MaxBlock  = ScsiDiskGetMaxTransferBlocks (ScsiDiskDevice);
+  Shortened = FALSE;
 
   PtrBuffer = Buffer;
 
@@ -3827,7 +3853,8 @@ ScsiDiskAsyncReadSectors (
       //
       if ((Status == EFI_DEVICE_ERROR) || (Status == EFI_TIMEOUT)) {
         if ((MaxBlock > 1) && (SectorCount > 1)) {
-          MaxBlock = MIN (MaxBlock, SectorCount) >> 1;
+          MaxBlock  = MIN (MaxBlock, SectorCount) >> 1;
+          Shortened = TRUE;
           continue;
         }
       }
@@ -3840,6 +3867,7 @@ ScsiDiskAsyncReadSectors (
         // function ScsiDiskNotify().
         //
         RemoveEntryList (&BlkIo2Req->Link);
+        ScsiDiskDevice->BlkIo2RequestCount--;
         FreePool (BlkIo2Req);
         BlkIo2Req = NULL;
         gBS->RestoreTPL (OldTpl);
@@ -3856,13 +3884,22 @@ ScsiDiskAsyncReadSectors (
         //
         // There are previous SCSI commands still running, EFI_SUCCESS should
         // be returned to make sure that the caller does not free resources
-        // still using by these SCSI commands.
+        // still using by these SCSI commands. The request still fails.
         //
+        Token->TransactionStatus = EFI_DEVICE_ERROR;
         Status = EFI_SUCCESS;
         goto Done;
       }
     }
 
+    //
+    // Keep the shorter length the device accepted for later commands
+    //
+    if (Shortened) {
+      ScsiDiskLimitTransferBlocks (ScsiDiskDevice, MaxBlock);
+      Shortened = FALSE;
+    }
+
     //
     // Sectors submitted for transfer
     //
@@ -3882,6 +3919,7 @@ Done:
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     if (IsListEmpty (&BlkIo2Req->ScsiRWQueue)) {
       RemoveEntryList (&BlkIo2Req->Link);
+      ScsiDiskDevice->BlkIo2RequestCount--;
       FreePool (BlkIo2Req);
       BlkIo2Req = NULL;
 
@@ -3890,6 +3928,8 @@ Done:
     gBS->RestoreTPL (OldTpl);
   }
 
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, FALSE);
+
   return Status;
 }
 
@@ -3925,6 +3965,7 @@ ScsiDiskAsyncWriteSectors (
   UINT32                SectorCount;
   UINT64                Timeout;
   SCSI_BLKIO2_REQUEST   *BlkIo2Req;
+  BOOLEAN               Shortened;
   EFI_STATUS            Status;
   EFI_TPL               OldTpl;
 
@@ -3941,6 +3982,7 @@ ScsiDiskAsyncWriteSectors (
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   InsertTailList (&ScsiDiskDevice->AsyncTaskQueue, &BlkIo2Req->Link);
+  ScsiDiskDevice->BlkIo2RequestCount++;
   gBS->RestoreTPL (OldTpl);
 
   InitializeListHead (&BlkIo2Req->ScsiRWQueue);
@@ -3951,14 +3993,10 @@ ScsiDiskAsyncWriteSectors (
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
 
   //
-  // Limit the data bytes that can be transferred by one Read(10) or Read(16)
-  // Command
+  // Limit the data bytes that can be transferred by one command
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
-  }
+  MaxBlock  = ScsiDiskGetMaxTransferBlocks (ScsiDiskDevice);
+  Shortened = FALSE;
 
   PtrBuffer = Buffer;
 
@@ -4044,7 +4082,8 @@ ScsiDiskAsyncWriteSectors (
       //
       if ((Status == EFI_DEVICE_ERROR) || (Status == EFI_TIMEOUT)) {
         if ((MaxBlock > 1) && (SectorCount > 1)) {
-          MaxBlock = MIN (MaxBlock, SectorCount) >> 1;
+          MaxBlock  = MIN (MaxBlock, SectorCount) >> 1;
+          Shortened = TRUE;
           continue;
         }
       }
@@ -4057,6 +4096,7 @@ ScsiDiskAsyncWriteSectors (
         // function ScsiDiskNotify().
         //
         RemoveEntryList (&BlkIo2Req->Link);
+        ScsiDiskDevice->BlkIo2RequestCount--;
         FreePool (BlkIo2Req);
         BlkIo2Req = NULL;
         gBS->RestoreTPL (OldTpl);
@@ -4073,13 +4113,22 @@ ScsiDiskAsyncWriteSectors (
         //
         // There are previous SCSI commands still running, EFI_SUCCESS should
         // be returned to make sure that the caller does not free resources
-        // still using by these SCSI commands.
+        // still using by these SCSI commands. The request still fails.
         //
+        Token->TransactionStatus = EFI_DEVICE_ERROR;
         Status = EFI_SUCCESS;
         goto Done;
       }
     }
 
+    //
+    // Keep the shorter length the device accepted for later commands
+    //
+    if (Shortened) {
+      ScsiDiskLimitTransferBlocks (ScsiDiskDevice, MaxBlock);
+      Shortened = FALSE;
+    }
+
     //
     // Sectors submitted for transfer
     //
@@ -4099,6 +4148,7 @@ Done:
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     if (IsListEmpty (&BlkIo2Req->ScsiRWQueue)) {
       RemoveEntryList (&BlkIo2Req->Link);
+      ScsiDiskDevice->BlkIo2RequestCount--;
       FreePool (BlkIo2Req);
       BlkIo2Req = NULL;
 
@@ -4107,6 +4157,8 @@ Done:
     gBS->RestoreTPL (OldTpl);
   }
 
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, FALSE);
+
   return Status;
 }
 
@@ -4606,6 +4658,445 @@ BackOff:
 }
 
 
+/**
+  Get the maximum number of blocks to move with one Read/Write command.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+
+  @return The maximum number of blocks of one Read/Write command.
+
+**/
+UINT32
+ScsiDiskGetMaxTransferBlocks (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice
+  )
+{
+  UINT32                       MaxBlock;
+  UINT32                       Granularity;
+
+  //
+  // Limit the data bytes that can be transferred by one Read(10)/Write(10) or
+  // Read(16)/Write(16) Command
+  //
+  if (!ScsiDiskDevice->Cdb16Byte) {
+    MaxBlock = 0xFFFF;
+  } else {
+    MaxBlock = 0xFFFFFFFF;
+  }
+
+  //
+  // Honor the limit of the Block Limits VPD page and the length the device
+  // fell back to before, rounded down to the optimal transfer length
+  // granularity so that split commands stay aligned on it.
+  //
+  if ((ScsiDiskDevice->MaxTransferBlocks != 0) &&
+      (ScsiDiskDevice->MaxTransferBlocks < MaxBlock)) {
+    MaxBlock = ScsiDiskDevice->MaxTransferBlocks;
+  }
+  if ((ScsiDiskDevice->BackOffTransferBlocks != 0) &&
+      (ScsiDiskDevice->BackOffTransferBlocks < MaxBlock)) {
+    MaxBlock = ScsiDiskDevice->BackOffTransferBlocks;
+  }
+
+  Granularity = ScsiDiskDevice->BlkIo.Media->OptimalTransferLengthGranularity;
+  if ((Granularity > 1) && (MaxBlock >= Granularity)) {
+    MaxBlock -= MaxBlock % Granularity;
+  }
+
+  return MaxBlock;
+}
+
+/**
+  Remember that the device only accepted a shorter Read/Write command, so that
+  later commands are not made longer than that.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  SectorCount        The number of blocks of the shorter command.
+
+**/
+VOID
+ScsiDiskLimitTransferBlocks (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN UINT32                    SectorCount
+  )
+{
+  if ((SectorCount != 0) &&
+      ((ScsiDiskDevice->BackOffTransferBlocks == 0) ||
+       (SectorCount < ScsiDiskDevice->BackOffTransferBlocks))) {
+    DEBUG ((EFI_D_INFO, "ScsiDisk: Limit Read/Write commands to %d blocks\n", SectorCount));
+    ScsiDiskDevice->BackOffTransferBlocks = SectorCount;
+  }
+}
+
+/**
+  Get a SCSI Read/Write sub-task structure, reusing a completed one of the
+  device when there is one.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+
+  @return The zeroed sub-task structure with its sense data buffer, or NULL
+          if there is not enough memory.
+
+**/
+SCSI_ASYNC_RW_REQUEST *
+ScsiDiskAllocateAsyncRequest (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice
+  )
+{
+  SCSI_ASYNC_RW_REQUEST        *Request;
+  EFI_SCSI_SENSE_DATA          *SenseData;
+  EFI_TPL                      OldTpl;
+
+  Request = NULL;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (!IsListEmpty (&ScsiDiskDevice->AsyncRequestPool)) {
+    Request = BASE_CR (
+                GetFirstNode (&ScsiDiskDevice->AsyncRequestPool),
+                SCSI_ASYNC_RW_REQUEST,
+                Link
+                );
+    RemoveEntryList (&Request->Link);
+    ScsiDiskDevice->AsyncRequestPoolCount--;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Request != NULL) {
+    SenseData = Request->SenseData;
+    ZeroMem (Request, sizeof (SCSI_ASYNC_RW_REQUEST));
+    ZeroMem (SenseData, 6 * sizeof (EFI_SCSI_SENSE_DATA));
+  } else {
+    Request = AllocateZeroPool (sizeof (SCSI_ASYNC_RW_REQUEST));
+    if (Request == NULL) {
+      return NULL;
+    }
+
+    SenseData = AllocateZeroPool (6 * sizeof (EFI_SCSI_SENSE_DATA));
+    if (SenseData == NULL) {
+      FreePool (Request);
+      return NULL;
+    }
+  }
+
+  Request->SenseData       = SenseData;
+  Request->SenseDataLength = (UINT8) (6 * sizeof (EFI_SCSI_SENSE_DATA));
+
+  return Request;
+}
+
+/**
+  Return a SCSI Read/Write sub-task structure to the device for reuse, or
+  free it if the device keeps enough of them already.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Request            The sub-task structure.
+
+**/
+VOID
+ScsiDiskFreeAsyncRequest (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN SCSI_ASYNC_RW_REQUEST     *Request
+  )
+{
+  EFI_TPL                      OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (ScsiDiskDevice->AsyncRequestPoolCount < SCSI_DISK_ASYNC_REQUEST_POOL_SIZE) {
+    InsertTailList (&ScsiDiskDevice->AsyncRequestPool, &Request->Link);
+    ScsiDiskDevice->AsyncRequestPoolCount++;
+    Request = NULL;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Request != NULL) {
+    FreePool (Request->SenseData);
+    FreePool (Request);
+  }
+}
+
+/**
+  Hold back a small BlockIo2 read while other BlockIo2 requests of the device
+  are running, so that it can be merged with adjacent reads queued meanwhile.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Buffer             The buffer to fill the read out data.
+  @param  Lba                The logic block address.
+  @param  NumberOfBlocks     The number of blocks to read.
+  @param  Token              The pointer to the token associated with the
+                             non-blocking read request.
+
+  @retval TRUE               The read is queued and will be sent later.
+  @retval FALSE              The read must be sent now.
+
+**/
+BOOLEAN
+ScsiDiskDeferAsyncRead (
+  IN  SCSI_DISK_DEV            *ScsiDiskDevice,
+  OUT VOID                     *Buffer,
+  IN  EFI_LBA                  Lba,
+  IN  UINTN                    NumberOfBlocks,
+  IN  EFI_BLOCK_IO2_TOKEN      *Token
+  )
+{
+  SCSI_PENDING_READ            *Read;
+  EFI_TPL                      OldTpl;
+
+  //
+  // Removable media may change before the held back read is sent.
+  //
+  if (!IS_DEVICE_FIXED (ScsiDiskDevice) ||
+      (NumberOfBlocks > SCSI_DISK_MERGE_READ_MAX_SIZE / ScsiDiskDevice->BlkIo.Media->BlockSize) ||
+      (ScsiDiskDevice->BlkIo2RequestCount == 0)) {
+    return FALSE;
+  }
+
+  Read = AllocatePool (sizeof (SCSI_PENDING_READ));
+  if (Read == NULL) {
+    return FALSE;
+  }
+
+  Read->Token          = Token;
+  Read->Buffer         = Buffer;
+  Read->Lba            = Lba;
+  Read->NumberOfBlocks = NumberOfBlocks;
+
+  //
+  // Check again at TPL_NOTIFY, the running requests may have completed since.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (ScsiDiskDevice->BlkIo2RequestCount != 0) {
+    InsertTailList (&ScsiDiskDevice->PendingReadQueue, &Read->Link);
+    Read = NULL;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Read != NULL) {
+    FreePool (Read);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Send the BlockIo2 reads held back by ScsiDiskDeferAsyncRead() once no other
+  BlockIo2 request of the device is running, merging adjacent ones.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Force              Send them even if other requests are running.
+
+**/
+VOID
+ScsiDiskIssuePendingReads (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN BOOLEAN                   Force
+  )
+{
+  LIST_ENTRY                   Reads;
+  LIST_ENTRY                   *Link;
+  SCSI_PENDING_READ            *Read;
+  SCSI_PENDING_READ            *Next;
+  SCSI_MERGED_READ             *MergedRead;
+  UINT32                       BlockSize;
+  UINTN                        MaxBlock;
+  UINTN                        NumberOfBlocks;
+  EFI_STATUS                   Status;
+  EFI_TPL                      OldTpl;
+
+  InitializeListHead (&Reads);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (Force || (ScsiDiskDevice->BlkIo2RequestCount == 0)) {
+    while (!IsListEmpty (&ScsiDiskDevice->PendingReadQueue)) {
+      Link = GetFirstNode (&ScsiDiskDevice->PendingReadQueue);
+      RemoveEntryList (Link);
+      InsertTailList (&Reads, Link);
+    }
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (IsListEmpty (&Reads)) {
+    return;
+  }
+
+  //
+  // A merged read is kept to one Read command.
+  //
+  BlockSize = ScsiDiskDevice->BlkIo.Media->BlockSize;
+  MaxBlock  = MIN (ScsiDiskGetMaxTransferBlocks (ScsiDiskDevice), SCSI_DISK_MERGE_READ_MAX_SIZE / BlockSize);
+
+  while (!IsListEmpty (&Reads)) {
+    Read = BASE_CR (GetFirstNode (&Reads), SCSI_PENDING_READ, Link);
+    RemoveEntryList (&Read->Link);
+
+    //
+    // Gather the following reads which start where the previous one ends.
+    //
+    MergedRead     = NULL;
+    NumberOfBlocks = Read->NumberOfBlocks;
+    while (!IsListEmpty (&Reads)) {
+      Next = BASE_CR (GetFirstNode (&Reads), SCSI_PENDING_READ, Link);
+      if ((Next->Lba != Read->Lba + NumberOfBlocks) ||
+          (NumberOfBlocks + Next->NumberOfBlocks > MaxBlock)) {
+        break;
+      }
+
+      if (MergedRead == NULL) {
+        MergedRead = AllocateZeroPool (sizeof (SCSI_MERGED_READ));
+        if (MergedRead == NULL) {
+          break;
+        }
+        MergedRead->ScsiDiskDevice = ScsiDiskDevice;
+        InitializeListHead (&MergedRead->Reads);
+        InsertTailList (&MergedRead->Reads, &Read->Link);
+      }
+
+      RemoveEntryList (&Next->Link);
+      InsertTailList (&MergedRead->Reads, &Next->Link);
+      NumberOfBlocks += Next->NumberOfBlocks;
+    }
+
+    if (MergedRead == NULL) {
+      ScsiDiskIssuePendingRead (ScsiDiskDevice, Read);
+      continue;
+    }
+
+    MergedRead->BufferSize = NumberOfBlocks * BlockSize;
+    MergedRead->Buffer     = AllocateAlignedBuffer (ScsiDiskDevice, MergedRead->BufferSize);
+    if (MergedRead->Buffer == NULL) {
+      ScsiDiskCompleteMergedRead (MergedRead, EFI_OUT_OF_RESOURCES);
+      continue;
+    }
+
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    ScsiDiskMergedReadNotify,
+                    MergedRead,
+                    &MergedRead->Token.Event
+                    );
+    if (EFI_ERROR (Status)) {
+      ScsiDiskCompleteMergedRead (MergedRead, Status);
+      continue;
+    }
+
+    MergedRead->Token.TransactionStatus = EFI_SUCCESS;
+    Status = ScsiDiskAsyncReadSectors (
+               ScsiDiskDevice,
+               MergedRead->Buffer,
+               Read->Lba,
+               NumberOfBlocks,
+               &MergedRead->Token
+               );
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (MergedRead->Token.Event);
+      ScsiDiskCompleteMergedRead (MergedRead, Status);
+    }
+  }
+}
+
+/**
+  Send a BlockIo2 read held back by ScsiDiskDeferAsyncRead() on its own, and
+  free its SCSI_PENDING_READ structure.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Read               The held back read.
+
+**/
+VOID
+ScsiDiskIssuePendingRead (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN SCSI_PENDING_READ         *Read
+  )
+{
+  EFI_STATUS                   Status;
+
+  Status = ScsiDiskAsyncReadSectors (
+             ScsiDiskDevice,
+             Read->Buffer,
+             Read->Lba,
+             Read->NumberOfBlocks,
+             Read->Token
+             );
+  if (EFI_ERROR (Status)) {
+    //
+    // The caller was already told that the read is queued.
+    //
+    Read->Token->TransactionStatus = Status;
+    gBS->SignalEvent (Read->Token->Event);
+  }
+
+  FreePool (Read);
+}
+
+/**
+  Finish a merged read: copy the data out to the reads it serves, or send them
+  one by one if the merged read failed. Then free the merged read.
+
+  @param  MergedRead         The merged read.
+  @param  Status             The status of the merged read.
+
+**/
+VOID
+ScsiDiskCompleteMergedRead (
+  IN SCSI_MERGED_READ          *MergedRead,
+  IN EFI_STATUS                Status
+  )
+{
+  SCSI_PENDING_READ            *Read;
+  UINT8                        *Data;
+  UINTN                        Size;
+
+  Data = MergedRead->Buffer;
+
+  while (!IsListEmpty (&MergedRead->Reads)) {
+    Read = BASE_CR (GetFirstNode (&MergedRead->Reads), SCSI_PENDING_READ, Link);
+    RemoveEntryList (&Read->Link);
+
+    if (EFI_ERROR (Status)) {
+      //
+      // Let each read go through the usual retries, so that only the reads
+      // which really fail report an error.
+      //
+      ScsiDiskIssuePendingRead (MergedRead->ScsiDiskDevice, Read);
+      continue;
+    }
+
+    Size = Read->NumberOfBlocks * MergedRead->ScsiDiskDevice->BlkIo.Media->BlockSize;
+    CopyMem (Read->Buffer, Data, Size);
+    Data += Size;
+
+    Read->Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Read->Token->Event);
+    FreePool (Read);
+  }
+
+  FreeAlignedBuffer (MergedRead->Buffer, MergedRead->BufferSize);
+  FreePool (MergedRead);
+}
+
+/**
+  Notify function of a merged read.
+
+  @param  Event    The instance of EFI_EVENT.
+  @param  Context  The parameter passed in.
+
+**/
+VOID
+EFIAPI
+ScsiDiskMergedReadNotify (
+  IN  EFI_EVENT  Event,
+  IN  VOID       *Context
+  )
+{
+  SCSI_MERGED_READ             *MergedRead;
+
+  gBS->CloseEvent (Event);
+
+  MergedRead = (SCSI_MERGED_READ *) Context;
+  ScsiDiskCompleteMergedRead (MergedRead, MergedRead->Token.TransactionStatus);
+}
+
 /**
   Internal helper notify function in which determine whether retry of a SCSI
   Read/Write command is needed and signal the event passed from Block I/O(2) if
@@ -4717,6 +5208,7 @@ ScsiDiskNotify (
       Request->SectorCount >>= 1;
       Request->DataLength = Request->SectorCount * ScsiDiskDevice->BlkIo.Media->BlockSize;
       Request->TimesRetry  = 0;
+      ScsiDiskLimitTransferBlocks (ScsiDiskDevice, Request->SectorCount);
 
       goto Retry;
     } else {
@@ -4877,12 +5369,17 @@ Exit:
     // The last SCSI R/W command of a BlockIo2 request completes
     //
     RemoveEntryList (&Request->BlkIo2Req->Link);
+    ScsiDiskDevice->BlkIo2RequestCount--;
     FreePool (Request->BlkIo2Req);  // Should be freed only once
     gBS->SignalEvent (Token->Event);
   }
 
-  FreePool (Request->SenseData);
-  FreePool (Request);
+  ScsiDiskFreeAsyncRequest (ScsiDiskDevice, Request);
+
+  //
+  // Held back reads are sent once the device has nothing else to do
+  //
+  ScsiDiskIssuePendingReads (ScsiDiskDevice, FALSE);
 }
 
 
@@ -4926,7 +5423,7 @@ ScsiDiskAsyncRead10 (
 
   AsyncIoEvent = NULL;
 
-  Request = AllocateZeroPool (sizeof (SCSI_ASYNC_RW_REQUEST));
+  Request = ScsiDiskAllocateAsyncRequest (ScsiDiskDevice);
   if (Request == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -4935,13 +5432,6 @@ ScsiDiskAsyncRead10 (
   InsertTailList (&BlkIo2Req->ScsiRWQueue, &Request->Link);
   gBS->RestoreTPL (OldTpl);
 
-  Request->SenseDataLength = (UINT8) (6 * sizeof (EFI_SCSI_SENSE_DATA));
-  Request->SenseData       = AllocateZeroPool (Request->SenseDataLength);
-  if (Request->SenseData == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto ErrorExit;
-  }
-
   Request->ScsiDiskDevice  = ScsiDiskDevice;
   Request->Timeout         = Timeout;
   Request->TimesRetry      = TimesRetry;
@@ -4990,15 +5480,11 @@ ErrorExit:
   }
 
   if (Request != NULL) {
-    if (Request->SenseData != NULL) {
-      FreePool (Request->SenseData);
-    }
-
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     RemoveEntryList (&Request->Link);
     gBS->RestoreTPL (OldTpl);
 
-    FreePool (Request);
+    ScsiDiskFreeAsyncRequest (ScsiDiskDevice, Request);
   }
 
   return Status;
@@ -5045,7 +5531,7 @@ ScsiDiskAsyncWrite10 (
 
   AsyncIoEvent = NULL;
 
-  Request = AllocateZeroPool (sizeof (SCSI_ASYNC_RW_REQUEST));
+  Request = ScsiDiskAllocateAsyncRequest (ScsiDiskDevice);
   if (Request == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -5054,13 +5540,6 @@ ScsiDiskAsyncWrite10 (
   InsertTailList (&BlkIo2Req->ScsiRWQueue, &Request->Link);
   gBS->RestoreTPL (OldTpl);
 
-  Request->SenseDataLength = (UINT8) (6 * sizeof (EFI_SCSI_SENSE_DATA));
-  Request->SenseData       = AllocateZeroPool (Request->SenseDataLength);
-  if (Request->SenseData == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto ErrorExit;
-  }
-
   Request->ScsiDiskDevice  = ScsiDiskDevice;
   Request->Timeout         = Timeout;
   Request->TimesRetry      = TimesRetry;
@@ -5109,15 +5588,11 @@ ErrorExit:
   }
 
   if (Request != NULL) {
-    if (Request->SenseData != NULL) {
-      FreePool (Request->SenseData);
-    }
-
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     RemoveEntryList (&Request->Link);
     gBS->RestoreTPL (OldTpl);
 
-    FreePool (Request);
+    ScsiDiskFreeAsyncRequest (ScsiDiskDevice, Request);
   }
 
   return Status;
@@ -5164,7 +5639,7 @@ ScsiDiskAsyncRead16 (
 
   AsyncIoEvent = NULL;
 
-  Request = AllocateZeroPool (sizeof (SCSI_ASYNC_RW_REQUEST));
+  Request = ScsiDiskAllocateAsyncRequest (ScsiDiskDevice);
   if (Request == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -5173,13 +5648,6 @@ ScsiDiskAsyncRead16 (
   InsertTailList (&BlkIo2Req->ScsiRWQueue, &Request->Link);
   gBS->RestoreTPL (OldTpl);
 
-  Request->SenseDataLength = (UINT8) (6 * sizeof (EFI_SCSI_SENSE_DATA));
-  Request->SenseData       = AllocateZeroPool (Request->SenseDataLength);
-  if (Request->SenseData == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto ErrorExit;
-  }
-
   Request->ScsiDiskDevice  = ScsiDiskDevice;
   Request->Timeout         = Timeout;
   Request->TimesRetry      = TimesRetry;
@@ -5228,15 +5696,11 @@ ErrorExit:
   }
 
   if (Request != NULL) {
-    if (Request->SenseData != NULL) {
-      FreePool (Request->SenseData);
-    }
-
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     RemoveEntryList (&Request->Link);
     gBS->RestoreTPL (OldTpl);
 
-    FreePool (Request);
+    ScsiDiskFreeAsyncRequest (ScsiDiskDevice, Request);
   }
 
   return Status;
@@ -5283,7 +5747,7 @@ ScsiDiskAsyncWrite16 (
 
   AsyncIoEvent = NULL;
 
-  Request = AllocateZeroPool (sizeof (SCSI_ASYNC_RW_REQUEST));
+  Request = ScsiDiskAllocateAsyncRequest (ScsiDiskDevice);
   if (Request == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -5292,13 +5756,6 @@ ScsiDiskAsyncWrite16 (
   InsertTailList (&BlkIo2Req->ScsiRWQueue, &Request->Link);
   gBS->RestoreTPL (OldTpl);
 
-  Request->SenseDataLength = (UINT8) (6 * sizeof (EFI_SCSI_SENSE_DATA));
-  Request->SenseData       = AllocateZeroPool (Request->SenseDataLength);
-  if (Request->SenseData == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto ErrorExit;
-  }
-
   Request->ScsiDiskDevice  = ScsiDiskDevice;
   Request->Timeout         = Timeout;
   Request->TimesRetry      = TimesRetry;
@@ -5347,15 +5804,11 @@ ErrorExit:
   }
 
   if (Request != NULL) {
-    if (Request->SenseData != NULL) {
-      FreePool (Request->SenseData);
-    }
-
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     RemoveEntryList (&Request->Link);
     gBS->RestoreTPL (OldTpl);
 
-    FreePool (Request);
+    ScsiDiskFreeAsyncRequest (ScsiDiskDevice, Request);
   }
 
   return Status;
@@ -5728,6 +6181,8 @@ ReleaseScsiDiskDeviceResources (
   IN  SCSI_DISK_DEV   *ScsiDiskDevice
   )
 {
+  SCSI_ASYNC_RW_REQUEST  *Request;
+
   if (ScsiDiskDevice == NULL) {
     return ;
   }
@@ -5737,6 +6192,18 @@ ReleaseScsiDiskDeviceResources (
     ScsiDiskDevice->SenseData = NULL;
   }
 
+  while (!IsListEmpty (&ScsiDiskDevice->AsyncRequestPool)) {
+    Request = BASE_CR (
+                GetFirstNode (&ScsiDiskDevice->AsyncRequestPool),
+                SCSI_ASYNC_RW_REQUEST,
+                Link
+                );
+    RemoveEntryList (&Request->Link);
+    FreePool (Request->SenseData);
+    FreePool (Request);
+  }
+  ScsiDiskDevice->AsyncRequestPoolCount = 0;
+
   if (ScsiDiskDevice->ControllerNameTable != NULL) {
     FreeUnicodeStringTable (ScsiDiskDevice->ControllerNameTable);
     ScsiDiskDevice->ControllerNameTable = NULL;
@@ -88,6 +88,18 @@ typedef struct {
   SCSI_UNMAP_PARAM_INFO     UnmapInfo;
   BOOLEAN                   BlockLimitsVpdSupported;
 
+  //
+  // Maximum number of blocks in one Read/Write command reported by the Block
+  // Limits VPD page, 0 if the device reports no limit
+  //
+  UINT32                    MaxTransferBlocks;
+
+  //
+  // Number of blocks the device last accepted after asking for a shorter
+  // transfer, 0 if it never did. Later commands are not made longer.
+  //
+  UINT32                    BackOffTransferBlocks;
+
   //
   // The flag indicates if 16-byte command can be used
   //
@@ -97,6 +109,23 @@ typedef struct {
   // The queue for asynchronous task requests
   //
   LIST_ENTRY                AsyncTaskQueue;
+
+  //
+  // Number of BlockIo2 read/write requests in AsyncTaskQueue
+  //
+  UINTN                     BlkIo2RequestCount;
+
+  //
+  // Completed SCSI Read/Write sub-task structures kept for reuse
+  //
+  LIST_ENTRY                AsyncRequestPool;
+  UINTN                     AsyncRequestPoolCount;
+
+  //
+  // Small BlockIo2 reads held back while other requests are running, so that
+  // adjacent ones can be merged into one command
+  //
+  LIST_ENTRY                PendingReadQueue;
 } SCSI_DISK_DEV;
 
 #define SCSI_DISK_DEV_FROM_BLKIO(a)  CR (a, SCSI_DISK_DEV, BlkIo, SCSI_DISK_DEV_SIGNATURE)
@@ -153,6 +182,34 @@ typedef struct {
   LIST_ENTRY                           Link;
 } SCSI_ASYNC_RW_REQUEST;
 
+//
+// Private data structure for a BlockIo2 read held back for merging
+//
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN                  *Token;
+  UINT8                                *Buffer;
+  EFI_LBA                              Lba;
+  UINTN                                NumberOfBlocks;
+
+  LIST_ENTRY                           Link;
+} SCSI_PENDING_READ;
+
+//
+// Private data structure for adjacent BlockIo2 reads merged into one read
+// through a bounce buffer
+//
+typedef struct {
+  SCSI_DISK_DEV                        *ScsiDiskDevice;
+  EFI_BLOCK_IO2_TOKEN                  Token;
+  UINT8                                *Buffer;
+  UINTN                                BufferSize;
+
+  //
+  // The SCSI_PENDING_READ structures served by the merged read
+  //
+  LIST_ENTRY                           Reads;
+} SCSI_MERGED_READ;
+
 //
 // Private data structure for an EraseBlock request
 //
@@ -191,6 +248,17 @@ extern EFI_COMPONENT_NAME2_PROTOCOL  gScsiDiskComponentName2;
 //
 #define SCSI_DISK_TIMEOUT           EFI_TIMER_PERIOD_SECONDS (30)
 
+//
+// Maximum number of completed SCSI Read/Write sub-task structures kept for
+// reuse per device
+//
+#define SCSI_DISK_ASYNC_REQUEST_POOL_SIZE  32
+
+//
+// Largest BlockIo2 read held back for merging, and largest merged read
+//
+#define SCSI_DISK_MERGE_READ_MAX_SIZE      SIZE_128KB
+
 /**
   Test to see if this driver supports ControllerHandle.
 
@@ -1244,6 +1312,142 @@ ScsiDiskWrite16 (
   IN     UINT32                SectorCount
   );
 
+/**
+  Get the maximum number of blocks to move with one Read/Write command.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+
+  @return The maximum number of blocks of one Read/Write command.
+
+**/
+UINT32
+ScsiDiskGetMaxTransferBlocks (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice
+  );
+
+/**
+  Remember that the device only accepted a shorter Read/Write command, so that
+  later commands are not made longer than that.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  SectorCount        The number of blocks of the shorter command.
+
+**/
+VOID
+ScsiDiskLimitTransferBlocks (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN UINT32                    SectorCount
+  );
+
+/**
+  Hold back a small BlockIo2 read while other BlockIo2 requests of the device
+  are running, so that it can be merged with adjacent reads queued meanwhile.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Buffer             The buffer to fill the read out data.
+  @param  Lba                The logic block address.
+  @param  NumberOfBlocks     The number of blocks to read.
+  @param  Token              The pointer to the token associated with the
+                             non-blocking read request.
+
+  @retval TRUE               The read is queued and will be sent later.
+  @retval FALSE              The read must be sent now.
+
+**/
+BOOLEAN
+ScsiDiskDeferAsyncRead (
+  IN  SCSI_DISK_DEV            *ScsiDiskDevice,
+  OUT VOID                     *Buffer,
+  IN  EFI_LBA                  Lba,
+  IN  UINTN                    NumberOfBlocks,
+  IN  EFI_BLOCK_IO2_TOKEN      *Token
+  );
+
+/**
+  Send the BlockIo2 reads held back by ScsiDiskDeferAsyncRead() once no other
+  BlockIo2 request of the device is running, merging adjacent ones.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Force              Send them even if other requests are running.
+
+**/
+VOID
+ScsiDiskIssuePendingReads (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN BOOLEAN                   Force
+  );
+
+/**
+  Send a BlockIo2 read held back by ScsiDiskDeferAsyncRead() on its own, and
+  free its SCSI_PENDING_READ structure.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Read               The held back read.
+
+**/
+VOID
+ScsiDiskIssuePendingRead (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN SCSI_PENDING_READ         *Read
+  );
+
+/**
+  Finish a merged read: copy the data out to the reads it serves, or send them
+  one by one if the merged read failed. Then free the merged read.
+
+  @param  MergedRead         The merged read.
+  @param  Status             The status of the merged read.
+
+**/
+VOID
+ScsiDiskCompleteMergedRead (
+  IN SCSI_MERGED_READ          *MergedRead,
+  IN EFI_STATUS                Status
+  );
+
+/**
+  Notify function of a merged read.
+
+  @param  Event    The instance of EFI_EVENT.
+  @param  Context  The parameter passed in.
+
+**/
+VOID
+EFIAPI
+ScsiDiskMergedReadNotify (
+  IN  EFI_EVENT  Event,
+  IN  VOID       *Context
+  );
+
+/**
+  Get a SCSI Read/Write sub-task structure, reusing a completed one of the
+  device when there is one.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+
+  @return The zeroed sub-task structure with its sense data buffer, or NULL
+          if there is not enough memory.
+
+**/
+SCSI_ASYNC_RW_REQUEST *
+ScsiDiskAllocateAsyncRequest (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice
+  );
+
+/**
+  Return a SCSI Read/Write sub-task structure to the device for reuse, or
+  free it if the device keeps enough of them already.
+
+  @param  ScsiDiskDevice     The pointer of ScsiDiskDevice.
+  @param  Request            The sub-task structure.
+
+**/
+VOID
+ScsiDiskFreeAsyncRequest (
+  IN SCSI_DISK_DEV             *ScsiDiskDevice,
+  IN SCSI_ASYNC_RW_REQUEST     *Request
+  );
+
 /**
   Submit Async Read(10) command.
 
@@ -767,6 +767,12 @@ UsbBootDetectMedia (
            &UsbMass->BlockIo,
            &UsbMass->BlockIo
            );
+    gBS->ReinstallProtocolInterface (
+           UsbMass->Controller,
+           &gEfiBlockIo2ProtocolGuid,
+           &UsbMass->BlockIo2,
+           &UsbMass->BlockIo2
+           );
 
     //
     // Reset MediaId after reinstalling Block I/O Protocol.
@@ -823,7 +829,7 @@ UsbBootReadWriteBlocks (
   UINT32                     Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+  CountMax  = UsbMass->MaxCarrySize / BlockSize;
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
@@ -861,7 +867,24 @@ UsbBootReadWriteBlocks (
                Timeout
                );
     if (EFI_ERROR (Status)) {
-      return Status;
+      //
+      // Some devices claim SuperSpeed but choke on large transfers.
+      // Fall back to the conservative carry size and retry this piece,
+      // but only on a transport failure: a timeout, or an error the sense
+      // data does not explain. Media, write protect and illegal request
+      // errors are the same at any size and go back to the caller.
+      //
+      if ((ByteSize <= USB_BOOT_MAX_CARRY_SIZE) ||
+          ((Status != EFI_TIMEOUT) && (Status != EFI_DEVICE_ERROR))) {
+        return Status;
+      }
+      DEBUG ((
+        EFI_D_WARN, "UsbBoot%sBlocks: %d bytes transfer (%r), fall back to %d bytes\n",
+        Write ? L"Write" : L"Read", ByteSize, Status, USB_BOOT_MAX_CARRY_SIZE
+        ));
+      UsbMass->MaxCarrySize = USB_BOOT_MAX_CARRY_SIZE;
+      CountMax              = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+      continue;
     }
     DEBUG ((
       DEBUG_BLKIO, "UsbBoot%sBlocks: LBA (0x%lx), Blk (0x%x)\n",
@@ -906,7 +929,7 @@ UsbBootReadWriteBlocks16 (
   UINT32                    Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+  CountMax  = UsbMass->MaxCarrySize / BlockSize;
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
@@ -941,7 +964,24 @@ UsbBootReadWriteBlocks16 (
                Timeout
                );
     if (EFI_ERROR (Status)) {
-      return Status;
+      //
+      // Some devices claim SuperSpeed but choke on large transfers.
+      // Fall back to the conservative carry size and retry this piece,
+      // but only on a transport failure: a timeout, or an error the sense
+      // data does not explain. Media, write protect and illegal request
+      // errors are the same at any size and go back to the caller.
+      //
+      if ((ByteSize <= USB_BOOT_MAX_CARRY_SIZE) ||
+          ((Status != EFI_TIMEOUT) && (Status != EFI_DEVICE_ERROR))) {
+        return Status;
+      }
+      DEBUG ((
+        EFI_D_WARN, "UsbBoot%sBlocks16: %d bytes transfer (%r), fall back to %d bytes\n",
+        Write ? L"Write" : L"Read", ByteSize, Status, USB_BOOT_MAX_CARRY_SIZE
+        ));
+      UsbMass->MaxCarrySize = USB_BOOT_MAX_CARRY_SIZE;
+      CountMax              = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+      continue;
     }
     DEBUG ((
       DEBUG_BLKIO, "UsbBoot%sBlocks16: LBA (0x%lx), Blk (0x%x)\n",
@@ -956,6 +996,52 @@ UsbBootReadWriteBlocks16 (
   return Status;
 }
 
+/**
+  Get the maximum number of bytes one READ/WRITE command may carry.
+
+  SuperSpeed devices, recognized by bulk endpoints with a 1024 byte maximum
+  packet size, can stream far more than 64KB per command, which amortizes
+  the CBW/CSW overhead of the BOT protocol.
+
+  @param  UsbIo                  The USB I/O Protocol instance
+
+  @return The maximum carry size in bytes.
+
+**/
+UINT32
+UsbBootGetMaxCarrySize (
+  IN EFI_USB_IO_PROTOCOL    *UsbIo
+  )
+{
+  EFI_USB_INTERFACE_DESCRIPTOR  Interface;
+  EFI_USB_ENDPOINT_DESCRIPTOR   EndPoint;
+  EFI_STATUS                    Status;
+  UINT8                         Index;
+  UINT32                        CarrySize;
+
+  CarrySize = USB_BOOT_MAX_CARRY_SIZE;
+
+  Status = UsbIo->UsbGetInterfaceDescriptor (UsbIo, &Interface);
+  if (EFI_ERROR (Status)) {
+    return CarrySize;
+  }
+
+  for (Index = 0; Index < Interface.NumEndpoints; Index++) {
+    Status = UsbIo->UsbGetEndpointDescriptor (UsbIo, Index, &EndPoint);
+
+    if (EFI_ERROR (Status) || !USB_IS_BULK_ENDPOINT (EndPoint.Attributes)) {
+      continue;
+    }
+
+    if (EndPoint.MaxPacketSize < USB_BOOT_SS_MAX_PACKET_SIZE) {
+      return USB_BOOT_MAX_CARRY_SIZE;
+    }
+    CarrySize = USB_BOOT_SS_MAX_CARRY_SIZE;
+  }
+
+  return CarrySize;
+}
+
 /**
   Use the USB clear feature control transfer to clear the endpoint stall condition.
 
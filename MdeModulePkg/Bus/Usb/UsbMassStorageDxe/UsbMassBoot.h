@@ -60,8 +60,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 //
 // Other parameters, Max carried size is 64KB.
+// SuperSpeed devices are allowed to carry up to 1MB per command.
 //
 #define USB_BOOT_MAX_CARRY_SIZE         SIZE_64KB
+#define USB_BOOT_SS_MAX_CARRY_SIZE      SIZE_1MB
+#define USB_BOOT_SS_MAX_PACKET_SIZE     1024
 
 //
 // Retry mass command times, set by experience
@@ -318,6 +321,23 @@ UsbBootReadWriteBlocks16 (
   IN OUT UINT8              *Buffer
   );
 
+/**
+  Get the maximum number of bytes one READ/WRITE command may carry.
+
+  SuperSpeed devices, recognized by bulk endpoints with a 1024 byte maximum
+  packet size, can stream far more than 64KB per command, which amortizes
+  the CBW/CSW overhead of the BOT protocol.
+
+  @param  UsbIo                  The USB I/O Protocol instance
+
+  @return The maximum carry size in bytes.
+
+**/
+UINT32
+UsbBootGetMaxCarrySize (
+  IN EFI_USB_IO_PROTOCOL    *UsbIo
+  );
+
 /**
   Use the USB clear feature control transfer to clear the endpoint stall condition.
 
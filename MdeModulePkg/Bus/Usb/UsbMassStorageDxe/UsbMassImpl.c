@@ -324,6 +324,166 @@ UsbMassFlushBlocks (
   return EFI_SUCCESS;
 }
 
+/**
+  Reset the block device.
+
+  This function implements EFI_BLOCK_IO2_PROTOCOL.Reset().
+
+  @param  This                   Indicates a pointer to the calling context.
+  @param  ExtendedVerification   Indicates that the driver may perform a more exhaustive
+                                 verification operation of the device during reset.
+
+  @retval EFI_SUCCESS            The block device was reset.
+  @retval EFI_DEVICE_ERROR       The block device is not functioning correctly and could not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbMassResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL   *This,
+  IN BOOLEAN                  ExtendedVerification
+  )
+{
+  USB_MASS_DEVICE  *UsbMass;
+
+  UsbMass = USB_MASS_DEVICE_FROM_BLOCK_IO2 (This);
+  return UsbMassReset (&UsbMass->BlockIo, ExtendedVerification);
+}
+
+/**
+  Reads the requested number of blocks from the device.
+
+  This function implements EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+  USB I/O Protocol offers no non-blocking bulk transfer, so the request
+  completes before returning and the caller's event is signaled directly.
+
+  @param  This                   Indicates a pointer to the calling context.
+  @param  MediaId                The media ID that the read request is for.
+  @param  Lba                    The starting logical block address to read from on the device.
+  @param  Token                  A pointer to the token associated with the transaction.
+  @param  BufferSize             The size of the Buffer in bytes.
+                                 This must be a multiple of the intrinsic block size of the device.
+  @param  Buffer                 A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS            The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR       The device reported an error while attempting to perform the read operation.
+  @retval EFI_NO_MEDIA           There is no media in the device.
+  @retval EFI_MEDIA_CHANGED      The MediaId is not for the current media.
+  @retval EFI_BAD_BUFFER_SIZE    The BufferSize parameter is not a multiple of the intrinsic block size of the device.
+  @retval EFI_INVALID_PARAMETER  The read request contains LBAs that are not valid,
+                                 or the buffer is not on proper alignment.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbMassReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+     OUT VOID                   *Buffer
+  )
+{
+  USB_MASS_DEVICE  *UsbMass;
+  EFI_STATUS       Status;
+
+  UsbMass = USB_MASS_DEVICE_FROM_BLOCK_IO2 (This);
+  Status  = UsbMassReadBlocks (&UsbMass->BlockIo, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes a specified number of blocks to the device.
+
+  This function implements EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+  USB I/O Protocol offers no non-blocking bulk transfer, so the request
+  completes before returning and the caller's event is signaled directly.
+
+  @param  This                   Indicates a pointer to the calling context.
+  @param  MediaId                The media ID that the write request is for.
+  @param  Lba                    The starting logical block address to be written.
+  @param  Token                  A pointer to the token associated with the transaction.
+  @param  BufferSize             The size of the Buffer in bytes.
+                                 This must be a multiple of the intrinsic block size of the device.
+  @param  Buffer                 Pointer to the source buffer for the data.
+
+  @retval EFI_SUCCESS            The data were written correctly to the device.
+  @retval EFI_WRITE_PROTECTED    The device cannot be written to.
+  @retval EFI_NO_MEDIA           There is no media in the device.
+  @retval EFI_MEDIA_CHANGED      The MediaId is not for the current media.
+  @retval EFI_DEVICE_ERROR       The device reported an error while attempting to perform the write operation.
+  @retval EFI_BAD_BUFFER_SIZE    The BufferSize parameter is not a multiple of the intrinsic
+                                 block size of the device.
+  @retval EFI_INVALID_PARAMETER  The write request contains LBAs that are not valid,
+                                 or the buffer is not on proper alignment.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbMassWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  USB_MASS_DEVICE  *UsbMass;
+  EFI_STATUS       Status;
+
+  UsbMass = USB_MASS_DEVICE_FROM_BLOCK_IO2 (This);
+  Status  = UsbMassWriteBlocks (&UsbMass->BlockIo, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Flushes all modified data to a physical block device.
+
+  This function implements EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+  USB mass storage device doesn't support write cache,
+  so only the caller's event needs to be signaled.
+
+  @param  This                   Indicates a pointer to the calling context.
+  @param  Token                  A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS            All outstanding data were written correctly to the device.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbMassFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
 
@@ -504,10 +664,16 @@ UsbMassInitMultiLun (
     UsbMass->BlockIo.ReadBlocks   = UsbMassReadBlocks;
     UsbMass->BlockIo.WriteBlocks  = UsbMassWriteBlocks;
     UsbMass->BlockIo.FlushBlocks  = UsbMassFlushBlocks;
+    UsbMass->BlockIo2.Media         = &UsbMass->BlockIoMedia;
+    UsbMass->BlockIo2.Reset         = UsbMassResetEx;
+    UsbMass->BlockIo2.ReadBlocksEx  = UsbMassReadBlocksEx;
+    UsbMass->BlockIo2.WriteBlocksEx = UsbMassWriteBlocksEx;
+    UsbMass->BlockIo2.FlushBlocksEx = UsbMassFlushBlocksEx;
     UsbMass->OpticalStorage       = FALSE;
     UsbMass->Transport            = Transport;
     UsbMass->Context              = Context;
     UsbMass->Lun                  = Index;
+    UsbMass->MaxCarrySize         = USB_BOOT_MAX_CARRY_SIZE;
 
     //
     // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -548,6 +714,8 @@ UsbMassInitMultiLun (
                     UsbMass->DevicePath,
                     &gEfiBlockIoProtocolGuid,
                     &UsbMass->BlockIo,
+                    &gEfiBlockIo2ProtocolGuid,
+                    &UsbMass->BlockIo2,
                     &gEfiDiskInfoProtocolGuid,
                     &UsbMass->DiskInfo,
                     NULL
@@ -580,6 +748,8 @@ UsbMassInitMultiLun (
              UsbMass->DevicePath,
              &gEfiBlockIoProtocolGuid,
              &UsbMass->BlockIo,
+             &gEfiBlockIo2ProtocolGuid,
+             &UsbMass->BlockIo2,
              &gEfiDiskInfoProtocolGuid,
              &UsbMass->DiskInfo,
              NULL
@@ -588,6 +758,8 @@ UsbMassInitMultiLun (
       FreePool (UsbMass);
       continue;
     }
+    UsbMass->MaxCarrySize = UsbBootGetMaxCarrySize (UsbIo);
+
     ReturnStatus = EFI_SUCCESS;
     DEBUG ((EFI_D_INFO, "UsbMassInitMultiLun: Success to initialize No.%d logic unit\n", Index));
   }
@@ -645,9 +817,15 @@ UsbMassInitNonLun (
   UsbMass->BlockIo.ReadBlocks   = UsbMassReadBlocks;
   UsbMass->BlockIo.WriteBlocks  = UsbMassWriteBlocks;
   UsbMass->BlockIo.FlushBlocks  = UsbMassFlushBlocks;
+  UsbMass->BlockIo2.Media         = &UsbMass->BlockIoMedia;
+  UsbMass->BlockIo2.Reset         = UsbMassResetEx;
+  UsbMass->BlockIo2.ReadBlocksEx  = UsbMassReadBlocksEx;
+  UsbMass->BlockIo2.WriteBlocksEx = UsbMassWriteBlocksEx;
+  UsbMass->BlockIo2.FlushBlocksEx = UsbMassFlushBlocksEx;
   UsbMass->OpticalStorage       = FALSE;
   UsbMass->Transport            = Transport;
   UsbMass->Context              = Context;
+  UsbMass->MaxCarrySize         = UsbBootGetMaxCarrySize (UsbIo);
 
   //
   // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -664,6 +842,8 @@ UsbMassInitNonLun (
                   &Controller,
                   &gEfiBlockIoProtocolGuid,
                   &UsbMass->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid,
+                  &UsbMass->BlockIo2,
                   &gEfiDiskInfoProtocolGuid,
                   &UsbMass->DiskInfo,
                   NULL
@@ -971,6 +1151,8 @@ USBMassDriverBindingStop (
                     Controller,
                     &gEfiBlockIoProtocolGuid,
                     &UsbMass->BlockIo,
+                    &gEfiBlockIo2ProtocolGuid,
+                    &UsbMass->BlockIo2,
                     &gEfiDiskInfoProtocolGuid,
                     &UsbMass->DiskInfo,
                     NULL
@@ -1031,6 +1213,8 @@ USBMassDriverBindingStop (
                     UsbMass->DevicePath,
                     &gEfiBlockIoProtocolGuid,
                     &UsbMass->BlockIo,
+                    &gEfiBlockIo2ProtocolGuid,
+                    &UsbMass->BlockIo2,
                     &gEfiDiskInfoProtocolGuid,
                     &UsbMass->DiskInfo,
                     NULL
@@ -39,6 +39,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Protocol/FirmwareVolume2.h>
 #include <Protocol/SimpleFileSystem.h>
+#include <Protocol/MemoryAttributeBatch.h>
 
 #include "DxeMain.h"
 #include "Mem/HeapGuard.h"
@@ -70,6 +71,43 @@ extern LIST_ENTRY         mGcdMemorySpaceMap;
 
 STATIC LIST_ENTRY         mProtectedImageRecordList;
 
+STATIC EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL  *mMemoryAttributeBatch = NULL;
+
+/**
+  Start a batch of memory attribute updates, if the CPU driver supports it.
+
+  Page attribute updates made in a batch may not take effect until the batch
+  is committed, so no memory whose attributes are changed may be allocated,
+  freed or accessed in the batch.
+**/
+STATIC
+VOID
+BeginMemoryAttributesBatch (
+  VOID
+  )
+{
+  if (mMemoryAttributeBatch != NULL) {
+    mMemoryAttributeBatch->BeginBatch (mMemoryAttributeBatch);
+  }
+}
+
+/**
+  Commit a batch of memory attribute updates, if the CPU driver supports it.
+**/
+STATIC
+VOID
+CommitMemoryAttributesBatch (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mMemoryAttributeBatch != NULL) {
+    Status = mMemoryAttributeBatch->CommitBatch (mMemoryAttributeBatch);
+    ASSERT_EFI_ERROR (Status);
+  }
+}
+
 /**
   Sort code section in image record, based upon CodeSegmentBase from low to high.
 
@@ -252,6 +290,11 @@ SetUefiImageProtectionAttributes (
   CurrentBase = ImageRecord->ImageBase;
   ImageEnd    = ImageRecord->ImageBase + ImageRecord->ImageSize;
 
+  //
+  // Apply the attributes of all sections with one TLB flush.
+  //
+  BeginMemoryAttributesBatch ();
+
   ImageRecordCodeSectionLink = ImageRecordCodeSectionList->ForwardLink;
   ImageRecordCodeSectionEndLink = ImageRecordCodeSectionList;
   while (ImageRecordCodeSectionLink != ImageRecordCodeSectionEndLink) {
@@ -298,6 +341,8 @@ SetUefiImageProtectionAttributes (
       EFI_MEMORY_XP
       );
   }
+
+  CommitMemoryAttributesBatch ();
   return ;
 }
 
@@ -855,6 +900,8 @@ InitializeDxeNxMemoryProtectionPolicy (
 
   MergeMemoryMapForProtectionPolicy (MemoryMap, &MemoryMapSize, DescriptorSize);
 
+  BeginMemoryAttributesBatch ();
+
   MemoryMapEntry = MemoryMap;
   MemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + MemoryMapSize);
   while ((UINTN) MemoryMapEntry < (UINTN) MemoryMapEnd) {
@@ -899,6 +946,8 @@ InitializeDxeNxMemoryProtectionPolicy (
     }
     MemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
   }
+
+  CommitMemoryAttributesBatch ();
   FreePool (MemoryMap);
 
   //
@@ -913,6 +962,7 @@ InitializeDxeNxMemoryProtectionPolicy (
       ));
 
     CoreAcquireGcdMemoryLock ();
+    BeginMemoryAttributesBatch ();
 
     Link = mGcdMemorySpaceMap.ForwardLink;
     while (Link != &mGcdMemorySpaceMap) {
@@ -940,6 +990,7 @@ InitializeDxeNxMemoryProtectionPolicy (
       Link = Link->ForwardLink;
     }
     CoreReleaseGcdMemoryLock ();
+    CommitMemoryAttributesBatch ();
   }
 }
 
@@ -972,6 +1023,15 @@ MemoryProtectionCpuArchProtocolNotify (
     goto Done;
   }
 
+  //
+  // The memory attribute batch protocol is optional, and is installed along
+  // with the CPU Arch protocol by the CPU drivers which support it.
+  //
+  Status = CoreLocateProtocol (&gEdkiiMemoryAttributeBatchProtocolGuid, NULL, (VOID **)&mMemoryAttributeBatch);
+  if (EFI_ERROR (Status)) {
+    mMemoryAttributeBatch = NULL;
+  }
+
   //
   // Apply the memory protection policy on non-BScode/RTcode regions.
   //
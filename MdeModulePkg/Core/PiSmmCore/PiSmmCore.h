@@ -74,14 +74,20 @@ typedef struct {
 
 #define SMI_ENTRY_SIGNATURE  SIGNATURE_32('s','m','i','e')
 
- typedef struct {
+ typedef struct _SMI_ENTRY {
   UINTN       Signature;
   LIST_ENTRY  AllEntries;  // All entries
 
   EFI_GUID    HandlerType; // Type of interrupt
   LIST_ENTRY  SmiHandlers; // All handlers
+  struct _SMI_ENTRY  *HashNext; // Next entry in the same mSmiEntryHashTable bucket
 } SMI_ENTRY;
 
+//
+// Number of buckets in the SMI_ENTRY lookup table, must be a power of 2
+//
+#define SMI_ENTRY_HASH_SIZE  64
+
 #define SMI_HANDLER_SIGNATURE  SIGNATURE_32('s','m','i','h')
 
  typedef struct {
@@ -92,6 +98,10 @@ typedef struct {
   SMI_ENTRY                     *SmiEntry;
   VOID                          *Context;    // for profile
   UINTN                         ContextSize; // for profile
+  UINT64                        InvocationCount; // for profile, number of times the handler is invoked
+  UINT64                        TotalTicks;      // for profile, sum of the TSC ticks spent in the handler
+  UINT64                        MaxTicks;        // for profile, longest single invocation in TSC ticks
+  BOOLEAN                       ToRemove;    // To remove this SMI_HANDLER later
 } SMI_HANDLER;
 
 //
@@ -17,6 +17,48 @@ SMI_ENTRY   mRootSmiEntry = {
   INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.SmiHandlers),
 };
 
+//
+// Non-root SMI entries hashed by handler type, so that SmiManage() does not
+// have to walk mSmiEntryList comparing GUIDs on every SMI.
+//
+SMI_ENTRY   *mSmiEntryHashTable[SMI_ENTRY_HASH_SIZE];
+
+//
+// Set by SmmCoreInitializeSmiHandlerProfile() to collect per handler timing.
+//
+BOOLEAN     mSmiHandlerTimingEnabled = FALSE;
+
+//
+// Depth of the nested SmiManage() calls. SmiHandlerUnRegister() called by an
+// SMI handler defers freeing the SMI_HANDLER until the outermost call returns.
+//
+UINTN       mSmiManageCallingDepth = 0;
+
+/**
+  Returns the mSmiEntryHashTable bucket index for the handler type.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return Bucket index
+**/
+UINTN
+SmiEntryHash (
+  IN CONST EFI_GUID  *HandlerType
+  )
+{
+  CONST UINT32  *Data;
+  UINT32        Hash;
+
+  //
+  // EFI_GUID is 32-bit aligned, fold the 4 dwords together.
+  //
+  Data = (CONST UINT32 *) HandlerType;
+  Hash = Data[0] ^ Data[1] ^ Data[2] ^ Data[3];
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return Hash & (SMI_ENTRY_HASH_SIZE - 1);
+}
+
 /**
   Finds the SMI entry for the requested handler type.
 
@@ -33,24 +75,21 @@ SmmCoreFindSmiEntry (
   IN BOOLEAN   Create
   )
 {
-  LIST_ENTRY  *Link;
-  SMI_ENTRY   *Item;
+  UINTN       Bucket;
   SMI_ENTRY   *SmiEntry;
 
   //
-  // Search the SMI entry list for the matching GUID
+  // Search the hash bucket for the matching GUID
   //
-  SmiEntry = NULL;
-  for (Link = mSmiEntryList.ForwardLink;
-       Link != &mSmiEntryList;
-       Link = Link->ForwardLink) {
-
-    Item = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
-    if (CompareGuid (&Item->HandlerType, HandlerType)) {
+  Bucket = SmiEntryHash (HandlerType);
+  for (SmiEntry = mSmiEntryHashTable[Bucket];
+       SmiEntry != NULL;
+       SmiEntry = SmiEntry->HashNext) {
+    ASSERT (SmiEntry->Signature == SMI_ENTRY_SIGNATURE);
+    if (CompareGuid (&SmiEntry->HandlerType, HandlerType)) {
       //
       // This is the SMI entry
       //
-      SmiEntry = Item;
       break;
     }
   }
@@ -70,14 +109,120 @@ SmmCoreFindSmiEntry (
       InitializeListHead (&SmiEntry->SmiHandlers);
 
       //
-      // Add it to SMI entry list
+      // Add it to SMI entry list and to the head of its hash bucket
       //
       InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      SmiEntry->HashNext = mSmiEntryHashTable[Bucket];
+      mSmiEntryHashTable[Bucket] = SmiEntry;
     }
   }
   return SmiEntry;
 }
 
+/**
+  Remove SmiHandler and free the memory it used.
+  If SmiEntry is empty, remove SmiEntry and free the memory it used.
+
+  @param  SmiHandler  Points to SMI handler.
+
+  @retval TRUE        SmiEntry is removed.
+  @retval FALSE       SmiEntry is not removed.
+**/
+BOOLEAN
+RemoveSmiHandler (
+  IN SMI_HANDLER  *SmiHandler
+  )
+{
+  SMI_ENTRY  *SmiEntry;
+  SMI_ENTRY  **HashLink;
+
+  ASSERT (SmiHandler->ToRemove);
+  SmiEntry = SmiHandler->SmiEntry;
+
+  RemoveEntryList (&SmiHandler->Link);
+  FreePool (SmiHandler);
+
+  if ((SmiEntry == NULL) || (SmiEntry == &mRootSmiEntry)) {
+    //
+    // This is root SMI handler
+    //
+    return FALSE;
+  }
+
+  if (!IsListEmpty (&SmiEntry->SmiHandlers)) {
+    return FALSE;
+  }
+
+  //
+  // No handler registered for this interrupt now, remove the SMI_ENTRY
+  //
+  RemoveEntryList (&SmiEntry->AllEntries);
+  for (HashLink = &mSmiEntryHashTable[SmiEntryHash (&SmiEntry->HandlerType)];
+       *HashLink != NULL;
+       HashLink = &(*HashLink)->HashNext) {
+    if (*HashLink == SmiEntry) {
+      *HashLink = SmiEntry->HashNext;
+      break;
+    }
+  }
+
+  FreePool (SmiEntry);
+  return TRUE;
+}
+
+/**
+  Remove the SMI handlers that were unregistered while SmiManage() was
+  dispatching them.
+
+**/
+VOID
+RemoveDeferredSmiHandlers (
+  VOID
+  )
+{
+  LIST_ENTRY   *EntryLink;
+  LIST_ENTRY   *Link;
+  SMI_ENTRY    *SmiEntry;
+  SMI_HANDLER  *SmiHandler;
+
+  //
+  // Go through all SmiHandler in root SMI handlers
+  //
+  for ( Link = GetFirstNode (&mRootSmiEntry.SmiHandlers)
+      ; !IsNull (&mRootSmiEntry.SmiHandlers, Link)
+      ; ) {
+    SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+    Link       = GetNextNode (&mRootSmiEntry.SmiHandlers, Link);
+    if (SmiHandler->ToRemove) {
+      RemoveSmiHandler (SmiHandler);
+    }
+  }
+
+  //
+  // Go through all SmiHandler in non-root SMI handlers
+  //
+  for ( EntryLink = GetFirstNode (&mSmiEntryList)
+      ; !IsNull (&mSmiEntryList, EntryLink)
+      ; ) {
+    SmiEntry  = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    EntryLink = GetNextNode (&mSmiEntryList, EntryLink);
+    for ( Link = GetFirstNode (&SmiEntry->SmiHandlers)
+        ; !IsNull (&SmiEntry->SmiHandlers, Link)
+        ; ) {
+      SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      Link       = GetNextNode (&SmiEntry->SmiHandlers, Link);
+      if (SmiHandler->ToRemove) {
+        if (RemoveSmiHandler (SmiHandler)) {
+          //
+          // The SMI_ENTRY was freed together with its last handler
+          //
+          break;
+        }
+      }
+    }
+  }
+}
+
 /**
   Manage SMI of a particular type.
 
@@ -106,10 +251,14 @@ SmiManage (
   SMI_ENTRY    *SmiEntry;
   SMI_HANDLER  *SmiHandler;
   BOOLEAN      SuccessReturn;
+  BOOLEAN      WillReturn;
   EFI_STATUS   Status;
+  UINT64       StartTicks;
+  UINT64       EndTicks;
 
   Status = EFI_NOT_FOUND;
   SuccessReturn = FALSE;
+  WillReturn = FALSE;
   if (HandlerType == NULL) {
     //
     // Root SMI handler
@@ -129,8 +278,22 @@ SmiManage (
   }
   Head = &SmiEntry->SmiHandlers;
 
+  //
+  // The handlers may unregister themselves, SmiHandlerUnRegister() keeps them
+  // linked until the outermost SmiManage() returns.
+  //
+  mSmiManageCallingDepth++;
+
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+    if (SmiHandler->ToRemove) {
+      continue;
+    }
+
+    StartTicks = 0;
+    if (mSmiHandlerTimingEnabled) {
+      StartTicks = AsmReadTsc ();
+    }
 
     Status = SmiHandler->Handler (
                (EFI_HANDLE) SmiHandler,
@@ -139,6 +302,17 @@ SmiManage (
                CommBufferSize
                );
 
+    if (mSmiHandlerTimingEnabled) {
+      EndTicks = AsmReadTsc ();
+      if (!SmiHandler->ToRemove) {
+        SmiHandler->InvocationCount++;
+        SmiHandler->TotalTicks += EndTicks - StartTicks;
+        if (EndTicks - StartTicks > SmiHandler->MaxTicks) {
+          SmiHandler->MaxTicks = EndTicks - StartTicks;
+        }
+      }
+    }
+
     switch (Status) {
     case EFI_INTERRUPT_PENDING:
       //
@@ -146,7 +320,7 @@ SmiManage (
       // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
       //
       if (HandlerType != NULL) {
-        return EFI_INTERRUPT_PENDING;
+        WillReturn = TRUE;
       }
       break;
 
@@ -157,7 +331,7 @@ SmiManage (
       // additional handlers will be processed.
       //
       if (HandlerType != NULL) {
-        return EFI_SUCCESS;
+        WillReturn = TRUE;
       }
       SuccessReturn = TRUE;
       break;
@@ -184,6 +358,25 @@ SmiManage (
       ASSERT (FALSE);
       break;
     }
+
+    if (WillReturn) {
+      break;
+    }
+  }
+
+  ASSERT (mSmiManageCallingDepth > 0);
+  mSmiManageCallingDepth--;
+
+  //
+  // SmiHandlerUnRegister() calls from SMI handlers are deferred till this point.
+  // Note that SmiManage() can be called recursively.
+  //
+  if (mSmiManageCallingDepth == 0) {
+    RemoveDeferredSmiHandlers ();
+  }
+
+  if (WillReturn) {
+    return Status;
   }
 
   if (SuccessReturn) {
@@ -304,30 +497,21 @@ SmiHandlerUnRegister (
     }
   }
 
-  if ((EFI_HANDLE) SmiHandler != DispatchHandle) {
+  if (((EFI_HANDLE) SmiHandler != DispatchHandle) || SmiHandler->ToRemove) {
     return EFI_INVALID_PARAMETER;
   }
 
-  SmiEntry = SmiHandler->SmiEntry;
-
-  RemoveEntryList (&SmiHandler->Link);
-  FreePool (SmiHandler);
+  SmiHandler->ToRemove = TRUE;
 
-  if (SmiEntry == NULL) {
+  if (mSmiManageCallingDepth > 0) {
     //
-    // This is root SMI handler
+    // This function is called from SmiManage()
+    // Do not delete or remove SmiHandler or SmiEntry now.
+    // SmiManage will handle it later
     //
     return EFI_SUCCESS;
   }
 
-  if (IsListEmpty (&SmiEntry->SmiHandlers)) {
-    //
-    // No handler registered for this interrupt now, remove the SMI_ENTRY
-    //
-    RemoveEntryList (&SmiEntry->AllEntries);
-
-    FreePool (SmiEntry);
-  }
-
+  RemoveSmiHandler (SmiHandler);
   return EFI_SUCCESS;
 }
@@ -73,6 +73,7 @@ InternalPeCoffGetEntryPoint (
 extern LIST_ENTRY  mSmiEntryList;
 extern LIST_ENTRY  mHardwareSmiEntryList;
 extern SMI_ENTRY   mRootSmiEntry;
+extern BOOLEAN     mSmiHandlerTimingEnabled;
 
 extern SMI_HANDLER_PROFILE_PROTOCOL  mSmiHandlerProfile;
 
@@ -90,11 +91,13 @@ GLOBAL_REMOVE_IF_UNREFERENCED UINT32        mImageStructCount;
 
 GLOBAL_REMOVE_IF_UNREFERENCED VOID   *mSmiHandlerProfileDatabase;
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmiHandlerProfileDatabaseSize;
+GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmiHandlerProfileDatabaseBufferSize;
 
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmImageDatabaseSize;
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmRootSmiDatabaseSize;
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmSmiDatabaseSize;
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmHardwareSmiDatabaseSize;
+GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmSmiTimingDatabaseSize;
 
 GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN  mSmiHandlerProfileRecordingStatus;
 
@@ -426,6 +429,15 @@ DumpSmiHandlerOnSmiEntry(
       DEBUG ((DEBUG_INFO, " <== RVA - 0x%x", SmiHandler->CallerAddr - (UINTN) ImageStruct->ImageBase));
     }
     DEBUG ((DEBUG_INFO, "\n"));
+    if (SmiHandler->InvocationCount != 0) {
+      DEBUG ((
+        DEBUG_INFO,
+        "  Invocations - 0x%lx, AverageTicks - 0x%lx, MaxTicks - 0x%lx\n",
+        SmiHandler->InvocationCount,
+        DivU64x64Remainder (SmiHandler->TotalTicks, SmiHandler->InvocationCount, NULL),
+        SmiHandler->MaxTicks
+        ));
+    }
   }
 
   return;
@@ -511,8 +523,13 @@ SmmReadyToLockInSmiHandlerProfile (
 
   RegisterSmiHandlerProfileHandler();
 
-  if (mImageStruct != NULL) {
+  //
+  // The image information is still needed to rebuild the database with
+  // up-to-date handler timing after SmmReadyToLock.
+  //
+  if ((mImageStruct != NULL) && !mSmiHandlerTimingEnabled) {
     FreePool(mImageStruct);
+    mImageStruct = NULL;
   }
 
   return EFI_SUCCESS;
@@ -594,6 +611,47 @@ GetSmmSmiDatabaseSize(
   return Size;
 }
 
+/**
+  return SMI handler timing database size.
+
+  @return SMI handler timing database size, 0 if the timing is disabled.
+**/
+UINTN
+GetSmmSmiTimingDatabaseSize (
+  VOID
+  )
+{
+  LIST_ENTRY      *SmiEntryLists[3];
+  LIST_ENTRY      *ListEntry;
+  LIST_ENTRY      *HandlerEntry;
+  SMI_ENTRY       *SmiEntry;
+  UINTN           Index;
+  UINTN           Size;
+
+  if (!mSmiHandlerTimingEnabled) {
+    return 0;
+  }
+
+  SmiEntryLists[0] = mSmmCoreRootSmiEntryList;
+  SmiEntryLists[1] = mSmmCoreSmiEntryList;
+  SmiEntryLists[2] = mSmmCoreHardwareSmiEntryList;
+
+  Size = 0;
+  for (Index = 0; Index < ARRAY_SIZE (SmiEntryLists); Index++) {
+    for (ListEntry = SmiEntryLists[Index]->ForwardLink;
+         ListEntry != SmiEntryLists[Index];
+         ListEntry = ListEntry->ForwardLink) {
+      SmiEntry = CR(ListEntry, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      for (HandlerEntry = SmiEntry->SmiHandlers.ForwardLink;
+           HandlerEntry != &SmiEntry->SmiHandlers;
+           HandlerEntry = HandlerEntry->ForwardLink) {
+        Size += sizeof(SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE);
+      }
+    }
+  }
+  return Size;
+}
+
 /**
   return SMI handler profile database size.
 
@@ -608,8 +666,9 @@ GetSmiHandlerProfileDatabaseSize (
   mSmmRootSmiDatabaseSize = GetSmmSmiDatabaseSize(mSmmCoreRootSmiEntryList);
   mSmmSmiDatabaseSize = GetSmmSmiDatabaseSize(mSmmCoreSmiEntryList);
   mSmmHardwareSmiDatabaseSize = GetSmmSmiDatabaseSize(mSmmCoreHardwareSmiEntryList);
+  mSmmSmiTimingDatabaseSize = GetSmmSmiTimingDatabaseSize();
 
-  return mSmmImageDatabaseSize + mSmmSmiDatabaseSize + mSmmRootSmiDatabaseSize + mSmmHardwareSmiDatabaseSize;
+  return mSmmImageDatabaseSize + mSmmSmiDatabaseSize + mSmmRootSmiDatabaseSize + mSmmHardwareSmiDatabaseSize + mSmmSmiTimingDatabaseSize;
 }
 
 /**
@@ -778,6 +837,72 @@ GetSmmSmiDatabaseData(
   return Size;
 }
 
+/**
+  get SMI handler timing database.
+
+  @param Data             The buffer to hold SMI handler timing database
+  @param ExpectedSize     The expected size of the SMI handler timing database
+
+  @return SMI handler timing database size.
+**/
+UINTN
+GetSmmSmiTimingDatabaseData (
+  IN OUT VOID            *Data,
+  IN     UINTN           ExpectedSize
+  )
+{
+  SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE  *TimingStruct;
+  LIST_ENTRY                             *SmiEntryLists[3];
+  UINT32                                 HandlerCategories[3];
+  LIST_ENTRY                             *ListEntry;
+  LIST_ENTRY                             *HandlerEntry;
+  SMI_ENTRY                              *SmiEntry;
+  SMI_HANDLER                            *SmiHandler;
+  UINTN                                  Index;
+  UINTN                                  Size;
+
+  SmiEntryLists[0] = mSmmCoreRootSmiEntryList;
+  SmiEntryLists[1] = mSmmCoreSmiEntryList;
+  SmiEntryLists[2] = mSmmCoreHardwareSmiEntryList;
+  HandlerCategories[0] = SmmCoreSmiHandlerCategoryRootHandler;
+  HandlerCategories[1] = SmmCoreSmiHandlerCategoryGuidHandler;
+  HandlerCategories[2] = SmmCoreSmiHandlerCategoryHardwareHandler;
+
+  TimingStruct = Data;
+  Size = 0;
+  for (Index = 0; Index < ARRAY_SIZE (SmiEntryLists); Index++) {
+    for (ListEntry = SmiEntryLists[Index]->ForwardLink;
+         ListEntry != SmiEntryLists[Index];
+         ListEntry = ListEntry->ForwardLink) {
+      SmiEntry = CR(ListEntry, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      for (HandlerEntry = SmiEntry->SmiHandlers.ForwardLink;
+           HandlerEntry != &SmiEntry->SmiHandlers;
+           HandlerEntry = HandlerEntry->ForwardLink) {
+        SmiHandler = CR(HandlerEntry, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+        if (sizeof(SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE) > ExpectedSize - Size) {
+          return 0;
+        }
+        TimingStruct->Header.Signature = SMM_CORE_SMI_HANDLER_TIMING_SIGNATURE;
+        TimingStruct->Header.Length = sizeof(SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE);
+        TimingStruct->Header.Revision = SMM_CORE_SMI_HANDLER_TIMING_REVISION;
+        CopyGuid(&TimingStruct->HandlerType, &SmiEntry->HandlerType);
+        TimingStruct->HandlerCategory = HandlerCategories[Index];
+        TimingStruct->ImageRef = AddressToImageRef((UINTN)SmiHandler->Handler);
+        TimingStruct->Handler = (UINTN)SmiHandler->Handler;
+        TimingStruct->InvocationCount = SmiHandler->InvocationCount;
+        TimingStruct->TotalTicks = SmiHandler->TotalTicks;
+        TimingStruct->MaxTicks = SmiHandler->MaxTicks;
+        Size += sizeof(SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE);
+        TimingStruct++;
+      }
+    }
+  }
+  if (ExpectedSize != Size) {
+    return 0;
+  }
+  return Size;
+}
+
 /**
   Get SMI handler profile database.
 
@@ -795,6 +920,7 @@ GetSmiHandlerProfileDatabaseData(
   UINTN  SmmSmiDatabaseSize;
   UINTN  SmmRootSmiDatabaseSize;
   UINTN  SmmHardwareSmiDatabaseSize;
+  UINTN  SmmSmiTimingDatabaseSize;
 
   DEBUG((DEBUG_VERBOSE, "GetSmiHandlerProfileDatabaseData\n"));
   SmmImageDatabaseSize = GetSmmImageDatabaseData(Data, mSmmImageDatabaseSize);
@@ -817,6 +943,11 @@ GetSmiHandlerProfileDatabaseData(
     DEBUG((DEBUG_ERROR, "GetSmiHandlerProfileDatabaseData - SmmHardwareSmiDatabaseSize mismatch!\n"));
     return EFI_INVALID_PARAMETER;
   }
+  SmmSmiTimingDatabaseSize = GetSmmSmiTimingDatabaseData((UINT8 *)Data + SmmImageDatabaseSize + SmmRootSmiDatabaseSize + SmmSmiDatabaseSize + SmmHardwareSmiDatabaseSize, mSmmSmiTimingDatabaseSize);
+  if (SmmSmiTimingDatabaseSize != mSmmSmiTimingDatabaseSize) {
+    DEBUG((DEBUG_ERROR, "GetSmiHandlerProfileDatabaseData - SmmSmiTimingDatabaseSize mismatch!\n"));
+    return EFI_INVALID_PARAMETER;
+  }
 
   return EFI_SUCCESS;
 }
@@ -833,12 +964,49 @@ BuildSmiHandlerProfileDatabase(
   mSmiHandlerProfileDatabaseSize = GetSmiHandlerProfileDatabaseSize();
   mSmiHandlerProfileDatabase = AllocatePool(mSmiHandlerProfileDatabaseSize);
   if (mSmiHandlerProfileDatabase == NULL) {
+    mSmiHandlerProfileDatabaseSize = 0;
     return;
   }
+  mSmiHandlerProfileDatabaseBufferSize = mSmiHandlerProfileDatabaseSize;
   Status = GetSmiHandlerProfileDatabaseData(mSmiHandlerProfileDatabase);
   if (EFI_ERROR(Status)) {
     FreePool(mSmiHandlerProfileDatabase);
     mSmiHandlerProfileDatabase = NULL;
+    mSmiHandlerProfileDatabaseSize = 0;
+    mSmiHandlerProfileDatabaseBufferSize = 0;
+  }
+}
+
+/**
+  Refresh SMI handler profile database, so that it carries the current
+  SMI handler timing.
+
+  The database is rebuilt in the buffer allocated at SmmReadyToLock. A new
+  buffer is only allocated if SMI handlers registered since then make the
+  database larger than that buffer.
+**/
+VOID
+RefreshSmiHandlerProfileDatabase (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       DatabaseSize;
+
+  DatabaseSize = GetSmiHandlerProfileDatabaseSize();
+  if ((mSmiHandlerProfileDatabase == NULL) || (DatabaseSize > mSmiHandlerProfileDatabaseBufferSize)) {
+    if (mSmiHandlerProfileDatabase != NULL) {
+      FreePool(mSmiHandlerProfileDatabase);
+      mSmiHandlerProfileDatabase = NULL;
+    }
+    BuildSmiHandlerProfileDatabase();
+    return;
+  }
+
+  mSmiHandlerProfileDatabaseSize = DatabaseSize;
+  Status = GetSmiHandlerProfileDatabaseData(mSmiHandlerProfileDatabase);
+  if (EFI_ERROR(Status)) {
+    mSmiHandlerProfileDatabaseSize = 0;
   }
 }
 
@@ -891,6 +1059,14 @@ SmiHandlerProfileHandlerGetInfo(
   SmiHandlerProfileRecordingStatus = mSmiHandlerProfileRecordingStatus;
   mSmiHandlerProfileRecordingStatus = FALSE;
 
+  //
+  // Handler timing keeps changing after SmmReadyToLock. Take a new snapshot
+  // here, the following GET_DATA_BY_OFFSET commands read from it.
+  //
+  if (mSmiHandlerTimingEnabled) {
+    RefreshSmiHandlerProfileDatabase();
+  }
+
   SmiHandlerProfileParameterGetInfo->DataSize = mSmiHandlerProfileDatabaseSize;
   SmiHandlerProfileParameterGetInfo->Header.ReturnStatus = 0;
 
@@ -1347,6 +1523,10 @@ SmmCoreInitializeSmiHandlerProfile (
   if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x1) != 0) {
     InsertTailList (&mRootSmiEntryList, &mRootSmiEntry.AllEntries);
 
+    if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x2) != 0) {
+      mSmiHandlerTimingEnabled = TRUE;
+    }
+
     Status = gSmst->SmmRegisterProtocolNotify (
                       &gEfiSmmReadyToLockProtocolGuid,
                       SmmReadyToLockInSmiHandlerProfile,
@@ -105,6 +105,25 @@ typedef struct {
 // +-------------------------------------+
 //
 
+//
+// Optional records that follow the SMM_CORE_SMI_DATABASE_STRUCTURE records,
+// one per SMI handler, when the SMI handler timing is enabled.
+// The time is in CPU time stamp counter ticks.
+//
+#define SMM_CORE_SMI_HANDLER_TIMING_SIGNATURE SIGNATURE_32 ('S','C','H','T')
+#define SMM_CORE_SMI_HANDLER_TIMING_REVISION  0x0001
+
+typedef struct {
+  SMM_CORE_DATABASE_COMMON_HEADER     Header;
+  EFI_GUID                            HandlerType;
+  UINT32                              HandlerCategory;
+  UINT32                              ImageRef;
+  PHYSICAL_ADDRESS                    Handler;
+  UINT64                              InvocationCount;
+  UINT64                              TotalTicks;
+  UINT64                              MaxTicks;
+} SMM_CORE_SMI_HANDLER_TIMING_STRUCTURE;
+
 
 
 //
@@ -0,0 +1,78 @@
+/** @file
+  Fault Tolerant Write Batch Protocol lets a caller group a sequence of
+  EFI_FAULT_TOLERANT_WRITE_PROTOCOL.Write() calls, so that consecutive writes
+  to the same target block are committed by one spare block update.
+
+  Between BeginBatch() and CommitBatch(), Write() may only merge the data into
+  the memory copy of the target block and return EFI_SUCCESS. Such a write is
+  not fault tolerant, and does not reach the flash, until the merged writes are
+  committed. They are committed when the last allocated write of the sequence
+  is received, when a write to another target block is received, when any other
+  FTW service except Abort() is called, or when CommitBatch() is called.
+  Abort() drops the merged writes that have not been committed yet.
+
+  The on-flash write records keep the format of the Fault Tolerant Write
+  Protocol, so the recovery of an interrupted write is not changed.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __FAULT_TOLERANT_WRITE_BATCH_H__
+#define __FAULT_TOLERANT_WRITE_BATCH_H__
+
+//{53D2BB49-1935-4BB6-99DE-74AA723AACC3}
+#define EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL_GUID \
+  { \
+    0x53d2bb49, 0x1935, 0x4bb6, { 0x99, 0xde, 0x74, 0xaa, 0x72, 0x3a, 0xac, 0xc3 } \
+  }
+
+typedef struct _EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL;
+
+/**
+  Start a batch of fault tolerant writes.
+
+  @param  This              The EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS           The batch was started.
+  @retval EFI_ALREADY_STARTED   A batch is already in progress.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_BATCH_BEGIN)(
+  IN  EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL   *This
+  );
+
+/**
+  Commit the writes merged in the current batch and end the batch.
+
+  When this function returns EFI_SUCCESS, all the writes made in the batch are
+  complete or can be restarted in a fault tolerant manner.
+
+  @param  This              The EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS           The batch was committed.
+  @retval EFI_NOT_STARTED       There is no batch in progress.
+  @retval EFI_ABORTED           The merged writes could not be committed.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_BATCH_COMMIT)(
+  IN  EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL   *This
+  );
+
+///
+/// Fault Tolerant Write Batch Protocol groups writes made through
+/// EFI_FAULT_TOLERANT_WRITE_PROTOCOL.Write().
+///
+struct _EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL {
+  EDKII_FAULT_TOLERANT_WRITE_BATCH_BEGIN    BeginBatch;
+  EDKII_FAULT_TOLERANT_WRITE_BATCH_COMMIT   CommitBatch;
+};
+
+extern EFI_GUID gEdkiiFaultTolerantWriteBatchProtocolGuid;
+
+#endif
@@ -0,0 +1,79 @@
+/** @file
+  Memory Attribute Batch Protocol lets a caller group a sequence of
+  EFI_CPU_ARCH_PROTOCOL.SetMemoryAttributes() calls so that the page table
+  updates are applied together.
+
+  Between BeginBatch() and CommitBatch(), the CPU driver may queue the page
+  attribute part of SetMemoryAttributes() requests, coalesce adjacent ranges,
+  merge split page tables back into large pages once their attributes have
+  converged, and flush the TLB only once. Cacheability attributes are still
+  applied immediately. The caller must not rely on the new page attributes of
+  the affected ranges before CommitBatch() returns.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __MEMORY_ATTRIBUTE_BATCH_H__
+#define __MEMORY_ATTRIBUTE_BATCH_H__
+
+//{4EAF1769-709E-4B4A-9269-A2955D049ADA}
+#define EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL_GUID \
+  { \
+    0x4eaf1769, 0x709e, 0x4b4a, { 0x92, 0x69, 0xa2, 0x95, 0x5d, 0x04, 0x9a, 0xda } \
+  }
+
+typedef struct _EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL;
+
+/**
+  Start a batch of memory attribute updates.
+
+  Batches may be nested. The updates are applied when the outermost batch is
+  committed.
+
+  @param  This              The EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS       The batch was started.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MEMORY_ATTRIBUTE_BATCH_BEGIN)(
+  IN  EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  );
+
+/**
+  Commit a batch of memory attribute updates.
+
+  When the outermost batch is committed, all queued page attribute updates are
+  applied in the order they were requested and the TLB is flushed once.
+
+  @param  This              The EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS           The batch was committed.
+  @retval EFI_NOT_STARTED       There is no batch in progress.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough system resources to apply
+                                one or more queued updates.
+  @retval EFI_UNSUPPORTED       One or more queued updates could not be
+                                applied.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MEMORY_ATTRIBUTE_BATCH_COMMIT)(
+  IN  EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  );
+
+///
+/// Memory Attribute Batch Protocol groups page attribute updates made through
+/// EFI_CPU_ARCH_PROTOCOL.SetMemoryAttributes().
+///
+struct _EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL {
+  EDKII_MEMORY_ATTRIBUTE_BATCH_BEGIN    BeginBatch;
+  EDKII_MEMORY_ATTRIBUTE_BATCH_COMMIT   CommitBatch;
+};
+
+extern EFI_GUID gEdkiiMemoryAttributeBatchProtocolGuid;
+
+#endif
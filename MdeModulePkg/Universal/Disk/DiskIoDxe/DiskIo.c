@@ -48,6 +48,13 @@ DISK_IO_PRIVATE_DATA        gDiskIoPrivateDataTemplate = {
   }
 };
 
+//
+// Number of DiskIo read requests, and of those whose unaligned head or tail
+// was merged with the rest into a single block read.
+//
+UINT64                      mDiskIoReads;
+UINT64                      mDiskIoMergedReads;
+
 /**
   Test to see if this driver supports ControllerHandle.
 
@@ -345,6 +352,30 @@ DiskIoDriverBindingStop (
 }
 
 
+/**
+  Get the number of bytes the sub task transfers from or to the device.
+
+  A sub task using a working buffer covers all the blocks touched by
+  [Offset, Offset + Length), otherwise it transfers Length bytes directly.
+
+  @param Subtask      Subtask.
+  @param BlockSize    The block size of the device.
+
+  @return The transfer size in bytes.
+**/
+UINTN
+DiskIoGetSubtaskTransferSize (
+  IN DISK_IO_SUBTASK          *Subtask,
+  IN UINT32                   BlockSize
+  )
+{
+  if ((Subtask->WorkingBuffer == NULL) || (Subtask->Length == 0)) {
+    return Subtask->Length;
+  }
+
+  return ((Subtask->Offset + Subtask->Length + BlockSize - 1) / BlockSize) * BlockSize;
+}
+
 /**
   Destroy the sub task.
 
@@ -373,9 +404,7 @@ DiskIoDestroySubtask (
     if (Subtask->WorkingBuffer != NULL) {
       FreeAlignedPages (
         Subtask->WorkingBuffer,
-        Subtask->Length < Instance->BlockIo->Media->BlockSize
-        ? EFI_SIZE_TO_PAGES (Instance->BlockIo->Media->BlockSize)
-        : EFI_SIZE_TO_PAGES (Subtask->Length)
+        EFI_SIZE_TO_PAGES (DiskIoGetSubtaskTransferSize (Subtask, Instance->BlockIo->Media->BlockSize))
         );
     }
     if (Subtask->BlockIo2Token.Event != NULL) {
@@ -536,6 +565,7 @@ DiskIoCreateSubtaskList (
   UINT8                 *BufferPtr;
   UINTN                 Length;
   UINTN                 DataBufferSize;
+  UINTN                 NumberOfBlocks;
   DISK_IO_SUBTASK       *Subtask;
   VOID                  *WorkingBuffer;
   LIST_ENTRY            *Link;
@@ -563,6 +593,37 @@ DiskIoCreateSubtaskList (
     return TRUE;
   }
 
+  if (!Write) {
+    mDiskIoReads++;
+  }
+
+  //
+  // A read with an unaligned head or tail would take separate block reads
+  // for the partial blocks and the aligned middle part. Merge them into a
+  // single read through a working buffer when the blocks fit in it.
+  //
+  NumberOfBlocks = (UnderRun + BufferSize + BlockSize - 1) / BlockSize;
+  if (!Write && (NumberOfBlocks > 1) && (NumberOfBlocks <= PcdGet32 (PcdDiskIoDataBufferBlockNum)) &&
+      ((UnderRun != 0) || ((UnderRun + BufferSize) % BlockSize != 0))) {
+    if (Blocking) {
+      WorkingBuffer = SharedWorkingBuffer;
+    } else {
+      WorkingBuffer = AllocateAlignedPages (EFI_SIZE_TO_PAGES (NumberOfBlocks * BlockSize), IoAlign);
+    }
+    if (WorkingBuffer != NULL) {
+      Subtask = DiskIoCreateSubtask (FALSE, Lba, UnderRun, BufferSize, WorkingBuffer, BufferPtr, Blocking);
+      if (Subtask == NULL) {
+        if (!Blocking) {
+          FreeAlignedPages (WorkingBuffer, EFI_SIZE_TO_PAGES (NumberOfBlocks * BlockSize));
+        }
+        goto Done;
+      }
+      InsertTailList (Subtasks, &Subtask->Link);
+      mDiskIoMergedReads++;
+      return TRUE;
+    }
+  }
+
   if (UnderRun != 0) {
     Length = MIN (BlockSize - UnderRun, BufferSize);
     if (Blocking) {
@@ -819,6 +880,8 @@ DiskIo2ReadWriteDisk (
   BOOLEAN                Blocking;
   BOOLEAN                SubtaskBlocking;
   LIST_ENTRY             *SubtasksPtr;
+  UINTN                  TransferSize;
+  UINT8                  *IoBuffer;
 
   Task      = NULL;
   BlockIo   = Instance->BlockIo;
@@ -871,7 +934,10 @@ DiskIo2ReadWriteDisk (
     Subtask->Task   = Task;
     SubtaskBlocking = Subtask->Blocking;
 
-    ASSERT ((Subtask->Length % Media->BlockSize == 0) || (Subtask->Length < Media->BlockSize));
+    TransferSize    = DiskIoGetSubtaskTransferSize (Subtask, Media->BlockSize);
+    IoBuffer        = (Subtask->WorkingBuffer != NULL) ? Subtask->WorkingBuffer : Subtask->Buffer;
+
+    ASSERT (TransferSize % Media->BlockSize == 0);
 
     if (Subtask->Write) {
       //
@@ -889,8 +955,8 @@ DiskIo2ReadWriteDisk (
                             BlockIo,
                             MediaId,
                             Subtask->Lba,
-                            (Subtask->Length % Media->BlockSize == 0) ? Subtask->Length : Media->BlockSize,
-                            (Subtask->WorkingBuffer != NULL) ? Subtask->WorkingBuffer : Subtask->Buffer
+                            TransferSize,
+                            IoBuffer
                             );
       } else {
         Status = BlockIo2->WriteBlocksEx (
@@ -898,8 +964,8 @@ DiskIo2ReadWriteDisk (
                              MediaId,
                              Subtask->Lba,
                              &Subtask->BlockIo2Token,
-                             (Subtask->Length % Media->BlockSize == 0) ? Subtask->Length : Media->BlockSize,
-                             (Subtask->WorkingBuffer != NULL) ? Subtask->WorkingBuffer : Subtask->Buffer
+                             TransferSize,
+                             IoBuffer
                              );
       }
 
@@ -912,8 +978,8 @@ DiskIo2ReadWriteDisk (
                             BlockIo,
                             MediaId,
                             Subtask->Lba,
-                            (Subtask->Length % Media->BlockSize == 0) ? Subtask->Length : Media->BlockSize,
-                            (Subtask->WorkingBuffer != NULL) ? Subtask->WorkingBuffer : Subtask->Buffer
+                            TransferSize,
+                            IoBuffer
                             );
         if (!EFI_ERROR (Status) && (Subtask->WorkingBuffer != NULL)) {
           CopyMem (Subtask->Buffer, Subtask->WorkingBuffer + Subtask->Offset, Subtask->Length);
@@ -924,8 +990,8 @@ DiskIo2ReadWriteDisk (
                              MediaId,
                              Subtask->Lba,
                              &Subtask->BlockIo2Token,
-                             (Subtask->Length % Media->BlockSize == 0) ? Subtask->Length : Media->BlockSize,
-                             (Subtask->WorkingBuffer != NULL) ? Subtask->WorkingBuffer : Subtask->Buffer
+                             TransferSize,
+                             IoBuffer
                              );
       }
     }
@@ -1226,6 +1292,26 @@ DiskIoWriteDisk (
            );
 }
 
+/**
+  Report the read merge counters of all Disk IO devices.
+
+  @param[in] Event          The ReadyToBoot event.
+  @param[in] Context        Not used.
+
+**/
+VOID
+EFIAPI
+DiskIoReportStatistics (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  DEBUG ((
+    DEBUG_INFO, "DiskIo: %ld reads, %ld with an unaligned head or tail merged into one block read\n",
+    mDiskIoReads, mDiskIoMergedReads
+    ));
+}
+
 /**
   The user Entry Point for module DiskIo. The user code starts with this function.
 
@@ -1244,6 +1330,7 @@ InitializeDiskIo (
   )
 {
   EFI_STATUS              Status;
+  EFI_EVENT               ReadyToBootEvent;
 
   //
   // Install driver model protocol(s).
@@ -1258,5 +1345,14 @@ InitializeDiskIo (
              );
   ASSERT_EFI_ERROR (Status);
 
+  DEBUG_CODE_BEGIN ();
+    EfiCreateEventReadyToBootEx (
+      TPL_CALLBACK,
+      DiskIoReportStatistics,
+      NULL,
+      &ReadyToBootEvent
+      );
+  DEBUG_CODE_END ();
+
   return Status;
 }
@@ -164,6 +164,591 @@ PartitionDriverBindingSupported (
   return Status;
 }
 
+//
+// Probe read-ahead entries of the sibling disks that the current recursive
+// ConnectController() has not started this driver on yet, and the device path
+// of their parent controller.
+//
+LIST_ENTRY                mPartitionProbeList = INITIALIZE_LIST_HEAD_VARIABLE (mPartitionProbeList);
+EFI_DEVICE_PATH_PROTOCOL  *mPartitionProbeParentPath = NULL;
+
+//
+// TRUE while the "PartitionConnectPass" PERF record of a read-ahead pass is
+// open. It runs from the Start() that issues the reads to the Start() that
+// consumes the last of them, so it covers the connect of all the disks the
+// reads overlap with.
+//
+BOOLEAN                   mPartitionProbePassTimed = FALSE;
+
+/**
+  Read BufferSize bytes from Offset into Buffer, using the probe read-ahead
+  data when it covers the whole range and the parent Disk IO otherwise.
+
+  @param  This                  Protocol instance pointer.
+  @param  MediaId               Id of the media, changes every time the media is replaced.
+  @param  Offset                The starting byte offset to read from
+  @param  BufferSize            Size of Buffer
+  @param  Buffer                Buffer containing read data
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval others                The status returned by the parent Disk IO.
+
+**/
+EFI_STATUS
+EFIAPI
+PartitionProbeReadDisk (
+  IN EFI_DISK_IO_PROTOCOL  *This,
+  IN UINT32                MediaId,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  OUT VOID                 *Buffer
+  )
+{
+  PARTITION_PROBE  *Probe;
+
+  Probe = PARTITION_PROBE_FROM_DISK_IO (This);
+  if ((Probe->Buffer != NULL) &&
+      (MediaId == Probe->MediaId) &&
+      (Offset <= Probe->BufferSize) &&
+      (BufferSize <= Probe->BufferSize - Offset)) {
+    CopyMem (Buffer, Probe->Buffer + (UINTN) Offset, BufferSize);
+    return EFI_SUCCESS;
+  }
+
+  return Probe->ParentDiskIo->ReadDisk (
+                                Probe->ParentDiskIo,
+                                MediaId,
+                                Offset,
+                                BufferSize,
+                                Buffer
+                                );
+}
+
+/**
+  Write BufferSize bytes from Buffer to Offset through the parent Disk IO.
+  The probe read-ahead data is dropped as it may no longer match the media.
+
+  @param  This                  Protocol instance pointer.
+  @param  MediaId               Id of the media, changes every time the media is replaced.
+  @param  Offset                The starting byte offset to write to
+  @param  BufferSize            Size of Buffer
+  @param  Buffer                Buffer containing data to write
+
+  @return The status returned by the parent Disk IO.
+
+**/
+EFI_STATUS
+EFIAPI
+PartitionProbeWriteDisk (
+  IN EFI_DISK_IO_PROTOCOL  *This,
+  IN UINT32                MediaId,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  IN VOID                  *Buffer
+  )
+{
+  PARTITION_PROBE  *Probe;
+
+  Probe = PARTITION_PROBE_FROM_DISK_IO (This);
+  if (Probe->Buffer != NULL) {
+    FreeAlignedPages (Probe->Buffer, EFI_SIZE_TO_PAGES (Probe->BufferSize));
+    Probe->Buffer = NULL;
+  }
+
+  return Probe->ParentDiskIo->WriteDisk (
+                                Probe->ParentDiskIo,
+                                MediaId,
+                                Offset,
+                                BufferSize,
+                                Buffer
+                                );
+}
+
+/**
+  Free a probe entry that is not on mPartitionProbeList and whose read is no
+  longer in flight.
+
+  @param  Probe                 The probe entry.
+
+**/
+VOID
+PartitionProbeFree (
+  IN PARTITION_PROBE  *Probe
+  )
+{
+  if (Probe->Buffer != NULL) {
+    FreeAlignedPages (Probe->Buffer, EFI_SIZE_TO_PAGES (Probe->BufferSize));
+  }
+  FreePool (Probe);
+}
+
+/**
+  Completion of a probe read-ahead. Closes the Block IO2 of the disk, drops
+  the data of a failed read, and frees the entry if it was dropped while the
+  read was in flight.
+
+  @param  Event                 The token event.
+  @param  Context               The probe entry.
+
+**/
+VOID
+EFIAPI
+PartitionProbeReadDone (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  PARTITION_PROBE  *Probe;
+
+  Probe = (PARTITION_PROBE *) Context;
+
+  gBS->CloseEvent (Event);
+  gBS->CloseProtocol (
+         Probe->Handle,
+         &gEfiBlockIo2ProtocolGuid,
+         Probe->AgentHandle,
+         Probe->Handle
+         );
+
+  Probe->Completed = TRUE;
+  if (EFI_ERROR (Probe->Token.TransactionStatus) && (Probe->Buffer != NULL)) {
+    FreeAlignedPages (Probe->Buffer, EFI_SIZE_TO_PAGES (Probe->BufferSize));
+    Probe->Buffer = NULL;
+  }
+
+  if (Probe->Dropped) {
+    PartitionProbeFree (Probe);
+  }
+}
+
+/**
+  Remove a probe entry from mPartitionProbeList and free it, or have the read
+  completion free it if its read is still in flight.
+
+  @param  Probe                 The probe entry.
+
+**/
+VOID
+PartitionProbeDrop (
+  IN PARTITION_PROBE  *Probe
+  )
+{
+  EFI_TPL  OldTpl;
+
+  RemoveEntryList (&Probe->Link);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (!Probe->Completed) {
+    Probe->Dropped = TRUE;
+    Probe = NULL;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Probe != NULL) {
+    PartitionProbeFree (Probe);
+  }
+}
+
+/**
+  Find the probe entry of a disk handle.
+
+  @param  Handle                The disk handle.
+
+  @return The probe entry, or NULL if the disk has none.
+
+**/
+PARTITION_PROBE *
+PartitionProbeFind (
+  IN EFI_HANDLE  Handle
+  )
+{
+  LIST_ENTRY       *Link;
+  PARTITION_PROBE  *Probe;
+
+  for (Link = GetFirstNode (&mPartitionProbeList)
+       ; !IsNull (&mPartitionProbeList, Link)
+       ; Link = GetNextNode (&mPartitionProbeList, Link)
+       ) {
+    Probe = CR (Link, PARTITION_PROBE, Link, PARTITION_PROBE_SIGNATURE);
+    if (Probe->Handle == Handle) {
+      return Probe;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Drop the probe entry of a disk handle, if it has one.
+
+  @param  Handle                The disk handle.
+
+**/
+VOID
+PartitionProbeInvalidate (
+  IN EFI_HANDLE  Handle
+  )
+{
+  PARTITION_PROBE  *Probe;
+
+  Probe = PartitionProbeFind (Handle);
+  if (Probe != NULL) {
+    PartitionProbeDrop (Probe);
+  }
+}
+
+/**
+  Get the device path of the controller that produced a disk.
+
+  @param  DevicePath            The device path of the disk.
+
+  @return The device path without its last node, or NULL if the disk has no
+          parent or there is not enough memory.
+
+**/
+EFI_DEVICE_PATH_PROTOCOL *
+PartitionProbeGetParentPath (
+  IN EFI_DEVICE_PATH_PROTOCOL  *DevicePath
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL  *ParentPath;
+  EFI_DEVICE_PATH_PROTOCOL  *Node;
+
+  if (IsDevicePathEnd (DevicePath)) {
+    return NULL;
+  }
+
+  ParentPath = DuplicateDevicePath (DevicePath);
+  if (ParentPath == NULL) {
+    return NULL;
+  }
+
+  Node = ParentPath;
+  while (!IsDevicePathEnd (NextDevicePathNode (Node))) {
+    Node = NextDevicePathNode (Node);
+  }
+  SetDevicePathEndNode (Node);
+
+  return ParentPath;
+}
+
+/**
+  Check whether a disk was produced by the controller of the current probe
+  read-ahead pass.
+
+  @param  DevicePath            The device path of the disk.
+
+  @retval TRUE                  The disk is a sibling of the current pass.
+  @retval FALSE                 The disk is not a sibling of the current pass.
+
+**/
+BOOLEAN
+PartitionProbeIsSibling (
+  IN EFI_DEVICE_PATH_PROTOCOL  *DevicePath
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL  *ParentPath;
+  UINTN                     Size;
+  BOOLEAN                   IsSibling;
+
+  if (mPartitionProbeParentPath == NULL) {
+    return FALSE;
+  }
+
+  ParentPath = PartitionProbeGetParentPath (DevicePath);
+  if (ParentPath == NULL) {
+    return FALSE;
+  }
+
+  Size      = GetDevicePathSize (ParentPath);
+  IsSibling = (BOOLEAN) ((Size == GetDevicePathSize (mPartitionProbeParentPath)) &&
+                         (CompareMem (ParentPath, mPartitionProbeParentPath, Size) == 0));
+  FreePool (ParentPath);
+
+  return IsSibling;
+}
+
+/**
+  Issue a non-blocking read of the first PARTITION_PROBE_SIZE bytes of a disk.
+
+  @param  This                  Protocol instance pointer.
+  @param  Handle                The disk handle.
+
+**/
+VOID
+PartitionProbeIssueRead (
+  IN EFI_DRIVER_BINDING_PROTOCOL  *This,
+  IN EFI_HANDLE                   Handle
+  )
+{
+  EFI_STATUS              Status;
+  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2;
+  EFI_BLOCK_IO_MEDIA      *Media;
+  PARTITION_PROBE         *Probe;
+  UINT64                  DiskSize;
+  UINTN                   Size;
+
+  //
+  // Only the disks this driver will be started on by the current
+  // ConnectController() are read ahead.
+  //
+  if (!EFI_ERROR (EfiTestManagedDevice (Handle, This->DriverBindingHandle, &gEfiDiskIoProtocolGuid))) {
+    return;
+  }
+
+  Status = gBS->OpenProtocol (
+                  Handle,
+                  &gEfiBlockIo2ProtocolGuid,
+                  (VOID **) &BlockIo2,
+                  This->DriverBindingHandle,
+                  Handle,
+                  EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Media = BlockIo2->Media;
+  if (!Media->MediaPresent || Media->RemovableMedia ||
+      Media->LogicalPartition || (Media->BlockSize == 0)) {
+    goto CloseBlockIo2;
+  }
+
+  Size     = MAX (PARTITION_PROBE_SIZE / Media->BlockSize, 1) * Media->BlockSize;
+  DiskSize = MultU64x32 (Media->LastBlock + 1, Media->BlockSize);
+  if (Size > DiskSize) {
+    Size = (UINTN) DiskSize;
+  }
+
+  Probe = AllocateZeroPool (sizeof (PARTITION_PROBE));
+  if (Probe == NULL) {
+    goto CloseBlockIo2;
+  }
+
+  Probe->Signature   = PARTITION_PROBE_SIGNATURE;
+  Probe->Handle      = Handle;
+  Probe->AgentHandle = This->DriverBindingHandle;
+  Probe->BlockIo2    = BlockIo2;
+  Probe->MediaId     = Media->MediaId;
+  Probe->BufferSize  = Size;
+  Probe->DiskIo.Revision  = EFI_DISK_IO_PROTOCOL_REVISION;
+  Probe->DiskIo.ReadDisk  = PartitionProbeReadDisk;
+  Probe->DiskIo.WriteDisk = PartitionProbeWriteDisk;
+
+  Probe->Buffer = AllocateAlignedPages (EFI_SIZE_TO_PAGES (Size), Media->IoAlign);
+  if (Probe->Buffer == NULL) {
+    goto FreeProbe;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  PartitionProbeReadDone,
+                  Probe,
+                  &Probe->Token.Event
+                  );
+  if (EFI_ERROR (Status)) {
+    goto FreeProbe;
+  }
+
+  //
+  // The entry must be on the list before the read can complete, as the
+  // completion may run before ReadBlocksEx() returns.
+  //
+  InsertTailList (&mPartitionProbeList, &Probe->Link);
+  Status = BlockIo2->ReadBlocksEx (
+                       BlockIo2,
+                       Probe->MediaId,
+                       0,
+                       &Probe->Token,
+                       Size,
+                       Probe->Buffer
+                       );
+  if (!EFI_ERROR (Status)) {
+    return;
+  }
+
+  RemoveEntryList (&Probe->Link);
+  gBS->CloseEvent (Probe->Token.Event);
+
+FreeProbe:
+  PartitionProbeFree (Probe);
+
+CloseBlockIo2:
+  gBS->CloseProtocol (
+         Handle,
+         &gEfiBlockIo2ProtocolGuid,
+         This->DriverBindingHandle,
+         Handle
+         );
+}
+
+/**
+  Close the PERF record of the current read-ahead pass.
+
+  @param  Force                 Close it even if read-ahead entries are left.
+
+**/
+VOID
+PartitionProbeEndPass (
+  IN BOOLEAN  Force
+  )
+{
+  if (mPartitionProbePassTimed && (Force || IsListEmpty (&mPartitionProbeList))) {
+    PERF_INMODULE_END ("PartitionConnectPass");
+    mPartitionProbePassTimed = FALSE;
+  }
+}
+
+/**
+  Start a probe read-ahead pass when a disk that is not part of the current
+  pass is started. The entries of the previous pass are dropped, and reads are
+  issued to the other disks produced by the same controller, which the
+  recursive ConnectController() of that controller is about to start this
+  driver on.
+
+  @param  This                  Protocol instance pointer.
+  @param  ControllerHandle      The disk handle being started.
+  @param  DevicePath            The device path of the disk.
+
+**/
+VOID
+PartitionProbeIssueReads (
+  IN EFI_DRIVER_BINDING_PROTOCOL  *This,
+  IN EFI_HANDLE                   ControllerHandle,
+  IN EFI_DEVICE_PATH_PROTOCOL     *DevicePath
+  )
+{
+  EFI_STATUS                Status;
+  EFI_HANDLE                *Handles;
+  UINTN                     HandleCount;
+  UINTN                     Index;
+  EFI_DEVICE_PATH_PROTOCOL  *SiblingPath;
+
+  if ((PartitionProbeFind (ControllerHandle) != NULL) &&
+      PartitionProbeIsSibling (DevicePath)) {
+    return;
+  }
+
+  PartitionProbeEndPass (TRUE);
+  while (!IsListEmpty (&mPartitionProbeList)) {
+    PartitionProbeDrop (CR (GetFirstNode (&mPartitionProbeList), PARTITION_PROBE, Link, PARTITION_PROBE_SIGNATURE));
+  }
+
+  if (mPartitionProbeParentPath != NULL) {
+    FreePool (mPartitionProbeParentPath);
+  }
+  mPartitionProbeParentPath = PartitionProbeGetParentPath (DevicePath);
+  if (mPartitionProbeParentPath == NULL) {
+    return;
+  }
+
+  PERF_INMODULE_BEGIN ("PartitionConnectPass");
+  mPartitionProbePassTimed = TRUE;
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiBlockIo2ProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &Handles
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    if (Handles[Index] == ControllerHandle) {
+      continue;
+    }
+
+    Status = gBS->OpenProtocol (
+                    Handles[Index],
+                    &gEfiDevicePathProtocolGuid,
+                    (VOID **) &SiblingPath,
+                    This->DriverBindingHandle,
+                    Handles[Index],
+                    EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                    );
+    if (EFI_ERROR (Status) || !PartitionProbeIsSibling (SiblingPath)) {
+      continue;
+    }
+
+    PartitionProbeIssueRead (This, Handles[Index]);
+  }
+
+  FreePool (Handles);
+}
+
+/**
+  Get the Disk IO to probe a disk with. The read-ahead data is used when it
+  has arrived; the disk is never made to wait for it. The entry of the disk is
+  removed from mPartitionProbeList either way.
+
+  @param  This                  Protocol instance pointer.
+  @param  ControllerHandle      The disk handle.
+  @param  DevicePath            The device path of the disk.
+  @param  BlockIo2              The Block IO2 of the disk, or NULL.
+  @param  DiskIo                The Disk IO of the disk.
+
+  @return The probe entry whose Disk IO serves the read-ahead data, or NULL
+          if DiskIo should be used directly.
+
+**/
+PARTITION_PROBE *
+PartitionProbeAcquire (
+  IN EFI_DRIVER_BINDING_PROTOCOL  *This,
+  IN EFI_HANDLE                   ControllerHandle,
+  IN EFI_DEVICE_PATH_PROTOCOL     *DevicePath,
+  IN EFI_BLOCK_IO2_PROTOCOL       *BlockIo2,
+  IN EFI_DISK_IO_PROTOCOL         *DiskIo
+  )
+{
+  PARTITION_PROBE  *Probe;
+  EFI_TPL          OldTpl;
+  BOOLEAN          Completed;
+
+  PartitionProbeIssueReads (This, ControllerHandle, DevicePath);
+
+  Probe = PartitionProbeFind (ControllerHandle);
+  if (Probe == NULL) {
+    return NULL;
+  }
+
+  OldTpl    = gBS->RaiseTPL (TPL_NOTIFY);
+  Completed = Probe->Completed;
+  gBS->RestoreTPL (OldTpl);
+
+  //
+  // The data is used only if the read has completed and the disk still has
+  // the Block IO2 and media it was read from.
+  //
+  if (!Completed || (Probe->Buffer == NULL) ||
+      (BlockIo2 != Probe->BlockIo2) ||
+      (BlockIo2->Media->MediaId != Probe->MediaId)) {
+    PartitionProbeDrop (Probe);
+    return NULL;
+  }
+
+  RemoveEntryList (&Probe->Link);
+  Probe->ParentDiskIo = DiskIo;
+  return Probe;
+}
+
+/**
+  Free a probe entry returned by PartitionProbeAcquire().
+
+  @param  Probe                 The probe entry.
+
+**/
+VOID
+PartitionProbeRelease (
+  IN PARTITION_PROBE  *Probe
+  )
+{
+  PartitionProbeFree (Probe);
+}
+
 /**
   Start this driver on ControllerHandle by opening a Block IO or a Block IO2
   or both, and Disk IO protocol, reading Device Path, and creating a child
@@ -197,6 +782,7 @@ PartitionDriverBindingStart (
   PARTITION_DETECT_ROUTINE  *Routine;
   BOOLEAN                   MediaPresent;
   EFI_TPL                   OldTpl;
+  PARTITION_PROBE           *Probe;
 
   BlockIo2 = NULL;
   OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
@@ -304,12 +890,14 @@ PartitionDriverBindingStart (
     // If the media supports a given partition type install child handles to
     // represent the partitions described by the media.
     //
+    PERF_INMODULE_BEGIN ("PartitionProbe");
+    Probe = PartitionProbeAcquire (This, ControllerHandle, ParentDevicePath, BlockIo2, DiskIo);
     Routine = &mPartitionDetectRoutineTable[0];
     while (*Routine != NULL) {
       Status = (*Routine) (
                    This,
                    ControllerHandle,
-                   DiskIo,
+                   (Probe != NULL) ? &Probe->DiskIo : DiskIo,
                    DiskIo2,
                    BlockIo,
                    BlockIo2,
@@ -320,6 +908,11 @@ PartitionDriverBindingStart (
       }
       Routine++;
     }
+    if (Probe != NULL) {
+      PartitionProbeRelease (Probe);
+    }
+    PERF_INMODULE_END ("PartitionProbe");
+    PartitionProbeEndPass (FALSE);
   }
   //
   // In the case that the driver is already started (OpenStatus == EFI_ALREADY_STARTED),
@@ -413,6 +1006,11 @@ PartitionDriverBindingStop (
       return EFI_DEVICE_ERROR;
     }
 
+    //
+    // Drop the probe read-ahead data of the disk, if any.
+    //
+    PartitionProbeInvalidate (ControllerHandle);
+
     //
     // Close the bus driver
     //
@@ -1147,6 +1745,13 @@ PartitionInstallChildHandle (
   Private->BlockSize        = BlockSize;
   Private->ParentBlockIo    = ParentBlockIo;
   Private->ParentBlockIo2   = ParentBlockIo2;
+  //
+  // Children must not keep the probe read-ahead Disk IO, it only lives as
+  // long as the parent is being probed.
+  //
+  if (ParentDiskIo->ReadDisk == PartitionProbeReadDisk) {
+    ParentDiskIo = PARTITION_PROBE_FROM_DISK_IO (ParentDiskIo)->ParentDiskIo;
+  }
   Private->DiskIo           = ParentDiskIo;
   Private->DiskIo2          = ParentDiskIo2;
 
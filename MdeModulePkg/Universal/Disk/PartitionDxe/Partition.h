@@ -31,6 +31,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <IndustryStandard/Mbr.h>
 #include <IndustryStandard/ElTorito.h>
@@ -72,6 +73,34 @@ typedef struct {
 #define PARTITION_DEVICE_FROM_BLOCK_IO_THIS(a)  CR (a, PARTITION_PRIVATE_DATA, BlockIo, PARTITION_PRIVATE_DATA_SIGNATURE)
 #define PARTITION_DEVICE_FROM_BLOCK_IO2_THIS(a) CR (a, PARTITION_PRIVATE_DATA, BlockIo2, PARTITION_PRIVATE_DATA_SIGNATURE)
 
+//
+// Probe read-ahead data. A recursive ConnectController() of a storage
+// controller connects its disks one at a time, so the Start() on the first of
+// them issues non-blocking reads of the head of its sibling disks, and the
+// Start() of each sibling scans its partition table from that data.
+//
+#define PARTITION_PROBE_SIGNATURE  SIGNATURE_32 ('P', 'r', 'o', 'b')
+#define PARTITION_PROBE_SIZE       SIZE_64KB
+typedef struct {
+  UINT32                       Signature;
+  LIST_ENTRY                   Link;          ///< On mPartitionProbeList until consumed
+
+  EFI_HANDLE                   Handle;
+  EFI_HANDLE                   AgentHandle;   ///< Opened BlockIo2 of Handle while the read is in flight
+  EFI_BLOCK_IO2_PROTOCOL       *BlockIo2;
+  EFI_BLOCK_IO2_TOKEN          Token;
+  BOOLEAN                      Completed;     ///< Set by the read completion at TPL_NOTIFY
+  BOOLEAN                      Dropped;       ///< Freed by the read completion
+  UINT32                       MediaId;
+  UINT8                        *Buffer;
+  UINTN                        BufferSize;
+
+  EFI_DISK_IO_PROTOCOL         DiskIo;        ///< Serves reads from Buffer
+  EFI_DISK_IO_PROTOCOL         *ParentDiskIo;
+} PARTITION_PROBE;
+
+#define PARTITION_PROBE_FROM_DISK_IO(a)  CR (a, PARTITION_PROBE, DiskIo, PARTITION_PROBE_SIGNATURE)
+
 //
 // Global Variables
 //
@@ -166,6 +166,16 @@ RamDiskBlkIoReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Sparse != NULL) {
+    RamDiskSparseRead (
+      PrivateData->Sparse,
+      MultU64x32 (Lba, PrivateData->Media.BlockSize),
+      BufferSize,
+      Buffer
+      );
+    return EFI_SUCCESS;
+  }
+
   CopyMem (
     Buffer,
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
@@ -213,6 +223,7 @@ RamDiskBlkIoWriteBlocks (
 {
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   UINTN                           NumberOfBlocks;
+  EFI_STATUS                      Status;
 
   PrivateData = RAM_DISK_PRIVATE_FROM_BLKIO (This);
 
@@ -245,6 +256,20 @@ RamDiskBlkIoWriteBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Sparse != NULL) {
+    Status = RamDiskSparseWrite (
+               PrivateData->Sparse,
+               MultU64x32 (Lba, PrivateData->Media.BlockSize),
+               BufferSize,
+               Buffer
+               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "RamDiskBlkIoWriteBlocks: Sparse RAM disk out of memory at LBA 0x%lx\n", Lba));
+      return EFI_DEVICE_ERROR;
+    }
+    return EFI_SUCCESS;
+  }
+
   CopyMem (
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
     Buffer,
@@ -181,7 +181,9 @@ UnregisterAllRamDisks (
 
       RemoveEntryList (&PrivateData->ThisInstance);
 
-      if (RamDiskCreateHii == PrivateData->CreateMethod) {
+      if (PrivateData->Sparse != NULL) {
+        RamDiskSparseFree (PrivateData->Sparse);
+      } else if (RamDiskCreateHii == PrivateData->CreateMethod) {
         //
         // If a RAM disk is created within HII, then the RamDiskDxe driver
         // driver is responsible for freeing the allocated memory for the
@@ -306,9 +308,13 @@ HiiCreateRamDisk (
   EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   EFI_FILE_INFO                   *FileInformation;
+  RAM_DISK_SPARSE_STORAGE         *Sparse;
+  UINT8                           *Chunk;
+  UINT64                          Offset;
 
   FileInformation = NULL;
   StartingAddr    = NULL;
+  Sparse          = NULL;
 
   if (FileHandle != NULL) {
     //
@@ -365,6 +371,14 @@ HiiCreateRamDisk (
                     (UINTN)Size,
                     (VOID**)&StartingAddr
                     );
+  } else if (MemoryType == RAM_DISK_SPARSE_MEMORY) {
+    //
+    // Only the directory of the sparse RAM disk is allocated here, the data
+    // pages are allocated as they get written.
+    //
+    Sparse       = RamDiskSparseCreate (Size);
+    StartingAddr = (UINT64 *) Sparse;
+    Status       = (Sparse == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
   } else {
     Status = EFI_INVALID_PARAMETER;
   }
@@ -385,7 +399,49 @@ HiiCreateRamDisk (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  if (FileHandle != NULL) {
+  if ((FileHandle != NULL) && (Sparse != NULL)) {
+    //
+    // Copy the file content to the sparse RAM disk through a bounce buffer.
+    // Zero pages of the file take no memory on the RAM disk.
+    //
+    Chunk  = AllocatePool (SIZE_1MB);
+    Offset = 0;
+    Status = (Chunk == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+    while (!EFI_ERROR (Status) && (Offset < Size)) {
+      BufferSize = (UINTN) MIN (SIZE_1MB, Size - Offset);
+      Status     = FileHandle->Read (FileHandle, &BufferSize, Chunk);
+      if (!EFI_ERROR (Status) && (BufferSize == 0)) {
+        Status = EFI_END_OF_FILE;
+      }
+      if (!EFI_ERROR (Status)) {
+        Status  = RamDiskSparseWrite (Sparse, Offset, BufferSize, Chunk);
+        Offset += BufferSize;
+      }
+    }
+
+    if (Chunk != NULL) {
+      FreePool (Chunk);
+    }
+
+    if (EFI_ERROR (Status)) {
+      RamDiskSparseFree (Sparse);
+      do {
+        CreatePopUp (
+          EFI_LIGHTGRAY | EFI_BACKGROUND_BLUE,
+          &Key,
+          L"",
+          (Status == EFI_OUT_OF_RESOURCES) ?
+            L"Not enough memory to create the RAM disk!" :
+            L"File content read error!",
+          L"Press ENTER to continue ...",
+          L"",
+          NULL
+          );
+      } while (Key.UnicodeChar != CHAR_CARRIAGE_RETURN);
+
+      return (Status == EFI_OUT_OF_RESOURCES) ? Status : EFI_DEVICE_ERROR;
+    }
+  } else if (FileHandle != NULL) {
     //
     // Copy the file content to the RAM disk.
     //
@@ -415,13 +471,25 @@ HiiCreateRamDisk (
   //
   // Register the newly created RAM disk.
   //
-  Status = RamDiskRegister (
-             ((UINT64)(UINTN) StartingAddr),
-             Size,
-             &gEfiVirtualDiskGuid,
-             NULL,
-             &DevicePath
-             );
+  if (Sparse != NULL) {
+    Status = RamDiskRegisterSparse (
+               Sparse,
+               &gEfiVirtualDiskGuid,
+               NULL,
+               &DevicePath
+               );
+    if (EFI_ERROR (Status)) {
+      RamDiskSparseFree (Sparse);
+    }
+  } else {
+    Status = RamDiskRegister (
+               ((UINT64)(UINTN) StartingAddr),
+               Size,
+               &gEfiVirtualDiskGuid,
+               NULL,
+               &DevicePath
+               );
+  }
   if (EFI_ERROR (Status)) {
     do {
       CreatePopUp (
@@ -517,14 +585,25 @@ UpdateMainForm (
     PrivateData->CheckBoxChecked = FALSE;
     String                       = RamDiskStr;
 
-    UnicodeSPrint (
-      String,
-      sizeof (RamDiskStr),
-      L"  RAM Disk %d: [0x%lx, 0x%lx]\n",
-      Index,
-      PrivateData->StartingAddr,
-      PrivateData->StartingAddr + PrivateData->Size - 1
-      );
+    if (PrivateData->Sparse != NULL) {
+      UnicodeSPrint (
+        String,
+        sizeof (RamDiskStr),
+        L"  RAM Disk %d: Sparse, 0x%lx bytes, %ld KB in use\n",
+        Index,
+        PrivateData->Size,
+        MultU64x32 (PrivateData->Sparse->AllocatedPages, EFI_PAGE_SIZE / SIZE_1KB)
+        );
+    } else {
+      UnicodeSPrint (
+        String,
+        sizeof (RamDiskStr),
+        L"  RAM Disk %d: [0x%lx, 0x%lx]\n",
+        Index,
+        PrivateData->StartingAddr,
+        PrivateData->StartingAddr + PrivateData->Size - 1
+        );
+    }
 
     StringId = HiiSetString (ConfigPrivate->HiiHandle, 0, RamDiskStr, NULL);
     ASSERT (StringId != 0);
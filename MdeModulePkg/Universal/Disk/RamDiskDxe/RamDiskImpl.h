@@ -80,6 +80,36 @@ typedef enum _RAM_DISK_CREATE_METHOD {
   RamDiskCreateHii
 } RAM_DISK_CREATE_METHOD;
 
+//
+// Sparse RAM disks keep their data in pages of RAM_DISK_SPARSE_PAGE_SIZE
+// bytes, allocated on first non-zero write and found through single page
+// tables of RAM_DISK_SPARSE_PAGES_PER_TABLE page pointers.
+//
+#define RAM_DISK_SPARSE_PAGE_SIZE        EFI_PAGE_SIZE
+#define RAM_DISK_SPARSE_PAGES_PER_TABLE  ((UINT32) (EFI_PAGE_SIZE / sizeof (UINT8 *)))
+
+typedef struct {
+  UINT64                          Size;
+  UINTN                           TableCount;
+  UINT8                           ***Tables;
+  UINTN                           PageCount;      ///< Data pages
+  UINTN                           AllocatedPages; ///< Data, table and top level table pages
+} RAM_DISK_SPARSE_STORAGE;
+
+//
+// The data of a sparse RAM disk is not held in a memory range, so it is
+// described by a vendor defined media node, whose GUID is the FILE_GUID of
+// this driver, instead of a MEDIA_RAM_DISK_DEVICE_PATH node.
+//
+#pragma pack(1)
+typedef struct {
+  VENDOR_DEVICE_PATH              VendorDevicePath;
+  EFI_GUID                        TypeGuid;
+  UINT8                           Size[8];
+  UINT32                          Identifier;
+} RAM_DISK_SPARSE_DEVICE_PATH;
+#pragma pack()
+
 //
 // RamDiskDxe driver maintains a list of registered RAM disks.
 // The struct contains the list entry and the information of each RAM
@@ -103,6 +133,13 @@ typedef struct {
   BOOLEAN                         InNfit;
   EFI_QUESTION_ID                 CheckBoxId;
   BOOLEAN                         CheckBoxChecked;
+  //
+  // Backing store of a sparse RAM disk, NULL for a RAM disk backed by the
+  // memory at StartingAddr. A sparse RAM disk has no StartingAddr and is
+  // identified by SparseIdentifier in its device path.
+  //
+  RAM_DISK_SPARSE_STORAGE         *Sparse;
+  UINT32                          SparseIdentifier;
 
   LIST_ENTRY                      ThisInstance;
 } RAM_DISK_PRIVATE_DATA;
@@ -203,6 +240,98 @@ RamDiskUnregister (
   IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath
   );
 
+/**
+  Register a sparse RAM disk. The RAM disk is not published in the NFIT as
+  its data is not held in a memory range the OS could use.
+
+  @param[in]  Sparse         The backing store of the RAM disk. On success
+                             the RAM disk takes ownership of it.
+  @param[in]  RamDiskType    The type of registered RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path. If there is no
+                             parent device path then ParentDevicePath is NULL.
+  @param[out] DevicePath     On return, points to a pointer to the device path
+                             of the RAM disk device.
+
+  @retval EFI_SUCCESS             The RAM disk is registered successfully.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL.
+  @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
+                                  is already present in the handle database.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk register operation fails due to
+                                  resource limitation.
+
+**/
+EFI_STATUS
+RamDiskRegisterSparse (
+  IN RAM_DISK_SPARSE_STORAGE      *Sparse,
+  IN EFI_GUID                     *RamDiskType,
+  IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+  );
+
+/**
+  Create the backing store of a sparse RAM disk. All of its data reads as
+  zero until written.
+
+  @param[in] Size            The size of the RAM disk.
+
+  @return The sparse backing store, or NULL if there is not enough memory.
+
+**/
+RAM_DISK_SPARSE_STORAGE *
+RamDiskSparseCreate (
+  IN UINT64                       Size
+  );
+
+/**
+  Free the backing store of a sparse RAM disk and all pages written to it.
+
+  @param[in] Storage         The sparse backing store.
+
+**/
+VOID
+RamDiskSparseFree (
+  IN RAM_DISK_SPARSE_STORAGE      *Storage
+  );
+
+/**
+  Read data from a sparse RAM disk.
+
+  @param[in]  Storage        The sparse backing store.
+  @param[in]  Offset         The byte offset to read from.
+  @param[in]  Length         The number of bytes to read.
+  @param[out] Buffer         The buffer to receive the data.
+
+**/
+VOID
+RamDiskSparseRead (
+  IN  RAM_DISK_SPARSE_STORAGE     *Storage,
+  IN  UINT64                      Offset,
+  IN  UINTN                       Length,
+  OUT UINT8                       *Buffer
+  );
+
+/**
+  Write data to a sparse RAM disk. Pages are allocated the first time
+  non-zero data is written to them.
+
+  @param[in] Storage         The sparse backing store.
+  @param[in] Offset          The byte offset to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data was written.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to store the data.
+
+**/
+EFI_STATUS
+RamDiskSparseWrite (
+  IN RAM_DISK_SPARSE_STORAGE      *Storage,
+  IN UINT64                       Offset,
+  IN UINTN                        Length,
+  IN UINT8                        *Buffer
+  );
+
 /**
   Initialize the BlockIO protocol of a RAM disk device.
 
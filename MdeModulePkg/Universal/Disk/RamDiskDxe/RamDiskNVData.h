@@ -28,7 +28,8 @@
 
 #define RAM_DISK_BOOT_SERVICE_DATA_MEMORY   0x00
 #define RAM_DISK_RESERVED_MEMORY            0x01
-#define RAM_DISK_MEMORY_TYPE_MAX            0x02
+#define RAM_DISK_SPARSE_MEMORY              0x02
+#define RAM_DISK_MEMORY_TYPE_MAX            0x03
 
 typedef struct {
   //
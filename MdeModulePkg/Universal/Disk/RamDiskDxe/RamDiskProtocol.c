@@ -25,6 +25,24 @@ MEDIA_RAM_DISK_DEVICE_PATH  mRamDiskDeviceNodeTemplate = {
   }
 };
 
+RAM_DISK_SPARSE_DEVICE_PATH  mRamDiskSparseDeviceNodeTemplate = {
+  {
+    {
+      MEDIA_DEVICE_PATH,
+      MEDIA_VENDOR_DP,
+      {
+        (UINT8) (sizeof (RAM_DISK_SPARSE_DEVICE_PATH)),
+        (UINT8) ((sizeof (RAM_DISK_SPARSE_DEVICE_PATH)) >> 8)
+      }
+    }
+  }
+};
+
+//
+// Identifier of the next registered sparse RAM disk.
+//
+UINT32   mRamDiskSparseIdentifier = 0;
+
 BOOLEAN  mRamDiskSsdtTableKeyValid = FALSE;
 UINTN    mRamDiskSsdtTableKey;
 
@@ -55,6 +73,26 @@ RamDiskInitDeviceNode (
 }
 
 
+/**
+  Initialize the device node of a sparse RAM disk.
+
+  @param[in]      PrivateData     Points to RAM disk private data.
+  @param[in, out] SparseDevNode   Points to the sparse RAM disk device node.
+
+**/
+VOID
+RamDiskInitSparseDeviceNode (
+  IN     RAM_DISK_PRIVATE_DATA         *PrivateData,
+  IN OUT RAM_DISK_SPARSE_DEVICE_PATH   *SparseDevNode
+  )
+{
+  CopyGuid (&SparseDevNode->VendorDevicePath.Guid, &gEfiCallerIdGuid);
+  CopyGuid (&SparseDevNode->TypeGuid, &PrivateData->TypeGuid);
+  WriteUnaligned64 ((UINT64 *) &(SparseDevNode->Size[0]), PrivateData->Size);
+  WriteUnaligned32 (&SparseDevNode->Identifier, PrivateData->SparseIdentifier);
+}
+
+
 /**
   Initialize and publish NVDIMM root device SSDT in ACPI table.
 
@@ -554,13 +592,17 @@ RamDiskUnpublishNfit (
 
 
 /**
-  Register a RAM disk with specified address, size and type.
+  Register a RAM disk backed either by memory or by a sparse backing store.
 
-  @param[in]  RamDiskBase    The base address of registered RAM disk.
+  @param[in]  RamDiskBase    The base address of registered RAM disk. Ignored
+                             for a sparse RAM disk.
   @param[in]  RamDiskSize    The size of registered RAM disk.
   @param[in]  RamDiskType    The type of registered RAM disk. The GUID can be
                              any of the values defined in section 9.3.6.9, or a
                              vendor defined GUID.
+  @param[in]  Sparse         The sparse backing store of the RAM disk, or NULL
+                             if the RAM disk data is at RamDiskBase. A sparse
+                             RAM disk gets a vendor defined device node.
   @param[in]  ParentDevicePath
                              Pointer to the parent device path. If there is no
                              parent device path then ParentDevicePath is NULL.
@@ -584,11 +626,11 @@ RamDiskUnpublishNfit (
 
 **/
 EFI_STATUS
-EFIAPI
-RamDiskRegister (
+RamDiskRegisterInternal (
   IN UINT64                       RamDiskBase,
   IN UINT64                       RamDiskSize,
   IN EFI_GUID                     *RamDiskType,
+  IN RAM_DISK_SPARSE_STORAGE      *Sparse               OPTIONAL,
   IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
   OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
   )
@@ -596,7 +638,7 @@ RamDiskRegister (
   EFI_STATUS                      Status;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   RAM_DISK_PRIVATE_DATA           *RegisteredPrivateData;
-  MEDIA_RAM_DISK_DEVICE_PATH      *RamDiskDevNode;
+  EFI_DEVICE_PATH_PROTOCOL        *RamDiskDevNode;
   UINTN                           DevicePathSize;
   LIST_ENTRY                      *Entry;
 
@@ -608,7 +650,7 @@ RamDiskRegister (
   // Add check to prevent data read across the memory boundary
   //
   if ((RamDiskSize > MAX_UINTN) ||
-      (RamDiskBase > MAX_UINTN - RamDiskSize + 1)) {
+      ((Sparse == NULL) && (RamDiskBase > MAX_UINTN - RamDiskSize + 1))) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -625,29 +667,41 @@ RamDiskRegister (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  PrivateData->StartingAddr = RamDiskBase;
   PrivateData->Size         = RamDiskSize;
+  PrivateData->Sparse       = Sparse;
   CopyGuid (&PrivateData->TypeGuid, RamDiskType);
   InitializeListHead (&PrivateData->ThisInstance);
 
   //
   // Generate device path information for the registered RAM disk
   //
-  RamDiskDevNode = AllocateCopyPool (
-                     sizeof (MEDIA_RAM_DISK_DEVICE_PATH),
-                     &mRamDiskDeviceNodeTemplate
-                     );
-  if (NULL == RamDiskDevNode) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto ErrorExit;
-  }
+  if (Sparse == NULL) {
+    PrivateData->StartingAddr = RamDiskBase;
+    RamDiskDevNode = AllocateCopyPool (
+                       sizeof (MEDIA_RAM_DISK_DEVICE_PATH),
+                       &mRamDiskDeviceNodeTemplate
+                       );
+    if (NULL == RamDiskDevNode) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto ErrorExit;
+    }
 
-  RamDiskInitDeviceNode (PrivateData, RamDiskDevNode);
+    RamDiskInitDeviceNode (PrivateData, (MEDIA_RAM_DISK_DEVICE_PATH *) RamDiskDevNode);
+  } else {
+    PrivateData->SparseIdentifier = mRamDiskSparseIdentifier++;
+    RamDiskDevNode = AllocateCopyPool (
+                       sizeof (RAM_DISK_SPARSE_DEVICE_PATH),
+                       &mRamDiskSparseDeviceNodeTemplate
+                       );
+    if (NULL == RamDiskDevNode) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto ErrorExit;
+    }
 
-  *DevicePath = AppendDevicePathNode (
-                  ParentDevicePath,
-                  (EFI_DEVICE_PATH_PROTOCOL *) RamDiskDevNode
-                  );
+    RamDiskInitSparseDeviceNode (PrivateData, (RAM_DISK_SPARSE_DEVICE_PATH *) RamDiskDevNode);
+  }
+
+  *DevicePath = AppendDevicePathNode (ParentDevicePath, RamDiskDevNode);
   if (NULL == *DevicePath) {
     Status = EFI_OUT_OF_RESOURCES;
     goto ErrorExit;
@@ -712,7 +766,7 @@ RamDiskRegister (
 
   FreePool (RamDiskDevNode);
 
-  if ((mAcpiTableProtocol != NULL) && (mAcpiSdtProtocol != NULL)) {
+  if ((Sparse == NULL) && (mAcpiTableProtocol != NULL) && (mAcpiSdtProtocol != NULL)) {
     RamDiskPublishNfit (PrivateData);
   }
 
@@ -735,6 +789,97 @@ ErrorExit:
 }
 
 
+/**
+  Register a RAM disk with specified address, size and type.
+
+  @param[in]  RamDiskBase    The base address of registered RAM disk.
+  @param[in]  RamDiskSize    The size of registered RAM disk.
+  @param[in]  RamDiskType    The type of registered RAM disk. The GUID can be
+                             any of the values defined in section 9.3.6.9, or a
+                             vendor defined GUID.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path. If there is no
+                             parent device path then ParentDevicePath is NULL.
+  @param[out] DevicePath     On return, points to a pointer to the device path
+                             of the RAM disk device.
+                             If ParentDevicePath is not NULL, the returned
+                             DevicePath is created by appending a RAM disk node
+                             to the parent device path. If ParentDevicePath is
+                             NULL, the returned DevicePath is a RAM disk device
+                             path without appending. This function is
+                             responsible for allocating the buffer DevicePath
+                             with the boot service AllocatePool().
+
+  @retval EFI_SUCCESS             The RAM disk is registered successfully.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL.
+                                  RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
+                                  is already present in the handle database.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk register operation fails due to
+                                  resource limitation.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegister (
+  IN UINT64                       RamDiskBase,
+  IN UINT64                       RamDiskSize,
+  IN EFI_GUID                     *RamDiskType,
+  IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+  )
+{
+  return RamDiskRegisterInternal (
+           RamDiskBase,
+           RamDiskSize,
+           RamDiskType,
+           NULL,
+           ParentDevicePath,
+           DevicePath
+           );
+}
+
+
+/**
+  Register a sparse RAM disk. The RAM disk is not published in the NFIT and
+  its device path has no memory range node, as its data is not held in a
+  memory range the OS could use.
+
+  @param[in]  Sparse         The backing store of the RAM disk. On success
+                             the RAM disk takes ownership of it.
+  @param[in]  RamDiskType    The type of registered RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path. If there is no
+                             parent device path then ParentDevicePath is NULL.
+  @param[out] DevicePath     On return, points to a pointer to the device path
+                             of the RAM disk device.
+
+  @retval EFI_SUCCESS             The RAM disk is registered successfully.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL.
+  @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
+                                  is already present in the handle database.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk register operation fails due to
+                                  resource limitation.
+
+**/
+EFI_STATUS
+RamDiskRegisterSparse (
+  IN RAM_DISK_SPARSE_STORAGE      *Sparse,
+  IN EFI_GUID                     *RamDiskType,
+  IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+  )
+{
+  return RamDiskRegisterInternal (
+           0,
+           Sparse->Size,
+           RamDiskType,
+           Sparse,
+           ParentDevicePath,
+           DevicePath
+           );
+}
+
 /**
   Unregister a RAM disk specified by DevicePath.
 
@@ -763,6 +908,7 @@ RamDiskUnregister (
   UINT64                          EndingAddr;
   EFI_DEVICE_PATH_PROTOCOL        *Header;
   MEDIA_RAM_DISK_DEVICE_PATH      *RamDiskDevNode;
+  RAM_DISK_SPARSE_DEVICE_PATH     *SparseDevNode;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
 
   if (NULL == DevicePath) {
@@ -773,6 +919,7 @@ RamDiskUnregister (
   // Locate the RAM disk device node.
   //
   RamDiskDevNode = NULL;
+  SparseDevNode  = NULL;
   Header         = DevicePath;
   do {
     //
@@ -785,16 +932,32 @@ RamDiskUnregister (
       break;
     }
 
+    //
+    // Test if the current device node is a sparse RAM disk.
+    //
+    if ((MEDIA_DEVICE_PATH == Header->Type) &&
+      (MEDIA_VENDOR_DP == Header->SubType) &&
+      (DevicePathNodeLength (Header) == sizeof (RAM_DISK_SPARSE_DEVICE_PATH)) &&
+      CompareGuid (&((VENDOR_DEVICE_PATH *) Header)->Guid, &gEfiCallerIdGuid)) {
+      SparseDevNode = (RAM_DISK_SPARSE_DEVICE_PATH *) Header;
+
+      break;
+    }
+
     Header = NextDevicePathNode (Header);
   } while ((Header->Type != END_DEVICE_PATH_TYPE));
 
-  if (NULL == RamDiskDevNode) {
+  if ((NULL == RamDiskDevNode) && (NULL == SparseDevNode)) {
     return EFI_UNSUPPORTED;
   }
 
   Found          = FALSE;
-  StartingAddr   = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->StartingAddr[0]));
-  EndingAddr     = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->EndingAddr[0]));
+  StartingAddr   = 0;
+  EndingAddr     = 0;
+  if (RamDiskDevNode != NULL) {
+    StartingAddr = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->StartingAddr[0]));
+    EndingAddr   = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->EndingAddr[0]));
+  }
 
   if (!IsListEmpty(&RegisteredRamDisks)) {
     EFI_LIST_FOR_EACH_SAFE (Entry, NextEntry, &RegisteredRamDisks) {
@@ -802,11 +965,19 @@ RamDiskUnregister (
 
       //
       // Unregister the RAM disk given by its starting address, ending address
+      // and type guid, or the sparse RAM disk given by its identifier, size
       // and type guid.
       //
-      if ((StartingAddr == PrivateData->StartingAddr) &&
-          (EndingAddr == PrivateData->StartingAddr + PrivateData->Size - 1) &&
-          (CompareGuid (&RamDiskDevNode->TypeGuid, &PrivateData->TypeGuid))) {
+      if (((RamDiskDevNode != NULL) &&
+           (PrivateData->Sparse == NULL) &&
+           (StartingAddr == PrivateData->StartingAddr) &&
+           (EndingAddr == PrivateData->StartingAddr + PrivateData->Size - 1) &&
+           (CompareGuid (&RamDiskDevNode->TypeGuid, &PrivateData->TypeGuid))) ||
+          ((SparseDevNode != NULL) &&
+           (PrivateData->Sparse != NULL) &&
+           (ReadUnaligned32 (&SparseDevNode->Identifier) == PrivateData->SparseIdentifier) &&
+           (ReadUnaligned64 ((UINT64 *) &(SparseDevNode->Size[0])) == PrivateData->Size) &&
+           (CompareGuid (&SparseDevNode->TypeGuid, &PrivateData->TypeGuid)))) {
         //
         // Remove the content for this RAM disk in NFIT.
         //
@@ -830,7 +1001,12 @@ RamDiskUnregister (
 
         RemoveEntryList (&PrivateData->ThisInstance);
 
-        if (RamDiskCreateHii == PrivateData->CreateMethod) {
+        if (PrivateData->Sparse != NULL) {
+          //
+          // The backing store of a sparse RAM disk is owned by the RAM disk.
+          //
+          RamDiskSparseFree (PrivateData->Sparse);
+        } else if (RamDiskCreateHii == PrivateData->CreateMethod) {
           //
           // If a RAM disk is created within HII, then the RamDiskDxe driver
           // driver is responsible for freeing the allocated memory for the
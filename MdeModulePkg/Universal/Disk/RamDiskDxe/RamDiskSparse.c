@@ -0,0 +1,228 @@
+/** @file
+  Sparse backing store of RAM disks.
+
+  The data of a sparse RAM disk is kept in RAM_DISK_SPARSE_PAGE_SIZE pages
+  that are only allocated when non-zero data is first written to them. Pages
+  that were never written read back as zeros, so a large disk that is mostly
+  empty only costs the memory of the data really stored on it.
+
+  The pages, the tables that find them and the top level table are all page
+  allocations, so AllocatedPages is exactly the memory the disk holds, apart
+  from the small RAM_DISK_SPARSE_STORAGE structure itself.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "RamDiskImpl.h"
+
+/**
+  Create the backing store of a sparse RAM disk. All of its data reads as
+  zero until written.
+
+  @param[in] Size            The size of the RAM disk.
+
+  @return The sparse backing store, or NULL if there is not enough memory.
+
+**/
+RAM_DISK_SPARSE_STORAGE *
+RamDiskSparseCreate (
+  IN UINT64                       Size
+  )
+{
+  RAM_DISK_SPARSE_STORAGE         *Storage;
+  UINT64                          TableCount;
+
+  TableCount = DivU64x32 (
+                 Size + MultU64x32 (RAM_DISK_SPARSE_PAGES_PER_TABLE, RAM_DISK_SPARSE_PAGE_SIZE) - 1,
+                 RAM_DISK_SPARSE_PAGES_PER_TABLE * RAM_DISK_SPARSE_PAGE_SIZE
+                 );
+  if ((Size == 0) || (TableCount > MAX_UINTN / sizeof (UINT8 **))) {
+    return NULL;
+  }
+
+  Storage = AllocateZeroPool (sizeof (RAM_DISK_SPARSE_STORAGE));
+  if (Storage == NULL) {
+    return NULL;
+  }
+
+  Storage->Size       = Size;
+  Storage->TableCount = (UINTN) TableCount;
+  Storage->Tables     = AllocatePages (EFI_SIZE_TO_PAGES (Storage->TableCount * sizeof (UINT8 **)));
+  if (Storage->Tables == NULL) {
+    FreePool (Storage);
+    return NULL;
+  }
+  ZeroMem (Storage->Tables, Storage->TableCount * sizeof (UINT8 **));
+  Storage->AllocatedPages = EFI_SIZE_TO_PAGES (Storage->TableCount * sizeof (UINT8 **));
+
+  return Storage;
+}
+
+/**
+  Free the backing store of a sparse RAM disk and all pages written to it.
+
+  @param[in] Storage         The sparse backing store.
+
+**/
+VOID
+RamDiskSparseFree (
+  IN RAM_DISK_SPARSE_STORAGE      *Storage
+  )
+{
+  UINTN                           TableIndex;
+  UINTN                           PageIndex;
+  UINT8                           **Table;
+
+  for (TableIndex = 0; TableIndex < Storage->TableCount; TableIndex++) {
+    Table = Storage->Tables[TableIndex];
+    if (Table == NULL) {
+      continue;
+    }
+
+    for (PageIndex = 0; PageIndex < RAM_DISK_SPARSE_PAGES_PER_TABLE; PageIndex++) {
+      if (Table[PageIndex] != NULL) {
+        FreePages (Table[PageIndex], 1);
+      }
+    }
+    FreePages (Table, 1);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "RamDiskSparseFree: %ld bytes disk held %ld data pages, %ld pages in total\n",
+    Storage->Size,
+    (UINT64) Storage->PageCount,
+    (UINT64) Storage->AllocatedPages
+    ));
+
+  FreePages (Storage->Tables, EFI_SIZE_TO_PAGES (Storage->TableCount * sizeof (UINT8 **)));
+  FreePool (Storage);
+}
+
+/**
+  Read data from a sparse RAM disk.
+
+  @param[in]  Storage        The sparse backing store.
+  @param[in]  Offset         The byte offset to read from.
+  @param[in]  Length         The number of bytes to read.
+  @param[out] Buffer         The buffer to receive the data.
+
+**/
+VOID
+RamDiskSparseRead (
+  IN  RAM_DISK_SPARSE_STORAGE     *Storage,
+  IN  UINT64                      Offset,
+  IN  UINTN                       Length,
+  OUT UINT8                       *Buffer
+  )
+{
+  UINT64                          PageNumber;
+  UINTN                           PageOffset;
+  UINTN                           DataLength;
+  UINT8                           **Table;
+  UINT8                           *Page;
+
+  ASSERT (Offset <= Storage->Size && Length <= Storage->Size - Offset);
+
+  while (Length > 0) {
+    PageNumber = DivU64x32 (Offset, RAM_DISK_SPARSE_PAGE_SIZE);
+    PageOffset = (UINTN) (Offset & (RAM_DISK_SPARSE_PAGE_SIZE - 1));
+    DataLength = MIN (Length, RAM_DISK_SPARSE_PAGE_SIZE - PageOffset);
+
+    Page  = NULL;
+    Table = Storage->Tables[(UINTN) DivU64x32 (PageNumber, RAM_DISK_SPARSE_PAGES_PER_TABLE)];
+    if (Table != NULL) {
+      Page = Table[(UINTN) PageNumber % RAM_DISK_SPARSE_PAGES_PER_TABLE];
+    }
+
+    if (Page != NULL) {
+      CopyMem (Buffer, Page + PageOffset, DataLength);
+    } else {
+      ZeroMem (Buffer, DataLength);
+    }
+
+    Offset += DataLength;
+    Buffer += DataLength;
+    Length -= DataLength;
+  }
+}
+
+/**
+  Write data to a sparse RAM disk. Pages are allocated the first time
+  non-zero data is written to them.
+
+  @param[in] Storage         The sparse backing store.
+  @param[in] Offset          The byte offset to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data was written.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to store the data.
+                                  The pages written before running out of
+                                  memory keep the new data.
+
+**/
+EFI_STATUS
+RamDiskSparseWrite (
+  IN RAM_DISK_SPARSE_STORAGE      *Storage,
+  IN UINT64                       Offset,
+  IN UINTN                        Length,
+  IN UINT8                        *Buffer
+  )
+{
+  UINT64                          PageNumber;
+  UINTN                           PageOffset;
+  UINTN                           DataLength;
+  UINT8                           ***Table;
+  UINT8                           **Page;
+
+  ASSERT (Offset <= Storage->Size && Length <= Storage->Size - Offset);
+
+  while (Length > 0) {
+    PageNumber = DivU64x32 (Offset, RAM_DISK_SPARSE_PAGE_SIZE);
+    PageOffset = (UINTN) (Offset & (RAM_DISK_SPARSE_PAGE_SIZE - 1));
+    DataLength = MIN (Length, RAM_DISK_SPARSE_PAGE_SIZE - PageOffset);
+
+    Table = &Storage->Tables[(UINTN) DivU64x32 (PageNumber, RAM_DISK_SPARSE_PAGES_PER_TABLE)];
+    Page  = NULL;
+    if (*Table != NULL) {
+      Page = &(*Table)[(UINTN) PageNumber % RAM_DISK_SPARSE_PAGES_PER_TABLE];
+    }
+
+    if ((Page == NULL || *Page == NULL) && IsZeroBuffer (Buffer, DataLength)) {
+      //
+      // Zeros written to a page never written before are already there.
+      //
+    } else {
+      if (*Table == NULL) {
+        *Table = AllocatePages (1);
+        if (*Table == NULL) {
+          return EFI_OUT_OF_RESOURCES;
+        }
+        ZeroMem (*Table, EFI_PAGE_SIZE);
+        Storage->AllocatedPages++;
+        Page = &(*Table)[(UINTN) PageNumber % RAM_DISK_SPARSE_PAGES_PER_TABLE];
+      }
+
+      if (*Page == NULL) {
+        *Page = AllocatePages (1);
+        if (*Page == NULL) {
+          return EFI_OUT_OF_RESOURCES;
+        }
+        ZeroMem (*Page, RAM_DISK_SPARSE_PAGE_SIZE);
+        Storage->PageCount++;
+        Storage->AllocatedPages++;
+      }
+
+      CopyMem (*Page + PageOffset, Buffer, DataLength);
+    }
+
+    Offset += DataLength;
+    Buffer += DataLength;
+    Length -= DataLength;
+  }
+
+  return EFI_SUCCESS;
+}
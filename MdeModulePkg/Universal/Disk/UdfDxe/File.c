@@ -264,6 +264,8 @@ UdfOpen (
   NewPrivFileData->FilePosition = 0;
   ZeroMem ((VOID *)&NewPrivFileData->ReadDirInfo,
            sizeof (UDF_READ_DIRECTORY_INFO));
+  ZeroMem ((VOID *)&NewPrivFileData->ReadCache,
+           sizeof (NewPrivFileData->ReadCache));
 
   *NewHandle = &NewPrivFileData->FileIo;
 
@@ -375,7 +377,8 @@ UdfRead (
       PrivFileData->FileSize,
       &PrivFileData->FilePosition,
       Buffer,
-      &BufferSizeUint64
+      &BufferSizeUint64,
+      &PrivFileData->ReadCache
       );
     ASSERT (BufferSizeUint64 <= MAX_UINTN);
     *BufferSize = (UINTN)BufferSizeUint64;
@@ -552,6 +555,8 @@ UdfClose (
 
   PrivFileData = PRIVATE_UDF_FILE_DATA_FROM_THIS (This);
 
+  CleanupFileReadCache (&PrivFileData->ReadCache);
+
   if (!PrivFileData->IsRootDirectory) {
     CleanupFileInformation (&PrivFileData->File);
 
@@ -2788,6 +2788,298 @@ Out_Free:
   return Status;
 }
 
+/**
+  Resolve the recorded extents of a file from its Allocation Descriptors,
+  including the ones in Allocation Extent Descriptors, and keep them in the
+  file's read cache. Physically contiguous extents are merged.
+
+  @param[in]      BlockIo       BlockIo interface.
+  @param[in]      DiskIo        DiskIo interface.
+  @param[in]      Volume        UDF volume information structure.
+  @param[in]      File          File information structure.
+  @param[in, out] ReadCache     Read cache of the open file.
+
+  @retval EFI_SUCCESS          The extents were resolved.
+  @retval EFI_UNSUPPORTED      The file data is not described by Short or Long
+                               Allocation Descriptors.
+  @retval EFI_OUT_OF_RESOURCES The extents were not resolved due to lack of
+                               resources.
+  @retval other                The extents were not resolved.
+
+**/
+EFI_STATUS
+GetFileExtents (
+  IN      EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN      EFI_DISK_IO_PROTOCOL   *DiskIo,
+  IN      UDF_VOLUME_INFO        *Volume,
+  IN      UDF_FILE_INFO          *File,
+  IN OUT  UDF_FILE_READ_CACHE    *ReadCache
+  )
+{
+  EFI_STATUS              Status;
+  UDF_FE_RECORDING_FLAGS  RecordingFlags;
+  VOID                    *Data;
+  VOID                    *DataBak;
+  UINT64                  Length;
+  VOID                    *Ad;
+  UINT64                  AdOffset;
+  UINT64                  Lsn;
+  BOOLEAN                 DoFreeAed;
+  UINT64                  FileOffset;
+  UINT64                  DiskOffset;
+  UINT32                  ExtentLength;
+  UDF_FILE_EXTENT         *Extents;
+  UDF_FILE_EXTENT         *Extent;
+  UINTN                   ExtentCount;
+  UINTN                   MaxExtentCount;
+
+  RecordingFlags = GET_FE_RECORDING_FLAGS (File->FileEntry);
+  if (RecordingFlags != LongAdsSequence && RecordingFlags != ShortAdsSequence) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = GetAdsInformation (File->FileEntry, Volume->FileEntrySize, &Data, &Length);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  DoFreeAed      = FALSE;
+  AdOffset       = 0;
+  FileOffset     = 0;
+  Extents        = NULL;
+  ExtentCount    = 0;
+  MaxExtentCount = 0;
+
+  for (;;) {
+    Status = GetAllocationDescriptor (RecordingFlags, Data, &AdOffset, Length, &Ad);
+    if (Status == EFI_DEVICE_ERROR) {
+      Status = EFI_SUCCESS;
+      break;
+    }
+
+    if (GET_EXTENT_FLAGS (RecordingFlags, Ad) == ExtentIsNextExtent) {
+      DataBak = Data;
+      Data    = NULL;
+      Status = GetAedAdsData (
+        BlockIo,
+        DiskIo,
+        Volume,
+        &File->FileIdentifierDesc->Icb,
+        RecordingFlags,
+        Ad,
+        &Data,
+        &Length
+        );
+
+      if (DoFreeAed) {
+        FreePool (DataBak);
+      }
+      DoFreeAed = (BOOLEAN) (Data != NULL);
+
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      AdOffset = 0;
+      continue;
+    }
+
+    ExtentLength = GET_EXTENT_LENGTH (RecordingFlags, Ad);
+
+    Status = GetAllocationDescriptorLsn (
+               RecordingFlags,
+               Volume,
+               &File->FileIdentifierDesc->Icb,
+               Ad,
+               &Lsn
+               );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    DiskOffset = MultU64x32 (Lsn, Volume->LogicalVolDesc.LogicalBlockSize);
+
+    Extent = (ExtentCount > 0) ? &Extents[ExtentCount - 1] : NULL;
+    if (Extent != NULL && Extent->DiskOffset + Extent->Length == DiskOffset) {
+      Extent->Length += ExtentLength;
+    } else if (ExtentLength != 0) {
+      if (ExtentCount == MaxExtentCount) {
+        MaxExtentCount = (MaxExtentCount == 0) ? 16 : MaxExtentCount * 2;
+        Extents = ReallocatePool (
+                    ExtentCount * sizeof (UDF_FILE_EXTENT),
+                    MaxExtentCount * sizeof (UDF_FILE_EXTENT),
+                    Extents
+                    );
+        if (Extents == NULL) {
+          Status = EFI_OUT_OF_RESOURCES;
+          break;
+        }
+      }
+
+      Extents[ExtentCount].FileOffset = FileOffset;
+      Extents[ExtentCount].DiskOffset = DiskOffset;
+      Extents[ExtentCount].Length     = ExtentLength;
+      ExtentCount++;
+    }
+
+    FileOffset += ExtentLength;
+    AdOffset   += AD_LENGTH (RecordingFlags);
+  }
+
+  if (DoFreeAed) {
+    FreePool (Data);
+  }
+
+  if (EFI_ERROR (Status)) {
+    if (Extents != NULL) {
+      FreePool (Extents);
+    }
+    return Status;
+  }
+
+  ReadCache->Extents     = Extents;
+  ReadCache->ExtentCount = ExtentCount;
+  ReadCache->LastExtent  = 0;
+  return EFI_SUCCESS;
+}
+
+/**
+  Find the extent of a file that holds a given file position.
+
+  @param[in, out] ReadCache     Read cache of the open file.
+  @param[in]      Position      File position.
+
+  @return The extent holding Position, or NULL if there is none.
+
+**/
+UDF_FILE_EXTENT *
+FindFileExtent (
+  IN OUT  UDF_FILE_READ_CACHE  *ReadCache,
+  IN      UINT64               Position
+  )
+{
+  UDF_FILE_EXTENT  *Extent;
+  UINTN            Low;
+  UINTN            High;
+  UINTN            Index;
+
+  //
+  // Sequential reads stay within, or move on to the extent next to, the one
+  // used last.
+  //
+  for (Index = ReadCache->LastExtent;
+       Index < ReadCache->ExtentCount && Index <= ReadCache->LastExtent + 1;
+       Index++) {
+    Extent = &ReadCache->Extents[Index];
+    if (Position >= Extent->FileOffset &&
+        Position - Extent->FileOffset < Extent->Length) {
+      ReadCache->LastExtent = Index;
+      return Extent;
+    }
+  }
+
+  Low  = 0;
+  High = ReadCache->ExtentCount;
+  while (Low < High) {
+    Index  = Low + (High - Low) / 2;
+    Extent = &ReadCache->Extents[Index];
+    if (Position < Extent->FileOffset) {
+      High = Index;
+    } else if (Position - Extent->FileOffset >= Extent->Length) {
+      Low = Index + 1;
+    } else {
+      ReadCache->LastExtent = Index;
+      return Extent;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Read file data straight from the extents of a file.
+
+  @param[in]      BlockIo       BlockIo interface.
+  @param[in]      DiskIo        DiskIo interface.
+  @param[in, out] ReadCache     Read cache of the open file.
+  @param[in]      Position      File position to read from.
+  @param[in]      Length        Number of bytes to read.
+  @param[out]     Buffer        File data.
+  @param[out]     ReadLength    Number of bytes read. Less than Length if
+                                the extents end before Position + Length.
+
+  @retval EFI_SUCCESS          The file data was read.
+  @retval other                The file data was not read.
+
+**/
+EFI_STATUS
+ReadFileExtents (
+  IN      EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN      EFI_DISK_IO_PROTOCOL   *DiskIo,
+  IN OUT  UDF_FILE_READ_CACHE    *ReadCache,
+  IN      UINT64                 Position,
+  IN      UINTN                  Length,
+  OUT     UINT8                  *Buffer,
+  OUT     UINTN                  *ReadLength
+  )
+{
+  EFI_STATUS       Status;
+  UDF_FILE_EXTENT  *Extent;
+  UINT64           Offset;
+  UINTN            DataLength;
+
+  *ReadLength = 0;
+  while (*ReadLength < Length) {
+    Extent = FindFileExtent (ReadCache, Position);
+    if (Extent == NULL) {
+      break;
+    }
+
+    Offset     = Position - Extent->FileOffset;
+    DataLength = Length - *ReadLength;
+    if (DataLength > Extent->Length - Offset) {
+      DataLength = (UINTN) (Extent->Length - Offset);
+    }
+
+    Status = DiskIo->ReadDisk (
+      DiskIo,
+      BlockIo->Media->MediaId,
+      Extent->DiskOffset + Offset,
+      DataLength,
+      Buffer + *ReadLength
+      );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Position    += DataLength;
+    *ReadLength += DataLength;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the extents and read-ahead data of an open file.
+
+  @param[in, out] ReadCache     Read cache of the open file.
+
+**/
+VOID
+CleanupFileReadCache (
+  IN OUT UDF_FILE_READ_CACHE  *ReadCache
+  )
+{
+  if (ReadCache->Extents != NULL) {
+    FreePool (ReadCache->Extents);
+  }
+  if (ReadCache->ReadAheadData != NULL) {
+    FreePool (ReadCache->ReadAheadData);
+  }
+
+  ZeroMem ((VOID *)ReadCache, sizeof (UDF_FILE_READ_CACHE));
+}
+
 /**
   Seek a file and read its data into memory on an UDF volume.
 
@@ -2799,6 +3091,9 @@ Out_Free:
   @param[in, out] FilePosition  File position.
   @param[in, out] Buffer        File data.
   @param[in, out] BufferSize    Read size.
+  @param[in, out] ReadCache     Optional read cache of the open file. Its
+                                extents and read-ahead data are used, and
+                                built on the first read.
 
   @retval EFI_SUCCESS          File seeked and read.
   @retval EFI_UNSUPPORTED      Extended Allocation Descriptors not supported.
@@ -2818,32 +3113,131 @@ ReadFileData (
   IN      UINT64                 FileSize,
   IN OUT  UINT64                 *FilePosition,
   IN OUT  VOID                   *Buffer,
-  IN OUT  UINT64                 *BufferSize
+  IN OUT  UINT64                 *BufferSize,
+  IN OUT  UDF_FILE_READ_CACHE    *ReadCache OPTIONAL
   )
 {
   EFI_STATUS          Status;
   UDF_READ_FILE_INFO  ReadFileInfo;
+  UINT64              Position;
+  UINTN               Length;
+  UINTN               DataLength;
+  UINTN               Done;
+
+  if (ReadCache != NULL && ReadCache->Extents == NULL && !ReadCache->NoExtents) {
+    //
+    // Resolve the extents on the first read. Files that can't be described
+    // by extents (e.g. inline data) are read through ReadFile() instead.
+    //
+    Status = GetFileExtents (BlockIo, DiskIo, Volume, File, ReadCache);
+    if (EFI_ERROR (Status) || ReadCache->Extents == NULL) {
+      ReadCache->NoExtents = TRUE;
+    }
+  }
 
-  ReadFileInfo.Flags         = ReadFileSeekAndRead;
-  ReadFileInfo.FilePosition  = *FilePosition;
-  ReadFileInfo.FileData      = Buffer;
-  ReadFileInfo.FileDataSize  = *BufferSize;
-  ReadFileInfo.FileSize      = FileSize;
+  if (ReadCache == NULL || ReadCache->Extents == NULL ||
+      *FilePosition >= FileSize || *BufferSize > MAX_UINTN) {
+    ReadFileInfo.Flags         = ReadFileSeekAndRead;
+    ReadFileInfo.FilePosition  = *FilePosition;
+    ReadFileInfo.FileData      = Buffer;
+    ReadFileInfo.FileDataSize  = *BufferSize;
+    ReadFileInfo.FileSize      = FileSize;
 
-  Status = ReadFile (
-                 BlockIo,
-                 DiskIo,
-                 Volume,
-                 &File->FileIdentifierDesc->Icb,
-                 File->FileEntry,
-                 &ReadFileInfo
-                 );
-  if (EFI_ERROR (Status)) {
-    return Status;
+    Status = ReadFile (
+                   BlockIo,
+                   DiskIo,
+                   Volume,
+                   &File->FileIdentifierDesc->Icb,
+                   File->FileEntry,
+                   &ReadFileInfo
+                   );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    *BufferSize    = ReadFileInfo.FileDataSize;
+    *FilePosition  = ReadFileInfo.FilePosition;
+
+    return EFI_SUCCESS;
   }
 
-  *BufferSize    = ReadFileInfo.FileDataSize;
-  *FilePosition  = ReadFileInfo.FilePosition;
+  Position = *FilePosition;
+  Length   = (UINTN) MIN (*BufferSize, FileSize - Position);
+  Done     = 0;
+
+  while (Done < Length) {
+    //
+    // Serve what the read-ahead buffer holds.
+    //
+    if (ReadCache->ReadAheadLength != 0 &&
+        Position >= ReadCache->ReadAheadPosition &&
+        Position - ReadCache->ReadAheadPosition < ReadCache->ReadAheadLength) {
+      DataLength = (UINTN) (ReadCache->ReadAheadPosition +
+                            ReadCache->ReadAheadLength - Position);
+      DataLength = MIN (DataLength, Length - Done);
+      CopyMem (
+        (UINT8 *)Buffer + Done,
+        ReadCache->ReadAheadData + (UINTN) (Position - ReadCache->ReadAheadPosition),
+        DataLength
+        );
+      Done     += DataLength;
+      Position += DataLength;
+      continue;
+    }
+
+    //
+    // Small sequential reads are grouped into UDF_READ_AHEAD_SIZE disk
+    // reads. Everything else is read into the caller's buffer directly.
+    //
+    if (Length - Done < UDF_READ_AHEAD_SIZE && Position == ReadCache->NextPosition) {
+      if (ReadCache->ReadAheadData == NULL) {
+        ReadCache->ReadAheadData = AllocatePool (UDF_READ_AHEAD_SIZE);
+      }
+      if (ReadCache->ReadAheadData != NULL) {
+        ReadCache->ReadAheadLength = 0;
+        Status = ReadFileExtents (
+                   BlockIo,
+                   DiskIo,
+                   ReadCache,
+                   Position,
+                   (UINTN) MIN (UDF_READ_AHEAD_SIZE, FileSize - Position),
+                   ReadCache->ReadAheadData,
+                   &DataLength
+                   );
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+        if (DataLength == 0) {
+          break;
+        }
+        ReadCache->ReadAheadPosition = Position;
+        ReadCache->ReadAheadLength   = DataLength;
+        continue;
+      }
+    }
+
+    Status = ReadFileExtents (
+               BlockIo,
+               DiskIo,
+               ReadCache,
+               Position,
+               Length - Done,
+               (UINT8 *)Buffer + Done,
+               &DataLength
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Done     += DataLength;
+    Position += DataLength;
+    break;
+  }
+
+  ReadCache->NextPosition = Position;
+
+  *BufferSize    = Done;
+  *FilePosition  = Position;
 
   return EFI_SUCCESS;
 }
@@ -114,6 +114,11 @@ typedef enum {
 #define UDF_FILENAME_LENGTH  128
 #define UDF_PATH_LENGTH      512
 
+//
+// Size of the per-file buffer used to read ahead on sequential reads.
+//
+#define UDF_READ_AHEAD_SIZE  SIZE_256KB
+
 #define GET_FID_FROM_ADS(_Data, _Offs) \
   ((UDF_FILE_IDENTIFIER_DESCRIPTOR *)((UINT8 *)(_Data) + (_Offs)))
 
@@ -331,6 +336,30 @@ typedef struct {
   UINT64                    FidOffset;
 } UDF_READ_DIRECTORY_INFO;
 
+//
+// Recorded extent of a file, resolved from its Allocation Descriptors.
+//
+typedef struct {
+  UINT64                    FileOffset;
+  UINT64                    DiskOffset;
+  UINT64                    Length;
+} UDF_FILE_EXTENT;
+
+//
+// Per open file state that speeds up reading a file's data: its extents,
+// resolved once, and a read-ahead buffer for sequential reads.
+//
+typedef struct {
+  UDF_FILE_EXTENT           *Extents;
+  UINTN                     ExtentCount;
+  UINTN                     LastExtent;
+  BOOLEAN                   NoExtents;
+  UINT8                     *ReadAheadData;
+  UINT64                    ReadAheadPosition;
+  UINTN                     ReadAheadLength;
+  UINT64                    NextPosition;
+} UDF_FILE_READ_CACHE;
+
 #define PRIVATE_UDF_FILE_DATA_SIGNATURE SIGNATURE_32 ('U', 'd', 'f', 'f')
 
 #define PRIVATE_UDF_FILE_DATA_FROM_THIS(a) \
@@ -353,6 +382,7 @@ typedef struct {
   CHAR16                           FileName[UDF_FILENAME_LENGTH];
   UINT64                           FileSize;
   UINT64                           FilePosition;
+  UDF_FILE_READ_CACHE              ReadCache;
 } PRIVATE_UDF_FILE_DATA;
 
 #define PRIVATE_UDF_SIMPLE_FS_DATA_SIGNATURE SIGNATURE_32 ('U', 'd', 'f', 's')
@@ -965,6 +995,7 @@ GetVolumeSize (
   @param[in, out] FilePosition  File position.
   @param[in, out] Buffer        File data.
   @param[in, out] BufferSize    Read size.
+  @param[in, out] ReadCache     Optional read cache of the open file.
 
   @retval EFI_SUCCESS          File seeked and read.
   @retval EFI_UNSUPPORTED      Extended Allocation Descriptors not supported.
@@ -984,7 +1015,19 @@ ReadFileData (
   IN      UINT64                 FileSize,
   IN OUT  UINT64                 *FilePosition,
   IN OUT  VOID                   *Buffer,
-  IN OUT  UINT64                 *BufferSize
+  IN OUT  UINT64                 *BufferSize,
+  IN OUT  UDF_FILE_READ_CACHE    *ReadCache OPTIONAL
+  );
+
+/**
+  Free the extents and read-ahead data of an open file.
+
+  @param[in, out] ReadCache     Read cache of the open file.
+
+**/
+VOID
+CleanupFileReadCache (
+  IN OUT UDF_FILE_READ_CACHE  *ReadCache
   );
 
 /**
@@ -81,6 +81,11 @@ FtwAllocate (
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
 
+  Status    = FtwFlushPendingWrites (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
   Status    = WorkSpaceRefresh (FtwDevice);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
@@ -277,12 +282,386 @@ FtwWriteRecord (
   return EFI_SUCCESS;
 }
 
+/**
+  Commit the new content of the target blocks through the spare block.
+
+  The original spare block content is saved, the new content is programmed to
+  the spare block and the last write record is marked as SpareComplete. Then
+  the spare block is flushed to the target blocks and the saved spare block
+  content is restored.
+
+  @param FtwDevice       The private data of FTW driver.
+  @param Fvb             The FVB protocol that provides services for
+                         reading, writing, and erasing the target block.
+  @param BlockSize       The size of the target block.
+  @param Buffer          The new content of the target blocks.
+  @param BufferSize      The size of Buffer in bytes.
+
+  @retval EFI_SUCCESS          The function completed successfully
+  @retval EFI_ABORTED          The function could not complete successfully.
+  @retval EFI_OUT_OF_RESOURCES Cannot allocate enough memory resource.
+
+**/
+EFI_STATUS
+FtwCommitThroughSpare (
+  IN EFI_FTW_DEVICE                        *FtwDevice,
+  IN EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL    *Fvb,
+  IN UINTN                                 BlockSize,
+  IN UINT8                                 *Buffer,
+  IN UINTN                                 BufferSize
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FAULT_TOLERANT_WRITE_RECORD     *Record;
+  UINTN                               MyLength;
+  UINTN                               MyOffset;
+  UINTN                               SpareBufferSize;
+  UINT8                               *SpareBuffer;
+  UINTN                               Index;
+  UINT8                               *Ptr;
+
+  //
+  // Try to keep the content of spare block
+  // Save spare block into a spare backup memory buffer (Sparebuffer)
+  //
+  SpareBufferSize = FtwDevice->SpareAreaLength;
+  SpareBuffer     = AllocatePool (SpareBufferSize);
+  if (SpareBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Ptr = SpareBuffer;
+  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
+    MyLength = FtwDevice->SpareBlockSize;
+    Status = FtwDevice->FtwBackupFvb->Read (
+                                        FtwDevice->FtwBackupFvb,
+                                        FtwDevice->FtwSpareLba + Index,
+                                        0,
+                                        &MyLength,
+                                        Ptr
+                                        );
+    if (EFI_ERROR (Status)) {
+      FreePool (SpareBuffer);
+      return EFI_ABORTED;
+    }
+
+    Ptr += MyLength;
+  }
+  //
+  // Write the memory buffer to spare block
+  // Do not assume Spare Block and Target Block have same block size
+  //
+  Status  = FtwEraseSpareBlock (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+  Ptr     = Buffer;
+  for (Index = 0; BufferSize > 0; Index += 1) {
+    if (BufferSize > FtwDevice->SpareBlockSize) {
+      MyLength = FtwDevice->SpareBlockSize;
+    } else {
+      MyLength = BufferSize;
+    }
+    Status = FtwDevice->FtwBackupFvb->Write (
+                                        FtwDevice->FtwBackupFvb,
+                                        FtwDevice->FtwSpareLba + Index,
+                                        0,
+                                        &MyLength,
+                                        Ptr
+                                        );
+    if (EFI_ERROR (Status)) {
+      FreePool (SpareBuffer);
+      return EFI_ABORTED;
+    }
+
+    Ptr += MyLength;
+    BufferSize -= MyLength;
+  }
+
+  //
+  // Set the SpareComplete in the FTW record,
+  //
+  Record   = FtwDevice->FtwLastWriteRecord;
+  MyOffset = (UINT8 *) Record - FtwDevice->FtwWorkSpace;
+  Status = FtwUpdateFvState (
+            FtwDevice->FtwFvBlock,
+            FtwDevice->WorkBlockSize,
+            FtwDevice->FtwWorkSpaceLba,
+            FtwDevice->FtwWorkSpaceBase + MyOffset,
+            SPARE_COMPLETED
+            );
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+
+  Record->SpareComplete = FTW_VALID_STATE;
+
+  //
+  //  Since the content has already backuped in spare block, the write is
+  //  guaranteed to be completed with fault tolerant manner.
+  //
+  Status = FtwWriteRecord (&FtwDevice->FtwInstance, Fvb, BlockSize);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+  //
+  // Restore spare backup buffer into spare block , if no failure happened during FtwWrite.
+  // Blocks that were erased do not need to be programmed again.
+  //
+  Status  = FtwEraseSpareBlock (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+  Ptr     = SpareBuffer;
+  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
+    MyLength = FtwDevice->SpareBlockSize;
+    if (!IsErasedFlashBuffer (Ptr, MyLength)) {
+      Status = FtwDevice->FtwBackupFvb->Write (
+                                          FtwDevice->FtwBackupFvb,
+                                          FtwDevice->FtwSpareLba + Index,
+                                          0,
+                                          &MyLength,
+                                          Ptr
+                                          );
+      if (EFI_ERROR (Status)) {
+        FreePool (SpareBuffer);
+        return EFI_ABORTED;
+      }
+    }
+
+    Ptr += MyLength;
+  }
+  //
+  // All success.
+  //
+  FreePool (SpareBuffer);
+
+  FtwDevice->Statistics.SpareUpdates++;
+  DEBUG ((
+    EFI_D_VERBOSE,
+    "Ftw: Writes:%ld Coalesced:%ld SpareUpdates:%ld SpareErases:%ld BlockErases:%ld RecordWrites:%ld\n",
+    FtwDevice->Statistics.WriteRequests,
+    FtwDevice->Statistics.CoalescedWrites,
+    FtwDevice->Statistics.SpareUpdates,
+    FtwDevice->Statistics.SpareErases,
+    FtwDevice->Statistics.BlockErases,
+    FtwDevice->Statistics.RecordWrites
+    ));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Commit the writes that have been coalesced into the pending buffer.
+
+  The merged writes are described by the record of the last one, which covers
+  the whole range they updated. The records before it are completed as empty
+  writes, so the work space keeps one record per Write() call in the standard
+  format and only the last record is ever restarted. All the pending records
+  are programmed to the working block in one update, then the merged target
+  block content goes through one spare block cycle.
+
+  @param FtwDevice       The private data of FTW driver
+
+  @retval EFI_SUCCESS           The pending writes were committed, or there was none.
+  @retval EFI_OUT_OF_RESOURCES  Allocate memory error
+  @retval EFI_ABORTED           The function could not complete successfully
+
+**/
+EFI_STATUS
+FtwFlushPendingWrites (
+  IN EFI_FTW_DEVICE   *FtwDevice
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_FAULT_TOLERANT_WRITE_HEADER *Header;
+  EFI_FAULT_TOLERANT_WRITE_RECORD *Record;
+  EFI_FAULT_TOLERANT_WRITE_RECORD *LastRecord;
+  UINTN                           RecordCount;
+  UINTN                           RecordSize;
+  UINTN                           Index;
+  UINTN                           Offset;
+
+  if (FtwDevice->PendingCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Header      = FtwDevice->FtwLastWriteHeader;
+  Record      = FtwDevice->FtwLastWriteRecord;
+  RecordCount = FtwDevice->PendingCount;
+  RecordSize  = FTW_RECORD_SIZE (Header->PrivateDataSize);
+
+  //
+  // Whatever the result is, the work space is refreshed from the working block
+  // by the next call, so the pending writes are gone after this point.
+  //
+  FtwDevice->PendingCount = 0;
+
+  LastRecord = Record;
+  for (Index = 1; Index < RecordCount; Index++) {
+    LastRecord->Offset              = FtwDevice->PendingOffset;
+    LastRecord->Length              = 0;
+    LastRecord->SpareComplete       = FTW_VALID_STATE;
+    LastRecord->DestinationComplete = FTW_VALID_STATE;
+    LastRecord = (EFI_FAULT_TOLERANT_WRITE_RECORD *) ((UINT8 *) LastRecord + RecordSize);
+  }
+
+  LastRecord->Offset = FtwDevice->PendingOffset;
+  LastRecord->Length = FtwDevice->PendingEnd - FtwDevice->PendingOffset;
+
+  //
+  // Program all the pending write records in one working block update.
+  //
+  Offset = (UINT8 *) Record - FtwDevice->FtwWorkSpace;
+  Status = WriteWorkSpaceData (
+             FtwDevice->FtwFvBlock,
+             FtwDevice->WorkBlockSize,
+             FtwDevice->FtwWorkSpaceLba,
+             FtwDevice->FtwWorkSpaceBase + Offset,
+             RecordCount * RecordSize,
+             (UINT8 *) Record
+             );
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+  FtwDevice->Statistics.RecordWrites++;
+
+  FtwDevice->FtwLastWriteRecord = LastRecord;
+  Status = FtwCommitThroughSpare (
+             FtwDevice,
+             FtwDevice->PendingFvb,
+             FtwDevice->PendingBlockSize,
+             FtwDevice->PendingBuffer,
+             FtwDevice->PendingBlocks * FtwDevice->PendingBlockSize
+             );
+
+  DEBUG ((
+    EFI_D_INFO,
+    "Ftw: Flush %d coalesced writes to Lba:%lx - %r\n",
+    RecordCount,
+    FtwDevice->PendingLba,
+    Status
+    ));
+
+  return Status;
+}
+
+/**
+  Drop the writes that have been coalesced but not committed yet.
+
+  @param FtwDevice       The private data of FTW driver
+
+**/
+VOID
+FtwDiscardPendingWrites (
+  IN EFI_FTW_DEVICE   *FtwDevice
+  )
+{
+  //
+  // The pending records only live in the memory work space,
+  // the next work space refresh drops them.
+  //
+  FtwDevice->PendingCount = 0;
+}
+
+/**
+  Merge a write into the pending content of the target block.
+
+  @param FtwDevice            The private data of FTW driver.
+  @param Fvb                  The FVB protocol of the target block.
+  @param FvBlockHandle        The handle of the FVB protocol.
+  @param Lba                  The logical block address of the target block.
+  @param BlockSize            The size of the target block.
+  @param NumberOfWriteBlocks  The number of blocks touched by this write.
+  @param Offset               The offset within the target block to place the data.
+  @param Length               The number of bytes to write to the target block.
+  @param Buffer               The data to write.
+
+  @retval EFI_SUCCESS          The write was merged.
+  @retval EFI_ABORTED          The original target block content could not be read.
+  @retval EFI_OUT_OF_RESOURCES Cannot allocate enough memory resource.
+
+**/
+EFI_STATUS
+FtwCoalesceWrite (
+  IN EFI_FTW_DEVICE                        *FtwDevice,
+  IN EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL    *Fvb,
+  IN EFI_HANDLE                            FvBlockHandle,
+  IN EFI_LBA                               Lba,
+  IN UINTN                                 BlockSize,
+  IN UINTN                                 NumberOfWriteBlocks,
+  IN UINTN                                 Offset,
+  IN UINTN                                 Length,
+  IN VOID                                  *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       ReadLength;
+
+  if (FtwDevice->PendingCount == 0) {
+    if (FtwDevice->PendingBuffer == NULL) {
+      FtwDevice->PendingBuffer = AllocatePool (FtwDevice->SpareAreaLength);
+      if (FtwDevice->PendingBuffer == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+
+    FtwDevice->PendingFvbHandle = FvBlockHandle;
+    FtwDevice->PendingFvb       = Fvb;
+    FtwDevice->PendingLba       = Lba;
+    FtwDevice->PendingBlockSize = BlockSize;
+    FtwDevice->PendingBlocks    = 0;
+    FtwDevice->PendingOffset    = Offset;
+    FtwDevice->PendingEnd       = Offset + Length;
+  }
+
+  //
+  // Read the original content of the target blocks not held yet.
+  //
+  while (FtwDevice->PendingBlocks < NumberOfWriteBlocks) {
+    ReadLength = BlockSize;
+    Status     = Fvb->Read (
+                        Fvb,
+                        Lba + FtwDevice->PendingBlocks,
+                        0,
+                        &ReadLength,
+                        FtwDevice->PendingBuffer + FtwDevice->PendingBlocks * BlockSize
+                        );
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
+
+    FtwDevice->PendingBlocks++;
+  }
+
+  CopyMem (FtwDevice->PendingBuffer + Offset, Buffer, Length);
+  FtwDevice->PendingOffset = MIN (FtwDevice->PendingOffset, Offset);
+  FtwDevice->PendingEnd    = MAX (FtwDevice->PendingEnd, Offset + Length);
+
+  if (FtwDevice->PendingCount != 0) {
+    FtwDevice->Statistics.CoalescedWrites++;
+  }
+  FtwDevice->PendingCount++;
+
+  return EFI_SUCCESS;
+}
+
 /**
   Starts a target block update. This function will record data about write
   in fault tolerant storage and will complete the write in a recoverable
   manner, ensuring at all times that either the original contents or
   the modified contents are available.
 
+  Inside a batch started by EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL, the
+  consecutive writes to the same target block are merged and only committed by
+  one spare block update when the last allocated write is received, when a
+  write to another block is received, when the batch is committed or when any
+  other FTW service is called. Until then, a merged write is not fault tolerant.
+
   @param This            The pointer to this protocol instance.
   @param Lba             The logical block address of the target block.
   @param Offset          The offset within the target block to place the data.
@@ -323,8 +702,6 @@ FtwWrite (
   UINTN                               MyOffset;
   UINTN                               MyBufferSize;
   UINT8                               *MyBuffer;
-  UINTN                               SpareBufferSize;
-  UINT8                               *SpareBuffer;
   UINTN                               Index;
   UINT8                               *Ptr;
   EFI_PHYSICAL_ADDRESS                FvbPhysicalAddress;
@@ -332,16 +709,38 @@ FtwWrite (
   UINTN                               NumberOfBlocks;
   UINTN                               NumberOfWriteBlocks;
   UINTN                               WriteLength;
+  BOOLEAN                             BootBlockUpdate;
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
 
-  Status    = WorkSpaceRefresh (FtwDevice);
-  if (EFI_ERROR (Status)) {
-    return EFI_ABORTED;
+  //
+  // A write to another target block ends the current coalesced writes.
+  //
+  if ((FtwDevice->PendingCount != 0) &&
+      ((FvBlockHandle != FtwDevice->PendingFvbHandle) || (Lba != FtwDevice->PendingLba))) {
+    Status = FtwFlushPendingWrites (FtwDevice);
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
+  }
+
+  //
+  // The records of the coalesced writes only live in the memory work space,
+  // so it is refreshed from the working block only when nothing is pending.
+  //
+  if (FtwDevice->PendingCount == 0) {
+    Status    = WorkSpaceRefresh (FtwDevice);
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
   }
 
   Header  = FtwDevice->FtwLastWriteHeader;
   Record  = FtwDevice->FtwLastWriteRecord;
+  if (FtwDevice->PendingCount != 0) {
+    Record = (EFI_FAULT_TOLERANT_WRITE_RECORD *) ((UINT8 *) Record +
+               FtwDevice->PendingCount * FTW_RECORD_SIZE (Header->PrivateDataSize));
+  }
 
   if (IsErasedFlashBuffer ((UINT8 *) Header, sizeof (EFI_FAULT_TOLERANT_WRITE_HEADER))) {
     if (PrivateData == NULL) {
@@ -423,7 +822,8 @@ FtwWrite (
   //
   // Set BootBlockUpdate FLAG if it's updating boot block.
   //
-  if (IsBootBlock (FtwDevice, Fvb)) {
+  BootBlockUpdate = IsBootBlock (FtwDevice, Fvb);
+  if (BootBlockUpdate) {
     Record->BootBlockUpdate = FTW_VALID_STATE;
     //
     // Boot Block and Spare Block should have same block size and block numbers.
@@ -441,6 +841,49 @@ FtwWrite (
     CopyMem ((Record + 1), PrivateData, (UINTN) Header->PrivateDataSize);
   }
 
+  FtwDevice->Statistics.WriteRequests++;
+
+  //
+  // Inside a batch, writes to regular target blocks may be merged, the record
+  // is only kept in the memory work space until the merged writes are committed.
+  //
+  if (FtwDevice->BatchActive &&
+      !BootBlockUpdate &&
+      !IsWorkingBlock (FtwDevice, Fvb, Lba)) {
+    Status = FtwCoalesceWrite (
+               FtwDevice,
+               Fvb,
+               FvBlockHandle,
+               Lba,
+               BlockSize,
+               NumberOfWriteBlocks,
+               Offset,
+               Length,
+               Buffer
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (IsLastRecordOfWrites (Header, Record) ||
+        (FtwDevice->PendingCount == FTW_MAX_COALESCED_WRITES)) {
+      Status = FtwFlushPendingWrites (FtwDevice);
+      if (EFI_ERROR (Status)) {
+        return EFI_ABORTED;
+      }
+    }
+
+    DEBUG (
+      (EFI_D_INFO,
+      "Ftw: Write() coalesced, (Lba:Offset)=(%lx:0x%x), Length: 0x%x\n",
+      Lba,
+      Offset,
+      Length)
+      );
+
+    return EFI_SUCCESS;
+  }
+
   MyOffset  = (UINT8 *) Record - FtwDevice->FtwWorkSpace;
   MyLength  = FTW_RECORD_SIZE (Header->PrivateDataSize);
 
@@ -455,6 +898,7 @@ FtwWrite (
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
+  FtwDevice->Statistics.RecordWrites++;
   //
   // Record has written to working block, then do the data.
   //
@@ -486,129 +930,11 @@ FtwWrite (
   //
   CopyMem (MyBuffer + Offset, Buffer, Length);
 
-  //
-  // Try to keep the content of spare block
-  // Save spare block into a spare backup memory buffer (Sparebuffer)
-  //
-  SpareBufferSize = FtwDevice->SpareAreaLength;
-  SpareBuffer     = AllocatePool (SpareBufferSize);
-  if (SpareBuffer == NULL) {
-    FreePool (MyBuffer);
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  Ptr = SpareBuffer;
-  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
-    MyLength = FtwDevice->SpareBlockSize;
-    Status = FtwDevice->FtwBackupFvb->Read (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (MyBuffer);
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
-
-    Ptr += MyLength;
-  }
-  //
-  // Write the memory buffer to spare block
-  // Do not assume Spare Block and Target Block have same block size
-  //
-  Status  = FtwEraseSpareBlock (FtwDevice);
-  if (EFI_ERROR (Status)) {
-    FreePool (MyBuffer);
-    FreePool (SpareBuffer);
-    return EFI_ABORTED;
-  }
-  Ptr     = MyBuffer;
-  for (Index = 0; MyBufferSize > 0; Index += 1) {
-    if (MyBufferSize > FtwDevice->SpareBlockSize) {
-      MyLength = FtwDevice->SpareBlockSize;
-    } else {
-      MyLength = MyBufferSize;
-    }
-    Status = FtwDevice->FtwBackupFvb->Write (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (MyBuffer);
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
-
-    Ptr += MyLength;
-    MyBufferSize -= MyLength;
-  }
-  //
-  // Free MyBuffer
-  //
+  Status = FtwCommitThroughSpare (FtwDevice, Fvb, BlockSize, MyBuffer, MyBufferSize);
   FreePool (MyBuffer);
-
-  //
-  // Set the SpareComplete in the FTW record,
-  //
-  MyOffset = (UINT8 *) Record - FtwDevice->FtwWorkSpace;
-  Status = FtwUpdateFvState (
-            FtwDevice->FtwFvBlock,
-            FtwDevice->WorkBlockSize,
-            FtwDevice->FtwWorkSpaceLba,
-            FtwDevice->FtwWorkSpaceBase + MyOffset,
-            SPARE_COMPLETED
-            );
-  if (EFI_ERROR (Status)) {
-    FreePool (SpareBuffer);
-    return EFI_ABORTED;
-  }
-
-  Record->SpareComplete = FTW_VALID_STATE;
-
-  //
-  //  Since the content has already backuped in spare block, the write is
-  //  guaranteed to be completed with fault tolerant manner.
-  //
-  Status = FtwWriteRecord (This, Fvb, BlockSize);
-  if (EFI_ERROR (Status)) {
-    FreePool (SpareBuffer);
-    return EFI_ABORTED;
-  }
-  //
-  // Restore spare backup buffer into spare block , if no failure happened during FtwWrite.
-  //
-  Status  = FtwEraseSpareBlock (FtwDevice);
   if (EFI_ERROR (Status)) {
-    FreePool (SpareBuffer);
-    return EFI_ABORTED;
-  }
-  Ptr     = SpareBuffer;
-  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
-    MyLength = FtwDevice->SpareBlockSize;
-    Status = FtwDevice->FtwBackupFvb->Write (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
-
-    Ptr += MyLength;
+    return Status;
   }
-  //
-  // All success.
-  //
-  FreePool (SpareBuffer);
 
   DEBUG (
     (EFI_D_INFO,
@@ -652,6 +978,11 @@ FtwRestart (
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
 
+  Status    = FtwFlushPendingWrites (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
   Status    = WorkSpaceRefresh (FtwDevice);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
@@ -740,6 +1071,11 @@ FtwAbort (
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
 
+  //
+  // The coalesced writes have not reached the flash yet, simply drop them.
+  //
+  FtwDiscardPendingWrites (FtwDevice);
+
   Status    = WorkSpaceRefresh (FtwDevice);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
@@ -820,6 +1156,11 @@ FtwGetLastWrite (
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
 
+  Status    = FtwFlushPendingWrites (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
   Status    = WorkSpaceRefresh (FtwDevice);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
@@ -885,3 +1226,66 @@ FtwGetLastWrite (
   return Status;
 }
 
+
+/**
+  Start a batch of fault tolerant writes.
+
+  @param This            The pointer to the batch protocol instance.
+
+  @retval EFI_SUCCESS          The batch was started.
+  @retval EFI_ALREADY_STARTED  A batch is already in progress.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwBeginBatch (
+  IN EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This
+  )
+{
+  EFI_FTW_DEVICE  *FtwDevice;
+
+  FtwDevice = FTW_BATCH_CONTEXT_FROM_THIS (This);
+
+  if (FtwDevice->BatchActive) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  FtwDevice->BatchActive = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Commit the writes merged in the current batch and end the batch.
+
+  @param This            The pointer to the batch protocol instance.
+
+  @retval EFI_SUCCESS          All the writes of the batch are fault tolerant.
+  @retval EFI_NOT_STARTED      There is no batch in progress.
+  @retval EFI_ABORTED          The merged writes could not be committed.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwCommitBatch (
+  IN EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This
+  )
+{
+  EFI_STATUS      Status;
+  EFI_FTW_DEVICE  *FtwDevice;
+
+  FtwDevice = FTW_BATCH_CONTEXT_FROM_THIS (This);
+
+  if (!FtwDevice->BatchActive) {
+    return EFI_NOT_STARTED;
+  }
+
+  FtwDevice->BatchActive = FALSE;
+
+  Status = FtwFlushPendingWrites (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -16,6 +16,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/ZeroGuid.h>
 #include <Protocol/FaultTolerantWrite.h>
+#include <Protocol/FaultTolerantWriteBatch.h>
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/SwapAddressRange.h>
 
@@ -47,6 +48,24 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define FTW_DEVICE_SIGNATURE  SIGNATURE_32 ('F', 'T', 'W', 'D')
 
+//
+// Maximum number of writes to one target block that are merged into a single
+// spare block update inside a batch.
+//
+#define FTW_MAX_COALESCED_WRITES  16
+
+//
+// Flash access statistics of the FTW driver, used to quantify flash wear.
+//
+typedef struct {
+  UINT64                                  WriteRequests;      // Number of Write() calls accepted.
+  UINT64                                  CoalescedWrites;    // Number of Write() calls merged into a previous spare block update.
+  UINT64                                  SpareUpdates;       // Number of backup/write/restore cycles of the spare block.
+  UINT64                                  SpareErases;        // Number of spare blocks erased.
+  UINT64                                  BlockErases;        // Number of target or working blocks erased.
+  UINT64                                  RecordWrites;       // Number of write record updates to the working block.
+} FTW_STATISTICS;
+
 //
 // EFI Fault tolerant protocol private data structure
 //
@@ -76,6 +95,18 @@ typedef struct {
   EFI_LBA                                 FtwWorkSpaceLbaInSpare; // Start LBA of working space in spare block.
   UINTN                                   FtwWorkSpaceBaseInSpare;// Offset into the FtwWorkSpaceLbaInSpare block.
   UINT8                                   *FtwWorkSpace;      // Point to Work Space in memory buffer
+  UINTN                                   PendingCount;       // Number of coalesced writes not yet committed.
+  EFI_HANDLE                              PendingFvbHandle;   // FVB handle of the coalesced target block.
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL      *PendingFvb;        // FVB of the coalesced target block.
+  EFI_LBA                                 PendingLba;         // Start LBA of the coalesced target block.
+  UINTN                                   PendingBlockSize;   // Block size of the coalesced target block.
+  UINTN                                   PendingBlocks;      // Number of blocks held in PendingBuffer.
+  UINTN                                   PendingOffset;      // Lowest offset updated by the coalesced writes.
+  UINTN                                   PendingEnd;         // End of the highest range updated by the coalesced writes.
+  UINT8                                   *PendingBuffer;     // Merged content of the coalesced target block.
+  FTW_STATISTICS                          Statistics;
+  BOOLEAN                                 BatchActive;        // Writes are merged until the batch is committed.
+  EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL BatchInstance;
   //
   // Following a buffer of FtwWorkSpace[FTW_WORK_SPACE_SIZE],
   // Allocated with EFI_FTW_DEVICE.
@@ -83,6 +114,7 @@ typedef struct {
 } EFI_FTW_DEVICE;
 
 #define FTW_CONTEXT_FROM_THIS(a)  CR (a, EFI_FTW_DEVICE, FtwInstance, FTW_DEVICE_SIGNATURE)
+#define FTW_BATCH_CONTEXT_FROM_THIS(a)  CR (a, EFI_FTW_DEVICE, BatchInstance, FTW_DEVICE_SIGNATURE)
 
 //
 // Driver entry point
@@ -270,6 +302,68 @@ FtwGetLastWrite (
   OUT BOOLEAN                              *Complete
   );
 
+/**
+  Commit the writes that have been coalesced into the pending buffer.
+
+  The last pending record describes the whole merged range, the records before
+  it are completed as empty writes. All of them are programmed to the working
+  block in one update, then the merged target block content goes through one
+  spare block cycle.
+
+  @param FtwDevice       The private data of FTW driver
+
+  @retval EFI_SUCCESS           The pending writes were committed, or there was none.
+  @retval EFI_OUT_OF_RESOURCES  Allocate memory error
+  @retval EFI_ABORTED           The function could not complete successfully
+
+**/
+EFI_STATUS
+FtwFlushPendingWrites (
+  IN EFI_FTW_DEVICE   *FtwDevice
+  );
+
+/**
+  Drop the writes that have been coalesced but not committed yet.
+
+  @param FtwDevice       The private data of FTW driver
+
+**/
+VOID
+FtwDiscardPendingWrites (
+  IN EFI_FTW_DEVICE   *FtwDevice
+  );
+
+/**
+  Start a batch of fault tolerant writes.
+
+  @param This            The pointer to the batch protocol instance.
+
+  @retval EFI_SUCCESS          The batch was started.
+  @retval EFI_ALREADY_STARTED  A batch is already in progress.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwBeginBatch (
+  IN EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This
+  );
+
+/**
+  Commit the writes merged in the current batch and end the batch.
+
+  @param This            The pointer to the batch protocol instance.
+
+  @retval EFI_SUCCESS          All the writes of the batch are fault tolerant.
+  @retval EFI_NOT_STARTED      There is no batch in progress.
+  @retval EFI_ABORTED          The merged writes could not be committed.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwCommitBatch (
+  IN EDKII_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This
+  );
+
 /**
   Erase spare block.
 
@@ -194,6 +194,16 @@ FvbNotificationEvent (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  if (FeaturePcdGet (PcdFtwCoalesceWrites)) {
+    Status = gBS->InstallProtocolInterface (
+                    &FtwDevice->Handle,
+                    &gEdkiiFaultTolerantWriteBatchProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &FtwDevice->BatchInstance
+                    );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   Status = gBS->CloseEvent (Event);
   ASSERT_EFI_ERROR (Status);
 
@@ -551,6 +551,16 @@ FvbNotificationEvent (
                     );
   ASSERT_EFI_ERROR (Status);
 
+  if (FeaturePcdGet (PcdFtwCoalesceWrites)) {
+    Status = gMmst->MmInstallProtocolInterface (
+                      &mFtwDevice->Handle,
+                      &gEdkiiFaultTolerantWriteBatchProtocolGuid,
+                      EFI_NATIVE_INTERFACE,
+                      &mFtwDevice->BatchInstance
+                      );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   ///
   /// Register SMM FTW SMI handler
   ///
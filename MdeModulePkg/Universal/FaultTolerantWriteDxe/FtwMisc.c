@@ -62,6 +62,7 @@ FtwEraseBlock (
   UINTN                               NumberOfBlocks
   )
 {
+  FtwDevice->Statistics.BlockErases += NumberOfBlocks;
   return FvBlock->EraseBlocks (
                     FvBlock,
                     Lba,
@@ -92,6 +93,7 @@ FtwEraseSpareBlock (
   IN EFI_FTW_DEVICE   *FtwDevice
   )
 {
+  FtwDevice->Statistics.SpareErases += FtwDevice->NumberOfSpareBlock;
   return FtwDevice->FtwBackupFvb->EraseBlocks (
                                     FtwDevice->FtwBackupFvb,
                                     FtwDevice->FtwSpareLba,
@@ -1373,6 +1375,9 @@ InitFtwProtocol (
   FtwDevice->FtwInstance.Abort           = FtwAbort;
   FtwDevice->FtwInstance.GetLastWrite    = FtwGetLastWrite;
 
+  FtwDevice->BatchInstance.BeginBatch    = FtwBeginBatch;
+  FtwDevice->BatchInstance.CommitBatch   = FtwCommitBatch;
+
   return EFI_SUCCESS;
 }
 
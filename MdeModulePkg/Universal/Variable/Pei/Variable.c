@@ -493,6 +493,42 @@ CompareWithValidVariable (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Compute the hash of a variable name and vendor GUID that is recorded in the
+  variable index table.
+
+  @param  VariableName  Pointer to the variable name.
+  @param  NameSize      Variable name size in bytes, including the null terminator.
+  @param  VendorGuid    Pointer to the vendor GUID.
+
+  @return The 16-bit hash of the variable name and vendor GUID.
+
+**/
+UINT16
+GetVariableHash (
+  IN CONST CHAR16           *VariableName,
+  IN UINTN                  NameSize,
+  IN CONST EFI_GUID         *VendorGuid
+  )
+{
+  CONST UINT8  *Buffer;
+  UINT32       Hash;
+  UINTN        Index;
+
+  Hash   = 0;
+  Buffer = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = Hash * 31 + Buffer[Index];
+  }
+
+  Buffer = (CONST UINT8 *) VariableName;
+  for (Index = 0; Index < NameSize; Index++) {
+    Hash = Hash * 31 + Buffer[Index];
+  }
+
+  return (UINT16) (Hash ^ (Hash >> 16));
+}
+
 /**
   Get HOB variable store.
 
@@ -568,6 +604,7 @@ GetVariableStore (
   UINT32                                BackUpOffset;
 
   StoreInfo->IndexTable = NULL;
+  StoreInfo->IndexHash  = NULL;
   StoreInfo->FtwLastWriteData = NULL;
   StoreInfo->AuthFlag = FALSE;
   VariableStoreHeader = NULL;
@@ -636,6 +673,10 @@ GetVariableStore (
         GuidHob = GetFirstGuidHob (&gEfiVariableIndexTableGuid);
         if (GuidHob != NULL) {
           StoreInfo->IndexTable = GET_GUID_HOB_DATA (GuidHob);
+          GuidHob = GetFirstGuidHob (&gEfiCallerIdGuid);
+          if (GuidHob != NULL) {
+            StoreInfo->IndexHash = GET_GUID_HOB_DATA (GuidHob);
+          }
         } else {
           //
           // If it's the first time to access variable region in flash, create a guid hob to record
@@ -648,6 +689,14 @@ GetVariableStore (
           StoreInfo->IndexTable->StartPtr    = GetStartPointer (VariableStoreHeader);
           StoreInfo->IndexTable->EndPtr      = GetEndPointer   (VariableStoreHeader);
           StoreInfo->IndexTable->GoneThrough = 0;
+          //
+          // The name hashes of the indexed variables are kept in a private HOB,
+          // it is only used when it is created together with the index table.
+          //
+          StoreInfo->IndexHash = (VARIABLE_INDEX_HASH *) BuildGuidHob (&gEfiCallerIdGuid, sizeof (VARIABLE_INDEX_HASH));
+          if (StoreInfo->IndexHash != NULL) {
+            StoreInfo->IndexHash->BytesScanned = 0;
+          }
         }
       }
       break;
@@ -806,6 +855,7 @@ FindVariableEx (
 {
   VARIABLE_HEADER         *Variable;
   VARIABLE_HEADER         *LastVariable;
+  VARIABLE_HEADER         *StartVariable;
   VARIABLE_HEADER         *MaxIndex;
   UINTN                   Index;
   UINTN                   Offset;
@@ -813,7 +863,10 @@ FindVariableEx (
   VARIABLE_HEADER         *InDeletedVariable;
   VARIABLE_STORE_HEADER   *VariableStoreHeader;
   VARIABLE_INDEX_TABLE    *IndexTable;
+  VARIABLE_INDEX_HASH     *IndexHash;
   VARIABLE_HEADER         *VariableHeader;
+  BOOLEAN                 UseHash;
+  UINT16                  Hash;
 
   VariableStoreHeader = StoreInfo->VariableStoreHeader;
 
@@ -830,6 +883,7 @@ FindVariableEx (
   }
 
   IndexTable = StoreInfo->IndexTable;
+  IndexHash  = StoreInfo->IndexHash;
   PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
   PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader);
 
@@ -841,15 +895,30 @@ FindVariableEx (
   MaxIndex   = NULL;
   VariableHeader = NULL;
 
+  //
+  // The name hash is not used when a part of the variable storage is backed up
+  // in the spare block, as a variable name may not be consecutive then.
+  //
+  UseHash = (BOOLEAN) ((IndexHash != NULL) && (StoreInfo->FtwLastWriteData == NULL) && (VariableName[0] != 0) && (VendorGuid != NULL));
+  Hash    = 0;
+  if (UseHash) {
+    Hash = GetVariableHash (VariableName, StrSize (VariableName), VendorGuid);
+  }
+
   if (IndexTable != NULL) {
     //
     // traverse the variable index table to look for varible.
     // The IndexTable->Index[Index] records the distance of two neighbouring VAR_ADDED type variables.
+    // The IndexHash->Hash[Index] filters out the variables whose name or GUID is different
+    // without accessing the variable storage.
     //
     for (Offset = 0, Index = 0; Index < IndexTable->Length; Index++) {
       ASSERT (Index < sizeof (IndexTable->Index) / sizeof (IndexTable->Index[0]));
       Offset   += IndexTable->Index[Index];
       MaxIndex  = (VARIABLE_HEADER *) ((UINT8 *) IndexTable->StartPtr + Offset);
+      if (UseHash && (IndexHash->Hash[Index] != Hash)) {
+        continue;
+      }
       GetVariableHeader (StoreInfo, MaxIndex, &VariableHeader);
       if (CompareWithValidVariable (StoreInfo, MaxIndex, VariableHeader, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
         if (VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
@@ -873,7 +942,9 @@ FindVariableEx (
     //
     // HOB exists but the variable cannot be found in HOB
     // If not found in HOB, then let's start from the MaxIndex we've found.
+    // The header of MaxIndex may have been skipped by the hash check.
     //
+    GetVariableHeader (StoreInfo, MaxIndex, &VariableHeader);
     Variable     = GetNextVariablePtr (StoreInfo, MaxIndex, VariableHeader);
     LastVariable = MaxIndex;
   } else {
@@ -888,6 +959,11 @@ FindVariableEx (
   //
   // Find the variable by walk through variable store
   //
+  StartVariable = Variable;
+  if (IndexTable != NULL) {
+    PERF_INMODULE_BEGIN ("PeiVariableScan");
+  }
+
   StopRecord = FALSE;
   while (GetVariableHeader (StoreInfo, Variable, &VariableHeader)) {
     if (VariableHeader->State == VAR_ADDED || VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
@@ -903,6 +979,16 @@ FindVariableEx (
           //
           StopRecord = TRUE;
         } else {
+          if (IndexHash != NULL) {
+            IndexHash->Hash[IndexTable->Length] = 0;
+            if (StoreInfo->FtwLastWriteData == NULL) {
+              IndexHash->Hash[IndexTable->Length] = GetVariableHash (
+                                                      GetVariableNamePtr (Variable, StoreInfo->AuthFlag),
+                                                      NameSizeOfVariable (VariableHeader, StoreInfo->AuthFlag),
+                                                      GetVendorGuidPtr (VariableHeader, StoreInfo->AuthFlag)
+                                                      );
+            }
+          }
           IndexTable->Index[IndexTable->Length++] = (UINT16) Offset;
           LastVariable = Variable;
         }
@@ -912,6 +998,12 @@ FindVariableEx (
         if (VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
           InDeletedVariable = PtrTrack->CurrPtr;
         } else {
+          if (IndexTable != NULL) {
+            if (IndexHash != NULL) {
+              IndexHash->BytesScanned += (UINT32) ((UINTN) Variable - (UINTN) StartVariable);
+            }
+            PERF_INMODULE_END ("PeiVariableScan");
+          }
           return EFI_SUCCESS;
         }
       }
@@ -919,6 +1011,15 @@ FindVariableEx (
 
     Variable = GetNextVariablePtr (StoreInfo, Variable, VariableHeader);
   }
+
+  if (IndexTable != NULL) {
+    PERF_INMODULE_END ("PeiVariableScan");
+    if (IndexHash != NULL) {
+      IndexHash->BytesScanned += (UINT32) ((UINTN) Variable - (UINTN) StartVariable);
+      DEBUG ((DEBUG_VERBOSE, "PeiVariable: %d variables indexed, 0x%x bytes of variable storage scanned\n", IndexTable->Length, IndexHash->BytesScanned));
+    }
+  }
+
   //
   // If gone through the VariableStore, that means we never find in Firmware any more.
   //
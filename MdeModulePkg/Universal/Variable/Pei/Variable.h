@@ -20,6 +20,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/PeiServicesTablePointerLib.h>
 #include <Library/PeiServicesLib.h>
+#include <Library/BaseLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <Guid/VariableFormat.h>
 #include <Guid/VariableIndexTable.h>
@@ -32,9 +34,27 @@ typedef enum {
   VariableStoreTypeMax
 } VARIABLE_STORE_TYPE;
 
+///
+/// PEI private companion of the VARIABLE_INDEX_TABLE HOB. It is built as a
+/// GUIDed HOB named by gEfiCallerIdGuid, so the public HOB keeps its layout.
+///
+typedef struct {
+  ///
+  /// The hash of the name and vendor GUID of the variable recorded in the same
+  /// position of VARIABLE_INDEX_TABLE.Index[], so that a variable can be skipped
+  /// without accessing the variable storage.
+  ///
+  UINT16          Hash[VARIABLE_INDEX_TABLE_VOLUME];
+  ///
+  /// The number of variable storage bytes walked because the variable was not indexed yet.
+  ///
+  UINT32          BytesScanned;
+} VARIABLE_INDEX_HASH;
+
 typedef struct {
   VARIABLE_STORE_HEADER                   *VariableStoreHeader;
   VARIABLE_INDEX_TABLE                    *IndexTable;
+  VARIABLE_INDEX_HASH                     *IndexHash;
   //
   // If it is not NULL, it means there may be an inconsecutive variable whose
   // partial content is still in NV storage, but another partial content is backed up
@@ -6,9 +6,11 @@
 
   - No attach/detach (ie. removable media).
 
-  - Although the non-blocking interfaces of EFI_BLOCK_IO2_PROTOCOL could be a
-    good match for multiple in-flight virtio-blk requests, we stick to
-    synchronous requests and EFI_BLOCK_IO_PROTOCOL for now.
+  - EFI_BLOCK_IO2_PROTOCOL is produced next to EFI_BLOCK_IO_PROTOCOL. The
+    descriptor table is split into fixed request slots, so that several
+    requests can be in flight on the single virtio ring at a time; blocking
+    requests use the same slots and poll for their own completion, while
+    non-blocking requests are reaped by a periodic timer.
 
   Copyright (C) 2012, Red Hat, Inc.
   Copyright (c) 2012 - 2018, Intel Corporation. All rights reserved.<BR>
@@ -178,20 +180,203 @@ VerifyReadWriteRequest (
 
 /**
 
-  Format a read / write / flush request as three consecutive virtio
-  descriptors, push them to the host, and poll for the response.
+  Reap the requests the device has completed since the last call.
 
-  This is the main workhorse function. Two use cases are supported, read/write
-  and flush. The function may only be called after the request parameters have
-  been verified by
-  - specific checks in ReadBlocks() / WriteBlocks() / FlushBlocks(), and
+  Completed non-blocking requests are finished here: their data buffer is
+  unmapped, their token is updated and signaled, and their slot is released.
+  Completed blocking requests are only marked done; the waiting caller
+  collects the result and releases the slot. Requests abandoned by their
+  submitter only release their slot.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in out] Dev  The virtio-blk device whose used ring is processed.
+
+**/
+STATIC
+VOID
+ReapRequests (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  volatile CONST VRING_USED_ELEM *UsedElem;
+  VBLK_REQUEST                   *Request;
+  UINT16                         Slot;
+  EFI_STATUS                     Status;
+  EFI_STATUS                     UnmapStatus;
+  BOOLEAN                        AsyncCompleted;
+
+  AsyncCompleted = FALSE;
+  MemoryFence ();
+  while (Dev->LastUsedIdx != *Dev->Ring.Used.Idx) {
+    MemoryFence ();
+    UsedElem = &Dev->Ring.Used.UsedElem[Dev->LastUsedIdx % Dev->Ring.QueueSize];
+    Dev->LastUsedIdx++;
+
+    //
+    // Do not trust the device with an index into our own bookkeeping: only
+    // accept the head descriptor of a slot that has a request outstanding.
+    //
+    if (UsedElem->Id % VBLK_DESC_PER_REQUEST != 0 ||
+        UsedElem->Id / VBLK_DESC_PER_REQUEST >= Dev->NumRequests) {
+      DEBUG ((DEBUG_ERROR, "%a: bogus used element id %u\n", __FUNCTION__,
+        UsedElem->Id));
+      Dev->Statistics.BadCompletions++;
+      continue;
+    }
+    Slot    = (UINT16) (UsedElem->Id / VBLK_DESC_PER_REQUEST);
+    Request = &Dev->Requests[Slot];
+    if (!Request->InUse || Request->Done) {
+      DEBUG ((DEBUG_ERROR, "%a: unexpected completion of slot %u\n",
+        __FUNCTION__, Slot));
+      Dev->Statistics.BadCompletions++;
+      continue;
+    }
+
+    Status = (Dev->SharedReqs[Slot].HostStatus == VIRTIO_BLK_S_OK) ?
+             EFI_SUCCESS :
+             EFI_DEVICE_ERROR;
+
+    if (Request->BufferSize > 0) {
+      UnmapStatus = Dev->VirtIo->UnmapSharedBuffer (
+                                   Dev->VirtIo,
+                                   Request->BufferMapping
+                                   );
+      if (EFI_ERROR (UnmapStatus) && !Request->RequestIsWrite &&
+          !EFI_ERROR (Status)) {
+        //
+        // Data from the bus master may not reach the caller; fail the request.
+        //
+        Status = EFI_DEVICE_ERROR;
+      }
+    }
+
+    Dev->NumInFlight--;
+    if (Request->Token != NULL) {
+      Request->Token->TransactionStatus = Status;
+      gBS->SignalEvent (Request->Token->Event);
+      Request->Token = NULL;
+      Request->InUse = FALSE;
+      Dev->NumAsyncInFlight--;
+      AsyncCompleted = TRUE;
+    } else if (Request->Abandoned) {
+      Request->Abandoned = FALSE;
+      Request->InUse     = FALSE;
+    } else {
+      Request->Status = Status;
+      Request->Done   = TRUE;
+    }
+    MemoryFence ();
+  }
+
+  if (AsyncCompleted && Dev->NumAsyncInFlight == 0) {
+    gBS->SetTimer (Dev->AsyncTimer, TimerCancel, 0);
+  }
+}
+
+/**
+
+  Report the request counters of the device.
+
+  @param[in] Dev  The virtio-blk device whose counters are reported.
+
+**/
+STATIC
+VOID
+DumpStatistics (
+  IN VBLK_DEV *Dev
+  )
+{
+  DEBUG ((DEBUG_INFO, "%a: %Lu blocking, %Lu non-blocking requests, "
+    "%Lu bytes, max %u in flight of %u slots, %Lu slot waits, "
+    "%Lu bad completions\n", __FUNCTION__,
+    Dev->Statistics.BlockingRequests, Dev->Statistics.NonBlockingRequests,
+    Dev->Statistics.BytesTransferred, Dev->Statistics.MaxInFlight,
+    Dev->NumRequests, Dev->Statistics.SlotWaits,
+    Dev->Statistics.BadCompletions));
+}
+
+/**
+
+  Timer notification function that reaps completed non-blocking requests.
+
+  @param[in] Event    Event whose notification function is being invoked.
+
+  @param[in] Context  Pointer to the VBLK_DEV structure.
+
+**/
+STATIC
+VOID
+EFIAPI
+VirtioBlkAsyncTimer (
+  IN  EFI_EVENT Event,
+  IN  VOID      *Context
+  )
+{
+  ReapRequests (Context);
+}
+
+/**
+
+  Wait until the device has completed every request in flight.
+
+  @param[in out] Dev  The virtio-blk device to drain.
+
+**/
+STATIC
+VOID
+DrainRequests (
+  IN OUT VBLK_DEV *Dev
+  )
+{
+  EFI_TPL OldTpl;
+  UINTN   PollPeriodUsecs;
+  UINT16  NumInFlight;
+
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ReapRequests (Dev);
+    NumInFlight = Dev->NumInFlight;
+    gBS->RestoreTPL (OldTpl);
+    if (NumInFlight == 0) {
+      return;
+    }
+
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
+  }
+}
+
+/**
+
+  Format a read / write / flush request as up to three virtio descriptors in
+  a free request slot, and push them to the host without waiting for the
+  response.
+
+  The function may only be called after the request parameters have been
+  verified by
+  - specific checks in ReadBlocks() / WriteBlocks() / FlushBlocks() and their
+    BlockIo2 counterparts, and
   - VerifyReadWriteRequest() (for read/write only).
 
+  If every request slot is busy, the function reaps completions until one is
+  released.
+
   Parameters handled commonly:
 
     @param[in] Dev             The virtio-blk device the request is targeted
                                at.
 
+    @param[in] Token           The BlockIo2 token to complete and signal when
+                               the device is done, or NULL for a blocking
+                               request whose caller collects the result with
+                               WaitRequest().
+
+    @param[out] Slot           The request slot the request was placed in.
+
   Flush request:
 
     @param[in] Lba             Must be zero.
@@ -212,49 +397,46 @@ VerifyReadWriteRequest (
                                positive.
 
     @param[in out] Buffer      The guest side area to read data from the device
-                               into, or write data to the device from.
+                               into, or write data to the device from. It must
+                               stay valid until the request completes.
 
     @param[in] RequestIsWrite  TRUE iff data transfer goes from guest to
                                device.
 
-  Return values are common to both use cases, and are appropriate to be
-  forwarded by the EFI_BLOCK_IO_PROTOCOL functions (ReadBlocks(),
-  WriteBlocks(), FlushBlocks()).
 
+  @retval EFI_SUCCESS          The request has been pushed to the host.
 
-  @retval EFI_SUCCESS          Transfer complete.
-
-  @retval EFI_DEVICE_ERROR     Failed to notify host side via VirtIo write, or
-                               unable to parse host response, or host response
-                               is not VIRTIO_BLK_S_OK or failed to map Buffer
-                               for a bus master operation.
+  @retval EFI_DEVICE_ERROR     Failed to map Buffer for a bus master
+                               operation, or failed to notify host side via
+                               VirtIo write. The request will not complete
+                               towards the caller, and Token is not signaled.
 
 **/
 
 STATIC
 EFI_STATUS
-EFIAPI
-SynchronousRequest (
-  IN              VBLK_DEV *Dev,
-  IN              EFI_LBA  Lba,
-  IN              UINTN    BufferSize,
-  IN OUT volatile VOID     *Buffer,
-  IN              BOOLEAN  RequestIsWrite
+SubmitRequest (
+  IN              VBLK_DEV            *Dev,
+  IN              EFI_LBA             Lba,
+  IN              UINTN               BufferSize,
+  IN OUT volatile VOID                *Buffer,
+  IN              BOOLEAN             RequestIsWrite,
+  IN              EFI_BLOCK_IO2_TOKEN *Token          OPTIONAL,
+  OUT             UINT16              *Slot
   )
 {
-  UINT32                  BlockSize;
-  volatile VIRTIO_BLK_REQ Request;
-  volatile UINT8          *HostStatus;
-  VOID                    *HostStatusBuffer;
-  DESC_INDICES            Indices;
-  VOID                    *RequestMapping;
-  VOID                    *StatusMapping;
-  VOID                    *BufferMapping;
-  EFI_PHYSICAL_ADDRESS    BufferDeviceAddress;
-  EFI_PHYSICAL_ADDRESS    HostStatusDeviceAddress;
-  EFI_PHYSICAL_ADDRESS    RequestDeviceAddress;
-  EFI_STATUS              Status;
-  EFI_STATUS              UnmapStatus;
+  UINT32                   BlockSize;
+  volatile VBLK_SHARED_REQ *SharedReq;
+  VBLK_REQUEST             *Request;
+  DESC_INDICES             Indices;
+  VOID                     *BufferMapping;
+  EFI_PHYSICAL_ADDRESS     BufferDeviceAddress;
+  EFI_PHYSICAL_ADDRESS     SharedReqDeviceAddress;
+  EFI_TPL                  OldTpl;
+  UINTN                    PollPeriodUsecs;
+  UINT16                   Index;
+  UINT16                   NextAvailIdx;
+  EFI_STATUS               Status;
 
   BlockSize = Dev->BlockIoMedia.BlockSize;
 
@@ -276,49 +458,6 @@ SynchronousRequest (
   //
   ASSERT (BufferSize % BlockSize == 0);
 
-  //
-  // Prepare virtio-blk request header, setting zero size for flush.
-  // IO Priority is homogeneously 0.
-  //
-  Request.Type   = RequestIsWrite ?
-                   (BufferSize == 0 ? VIRTIO_BLK_T_FLUSH : VIRTIO_BLK_T_OUT) :
-                   VIRTIO_BLK_T_IN;
-  Request.IoPrio = 0;
-  Request.Sector = MultU64x32(Lba, BlockSize / 512);
-
-  //
-  // Host status is bi-directional (we preset with a value and expect the
-  // device to update it). Allocate a host status buffer which can be mapped
-  // to access equally by both processor and the device.
-  //
-  Status = Dev->VirtIo->AllocateSharedPages (
-                          Dev->VirtIo,
-                          EFI_SIZE_TO_PAGES (sizeof *HostStatus),
-                          &HostStatusBuffer
-                          );
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
-  }
-
-  HostStatus = HostStatusBuffer;
-
-  //
-  // Map virtio-blk request header (must be done after request header is
-  // populated)
-  //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterRead,
-             (VOID *) &Request,
-             sizeof Request,
-             &RequestDeviceAddress,
-             &RequestMapping
-             );
-  if (EFI_ERROR (Status)) {
-    Status = EFI_DEVICE_ERROR;
-    goto FreeHostStatusBuffer;
-  }
-
   //
   // Map data buffer
   //
@@ -334,48 +473,73 @@ SynchronousRequest (
                &BufferMapping
                );
     if (EFI_ERROR (Status)) {
-      Status = EFI_DEVICE_ERROR;
-      goto UnmapRequestBuffer;
+      return EFI_DEVICE_ERROR;
     }
   }
 
   //
-  // preset a host status for ourselves that we do not accept as success
+  // Claim a free request slot. The ring is only ever touched at TPL_NOTIFY,
+  // so that the timer reaping non-blocking requests cannot interleave.
   //
-  *HostStatus = VIRTIO_BLK_S_IOERR;
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    for (Index = 0; Index < Dev->NumRequests; Index++) {
+      if (!Dev->Requests[Index].InUse) {
+        break;
+      }
+    }
+    if (Index < Dev->NumRequests) {
+      break;
+    }
 
-  //
-  // Map the Status Buffer with VirtioOperationBusMasterCommonBuffer so that
-  // both processor and device can access it.
-  //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterCommonBuffer,
-             HostStatusBuffer,
-             sizeof *HostStatus,
-             &HostStatusDeviceAddress,
-             &StatusMapping
-             );
-  if (EFI_ERROR (Status)) {
-    Status = EFI_DEVICE_ERROR;
-    goto UnmapDataBuffer;
+    if (PollPeriodUsecs == 1) {
+      Dev->Statistics.SlotWaits++;
+    }
+    ReapRequests (Dev);
+    gBS->RestoreTPL (OldTpl);
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
   }
 
-  VirtioPrepare (&Dev->Ring, &Indices);
+  Request                 = &Dev->Requests[Index];
+  Request->InUse          = TRUE;
+  Request->Done           = FALSE;
+  Request->Abandoned      = FALSE;
+  Request->RequestIsWrite = RequestIsWrite;
+  Request->BufferSize     = BufferSize;
+  Request->BufferMapping  = BufferMapping;
+  Request->Token          = Token;
 
   //
-  // ensured by VirtioBlkInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // Prepare virtio-blk request header, setting zero size for flush.
+  // IO Priority is homogeneously 0. Preset a host status for ourselves that
+  // we do not accept as success.
   //
-  ASSERT (Dev->Ring.QueueSize >= 3);
+  SharedReq                = &Dev->SharedReqs[Index];
+  SharedReq->Header.Type   = RequestIsWrite ?
+                             (BufferSize == 0 ?
+                              VIRTIO_BLK_T_FLUSH :
+                              VIRTIO_BLK_T_OUT) :
+                             VIRTIO_BLK_T_IN;
+  SharedReq->Header.IoPrio = 0;
+  SharedReq->Header.Sector = MultU64x32 (Lba, BlockSize / 512);
+  SharedReq->HostStatus    = VIRTIO_BLK_S_IOERR;
+  SharedReqDeviceAddress   = Dev->SharedReqsDeviceAddress +
+                             Index * sizeof (VBLK_SHARED_REQ);
+
+  Indices.HeadDescIdx = (UINT16) (Index * VBLK_DESC_PER_REQUEST);
+  Indices.NextDescIdx = Indices.HeadDescIdx;
 
   //
   // virtio-blk header in first desc
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    RequestDeviceAddress,
-    sizeof Request,
+    SharedReqDeviceAddress + OFFSET_OF (VBLK_SHARED_REQ, Header),
+    sizeof (VIRTIO_BLK_REQ),
     VRING_DESC_F_NEXT,
     &Indices
     );
@@ -411,47 +575,163 @@ SynchronousRequest (
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    HostStatusDeviceAddress,
-    sizeof *HostStatus,
+    SharedReqDeviceAddress + OFFSET_OF (VBLK_SHARED_REQ, HostStatus),
+    sizeof (UINT8),
     VRING_DESC_F_WRITE,
     &Indices
     );
 
   //
-  // virtio-blk's only virtqueue is #0, called "requestq" (see Appendix D).
-  //
-  if (VirtioFlush (Dev->VirtIo, 0, &Dev->Ring, &Indices,
-        NULL) == EFI_SUCCESS &&
-      *HostStatus == VIRTIO_BLK_S_OK) {
-    Status = EFI_SUCCESS;
+  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring, and 2.4.1.3 Updating
+  // the Index Field. Each entry in the Available Ring references only the
+  // head descriptor of the chain.
+  //
+  NextAvailIdx = *Dev->Ring.Avail.Idx;
+  Dev->Ring.Avail.Ring[NextAvailIdx++ % Dev->Ring.QueueSize] =
+    Indices.HeadDescIdx;
+  MemoryFence ();
+  *Dev->Ring.Avail.Idx = NextAvailIdx;
+  Dev->NumInFlight++;
+  Dev->Statistics.MaxInFlight = MAX (Dev->Statistics.MaxInFlight,
+                                     Dev->NumInFlight);
+  Dev->Statistics.BytesTransferred += BufferSize;
+  if (Token != NULL) {
+    Dev->Statistics.NonBlockingRequests++;
   } else {
-    Status = EFI_DEVICE_ERROR;
+    Dev->Statistics.BlockingRequests++;
+  }
+  if (Token != NULL && Dev->NumAsyncInFlight++ == 0) {
+    gBS->SetTimer (Dev->AsyncTimer, TimerPeriodic, VBLK_ASYNC_POLL_INTERVAL);
   }
 
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, StatusMapping);
+  //
+  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- gratuitous notifications
+  // are OK. virtio-blk's only virtqueue is #0, called "requestq" (see
+  // Appendix D).
+  //
+  MemoryFence ();
+  Status = Dev->VirtIo->SetQueueNotify (Dev->VirtIo, 0);
+  if (EFI_ERROR (Status)) {
+    //
+    // The chain is already visible to the device and cannot be taken back.
+    // Abandon it: the slot is released whenever the device completes it, and
+    // the caller is not told about that completion.
+    //
+    if (Token != NULL) {
+      Request->Token = NULL;
+      if (--Dev->NumAsyncInFlight == 0) {
+        gBS->SetTimer (Dev->AsyncTimer, TimerCancel, 0);
+      }
+    }
+    Request->Abandoned = TRUE;
+    gBS->RestoreTPL (OldTpl);
+    return EFI_DEVICE_ERROR;
+  }
+  gBS->RestoreTPL (OldTpl);
 
-UnmapDataBuffer:
-  if (BufferSize > 0) {
-    UnmapStatus = Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, BufferMapping);
-    if (EFI_ERROR (UnmapStatus) && !RequestIsWrite && !EFI_ERROR (Status)) {
-      //
-      // Data from the bus master may not reach the caller; fail the request.
-      //
-      Status = EFI_DEVICE_ERROR;
+  *Slot = Index;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Poll for the completion of a blocking request, then release its slot.
+
+  @param[in] Dev   The virtio-blk device the request was submitted to.
+
+  @param[in] Slot  The request slot returned by SubmitRequest().
+
+  @return  The completion status of the request.
+
+**/
+STATIC
+EFI_STATUS
+WaitRequest (
+  IN VBLK_DEV *Dev,
+  IN UINT16   Slot
+  )
+{
+  VBLK_REQUEST *Request;
+  EFI_TPL      OldTpl;
+  UINTN        PollPeriodUsecs;
+  EFI_STATUS   Status;
+
+  Request = &Dev->Requests[Slot];
+  ASSERT (Request->InUse && Request->Token == NULL);
+
+  //
+  // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
+  // Keep slowing down until we reach a poll period of slightly above 1 ms.
+  //
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ReapRequests (Dev);
+    if (Request->Done) {
+      Status         = Request->Status;
+      Request->Done  = FALSE;
+      Request->InUse = FALSE;
+      gBS->RestoreTPL (OldTpl);
+      return Status;
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    gBS->Stall (PollPeriodUsecs); // calls AcpiTimerLib::MicroSecondDelay
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
     }
   }
+}
 
-UnmapRequestBuffer:
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, RequestMapping);
+/**
 
-FreeHostStatusBuffer:
-  Dev->VirtIo->FreeSharedPages (
-                 Dev->VirtIo,
-                 EFI_SIZE_TO_PAGES (sizeof *HostStatus),
-                 HostStatusBuffer
-                 );
+  Submit a read / write / flush request and poll for the response.
 
-  return Status;
+  This is the main workhorse function of the blocking interfaces. Parameters
+  and preconditions are those of SubmitRequest(), without the Token.
+
+  Return values are common to read/write and flush, and are appropriate to be
+  forwarded by the EFI_BLOCK_IO_PROTOCOL functions (ReadBlocks(),
+  WriteBlocks(), FlushBlocks()).
+
+
+  @retval EFI_SUCCESS          Transfer complete.
+
+  @retval EFI_DEVICE_ERROR     Failed to notify host side via VirtIo write, or
+                               unable to parse host response, or host response
+                               is not VIRTIO_BLK_S_OK or failed to map Buffer
+                               for a bus master operation.
+
+**/
+
+STATIC
+EFI_STATUS
+EFIAPI
+SynchronousRequest (
+  IN              VBLK_DEV *Dev,
+  IN              EFI_LBA  Lba,
+  IN              UINTN    BufferSize,
+  IN OUT volatile VOID     *Buffer,
+  IN              BOOLEAN  RequestIsWrite
+  )
+{
+  EFI_STATUS Status;
+  UINT16     Slot;
+
+  Status = SubmitRequest (
+             Dev,
+             Lba,
+             BufferSize,
+             Buffer,
+             RequestIsWrite,
+             NULL,           // Token
+             &Slot
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return WaitRequest (Dev, Slot);
 }
 
 
@@ -581,6 +861,9 @@ VirtioBlkWriteBlocks (
   according to EFI_BLOCK_IO_MEDIA characteristics set in VirtioBlkInit().
   Should they do nonetheless, we do nothing, successfully.
 
+  Requests still in flight from EFI_BLOCK_IO2_PROTOCOL are drained first, as
+  the virtio-blk flush command only covers completed writes.
+
 **/
 
 EFI_STATUS
@@ -592,6 +875,12 @@ VirtioBlkFlushBlocks (
   VBLK_DEV *Dev;
 
   Dev = VIRTIO_BLK_FROM_BLOCK_IO (This);
+  if (Dev->BlockIoMedia.WriteCaching) {
+    //
+    // Let non-blocking writes submitted through BlockIo2 complete first.
+    //
+    DrainRequests (Dev);
+  }
   return Dev->BlockIoMedia.WriteCaching ?
            SynchronousRequest (
              Dev,
@@ -604,6 +893,224 @@ VirtioBlkFlushBlocks (
 }
 
 
+//
+// UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  )
+{
+  //
+  // Requests on the ring cannot be aborted short of resetting the device, so
+  // let them complete. If we managed to initialize and install the driver,
+  // then the device is working correctly.
+  //
+  DrainRequests (VIRTIO_BLK_FROM_BLOCK_IO2 (This));
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Common implementation of ReadBlocksEx() and WriteBlocksEx().
+
+  @param[in] This            The EFI_BLOCK_IO2_PROTOCOL instance.
+
+  @param[in] Lba             Logical Block Address of the transfer.
+
+  @param[in out] Token       Token of the non-blocking request, or NULL (or
+                             a token with a NULL Event) for a blocking one.
+
+  @param[in] BufferSize      Size of buffer to transfer, in bytes.
+
+  @param[in out] Buffer      The guest side data buffer.
+
+  @param[in] RequestIsWrite  TRUE iff data transfer goes from guest to
+                             device.
+
+  @return  Validation result from VerifyReadWriteRequest(), or the submission
+           or completion status of the request.
+
+**/
+
+STATIC
+EFI_STATUS
+ReadWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN OUT VOID                   *Buffer,
+  IN     BOOLEAN                RequestIsWrite
+  )
+{
+  VBLK_DEV   *Dev;
+  EFI_STATUS Status;
+  UINT16     Slot;
+
+  if (BufferSize == 0) {
+    if (Token != NULL && Token->Event != NULL) {
+      Token->TransactionStatus = EFI_SUCCESS;
+      gBS->SignalEvent (Token->Event);
+    }
+    return EFI_SUCCESS;
+  }
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  Status = VerifyReadWriteRequest (
+             &Dev->BlockIoMedia,
+             Lba,
+             BufferSize,
+             RequestIsWrite
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Token == NULL || Token->Event == NULL) {
+    return SynchronousRequest (Dev, Lba, BufferSize, Buffer, RequestIsWrite);
+  }
+
+  return SubmitRequest (
+           Dev,
+           Lba,
+           BufferSize,
+           Buffer,
+           RequestIsWrite,
+           Token,
+           &Slot
+           );
+}
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+
+  If Token is NULL or Token->Event is NULL, the request is blocking and
+  behaves like ReadBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled once the device has completed it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  )
+{
+  return ReadWriteBlocksEx (
+           This,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           FALSE       // RequestIsWrite
+           );
+}
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+
+  If Token is NULL or Token->Event is NULL, the request is blocking and
+  behaves like WriteBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled once the device has completed it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  return ReadWriteBlocksEx (
+           This,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           TRUE        // RequestIsWrite
+           );
+}
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+
+  The virtio-blk flush command only covers writes the device has already
+  completed, so the requests in flight are drained before the flush is
+  queued.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  VBLK_DEV *Dev;
+  UINT16   Slot;
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  if (!Dev->BlockIoMedia.WriteCaching) {
+    if (Token != NULL && Token->Event != NULL) {
+      Token->TransactionStatus = EFI_SUCCESS;
+      gBS->SignalEvent (Token->Event);
+    }
+    return EFI_SUCCESS;
+  }
+
+  DrainRequests (Dev);
+  if (Token == NULL || Token->Event == NULL) {
+    return SynchronousRequest (
+             Dev,
+             0,    // Lba
+             0,    // BufferSize
+             NULL, // Buffer
+             TRUE  // RequestIsWrite
+             );
+  }
+
+  return SubmitRequest (
+           Dev,
+           0,     // Lba
+           0,     // BufferSize
+           NULL,  // Buffer
+           TRUE,  // RequestIsWrite
+           Token,
+           &Slot
+           );
+}
+
+
 /**
 
   Device probe function for this driver.
@@ -692,7 +1199,8 @@ VirtioBlkDriverBindingSupported (
 
   @param[in out] Dev  The driver instance to configure. The caller is
                       responsible for Dev->VirtIo's validity (ie. working IO
-                      access to the underlying virtio-blk device).
+                      access to the underlying virtio-blk device), and for
+                      Dev->AsyncTimer's.
 
   @retval EFI_SUCCESS      Setup complete.
 
@@ -723,6 +1231,7 @@ VirtioBlkInit (
   UINT32     OptIoSize;
   UINT16     QueueSize;
   UINT64     RingBaseShift;
+  VOID       *SharedReqsBuffer;
 
   PhysicalBlockExp = 0;
   AlignmentOffset = 0;
@@ -841,7 +1350,7 @@ VirtioBlkInit (
   if (EFI_ERROR (Status)) {
     goto Failed;
   }
-  if (QueueSize < 3) { // SynchronousRequest() uses at most three descriptors
+  if (QueueSize < VBLK_DESC_PER_REQUEST) { // room for at least one request
     Status = EFI_UNSUPPORTED;
     goto Failed;
   }
@@ -864,18 +1373,55 @@ VirtioBlkInit (
     goto ReleaseQueue;
   }
 
+  //
+  // Allocate and map the request headers and host status bytes of all
+  // request slots once, as a common buffer shared with the device. If
+  // anything fails from here on, we must unmap the ring resources.
+  //
+  Dev->NumRequests = (UINT16) MIN (QueueSize / VBLK_DESC_PER_REQUEST,
+                                   VBLK_MAX_REQUESTS);
+  Status = Dev->VirtIo->AllocateSharedPages (
+                          Dev->VirtIo,
+                          EFI_SIZE_TO_PAGES (sizeof (VBLK_SHARED_REQ) *
+                                             VBLK_MAX_REQUESTS),
+                          &SharedReqsBuffer
+                          );
+  if (EFI_ERROR (Status)) {
+    goto UnmapQueue;
+  }
+
+  Status = VirtioMapAllBytesInSharedBuffer (
+             Dev->VirtIo,
+             VirtioOperationBusMasterCommonBuffer,
+             SharedReqsBuffer,
+             sizeof (VBLK_SHARED_REQ) * VBLK_MAX_REQUESTS,
+             &Dev->SharedReqsDeviceAddress,
+             &Dev->SharedReqsMap
+             );
+  if (EFI_ERROR (Status)) {
+    goto FreeSharedReqs;
+  }
+  Dev->SharedReqs = SharedReqsBuffer;
+
+  //
+  // We're going to poll for the answers, the host should not send
+  // interrupts.
+  //
+  *Dev->Ring.Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
-  // size. If anything fails from here on, we must unmap the ring resources.
+  // size. If anything fails from here on, we must unmap the shared request
+  // area.
   //
   Status = Dev->VirtIo->SetQueueNum (Dev->VirtIo, QueueSize);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   Status = Dev->VirtIo->SetQueueAlign (Dev->VirtIo, EFI_PAGE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -887,7 +1433,7 @@ VirtioBlkInit (
                           RingBaseShift
                           );
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
 
@@ -898,7 +1444,7 @@ VirtioBlkInit (
     Features &= ~(UINT64)(VIRTIO_F_VERSION_1 | VIRTIO_F_IOMMU_PLATFORM);
     Status = Dev->VirtIo->SetGuestFeatures (Dev->VirtIo, Features);
     if (EFI_ERROR (Status)) {
-      goto UnmapQueue;
+      goto UnmapSharedReqs;
     }
   }
 
@@ -908,7 +1454,7 @@ VirtioBlkInit (
   NextDevStat |= VSTAT_DRIVER_OK;
   Status = Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, NextDevStat);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -921,6 +1467,11 @@ VirtioBlkInit (
   Dev->BlockIo.ReadBlocks            = &VirtioBlkReadBlocks;
   Dev->BlockIo.WriteBlocks           = &VirtioBlkWriteBlocks;
   Dev->BlockIo.FlushBlocks           = &VirtioBlkFlushBlocks;
+  Dev->BlockIo2.Media                = &Dev->BlockIoMedia;
+  Dev->BlockIo2.Reset                = &VirtioBlkResetEx;
+  Dev->BlockIo2.ReadBlocksEx         = &VirtioBlkReadBlocksEx;
+  Dev->BlockIo2.WriteBlocksEx        = &VirtioBlkWriteBlocksEx;
+  Dev->BlockIo2.FlushBlocksEx        = &VirtioBlkFlushBlocksEx;
   Dev->BlockIoMedia.MediaId          = 0;
   Dev->BlockIoMedia.RemovableMedia   = FALSE;
   Dev->BlockIoMedia.MediaPresent     = TRUE;
@@ -935,6 +1486,8 @@ VirtioBlkInit (
   DEBUG ((DEBUG_INFO, "%a: LbaSize=0x%x[B] NumBlocks=0x%Lx[Lba]\n",
     __FUNCTION__, Dev->BlockIoMedia.BlockSize,
     Dev->BlockIoMedia.LastBlock + 1));
+  DEBUG ((DEBUG_INFO, "%a: QueueSize=%d MaxRequestsInFlight=%d\n",
+    __FUNCTION__, QueueSize, Dev->NumRequests));
 
   if (Features & VIRTIO_BLK_F_TOPOLOGY) {
     Dev->BlockIo.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION3;
@@ -951,6 +1504,18 @@ VirtioBlkInit (
   }
   return EFI_SUCCESS;
 
+UnmapSharedReqs:
+  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->SharedReqsMap);
+  Dev->SharedReqs = NULL;
+
+FreeSharedReqs:
+  Dev->VirtIo->FreeSharedPages (
+                 Dev->VirtIo,
+                 EFI_SIZE_TO_PAGES (sizeof (VBLK_SHARED_REQ) *
+                                    VBLK_MAX_REQUESTS),
+                 SharedReqsBuffer
+                 );
+
 UnmapQueue:
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
 
@@ -992,10 +1557,20 @@ VirtioBlkUninit (
   //
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 
+  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->SharedReqsMap);
+  Dev->VirtIo->FreeSharedPages (
+                 Dev->VirtIo,
+                 EFI_SIZE_TO_PAGES (sizeof (VBLK_SHARED_REQ) *
+                                    VBLK_MAX_REQUESTS),
+                 (VOID *) Dev->SharedReqs
+                 );
+  Dev->SharedReqs = NULL;
+
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
   VirtioRingUninit (Dev->VirtIo, &Dev->Ring);
 
   SetMem (&Dev->BlockIo,      sizeof Dev->BlockIo,      0x00);
+  SetMem (&Dev->BlockIo2,     sizeof Dev->BlockIo2,     0x00);
   SetMem (&Dev->BlockIoMedia, sizeof Dev->BlockIoMedia, 0x00);
 }
 
@@ -1029,6 +1604,7 @@ VirtioBlkExitBoot (
   // executing after ExitBootServices() is permitted to overwrite it.
   //
   Dev = Context;
+  DumpStatistics (Dev);
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 }
 
@@ -1084,12 +1660,18 @@ VirtioBlkDriverBindingStart (
     goto FreeVirtioBlk;
   }
 
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY,
+                  &VirtioBlkAsyncTimer, Dev, &Dev->AsyncTimer);
+  if (EFI_ERROR (Status)) {
+    goto CloseVirtIo;
+  }
+
   //
   // VirtIo access granted, configure virtio-blk device.
   //
   Status = VirtioBlkInit (Dev);
   if (EFI_ERROR (Status)) {
-    goto CloseVirtIo;
+    goto CloseAsyncTimer;
   }
 
   Status = gBS->CreateEvent (EVT_SIGNAL_EXIT_BOOT_SERVICES, TPL_CALLBACK,
@@ -1099,12 +1681,14 @@ VirtioBlkDriverBindingStart (
   }
 
   //
-  // Setup complete, attempt to export the driver instance's BlockIo interface.
+  // Setup complete, attempt to export the driver instance's BlockIo and
+  // BlockIo2 interfaces.
   //
   Dev->Signature = VBLK_SIG;
-  Status = gBS->InstallProtocolInterface (&DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, EFI_NATIVE_INTERFACE,
-                  &Dev->BlockIo);
+  Status = gBS->InstallMultipleProtocolInterfaces (&DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
   if (EFI_ERROR (Status)) {
     goto CloseExitBoot;
   }
@@ -1117,6 +1701,9 @@ CloseExitBoot:
 UninitDev:
   VirtioBlkUninit (Dev);
 
+CloseAsyncTimer:
+  gBS->CloseEvent (Dev->AsyncTimer);
+
 CloseVirtIo:
   gBS->CloseProtocol (DeviceHandle, &gVirtioDeviceProtocolGuid,
          This->DriverBindingHandle, DeviceHandle);
@@ -1181,16 +1768,27 @@ VirtioBlkDriverBindingStop (
   //
   // Handle Stop() requests for in-use driver instances gracefully.
   //
-  Status = gBS->UninstallProtocolInterface (DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo);
+  Status = gBS->UninstallMultipleProtocolInterfaces (DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
+  //
+  // Complete the non-blocking requests still on the ring before the ring goes
+  // away.
+  //
+  DrainRequests (Dev);
+  DumpStatistics (Dev);
+
   gBS->CloseEvent (Dev->ExitBoot);
 
   VirtioBlkUninit (Dev);
 
+  gBS->CloseEvent (Dev->AsyncTimer);
+
   gBS->CloseProtocol (DeviceHandle, &gVirtioDeviceProtocolGuid,
          This->DriverBindingHandle, DeviceHandle);
 
@@ -13,14 +13,75 @@
 #define _VIRTIO_BLK_DXE_H_
 
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/DriverBinding.h>
 
 #include <IndustryStandard/Virtio.h>
+#include <IndustryStandard/VirtioBlk.h>
 
 
 #define VBLK_SIG SIGNATURE_32 ('V', 'B', 'L', 'K')
 
+//
+// Every request occupies a fixed group of descriptors in the descriptor
+// table: request header, data buffer (absent for flush) and host status.
+// Request slot N owns descriptors [N * VBLK_DESC_PER_REQUEST, ...], so the
+// head descriptor index reported in the used ring identifies the slot.
+//
+#define VBLK_DESC_PER_REQUEST 3
+
+//
+// Upper limit on requests in flight on the virtio ring. The actual limit is
+// further capped by the queue size the device offers.
+//
+#define VBLK_MAX_REQUESTS     32
+
+//
+// Period of the timer that reaps completed non-blocking requests.
+//
+#define VBLK_ASYNC_POLL_INTERVAL EFI_TIMER_PERIOD_MILLISECONDS (1)
+
+//
+// Per-slot area shared with the device: the request header, read by the
+// device, and the host status byte, written by the device. Padded to keep
+// each slot in its own 32-byte chunk.
+//
+#pragma pack(1)
+typedef struct {
+  VIRTIO_BLK_REQ Header;
+  UINT8          HostStatus;
+  UINT8          Reserved[15];
+} VBLK_SHARED_REQ;
+#pragma pack()
+
+//
+// Driver-side bookkeeping of one request slot.
+//
+typedef struct {
+  BOOLEAN             InUse;          // Slot is owned by a request
+  BOOLEAN             Done;           // Device completed a blocking request
+  BOOLEAN             Abandoned;      // Submitter gave up on the request
+  BOOLEAN             RequestIsWrite; // Data flows from guest to device
+  UINTN               BufferSize;     // Zero for flush
+  VOID                *BufferMapping; // Bus master mapping of the data buffer
+  EFI_BLOCK_IO2_TOKEN *Token;         // NULL for blocking requests
+  EFI_STATUS          Status;         // Result of a completed blocking request
+} VBLK_REQUEST;
+
+//
+// Request counters, reported when the device is stopped or boot services are
+// exited.
+//
+typedef struct {
+  UINT64              BlockingRequests;     // Requests whose caller polled
+  UINT64              NonBlockingRequests;  // BlockIo2 requests with an event
+  UINT64              BytesTransferred;     // Data bytes of all requests
+  UINT64              SlotWaits;            // Submissions that found no free slot
+  UINT64              BadCompletions;       // Used ring entries not matching a request
+  UINT16              MaxInFlight;          // Most requests on the ring at once
+} VBLK_STATISTICS;
+
 typedef struct {
   //
   // Parts of this structure are initialized / torn down in various functions
@@ -32,15 +93,29 @@ typedef struct {
   UINT32                 Signature;            // DriverBindingStart  0
   VIRTIO_DEVICE_PROTOCOL *VirtIo;              // DriverBindingStart  0
   EFI_EVENT              ExitBoot;             // DriverBindingStart  0
+  EFI_EVENT              AsyncTimer;           // DriverBindingStart  0
   VRING                  Ring;                 // VirtioRingInit      2
   EFI_BLOCK_IO_PROTOCOL  BlockIo;              // VirtioBlkInit       1
+  EFI_BLOCK_IO2_PROTOCOL BlockIo2;             // VirtioBlkInit       1
   EFI_BLOCK_IO_MEDIA     BlockIoMedia;         // VirtioBlkInit       1
   VOID                   *RingMap;             // VirtioRingMap       2
+  volatile VBLK_SHARED_REQ *SharedReqs;        // VirtioBlkInit       1
+  EFI_PHYSICAL_ADDRESS   SharedReqsDeviceAddress; // VirtioBlkInit    1
+  VOID                   *SharedReqsMap;       // VirtioBlkInit       1
+  UINT16                 NumRequests;          // VirtioBlkInit       1
+  UINT16                 LastUsedIdx;          // VirtioBlkInit       1
+  UINT16                 NumInFlight;          // VirtioBlkInit       1
+  UINT16                 NumAsyncInFlight;     // VirtioBlkInit       1
+  VBLK_REQUEST           Requests[VBLK_MAX_REQUESTS]; // VirtioBlkInit 1
+  VBLK_STATISTICS        Statistics;           // DriverBindingStart  0
 } VBLK_DEV;
 
 #define VIRTIO_BLK_FROM_BLOCK_IO(BlockIoPointer) \
         CR (BlockIoPointer, VBLK_DEV, BlockIo, VBLK_SIG)
 
+#define VIRTIO_BLK_FROM_BLOCK_IO2(BlockIo2Pointer) \
+        CR (BlockIo2Pointer, VBLK_DEV, BlockIo2, VBLK_SIG)
+
 
 /**
 
@@ -253,6 +328,88 @@ VirtioBlkFlushBlocks (
   );
 
 
+//
+// UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  );
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+
+  If Token is NULL or Token->Event is NULL, the request is blocking and
+  behaves like ReadBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled once the device has completed it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  );
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+
+  If Token is NULL or Token->Event is NULL, the request is blocking and
+  behaves like WriteBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled once the device has completed it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  );
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See UEFI Spec 2.3.1 + Errata C, 12.9 EFI Block I/O 2 Protocol,
+  EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+
+  The virtio-blk flush command only covers writes the device has already
+  completed, so the requests in flight are drained before the flush is
+  queued.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  );
+
+
 //
 // The purpose of the following scaffolding (EFI_COMPONENT_NAME_PROTOCOL and
 // EFI_COMPONENT_NAME2_PROTOCOL implementation) is to format the driver's name
@@ -7,16 +7,18 @@
 
   - No hotplug / hot-unplug.
 
-  - Although EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() could be a good match
-    for multiple in-flight virtio-scsi requests, we stick to synchronous
-    requests for now.
+  - EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() supports non-blocking
+    requests. The descriptor table of the request queue is split into fixed
+    request slots, so that several requests can be in flight at a time;
+    blocking requests use the same slots and poll for their own completion,
+    while non-blocking requests are reaped by a periodic timer.
 
   - Timeouts are not supported for EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru().
 
   - Only one channel is supported. (At the time of this writing, host-side
     virtio-scsi supports a single channel too.)
 
-  - Only one request queue is used (for the one synchronous request).
+  - Only one request queue is used.
 
   - The ResetChannel() and ResetTargetLun() functions of
     EFI_EXT_SCSI_PASS_THRU_PROTOCOL are not supported (which is allowed by the
@@ -413,6 +415,237 @@ ReportHostAdapterError (
 }
 
 
+/**
+
+  Complete a request the device has processed: parse the response into the
+  caller's packet, copy intermediate "datain" contents, and release the
+  mappings and buffers of the request.
+
+  For an abandoned request only the resources are released.
+
+  @param[in out] Dev   The virtio-scsi host device.
+
+  @param[in]     Slot  The request slot to complete.
+
+
+  @return  PassThru() status codes mandated by UEFI Spec 2.3.1 + Errata C, 14.7
+           Extended SCSI Pass Thru Protocol.
+
+**/
+STATIC
+EFI_STATUS
+FinishRequest (
+  IN OUT VSCSI_DEV *Dev,
+  IN     UINT16    Slot
+  )
+{
+  VSCSI_REQUEST                              *Request;
+  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet;
+  EFI_STATUS                                 Status;
+
+  Request = &Dev->Requests[Slot];
+  Packet  = Request->Packet;
+  Status  = EFI_DEVICE_ERROR;
+
+  if (Packet != NULL) {
+    Status = ParseResponse (Packet, &Dev->SharedReqs[Slot].Response);
+
+    //
+    // If the request went through an intermediate buffer, copy the data
+    // from there to the final buffer.
+    //
+    if (Request->InDataBuffer != NULL) {
+      CopyMem (
+        Packet->InDataBuffer,
+        Request->InDataBuffer,
+        Packet->InTransferLength
+        );
+    }
+  }
+
+  if (Request->OutDataMapping != NULL) {
+    Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Request->OutDataMapping);
+    Request->OutDataMapping = NULL;
+  }
+
+  if (Request->InDataMapping != NULL) {
+    Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Request->InDataMapping);
+    Request->InDataMapping = NULL;
+  }
+
+  if (Request->InDataBuffer != NULL) {
+    Dev->VirtIo->FreeSharedPages (
+                   Dev->VirtIo,
+                   Request->InDataNumPages,
+                   Request->InDataBuffer
+                   );
+    Request->InDataBuffer = NULL;
+  }
+
+  return Status;
+}
+
+
+/**
+
+  Reap the requests the device has completed since the last call.
+
+  Non-blocking requests are completed here and their event is signaled.
+  Blocking requests are completed and marked done; the waiting caller
+  collects the result and releases the slot. Abandoned requests only release
+  their resources and slot.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in out] Dev  The virtio-scsi host device whose used ring is
+                      processed.
+
+**/
+STATIC
+VOID
+ReapRequests (
+  IN OUT VSCSI_DEV *Dev
+  )
+{
+  volatile CONST VRING_USED_ELEM *UsedElem;
+  VSCSI_REQUEST                  *Request;
+  EFI_EVENT                      Event;
+  UINT16                         Slot;
+  EFI_STATUS                     Status;
+  BOOLEAN                        AsyncCompleted;
+
+  AsyncCompleted = FALSE;
+  MemoryFence ();
+  while (Dev->LastUsedIdx != *Dev->Ring.Used.Idx) {
+    MemoryFence ();
+    UsedElem = &Dev->Ring.Used.UsedElem[Dev->LastUsedIdx % Dev->Ring.QueueSize];
+    Dev->LastUsedIdx++;
+
+    //
+    // Do not trust the device with an index into our own bookkeeping: only
+    // accept the head descriptor of a slot that has a request outstanding.
+    //
+    if (UsedElem->Id % VSCSI_DESC_PER_REQUEST != 0 ||
+        UsedElem->Id / VSCSI_DESC_PER_REQUEST >= Dev->NumRequests) {
+      DEBUG ((DEBUG_ERROR, "%a: bogus used element id %u\n", __FUNCTION__,
+        UsedElem->Id));
+      Dev->Statistics.BadCompletions++;
+      continue;
+    }
+    Slot    = (UINT16) (UsedElem->Id / VSCSI_DESC_PER_REQUEST);
+    Request = &Dev->Requests[Slot];
+    if (!Request->InUse || Request->Done) {
+      DEBUG ((DEBUG_ERROR, "%a: unexpected completion of slot %u\n",
+        __FUNCTION__, Slot));
+      Dev->Statistics.BadCompletions++;
+      continue;
+    }
+
+    Status = FinishRequest (Dev, Slot);
+    Dev->NumInFlight--;
+    if (Request->Event != NULL) {
+      Event            = Request->Event;
+      Request->Event   = NULL;
+      Request->Packet  = NULL;
+      Request->InUse   = FALSE;
+      Dev->NumAsyncInFlight--;
+      AsyncCompleted   = TRUE;
+      gBS->SignalEvent (Event);
+    } else if (Request->Abandoned) {
+      Request->Abandoned = FALSE;
+      Request->InUse     = FALSE;
+    } else {
+      Request->Status = Status;
+      Request->Done   = TRUE;
+    }
+    MemoryFence ();
+  }
+
+  if (AsyncCompleted && Dev->NumAsyncInFlight == 0) {
+    gBS->SetTimer (Dev->AsyncTimer, TimerCancel, 0);
+  }
+}
+
+
+/**
+
+  Report the request counters of the host device.
+
+  @param[in] Dev  The virtio-scsi host device whose counters are reported.
+
+**/
+STATIC
+VOID
+DumpStatistics (
+  IN VSCSI_DEV *Dev
+  )
+{
+  DEBUG ((DEBUG_INFO, "%a: %Lu blocking, %Lu non-blocking requests, "
+    "%Lu bytes, max %u in flight of %u slots, %Lu slot waits, "
+    "%Lu bad completions\n", __FUNCTION__,
+    Dev->Statistics.BlockingRequests, Dev->Statistics.NonBlockingRequests,
+    Dev->Statistics.BytesTransferred, Dev->Statistics.MaxInFlight,
+    Dev->NumRequests, Dev->Statistics.SlotWaits,
+    Dev->Statistics.BadCompletions));
+}
+
+
+/**
+
+  Timer notification function that reaps completed non-blocking requests.
+
+  @param[in] Event    Event whose notification function is being invoked.
+
+  @param[in] Context  Pointer to the VSCSI_DEV structure.
+
+**/
+STATIC
+VOID
+EFIAPI
+VirtioScsiAsyncTimer (
+  IN  EFI_EVENT Event,
+  IN  VOID      *Context
+  )
+{
+  ReapRequests (Context);
+}
+
+
+/**
+
+  Wait until the device has completed every request in flight.
+
+  @param[in out] Dev  The virtio-scsi host device to drain.
+
+**/
+STATIC
+VOID
+DrainRequests (
+  IN OUT VSCSI_DEV *Dev
+  )
+{
+  EFI_TPL OldTpl;
+  UINTN   PollPeriodUsecs;
+  UINT16  NumInFlight;
+
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ReapRequests (Dev);
+    NumInFlight = Dev->NumInFlight;
+    gBS->RestoreTPL (OldTpl);
+    if (NumInFlight == 0) {
+      return;
+    }
+
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
+  }
+}
+
+
 //
 // The next seven functions implement EFI_EXT_SCSI_PASS_THRU_PROTOCOL
 // for the virtio-scsi HBA. Refer to UEFI Spec 2.3.1 + Errata C, sections
@@ -434,24 +667,25 @@ VirtioScsiPassThru (
   UINT16                    TargetValue;
   EFI_STATUS                Status;
   volatile VIRTIO_SCSI_REQ  Request;
-  volatile VIRTIO_SCSI_RESP *Response;
-  VOID                      *ResponseBuffer;
+  volatile VSCSI_SHARED_REQ *SharedReq;
+  VSCSI_REQUEST             *Slot;
   DESC_INDICES              Indices;
-  VOID                      *RequestMapping;
-  VOID                      *ResponseMapping;
   VOID                      *InDataMapping;
   VOID                      *OutDataMapping;
-  EFI_PHYSICAL_ADDRESS      RequestDeviceAddress;
-  EFI_PHYSICAL_ADDRESS      ResponseDeviceAddress;
+  EFI_PHYSICAL_ADDRESS      SharedReqDeviceAddress;
   EFI_PHYSICAL_ADDRESS      InDataDeviceAddress;
   EFI_PHYSICAL_ADDRESS      OutDataDeviceAddress;
   VOID                      *InDataBuffer;
   UINTN                     InDataNumPages;
-  BOOLEAN                   OutDataBufferIsMapped;
+  EFI_TPL                   OldTpl;
+  UINTN                     PollPeriodUsecs;
+  UINT16                    Index;
+  UINT16                    NextAvailIdx;
 
   //
-  // Set InDataMapping,OutDataMapping,InDataDeviceAddress and OutDataDeviceAddress to
-  // suppress incorrect compiler/analyzer warnings.
+  // FinishRequest() relies on NULL mappings for absent data buffers. Set
+  // InDataDeviceAddress and OutDataDeviceAddress to suppress incorrect
+  // compiler/analyzer warnings.
   //
   InDataMapping        = NULL;
   OutDataMapping       = NULL;
@@ -464,7 +698,6 @@ VirtioScsiPassThru (
   CopyMem (&TargetValue, Target, sizeof TargetValue);
 
   InDataBuffer = NULL;
-  OutDataBufferIsMapped = FALSE;
   InDataNumPages = 0;
 
   Status = PopulateRequest (Dev, TargetValue, Lun, Packet, &Request);
@@ -472,20 +705,6 @@ VirtioScsiPassThru (
     return Status;
   }
 
-  //
-  // Map the virtio-scsi Request header buffer
-  //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterRead,
-             (VOID *) &Request,
-             sizeof Request,
-             &RequestDeviceAddress,
-             &RequestMapping);
-  if (EFI_ERROR (Status)) {
-    return ReportHostAdapterError (Packet);
-  }
-
   //
   // Map the input buffer
   //
@@ -505,6 +724,11 @@ VirtioScsiPassThru (
     // the Virtio request is successful then we copy the data from temporary
     // buffer into Packet->InDataBuffer.
     //
+    // Read-only requests go through the intermediate buffer as well. Mapping
+    // the caller's buffer directly with BusMasterWrite would let the unmap
+    // copy the whole mapped length back from a bounce buffer, overwriting the
+    // caller's memory beyond the InTransferLength the device reported.
+    //
     InDataNumPages = EFI_SIZE_TO_PAGES ((UINTN)Packet->InTransferLength);
     Status = Dev->VirtIo->AllocateSharedPages (
                             Dev->VirtIo,
@@ -512,8 +736,7 @@ VirtioScsiPassThru (
                             &InDataBuffer
                             );
     if (EFI_ERROR (Status)) {
-      Status = ReportHostAdapterError (Packet);
-      goto UnmapRequestBuffer;
+      return ReportHostAdapterError (Packet);
     }
 
     ZeroMem (InDataBuffer, Packet->InTransferLength);
@@ -548,66 +771,67 @@ VirtioScsiPassThru (
       Status = ReportHostAdapterError (Packet);
       goto UnmapInDataBuffer;
     }
-
-    OutDataBufferIsMapped = TRUE;
-  }
-
-  //
-  // Response header is bi-direction (we preset with host status and expect
-  // the device to update it). Allocate a response buffer which can be mapped
-  // to access equally by both processor and device.
-  //
-  Status = Dev->VirtIo->AllocateSharedPages (
-                          Dev->VirtIo,
-                          EFI_SIZE_TO_PAGES (sizeof *Response),
-                          &ResponseBuffer
-                          );
-  if (EFI_ERROR (Status)) {
-    Status = ReportHostAdapterError (Packet);
-    goto UnmapOutDataBuffer;
   }
 
-  Response = ResponseBuffer;
-
-  ZeroMem ((VOID *)Response, sizeof (*Response));
-
   //
-  // preset a host status for ourselves that we do not accept as success
+  // Claim a free request slot. The ring is only ever touched at TPL_NOTIFY,
+  // so that the timer reaping non-blocking requests cannot interleave.
   //
-  Response->Response = VIRTIO_SCSI_S_FAILURE;
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    for (Index = 0; Index < Dev->NumRequests; Index++) {
+      if (!Dev->Requests[Index].InUse) {
+        break;
+      }
+    }
+    if (Index < Dev->NumRequests) {
+      break;
+    }
 
-  //
-  // Map the response buffer with BusMasterCommonBuffer so that response
-  // buffer can be accessed by both host and device.
-  //
-  Status = VirtioMapAllBytesInSharedBuffer (
-             Dev->VirtIo,
-             VirtioOperationBusMasterCommonBuffer,
-             ResponseBuffer,
-             sizeof (*Response),
-             &ResponseDeviceAddress,
-             &ResponseMapping
-             );
-  if (EFI_ERROR (Status)) {
-    Status = ReportHostAdapterError (Packet);
-    goto FreeResponseBuffer;
+    if (PollPeriodUsecs == 1) {
+      Dev->Statistics.SlotWaits++;
+    }
+    ReapRequests (Dev);
+    gBS->RestoreTPL (OldTpl);
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
   }
 
-  VirtioPrepare (&Dev->Ring, &Indices);
+  Slot                 = &Dev->Requests[Index];
+  Slot->InUse          = TRUE;
+  Slot->Done           = FALSE;
+  Slot->Abandoned      = FALSE;
+  Slot->Packet         = Packet;
+  Slot->Event          = Event;
+  Slot->InDataBuffer   = InDataBuffer;
+  Slot->InDataNumPages = InDataNumPages;
+  Slot->InDataMapping  = InDataMapping;
+  Slot->OutDataMapping = OutDataMapping;
 
   //
-  // ensured by VirtioScsiInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // Copy the request header to the slot's shared area, and preset a host
+  // status for ourselves that we do not accept as success.
   //
-  ASSERT (Dev->Ring.QueueSize >= 4);
+  SharedReq = &Dev->SharedReqs[Index];
+  CopyMem ((VOID *) &SharedReq->Request, (VOID *) &Request, sizeof Request);
+  ZeroMem ((VOID *) &SharedReq->Response, sizeof SharedReq->Response);
+  SharedReq->Response.Response = VIRTIO_SCSI_S_FAILURE;
+  SharedReqDeviceAddress = Dev->SharedReqsDeviceAddress +
+                           Index * sizeof (VSCSI_SHARED_REQ);
+
+  Indices.HeadDescIdx = (UINT16) (Index * VSCSI_DESC_PER_REQUEST);
+  Indices.NextDescIdx = Indices.HeadDescIdx;
 
   //
   // enqueue Request
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    RequestDeviceAddress,
-    sizeof Request,
+    SharedReqDeviceAddress + OFFSET_OF (VSCSI_SHARED_REQ, Request),
+    sizeof (VIRTIO_SCSI_REQ),
     VRING_DESC_F_NEXT,
     &Indices
     );
@@ -630,8 +854,8 @@ VirtioScsiPassThru (
   //
   VirtioAppendDesc (
     &Dev->Ring,
-    ResponseDeviceAddress,
-    sizeof *Response,
+    SharedReqDeviceAddress + OFFSET_OF (VSCSI_SHARED_REQ, Response),
+    sizeof (VIRTIO_SCSI_RESP),
     VRING_DESC_F_WRITE | (Packet->InTransferLength > 0 ? VRING_DESC_F_NEXT : 0),
     &Indices
     );
@@ -649,44 +873,90 @@ VirtioScsiPassThru (
       );
   }
 
-  // If kicking the host fails, we must fake a host adapter error.
-  // EFI_NOT_READY would save us the effort, but it would also suggest that the
-  // caller retry.
   //
-  if (VirtioFlush (Dev->VirtIo, VIRTIO_SCSI_REQUEST_QUEUE, &Dev->Ring,
-        &Indices, NULL) != EFI_SUCCESS) {
-    Status = ReportHostAdapterError (Packet);
-    goto UnmapResponseBuffer;
+  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring, and 2.4.1.3 Updating
+  // the Index Field. Each entry in the Available Ring references only the
+  // head descriptor of the chain.
+  //
+  NextAvailIdx = *Dev->Ring.Avail.Idx;
+  Dev->Ring.Avail.Ring[NextAvailIdx++ % Dev->Ring.QueueSize] =
+    Indices.HeadDescIdx;
+  MemoryFence ();
+  *Dev->Ring.Avail.Idx = NextAvailIdx;
+  Dev->NumInFlight++;
+  Dev->Statistics.MaxInFlight = MAX (Dev->Statistics.MaxInFlight,
+                                     Dev->NumInFlight);
+  Dev->Statistics.BytesTransferred += (UINT64) Packet->InTransferLength +
+                                      Packet->OutTransferLength;
+  if (Event != NULL) {
+    Dev->Statistics.NonBlockingRequests++;
+  } else {
+    Dev->Statistics.BlockingRequests++;
+  }
+  if (Event != NULL && Dev->NumAsyncInFlight++ == 0) {
+    gBS->SetTimer (Dev->AsyncTimer, TimerPeriodic, VSCSI_ASYNC_POLL_INTERVAL);
   }
-
-  Status = ParseResponse (Packet, Response);
 
   //
-  // If virtio request was successful and it was a CPU read request then we
-  // have used an intermediate buffer. Copy the data from intermediate buffer
-  // to the final buffer.
+  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- gratuitous notifications
+  // are OK.
   //
-  if (InDataBuffer != NULL) {
-    CopyMem (Packet->InDataBuffer, InDataBuffer, Packet->InTransferLength);
+  // If kicking the host fails, we must fake a host adapter error.
+  // EFI_NOT_READY would save us the effort, but it would also suggest that the
+  // caller retry. The chain is already visible to the device and cannot be
+  // taken back, so abandon it: its resources are released whenever the device
+  // completes it, and the caller's packet is not touched again.
+  //
+  MemoryFence ();
+  if (Dev->VirtIo->SetQueueNotify (Dev->VirtIo,
+                     VIRTIO_SCSI_REQUEST_QUEUE) != EFI_SUCCESS) {
+    if (Event != NULL) {
+      Slot->Event = NULL;
+      if (--Dev->NumAsyncInFlight == 0) {
+        gBS->SetTimer (Dev->AsyncTimer, TimerCancel, 0);
+      }
+    }
+    Slot->Packet    = NULL;
+    Slot->Abandoned = TRUE;
+    gBS->RestoreTPL (OldTpl);
+    return ReportHostAdapterError (Packet);
   }
+  gBS->RestoreTPL (OldTpl);
 
-UnmapResponseBuffer:
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, ResponseMapping);
+  if (Event != NULL) {
+    //
+    // Non-blocking request: the packet is updated and Event is signaled once
+    // the device is done.
+    //
+    return EFI_SUCCESS;
+  }
 
-FreeResponseBuffer:
-  Dev->VirtIo->FreeSharedPages (
-                 Dev->VirtIo,
-                 EFI_SIZE_TO_PAGES (sizeof *Response),
-                 ResponseBuffer
-                 );
+  //
+  // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
+  // Keep slowing down until we reach a poll period of slightly above 1 ms.
+  //
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ReapRequests (Dev);
+    if (Slot->Done) {
+      Status       = Slot->Status;
+      Slot->Done   = FALSE;
+      Slot->Packet = NULL;
+      Slot->InUse  = FALSE;
+      gBS->RestoreTPL (OldTpl);
+      return Status;
+    }
+    gBS->RestoreTPL (OldTpl);
 
-UnmapOutDataBuffer:
-  if (OutDataBufferIsMapped) {
-    Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, OutDataMapping);
+    gBS->Stall (PollPeriodUsecs); // calls AcpiTimerLib::MicroSecondDelay
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
   }
 
 UnmapInDataBuffer:
-  if (InDataBuffer != NULL) {
+  if (InDataMapping != NULL) {
     Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, InDataMapping);
   }
 
@@ -695,9 +965,6 @@ FreeInDataBuffer:
     Dev->VirtIo->FreeSharedPages (Dev->VirtIo, InDataNumPages, InDataBuffer);
   }
 
-UnmapRequestBuffer:
-  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, RequestMapping);
-
   return Status;
 }
 
@@ -930,6 +1197,7 @@ VirtioScsiInit (
   UINT16     MaxChannel; // for validation only
   UINT32     NumQueues;  // for validation only
   UINT16     QueueSize;
+  VOID       *SharedReqsBuffer;
 
   //
   // Execute virtio-0.9.5, 2.2.1 Device Initialization Sequence.
@@ -1045,9 +1313,9 @@ VirtioScsiInit (
     goto Failed;
   }
   //
-  // VirtioScsiPassThru() uses at most four descriptors
+  // VirtioScsiPassThru() uses at most four descriptors per request
   //
-  if (QueueSize < 4) {
+  if (QueueSize < VSCSI_DESC_PER_REQUEST) {
     Status = EFI_UNSUPPORTED;
     goto Failed;
   }
@@ -1070,18 +1338,55 @@ VirtioScsiInit (
     goto ReleaseQueue;
   }
 
+  //
+  // Allocate and map the request headers and responses of all request slots
+  // once, as a common buffer shared with the device. If anything fails from
+  // here on, we must unmap the ring resources.
+  //
+  Dev->NumRequests = (UINT16) MIN (QueueSize / VSCSI_DESC_PER_REQUEST,
+                                   VSCSI_MAX_REQUESTS);
+  Status = Dev->VirtIo->AllocateSharedPages (
+                          Dev->VirtIo,
+                          EFI_SIZE_TO_PAGES (sizeof (VSCSI_SHARED_REQ) *
+                                             VSCSI_MAX_REQUESTS),
+                          &SharedReqsBuffer
+                          );
+  if (EFI_ERROR (Status)) {
+    goto UnmapQueue;
+  }
+
+  Status = VirtioMapAllBytesInSharedBuffer (
+             Dev->VirtIo,
+             VirtioOperationBusMasterCommonBuffer,
+             SharedReqsBuffer,
+             sizeof (VSCSI_SHARED_REQ) * VSCSI_MAX_REQUESTS,
+             &Dev->SharedReqsDeviceAddress,
+             &Dev->SharedReqsMap
+             );
+  if (EFI_ERROR (Status)) {
+    goto FreeSharedReqs;
+  }
+  Dev->SharedReqs = SharedReqsBuffer;
+
+  //
+  // We're going to poll for the answers, the host should not send
+  // interrupts.
+  //
+  *Dev->Ring.Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
-  // size. If anything fails from here on, we must unmap the ring resources.
+  // size. If anything fails from here on, we must unmap the shared request
+  // area.
   //
   Status = Dev->VirtIo->SetQueueNum (Dev->VirtIo, QueueSize);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   Status = Dev->VirtIo->SetQueueAlign (Dev->VirtIo, EFI_PAGE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -1093,7 +1398,7 @@ VirtioScsiInit (
                           RingBaseShift
                           );
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -1103,7 +1408,7 @@ VirtioScsiInit (
     Features &= ~(UINT64)(VIRTIO_F_VERSION_1 | VIRTIO_F_IOMMU_PLATFORM);
     Status = Dev->VirtIo->SetGuestFeatures (Dev->VirtIo, Features);
     if (EFI_ERROR (Status)) {
-      goto UnmapQueue;
+      goto UnmapSharedReqs;
     }
   }
 
@@ -1113,11 +1418,11 @@ VirtioScsiInit (
   //
   Status = VIRTIO_CFG_WRITE (Dev, CdbSize, VIRTIO_SCSI_CDB_SIZE);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
   Status = VIRTIO_CFG_WRITE (Dev, SenseSize, VIRTIO_SCSI_SENSE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -1126,7 +1431,7 @@ VirtioScsiInit (
   NextDevStat |= VSTAT_DRIVER_OK;
   Status = Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, NextDevStat);
   if (EFI_ERROR (Status)) {
-    goto UnmapQueue;
+    goto UnmapSharedReqs;
   }
 
   //
@@ -1150,18 +1455,35 @@ VirtioScsiInit (
   //
   // Set both physical and logical attributes for non-RAID SCSI channel. See
   // Driver Writer's Guide for UEFI 2.3.1 v1.01, 20.1.5 Implementing Extended
-  // SCSI Pass Thru Protocol.
+  // SCSI Pass Thru Protocol. Advertise non-blocking I/O so that the SCSI bus
+  // driver forwards the caller's event instead of emulating it.
   //
   Dev->PassThruMode.Attributes = EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_PHYSICAL |
-                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL;
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL |
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO;
 
   //
   // no restriction on transfer buffer alignment
   //
   Dev->PassThruMode.IoAlign = 0;
 
+  DEBUG ((DEBUG_INFO, "%a: QueueSize=%d MaxRequestsInFlight=%d\n",
+    __FUNCTION__, QueueSize, Dev->NumRequests));
+
   return EFI_SUCCESS;
 
+UnmapSharedReqs:
+  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->SharedReqsMap);
+  Dev->SharedReqs = NULL;
+
+FreeSharedReqs:
+  Dev->VirtIo->FreeSharedPages (
+                 Dev->VirtIo,
+                 EFI_SIZE_TO_PAGES (sizeof (VSCSI_SHARED_REQ) *
+                                    VSCSI_MAX_REQUESTS),
+                 SharedReqsBuffer
+                 );
+
 UnmapQueue:
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
 
@@ -1204,6 +1526,15 @@ VirtioScsiUninit (
   Dev->MaxLun         = 0;
   Dev->MaxSectors     = 0;
 
+  Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->SharedReqsMap);
+  Dev->VirtIo->FreeSharedPages (
+                 Dev->VirtIo,
+                 EFI_SIZE_TO_PAGES (sizeof (VSCSI_SHARED_REQ) *
+                                    VSCSI_MAX_REQUESTS),
+                 (VOID *) Dev->SharedReqs
+                 );
+  Dev->SharedReqs = NULL;
+
   Dev->VirtIo->UnmapSharedBuffer (Dev->VirtIo, Dev->RingMap);
   VirtioRingUninit (Dev->VirtIo, &Dev->Ring);
 
@@ -1235,6 +1566,7 @@ VirtioScsiExitBoot (
   // executing after ExitBootServices() is permitted to overwrite it.
   //
   Dev = Context;
+  DumpStatistics (Dev);
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 }
 
@@ -1321,12 +1653,18 @@ VirtioScsiDriverBindingStart (
     goto FreeVirtioScsi;
   }
 
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY,
+                  &VirtioScsiAsyncTimer, Dev, &Dev->AsyncTimer);
+  if (EFI_ERROR (Status)) {
+    goto CloseVirtIo;
+  }
+
   //
   // VirtIo access granted, configure virtio-scsi device.
   //
   Status = VirtioScsiInit (Dev);
   if (EFI_ERROR (Status)) {
-    goto CloseVirtIo;
+    goto CloseAsyncTimer;
   }
 
   Status = gBS->CreateEvent (EVT_SIGNAL_EXIT_BOOT_SERVICES, TPL_CALLBACK,
@@ -1355,6 +1693,9 @@ CloseExitBoot:
 UninitDev:
   VirtioScsiUninit (Dev);
 
+CloseAsyncTimer:
+  gBS->CloseEvent (Dev->AsyncTimer);
+
 CloseVirtIo:
   gBS->CloseProtocol (DeviceHandle, &gVirtioDeviceProtocolGuid,
          This->DriverBindingHandle, DeviceHandle);
@@ -1402,10 +1743,19 @@ VirtioScsiDriverBindingStop (
     return Status;
   }
 
+  //
+  // Complete the non-blocking requests still on the ring before the ring goes
+  // away.
+  //
+  DrainRequests (Dev);
+  DumpStatistics (Dev);
+
   gBS->CloseEvent (Dev->ExitBoot);
 
   VirtioScsiUninit (Dev);
 
+  gBS->CloseEvent (Dev->AsyncTimer);
+
   gBS->CloseProtocol (DeviceHandle, &gVirtioDeviceProtocolGuid,
          This->DriverBindingHandle, DeviceHandle);
 
@@ -17,6 +17,7 @@
 #include <Protocol/ScsiPassThruExt.h>
 
 #include <IndustryStandard/Virtio.h>
+#include <IndustryStandard/VirtioScsi.h>
 
 
 //
@@ -36,6 +37,66 @@
 
 #define VSCSI_SIG SIGNATURE_32 ('V', 'S', 'C', 'S')
 
+//
+// Every request occupies a fixed group of descriptors in the descriptor
+// table: request header, "dataout", response and "datain" (the data
+// descriptors are present only when needed). Request slot N owns descriptors
+// [N * VSCSI_DESC_PER_REQUEST, ...], so the head descriptor index reported in
+// the used ring identifies the slot.
+//
+#define VSCSI_DESC_PER_REQUEST 4
+
+//
+// Upper limit on requests in flight on the request queue. The actual limit is
+// further capped by the queue size the device offers.
+//
+#define VSCSI_MAX_REQUESTS     16
+
+//
+// Period of the timer that reaps completed non-blocking requests.
+//
+#define VSCSI_ASYNC_POLL_INTERVAL EFI_TIMER_PERIOD_MILLISECONDS (1)
+
+//
+// Per-slot area shared with the device: the request header, read by the
+// device, and the response, written by the device.
+//
+#pragma pack(1)
+typedef struct {
+  VIRTIO_SCSI_REQ  Request;
+  VIRTIO_SCSI_RESP Response;
+} VSCSI_SHARED_REQ;
+#pragma pack()
+
+//
+// Driver-side bookkeeping of one request slot.
+//
+typedef struct {
+  BOOLEAN                                    InUse;     // Slot is owned by a request
+  BOOLEAN                                    Done;      // Device completed a blocking request
+  BOOLEAN                                    Abandoned; // Submitter gave up on the request
+  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet;   // NULL once abandoned
+  EFI_EVENT                                  Event;     // NULL for blocking requests
+  VOID                                       *InDataBuffer;   // Intermediate "datain" buffer
+  UINTN                                      InDataNumPages;
+  VOID                                       *InDataMapping;
+  VOID                                       *OutDataMapping;
+  EFI_STATUS                                 Status;    // Result of a completed blocking request
+} VSCSI_REQUEST;
+
+//
+// Request counters, reported when the device is stopped or boot services are
+// exited.
+//
+typedef struct {
+  UINT64 BlockingRequests;    // Requests whose caller polled
+  UINT64 NonBlockingRequests; // Requests with an event
+  UINT64 BytesTransferred;    // Data bytes of all requests, both directions
+  UINT64 SlotWaits;           // Submissions that found no free slot
+  UINT64 BadCompletions;      // Used ring entries not matching a request
+  UINT16 MaxInFlight;         // Most requests on the ring at once
+} VSCSI_STATISTICS;
+
 typedef struct {
   //
   // Parts of this structure are initialized / torn down in various functions
@@ -47,6 +108,7 @@ typedef struct {
   UINT32                          Signature;      // DriverBindingStart  0
   VIRTIO_DEVICE_PROTOCOL          *VirtIo;        // DriverBindingStart  0
   EFI_EVENT                       ExitBoot;       // DriverBindingStart  0
+  EFI_EVENT                       AsyncTimer;     // DriverBindingStart  0
   BOOLEAN                         InOutSupported; // VirtioScsiInit      1
   UINT16                          MaxTarget;      // VirtioScsiInit      1
   UINT32                          MaxLun;         // VirtioScsiInit      1
@@ -55,6 +117,15 @@ typedef struct {
   EFI_EXT_SCSI_PASS_THRU_PROTOCOL PassThru;       // VirtioScsiInit      1
   EFI_EXT_SCSI_PASS_THRU_MODE     PassThruMode;   // VirtioScsiInit      1
   VOID                            *RingMap;       // VirtioRingMap       2
+  volatile VSCSI_SHARED_REQ       *SharedReqs;    // VirtioScsiInit      1
+  EFI_PHYSICAL_ADDRESS            SharedReqsDeviceAddress; // VirtioScsiInit 1
+  VOID                            *SharedReqsMap; // VirtioScsiInit      1
+  UINT16                          NumRequests;    // VirtioScsiInit      1
+  UINT16                          LastUsedIdx;    // VirtioScsiInit      1
+  UINT16                          NumInFlight;    // VirtioScsiInit      1
+  UINT16                          NumAsyncInFlight; // VirtioScsiInit    1
+  VSCSI_REQUEST                   Requests[VSCSI_MAX_REQUESTS]; // VirtioScsiInit 1
+  VSCSI_STATISTICS                Statistics;     // DriverBindingStart  0
 } VSCSI_DEV;
 
 #define VIRTIO_SCSI_FROM_PASS_THRU(PassThruPointer) \
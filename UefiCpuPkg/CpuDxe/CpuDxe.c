@@ -96,6 +96,11 @@ EFI_CPU_ARCH_PROTOCOL  gCpu = {
   4                           // DmaBufferAlignment
 };
 
+EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL  mMemoryAttributeBatch = {
+  CpuBeginMemoryAttributesBatch,
+  CpuCommitMemoryAttributesBatch
+};
+
 //
 // CPU Arch Protocol Functions
 //
@@ -499,6 +504,47 @@ CpuSetMemoryAttributes (
   return AssignMemoryPageAttributes (NULL, BaseAddress, Length, MemoryAttributes, NULL);
 }
 
+/**
+  Start a batch of memory attribute updates.
+
+  Until the outermost batch is committed, the page attribute part of
+  CpuSetMemoryAttributes() is only queued.
+
+  @param  This                   Protocol instance structure
+
+  @retval EFI_SUCCESS            The batch was started.
+
+**/
+EFI_STATUS
+EFIAPI
+CpuBeginMemoryAttributesBatch (
+  IN EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  )
+{
+  BeginMemoryPageAttributesBatch ();
+  return EFI_SUCCESS;
+}
+
+/**
+  Commit a batch of memory attribute updates.
+
+  @param  This                   Protocol instance structure
+
+  @retval EFI_SUCCESS            The batch was committed.
+  @retval EFI_NOT_STARTED        There is no batch in progress.
+  @retval others                 One or more queued updates could not be
+                                 applied.
+
+**/
+EFI_STATUS
+EFIAPI
+CpuCommitMemoryAttributesBatch (
+  IN EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  )
+{
+  return CommitMemoryPageAttributesBatch ();
+}
+
 /**
   Initializes the valid bits mask and valid address mask for MTRRs.
 
@@ -1184,6 +1230,7 @@ InitializeCpu (
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mCpuHandle,
                   &gEfiCpuArchProtocolGuid, &gCpu,
+                  &gEdkiiMemoryAttributeBatchProtocolGuid, &mMemoryAttributeBatch,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -13,6 +13,7 @@
 
 #include <Protocol/Cpu.h>
 #include <Protocol/MpService.h>
+#include <Protocol/MemoryAttributeBatch.h>
 #include <Register/Intel/Msr.h>
 
 #include <Ppi/SecPlatformInformation.h>
@@ -232,6 +233,37 @@ CpuSetMemoryAttributes (
   IN UINT64                     Attributes
   );
 
+/**
+  Start a batch of memory attribute updates.
+
+  @param  This                   Protocol instance structure
+
+  @retval EFI_SUCCESS            The batch was started.
+
+**/
+EFI_STATUS
+EFIAPI
+CpuBeginMemoryAttributesBatch (
+  IN EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  );
+
+/**
+  Commit a batch of memory attribute updates.
+
+  @param  This                   Protocol instance structure
+
+  @retval EFI_SUCCESS            The batch was committed.
+  @retval EFI_NOT_STARTED        There is no batch in progress.
+  @retval others                 One or more queued updates could not be
+                                 applied.
+
+**/
+EFI_STATUS
+EFIAPI
+CpuCommitMemoryAttributesBatch (
+  IN EDKII_MEMORY_ATTRIBUTE_BATCH_PROTOCOL   *This
+  );
+
 /**
   Initialize Global Descriptor Table.
 
@@ -57,6 +57,8 @@
 #define PAGING_1G_ADDRESS_MASK_64 0x000FFFFFC0000000ull
 
 #define MAX_PF_ENTRY_COUNT        10
+#define MAX_BATCH_REQUEST_COUNT   64
+#define MAX_BATCH_SPLIT_COUNT     128
 #define MAX_DEBUG_MESSAGE_LENGTH  0x100
 #define IA32_PF_EC_ID             BIT4
 
@@ -79,6 +81,26 @@ typedef enum {
   PageActionClear,
 } PAGE_ACTION;
 
+typedef struct {
+  PHYSICAL_ADDRESS BaseAddress;
+  UINT64           Length;
+  UINT64           Attributes;
+} PAGE_ATTRIBUTE_REQUEST;
+
+typedef struct {
+  UINT64           *PageEntry;
+  UINT64           *PageTable;
+  PAGE_ATTRIBUTE   PageAttribute;
+  BOOLEAN          Merged;
+} PAGE_TABLE_SPLIT;
+
+typedef struct {
+  UINT64           PageSplits;
+  UINT64           PageMerges;
+  UINT64           TlbFlushes;
+  UINT64           TlbFlushesDeferred;
+} PAGE_TABLE_STATISTICS;
+
 PAGE_ATTRIBUTE_TABLE mPageAttributeTable[] = {
   {Page4K,  SIZE_4KB, PAGING_4K_ADDRESS_MASK_64},
   {Page2M,  SIZE_2MB, PAGING_2M_ADDRESS_MASK_64},
@@ -90,6 +112,21 @@ BOOLEAN                           mPageTablePoolLock = FALSE;
 PAGE_TABLE_LIB_PAGING_CONTEXT     mPagingContext;
 EFI_SMM_BASE2_PROTOCOL            *mSmmBase2 = NULL;
 
+//
+// Page attribute updates queued by the current batch, the snapshot of them
+// being applied, the large pages split while applying them, and the page
+// table pages released by merging split pages back into large pages.
+//
+UINTN                             mPageAttributeBatchDepth = 0;
+PAGE_ATTRIBUTE_REQUEST            mPageAttributeRequests[MAX_BATCH_REQUEST_COUNT];
+UINTN                             mPageAttributeRequestCount = 0;
+PAGE_ATTRIBUTE_REQUEST            mAppliedPageAttributeRequests[MAX_BATCH_REQUEST_COUNT];
+BOOLEAN                           mPageAttributeRequestsApplying = FALSE;
+PAGE_TABLE_SPLIT                  mPageTableSplits[MAX_BATCH_SPLIT_COUNT];
+UINTN                             mPageTableSplitCount = 0;
+VOID                              *mFreePageTableList = NULL;
+PAGE_TABLE_STATISTICS             mPageTableStatistics;
+
 //
 // Record the page fault exception count for one instruction execution.
 //
@@ -703,6 +740,7 @@ ConvertMemoryPageAttributes (
   RETURN_STATUS                     Status;
   BOOLEAN                           IsEntryModified;
   BOOLEAN                           IsWpEnabled;
+  UINT64                            AddressEncMask;
 
   if ((BaseAddress & (SIZE_4KB - 1)) != 0) {
     DEBUG ((DEBUG_ERROR, "BaseAddress(0x%lx) is not aligned!\n", BaseAddress));
@@ -767,6 +805,8 @@ ConvertMemoryPageAttributes (
     AllocatePagesFunc = AllocatePageTableMemory;
   }
 
+  AddressEncMask = PcdGet64 (PcdPteMemoryEncryptionAddressOrMask) & PAGING_1G_ADDRESS_MASK_64;
+
   //
   // Make sure that the page table is changeable.
   //
@@ -809,6 +849,18 @@ ConvertMemoryPageAttributes (
         Status = RETURN_UNSUPPORTED;
         goto Done;
       }
+      mPageTableStatistics.PageSplits++;
+      if (mPageAttributeRequestsApplying && (mPageTableSplitCount < MAX_BATCH_SPLIT_COUNT)) {
+        //
+        // Only the page tables split by the current batch are candidates for
+        // merging when the batch has been applied.
+        //
+        mPageTableSplits[mPageTableSplitCount].PageEntry     = PageEntry;
+        mPageTableSplits[mPageTableSplitCount].PageTable     = (UINT64 *)(UINTN)(*PageEntry & ~AddressEncMask & PAGING_4K_ADDRESS_MASK_64);
+        mPageTableSplits[mPageTableSplitCount].PageAttribute = PageAttribute;
+        mPageTableSplits[mPageTableSplitCount].Merged        = FALSE;
+        mPageTableSplitCount++;
+      }
       if (IsSplitted != NULL) {
         *IsSplitted = TRUE;
       }
@@ -832,6 +884,314 @@ Done:
   return Status;
 }
 
+/**
+  This function merges one page entry split by the current batch back into a
+  large page entry if all the small page entries map contiguous memory with
+  the same attributes, including the memory encryption bit.
+
+  The page table page which is no longer used is not put into the free list of
+  page table memory here. Caller must flush the TLB first.
+
+  @param[in]  Split             The page split recorded by the current batch.
+
+  @retval TRUE    The page entry is merged.
+  @retval FALSE   The page entry is not merged.
+**/
+BOOLEAN
+MergePage (
+  IN  PAGE_TABLE_SPLIT                  *Split
+  )
+{
+  UINT64   *PageEntry;
+  UINT64   *PageTable;
+  UINT64   AddressEncMask;
+  UINT64   AddressMask;
+  UINT64   EntryLength;
+  UINT64   BaseAddress;
+  UINT64   EncBits;
+  UINT64   Attributes;
+  UINT64   AccessedDirty;
+  UINTN    Index;
+
+  PageEntry = Split->PageEntry;
+  PageTable = Split->PageTable;
+
+  AddressEncMask = PcdGet64 (PcdPteMemoryEncryptionAddressOrMask) & PAGING_1G_ADDRESS_MASK_64;
+  if (((*PageEntry & IA32_PG_P) == 0) || ((*PageEntry & IA32_PG_PS) != 0) ||
+      ((UINT64 *)(UINTN)(*PageEntry & ~AddressEncMask & PAGING_4K_ADDRESS_MASK_64) != PageTable)) {
+    return FALSE;
+  }
+
+  if (Split->PageAttribute == Page2M) {
+    AddressMask = PAGING_4K_ADDRESS_MASK_64;
+    EntryLength = SIZE_4KB;
+  } else {
+    AddressMask = PAGING_2M_ADDRESS_MASK_64;
+    EntryLength = SIZE_2MB;
+  }
+
+  BaseAddress = PageTable[0] & ~AddressEncMask & AddressMask;
+  EncBits     = PageTable[0] & AddressEncMask;
+  Attributes  = PageTable[0] & ~AddressMask & ~(UINT64)(IA32_PG_A | IA32_PG_D);
+  if ((BaseAddress & (PageAttributeToLength (Split->PageAttribute) - 1)) != 0) {
+    return FALSE;
+  }
+  if ((Split->PageAttribute == Page1G) && ((Attributes & IA32_PG_PS) == 0)) {
+    return FALSE;
+  }
+
+  //
+  // Accessed and dirty bits are maintained by the processor per entry, so
+  // ignore them in the comparison and carry them over to the large page.
+  //
+  AccessedDirty = 0;
+  for (Index = 0; Index < SIZE_4KB / sizeof(UINT64); Index++) {
+    if ((PageTable[Index] & ~AddressEncMask & AddressMask) != BaseAddress + EntryLength * Index ||
+        (PageTable[Index] & AddressEncMask) != EncBits ||
+        (PageTable[Index] & ~AddressMask & ~(UINT64)(IA32_PG_A | IA32_PG_D)) != Attributes) {
+      return FALSE;
+    }
+    AccessedDirty |= PageTable[Index] & (IA32_PG_A | IA32_PG_D);
+  }
+
+  if (Split->PageAttribute == Page2M) {
+    //
+    // The PAT bit moves from bit 7 in a 4K page entry to bit 12 in a 2M one.
+    //
+    if ((Attributes & IA32_PG_PAT_4K) != 0) {
+      Attributes = (Attributes & ~(UINT64)IA32_PG_PAT_4K) | IA32_PG_PAT_2M;
+    }
+    Attributes |= IA32_PG_PS;
+  }
+
+  *PageEntry = BaseAddress | EncBits | Attributes | AccessedDirty;
+  DEBUG ((DEBUG_VERBOSE, "Merge - 0x%x\n", PageTable));
+
+  mPageTableStatistics.PageMerges++;
+  return TRUE;
+}
+
+/**
+  This function merges the pages split by the current batch back into large
+  pages wherever possible.
+
+  2M pages are merged first, so that the 2M page tables split from 1G pages
+  can be merged afterwards. Page tables which were not split by the current
+  batch are left alone.
+
+  @param[in]  PagingContext     The paging context.
+
+  @retval TRUE    At least one page entry is merged.
+  @retval FALSE   No page entry is merged.
+**/
+BOOLEAN
+MergeSplitPages (
+  IN  PAGE_TABLE_LIB_PAGING_CONTEXT     *PagingContext
+  )
+{
+  UINTN                 Index;
+  BOOLEAN               IsMerged;
+
+  IsMerged = FALSE;
+  for (Index = 0; Index < mPageTableSplitCount; Index++) {
+    if (mPageTableSplits[Index].PageAttribute == Page2M) {
+      mPageTableSplits[Index].Merged = MergePage (&mPageTableSplits[Index]);
+      IsMerged |= mPageTableSplits[Index].Merged;
+    }
+  }
+
+  //
+  // 1G pages are only available in 64-bit mode and when supported by the processor.
+  //
+  if ((PagingContext->MachineType != IMAGE_FILE_MACHINE_X64) ||
+      ((PagingContext->ContextData.X64.Attributes & PAGE_TABLE_LIB_PAGING_CONTEXT_IA32_X64_ATTRIBUTES_PAGE_1G_SUPPORT) == 0)) {
+    return IsMerged;
+  }
+  for (Index = 0; Index < mPageTableSplitCount; Index++) {
+    if (mPageTableSplits[Index].PageAttribute == Page1G) {
+      mPageTableSplits[Index].Merged = MergePage (&mPageTableSplits[Index]);
+      IsMerged |= mPageTableSplits[Index].Merged;
+    }
+  }
+  return IsMerged;
+}
+
+/**
+  Put the page table pages released by merging into the free list of page
+  table memory. Caller must have flushed the TLB, since the first entry of
+  each page is overwritten by the list link.
+**/
+VOID
+ReleaseMergedPageTables (
+  VOID
+  )
+{
+  UINTN                 Index;
+  VOID                  *PageTable;
+
+  for (Index = 0; Index < mPageTableSplitCount; Index++) {
+    if (mPageTableSplits[Index].Merged) {
+      PageTable           = mPageTableSplits[Index].PageTable;
+      *(VOID **)PageTable = mFreePageTableList;
+      mFreePageTableList  = PageTable;
+    }
+  }
+  mPageTableSplitCount = 0;
+}
+
+/**
+  Apply the page attribute updates queued by the current batch.
+
+  The updates are applied in the order they were queued. Then the split pages
+  covering the updated regions are merged back into large pages where the
+  attributes have converged, and the TLB is flushed once.
+
+  The queue is emptied before the updates are applied. Splitting a large page
+  allocates page table memory, which may update page attributes again; these
+  nested updates are applied directly instead of being queued.
+
+  @retval RETURN_SUCCESS  All the queued updates were applied.
+  @retval others          The error returned by the first failed update.
+**/
+RETURN_STATUS
+ApplyPageAttributeRequests (
+  VOID
+  )
+{
+  PAGE_TABLE_LIB_PAGING_CONTEXT     PagingContext;
+  RETURN_STATUS                     Status;
+  RETURN_STATUS                     RequestStatus;
+  BOOLEAN                           IsModified;
+  BOOLEAN                           IsEntryModified;
+  BOOLEAN                           IsWpEnabled;
+  BOOLEAN                           IsMerged;
+  UINTN                             Index;
+  UINTN                             RequestCount;
+
+  ASSERT (!mPageAttributeRequestsApplying);
+  mPageAttributeRequestsApplying = TRUE;
+
+  RequestCount = mPageAttributeRequestCount;
+  CopyMem (
+    mAppliedPageAttributeRequests,
+    mPageAttributeRequests,
+    RequestCount * sizeof (PAGE_ATTRIBUTE_REQUEST)
+    );
+  mPageAttributeRequestCount = 0;
+  mPageTableSplitCount       = 0;
+
+  Status     = RETURN_SUCCESS;
+  IsModified = FALSE;
+  for (Index = 0; Index < RequestCount; Index++) {
+    RequestStatus = ConvertMemoryPageAttributes (
+                      NULL,
+                      mAppliedPageAttributeRequests[Index].BaseAddress,
+                      mAppliedPageAttributeRequests[Index].Length,
+                      mAppliedPageAttributeRequests[Index].Attributes,
+                      PageActionAssign,
+                      NULL,
+                      NULL,
+                      &IsEntryModified
+                      );
+    if (RETURN_ERROR (RequestStatus) && !RETURN_ERROR (Status)) {
+      Status = RequestStatus;
+    }
+    IsModified |= IsEntryModified;
+  }
+
+  if (IsModified) {
+    GetCurrentPagingContext (&PagingContext);
+    IsWpEnabled = IsReadOnlyPageWriteProtected ();
+    if (IsWpEnabled) {
+      DisableReadOnlyPageWriteProtect ();
+    }
+    IsMerged = MergeSplitPages (&PagingContext);
+
+    //
+    // Flush TLB once for the whole batch. See AssignMemoryPageAttributes() for
+    // the reason why the APs need not be flushed here. The merged page tables
+    // may still be cached until then, so release them only after the flush.
+    //
+    CpuFlushTlb ();
+    mPageTableStatistics.TlbFlushes++;
+    if (IsMerged) {
+      ReleaseMergedPageTables ();
+    }
+    if (IsWpEnabled) {
+      EnableReadOnlyPageWriteProtect ();
+    }
+  }
+  mPageTableSplitCount = 0;
+
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "Paging: batch of %Lu requests - splits %ld, merges %ld, TLB flushes %ld (%ld deferred)\n",
+    (UINT64) RequestCount,
+    mPageTableStatistics.PageSplits,
+    mPageTableStatistics.PageMerges,
+    mPageTableStatistics.TlbFlushes,
+    mPageTableStatistics.TlbFlushesDeferred
+    ));
+
+  mPageAttributeRequestsApplying = FALSE;
+  return Status;
+}
+
+/**
+  Queue a page attribute update in the current batch.
+
+  Requests with the same attributes which are adjacent to or overlap the last
+  queued request are coalesced into it. If the queue is full, the queued
+  requests are applied first.
+
+  @param[in]  BaseAddress       The physical address that is the start address of a memory region.
+  @param[in]  Length            The size in bytes of the memory region.
+  @param[in]  Attributes        The bit mask of attributes to set for the memory region.
+
+  @retval RETURN_SUCCESS  The request was queued.
+  @retval others          The queue was full and applying it failed.
+**/
+RETURN_STATUS
+QueuePageAttributeRequest (
+  IN  PHYSICAL_ADDRESS                  BaseAddress,
+  IN  UINT64                            Length,
+  IN  UINT64                            Attributes
+  )
+{
+  PAGE_ATTRIBUTE_REQUEST            *Request;
+  PHYSICAL_ADDRESS                  EndAddress;
+  RETURN_STATUS                     Status;
+
+  if (mPageAttributeRequestCount != 0) {
+    Request = &mPageAttributeRequests[mPageAttributeRequestCount - 1];
+    if ((Request->Attributes == Attributes) &&
+        (BaseAddress <= Request->BaseAddress + Request->Length) &&
+        (Request->BaseAddress <= BaseAddress + Length)) {
+      EndAddress           = MAX (Request->BaseAddress + Request->Length, BaseAddress + Length);
+      Request->BaseAddress = MIN (Request->BaseAddress, BaseAddress);
+      Request->Length      = EndAddress - Request->BaseAddress;
+      mPageTableStatistics.TlbFlushesDeferred++;
+      return RETURN_SUCCESS;
+    }
+  }
+
+  if (mPageAttributeRequestCount == MAX_BATCH_REQUEST_COUNT) {
+    Status = ApplyPageAttributeRequests ();
+    if (RETURN_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Request = &mPageAttributeRequests[mPageAttributeRequestCount++];
+  Request->BaseAddress = BaseAddress;
+  Request->Length      = Length;
+  Request->Attributes  = Attributes;
+  if (mPageAttributeRequestCount > 1) {
+    mPageTableStatistics.TlbFlushesDeferred++;
+  }
+  return RETURN_SUCCESS;
+}
+
 /**
   This function assigns the page attributes for the memory region specified by BaseAddress and
   Length from their current attributes to the attributes specified by Attributes.
@@ -875,6 +1235,19 @@ AssignMemoryPageAttributes (
   BOOLEAN        IsSplitted;
 
 //  DEBUG((DEBUG_INFO, "AssignMemoryPageAttributes: 0x%lx - 0x%lx (0x%lx)\n", BaseAddress, Length, Attributes));
+  //
+  // Queue the update if a batch is in progress. Invalid requests are not
+  // queued so that the error is reported right away. Updates made while the
+  // queued ones are being applied are applied directly.
+  //
+  if ((PagingContext == NULL) && (mPageAttributeBatchDepth != 0) &&
+      !mPageAttributeRequestsApplying &&
+      ((BaseAddress & (SIZE_4KB - 1)) == 0) && ((Length & (SIZE_4KB - 1)) == 0) && (Length != 0) &&
+      ((Attributes & ~(EFI_MEMORY_RP | EFI_MEMORY_RO | EFI_MEMORY_XP)) == 0) &&
+      !IsInSmm ()) {
+    return QueuePageAttributeRequest (BaseAddress, Length, Attributes);
+  }
+
   Status = ConvertMemoryPageAttributes (PagingContext, BaseAddress, Length, Attributes, PageActionAssign, AllocatePagesFunc, &IsSplitted, &IsModified);
   if (!EFI_ERROR(Status)) {
     if ((PagingContext == NULL) && IsModified) {
@@ -886,12 +1259,54 @@ AssignMemoryPageAttributes (
       // here.
       //
       CpuFlushTlb();
+      mPageTableStatistics.TlbFlushes++;
     }
   }
 
   return Status;
 }
 
+/**
+  Start a batch of page attribute updates on the current paging context.
+
+  Until the outermost batch is committed, AssignMemoryPageAttributes() only
+  queues the updates for the current paging context.
+**/
+VOID
+BeginMemoryPageAttributesBatch (
+  VOID
+  )
+{
+  mPageAttributeBatchDepth++;
+}
+
+/**
+  Commit a batch of page attribute updates on the current paging context.
+
+  When the outermost batch is committed, the queued updates are applied, the
+  split pages are merged back into large pages where possible and the TLB is
+  flushed once.
+
+  @retval RETURN_SUCCESS      The batch was committed.
+  @retval RETURN_NOT_STARTED  There is no batch in progress.
+  @retval others              The error returned by the first failed update.
+**/
+RETURN_STATUS
+CommitMemoryPageAttributesBatch (
+  VOID
+  )
+{
+  if (mPageAttributeBatchDepth == 0) {
+    return RETURN_NOT_STARTED;
+  }
+
+  mPageAttributeBatchDepth--;
+  if (mPageAttributeBatchDepth != 0 || mPageAttributeRequestCount == 0) {
+    return RETURN_SUCCESS;
+  }
+  return ApplyPageAttributeRequests ();
+}
+
 /**
  Check if Execute Disable feature is enabled or not.
 **/
@@ -1166,6 +1581,15 @@ AllocatePageTableMemory (
     return NULL;
   }
 
+  //
+  // Reuse the page table pages released by merging split pages.
+  //
+  if ((Pages == 1) && (mFreePageTableList != NULL)) {
+    Buffer             = mFreePageTableList;
+    mFreePageTableList = *(VOID **)Buffer;
+    return Buffer;
+  }
+
   //
   // Renew the pool if necessary.
   //
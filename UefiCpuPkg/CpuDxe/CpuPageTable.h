@@ -110,6 +110,33 @@ AssignMemoryPageAttributes (
   IN  PAGE_TABLE_LIB_ALLOCATE_PAGES     AllocatePagesFunc OPTIONAL
   );
 
+/**
+  Start a batch of page attribute updates on the current paging context.
+
+  Until the outermost batch is committed, AssignMemoryPageAttributes() only
+  queues the updates for the current paging context.
+**/
+VOID
+BeginMemoryPageAttributesBatch (
+  VOID
+  );
+
+/**
+  Commit a batch of page attribute updates on the current paging context.
+
+  When the outermost batch is committed, the queued updates are applied, the
+  split pages are merged back into large pages where possible and the TLB is
+  flushed once.
+
+  @retval RETURN_SUCCESS      The batch was committed.
+  @retval RETURN_NOT_STARTED  There is no batch in progress.
+  @retval others              The error returned by the first failed update.
+**/
+RETURN_STATUS
+CommitMemoryPageAttributesBatch (
+  VOID
+  );
+
 /**
   Initialize the Page Table lib.
 **/
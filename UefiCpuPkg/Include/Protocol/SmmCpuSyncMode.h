@@ -0,0 +1,49 @@
+/** @file
+  SMM CPU Sync Mode protocol definition.
+
+  This protocol lets an SMM driver select the method used to synchronize the
+  processors on SMIs at runtime. The initial method is PcdCpuSmmSyncMode.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SMM_CPU_SYNC_MODE_PROTOCOL_H_
+#define _SMM_CPU_SYNC_MODE_PROTOCOL_H_
+
+#define EDKII_SMM_CPU_SYNC_MODE_PROTOCOL_GUID \
+  { \
+    0x92bf346a, 0x4777, 0x40e2, { 0xa6, 0x95, 0x7d, 0x35, 0x60, 0x40, 0x62, 0x53 } \
+  }
+
+typedef struct _EDKII_SMM_CPU_SYNC_MODE_PROTOCOL EDKII_SMM_CPU_SYNC_MODE_PROTOCOL;
+
+/**
+  Select the method used to synchronize the processors on subsequent SMIs.
+
+  The new method takes effect when the current SMI run, if any, completes.
+
+  @param  This                 A pointer to the EDKII_SMM_CPU_SYNC_MODE_PROTOCOL instance.
+  @param  SyncMode             The synchronization method, encoded as PcdCpuSmmSyncMode.
+
+  @retval EFI_SUCCESS           The synchronization method was selected.
+  @retval EFI_INVALID_PARAMETER SyncMode is not a supported synchronization method.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SMM_CPU_SET_SYNC_MODE) (
+  IN CONST EDKII_SMM_CPU_SYNC_MODE_PROTOCOL  *This,
+  IN       UINT8                             SyncMode
+  );
+
+//
+//  This protocol selects the SMM CPU synchronization method.
+//
+struct _EDKII_SMM_CPU_SYNC_MODE_PROTOCOL {
+  EDKII_SMM_CPU_SET_SYNC_MODE         SetSyncMode;
+};
+
+extern EFI_GUID gEdkiiSmmCpuSyncModeProtocolGuid;
+
+#endif
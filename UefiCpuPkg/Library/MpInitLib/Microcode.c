@@ -26,6 +26,200 @@ GetCurrentMicrocodeSignature (
   return BiosSignIdMsr.Bits.MicrocodeUpdateSignature;
 }
 
+/**
+  Walk the microcode patch region and collect the (signature, platform flags)
+  pairs provided by each microcode patch.
+
+  When Entries is NULL, no checksum is calculated and an upper bound of the
+  number of entries is returned so that the caller can size the index buffer.
+  Otherwise CheckSum Part1, Part2 and Part3 (see MicrocodeDetect()) are
+  verified and only the pairs with a correct checksum are returned.
+
+  @param[in]   CpuMpData    The pointer to CPU MP Data structure.
+  @param[out]  Entries      Buffer to receive the index entries, or NULL.
+  @param[in]   MaxEntries   Number of entries Entries can hold.
+
+  @return  Number of entries stored in Entries, or the upper bound of the
+           number of entries if Entries is NULL.
+**/
+STATIC
+UINTN
+ParseMicrocodePatchRegion (
+  IN  CPU_MP_DATA                         *CpuMpData,
+  OUT MICROCODE_PATCH_INDEX_ENTRY         *Entries,     OPTIONAL
+  IN  UINTN                               MaxEntries
+  )
+{
+  UINT32                                  ExtendedTableLength;
+  UINT32                                  ExtendedTableCount;
+  CPU_MICROCODE_EXTENDED_TABLE            *ExtendedTable;
+  CPU_MICROCODE_EXTENDED_TABLE_HEADER     *ExtendedTableHeader;
+  CPU_MICROCODE_HEADER                    *MicrocodeEntryPoint;
+  UINTN                                   MicrocodeEnd;
+  UINTN                                   TotalSize;
+  UINT32                                  CheckSum32;
+  UINT32                                  InCompleteCheckSum32;
+  UINTN                                   Index;
+  UINTN                                   Count;
+
+  Count               = 0;
+  MicrocodeEnd        = (UINTN) (CpuMpData->MicrocodePatchAddress + CpuMpData->MicrocodePatchRegionSize);
+  MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (UINTN) CpuMpData->MicrocodePatchAddress;
+
+  do {
+    if (MicrocodeEntryPoint->DataSize == 0) {
+      TotalSize = sizeof (CPU_MICROCODE_HEADER) + 2000;
+    } else {
+      TotalSize = sizeof (CPU_MICROCODE_HEADER) + MicrocodeEntryPoint->DataSize;
+    }
+
+    //
+    // TotalSize is only valid between 0 and (MicrocodeEnd - MicrocodeEntry)
+    // and it should be aligned with 4 bytes. The padding data between the
+    // microcode patches does not start with header version 0x1. Skip 1KB to
+    // check next entry in both cases.
+    //
+    if ( (UINTN)MicrocodeEntryPoint > (MAX_ADDRESS - TotalSize) ||
+         ((UINTN)MicrocodeEntryPoint + TotalSize) > MicrocodeEnd ||
+         (TotalSize & 0x3) != 0 ||
+         MicrocodeEntryPoint->HeaderVersion != 0x1
+       ) {
+      MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (((UINTN) MicrocodeEntryPoint) + SIZE_1KB);
+      continue;
+    }
+
+    //
+    // Locate the extended signature table, if any, and make sure it does not
+    // run past the end of the microcode patch region.
+    //
+    ExtendedTableHeader = NULL;
+    ExtendedTableCount  = 0;
+    ExtendedTableLength = 0;
+    if ((MicrocodeEntryPoint->DataSize != 0) &&
+        (MicrocodeEntryPoint->TotalSize > TotalSize + sizeof (CPU_MICROCODE_EXTENDED_TABLE_HEADER)) &&
+        ((UINTN)MicrocodeEntryPoint + MicrocodeEntryPoint->TotalSize <= MicrocodeEnd)) {
+      ExtendedTableLength = MicrocodeEntryPoint->TotalSize - (UINT32) TotalSize;
+      ExtendedTableHeader = (CPU_MICROCODE_EXTENDED_TABLE_HEADER *) ((UINT8 *) MicrocodeEntryPoint + TotalSize);
+      ExtendedTableCount  = MIN (
+                              ExtendedTableHeader->ExtendedSignatureCount,
+                              (ExtendedTableLength - sizeof (CPU_MICROCODE_EXTENDED_TABLE_HEADER)) /
+                              sizeof (CPU_MICROCODE_EXTENDED_TABLE)
+                              );
+    }
+
+    if (Entries == NULL) {
+      Count += 1 + ExtendedTableCount;
+    } else {
+      //
+      // Save an in-complete CheckSum32 from CheckSum Part1 for common parts.
+      //
+      InCompleteCheckSum32 = CalculateSum32 ((UINT32 *) MicrocodeEntryPoint, TotalSize);
+      InCompleteCheckSum32 -= MicrocodeEntryPoint->ProcessorSignature.Uint32;
+      InCompleteCheckSum32 -= MicrocodeEntryPoint->ProcessorFlags;
+      InCompleteCheckSum32 -= MicrocodeEntryPoint->Checksum;
+
+      //
+      // Calculate CheckSum Part1.
+      //
+      CheckSum32 = InCompleteCheckSum32;
+      CheckSum32 += MicrocodeEntryPoint->ProcessorSignature.Uint32;
+      CheckSum32 += MicrocodeEntryPoint->ProcessorFlags;
+      CheckSum32 += MicrocodeEntryPoint->Checksum;
+      if (CheckSum32 == 0 && Count < MaxEntries) {
+        Entries[Count].ProcessorSignature = MicrocodeEntryPoint->ProcessorSignature.Uint32;
+        Entries[Count].ProcessorFlags     = MicrocodeEntryPoint->ProcessorFlags;
+        Entries[Count].UpdateRevision     = MicrocodeEntryPoint->UpdateRevision;
+        Entries[Count].MicrocodeData      = (UINTN) MicrocodeEntryPoint + sizeof (CPU_MICROCODE_HEADER);
+        Count++;
+      }
+
+      //
+      // Calculate CheckSum Part2 before trusting any extended signature.
+      //
+      if ((ExtendedTableCount != 0) && ((ExtendedTableLength % 4) == 0) &&
+          (CalculateSum32 ((UINT32 *) ExtendedTableHeader, ExtendedTableLength) == 0)) {
+        ExtendedTable = (CPU_MICROCODE_EXTENDED_TABLE *) (ExtendedTableHeader + 1);
+        for (Index = 0; Index < ExtendedTableCount; Index++, ExtendedTable++) {
+          //
+          // Calculate CheckSum Part3.
+          //
+          CheckSum32 = InCompleteCheckSum32;
+          CheckSum32 += ExtendedTable->ProcessorSignature.Uint32;
+          CheckSum32 += ExtendedTable->ProcessorFlag;
+          CheckSum32 += ExtendedTable->Checksum;
+          if (CheckSum32 == 0 && Count < MaxEntries) {
+            Entries[Count].ProcessorSignature = ExtendedTable->ProcessorSignature.Uint32;
+            Entries[Count].ProcessorFlags     = ExtendedTable->ProcessorFlag;
+            Entries[Count].UpdateRevision     = MicrocodeEntryPoint->UpdateRevision;
+            Entries[Count].MicrocodeData      = (UINTN) MicrocodeEntryPoint + sizeof (CPU_MICROCODE_HEADER);
+            Count++;
+          }
+        }
+      }
+    }
+
+    //
+    // Get the next patch.
+    //
+    if (MicrocodeEntryPoint->DataSize == 0) {
+      TotalSize = 2048;
+    } else {
+      TotalSize = MicrocodeEntryPoint->TotalSize;
+    }
+    MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (((UINTN) MicrocodeEntryPoint) + TotalSize);
+  } while (((UINTN) MicrocodeEntryPoint < MicrocodeEnd));
+
+  return Count;
+}
+
+/**
+  Build the microcode patch index from the microcode patch region.
+
+  The microcode patch region is walked and checksummed only once, by the BSP.
+  MicrocodeDetect() then finds the patch of each processor by looking up the
+  index. If the index cannot be allocated, MicrocodeDetect() falls back to
+  walking the microcode patch region.
+
+  @param[in, out]  CpuMpData    The pointer to CPU MP Data structure.
+**/
+VOID
+BuildMicrocodePatchIndex (
+  IN OUT CPU_MP_DATA         *CpuMpData
+  )
+{
+  MICROCODE_PATCH_INDEX_ENTRY  *Entries;
+  UINTN                        MaxEntries;
+  UINTN                        Count;
+  UINT64                       StartTime;
+
+  CpuMpData->MicrocodePatchIndex      = 0;
+  CpuMpData->MicrocodePatchIndexCount = 0;
+  if (CpuMpData->MicrocodePatchRegionSize == 0) {
+    return;
+  }
+
+  StartTime  = GetPerformanceCounter ();
+  MaxEntries = ParseMicrocodePatchRegion (CpuMpData, NULL, 0);
+  if (MaxEntries == 0) {
+    return;
+  }
+  Entries = AllocatePool (MaxEntries * sizeof (MICROCODE_PATCH_INDEX_ENTRY));
+  if (Entries == NULL) {
+    return;
+  }
+  Count = ParseMicrocodePatchRegion (CpuMpData, Entries, MaxEntries);
+
+  CpuMpData->MicrocodePatchIndex          = (UINTN) Entries;
+  CpuMpData->MicrocodePatchIndexCount     = (UINT32) Count;
+  CpuMpData->MicrocodePatchIndexBuildTime = GetTimeInNanoSecond (GetPerformanceCounter () - StartTime);
+  DEBUG ((
+    DEBUG_INFO,
+    "MpInitLib: Indexed %d microcode patch signatures in %Lu microseconds.\n",
+    Count,
+    DivU64x32 (CpuMpData->MicrocodePatchIndexBuildTime, 1000)
+    ));
+}
+
 /**
   Detect whether specified processor can find matching microcode patch and load it.
 
@@ -93,6 +287,7 @@ MicrocodeDetect (
   MSR_IA32_PLATFORM_ID_REGISTER           PlatformIdMsr;
   UINT32                                  ProcessorFlags;
   UINT32                                  ThreadId;
+  MICROCODE_PATCH_INDEX_ENTRY             *IndexEntry;
 
   //
   // set ProcessorFlags to suppress incorrect compiler/analyzer warnings
@@ -150,6 +345,26 @@ MicrocodeDetect (
 
   LatestRevision = 0;
   MicrocodeData  = NULL;
+
+  if (CpuMpData->MicrocodePatchIndex != 0) {
+    //
+    // Look up the patch index built by BSP instead of walking and checksumming
+    // the whole microcode patch region.
+    //
+    IndexEntry = (MICROCODE_PATCH_INDEX_ENTRY *) (UINTN) CpuMpData->MicrocodePatchIndex;
+    for (Index = 0; Index < CpuMpData->MicrocodePatchIndexCount; Index++, IndexEntry++) {
+      if ((IndexEntry->ProcessorSignature == Eax.Uint32) &&
+          (IndexEntry->UpdateRevision > LatestRevision) &&
+          (IndexEntry->ProcessorFlags & (1 << PlatformId)) != 0) {
+        LatestRevision = IndexEntry->UpdateRevision;
+        ProcessorFlags = IndexEntry->ProcessorFlags;
+        MicrocodeData  = (VOID *) (UINTN) IndexEntry->MicrocodeData;
+      }
+    }
+    InterlockedIncrement (&CpuMpData->MicrocodePatchIndexLookups);
+    goto Done;
+  }
+
   MicrocodeEnd = (UINTN) (CpuMpData->MicrocodePatchAddress + CpuMpData->MicrocodePatchRegionSize);
   MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (UINTN) CpuMpData->MicrocodePatchAddress;
 
@@ -275,6 +275,7 @@ GetApLoopMode (
 {
   UINT8                         ApLoopMode;
   CPUID_MONITOR_MWAIT_EBX       MonitorMwaitEbx;
+  CPUID_VERSION_INFO_EBX        VersionInfoEbx;
 
   ASSERT (MonitorFilterSize != NULL);
 
@@ -291,7 +292,12 @@ GetApLoopMode (
   }
 
   if (ApLoopMode != ApInMwaitLoop) {
-    *MonitorFilterSize = sizeof (UINT32);
+    //
+    // Keep each AP's wakeup signal in its own cache line, so that an AP
+    // polling its signal does not contend with the BSP waking its neighbors.
+    //
+    AsmCpuid (CPUID_VERSION_INFO, NULL, &VersionInfoEbx.Uint32, NULL, NULL);
+    *MonitorFilterSize = MAX ((UINT32)sizeof (UINT32), VersionInfoEbx.Bits.CacheLineSize * 8);
   } else {
     //
     // CPUID.[EAX=05H]:EBX.BIT0-15: Largest monitor-line size in bytes
@@ -458,10 +464,12 @@ CollectProcessorCount (
   )
 {
   UINTN                  Index;
+  UINT64                 StartTime;
 
   //
   // Send 1st broadcast IPI to APs to wakeup APs
   //
+  StartTime = GetPerformanceCounter ();
   CpuMpData->InitFlag     = ApInitConfig;
   CpuMpData->X2ApicEnable = FALSE;
   WakeUpAP (CpuMpData, TRUE, 0, NULL, NULL, TRUE);
@@ -474,6 +482,27 @@ CollectProcessorCount (
     CpuPause ();
   }
 
+  DEBUG ((
+    DEBUG_INFO,
+    "MpInitLib: AP detection found %d CPUs (expected %d) in %Lu microseconds.\n",
+    CpuMpData->CpuCount,
+    PcdGet32 (PcdCpuExpectedLogicalProcessorNumber),
+    DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter () - StartTime), 1000)
+    ));
+  if ((PcdGet32 (PcdCpuExpectedLogicalProcessorNumber) > 0) &&
+      (CpuMpData->CpuCount > PcdGet32 (PcdCpuExpectedLogicalProcessorNumber))) {
+    //
+    // The wait ended once the expected count was reached, so the APs that
+    // were slower than that may have been missed.
+    //
+    DEBUG ((
+      DEBUG_WARN,
+      "MpInitLib: PcdCpuExpectedLogicalProcessorNumber (%d) is lower than the detected CPU count (%d), APs may be missed.\n",
+      PcdGet32 (PcdCpuExpectedLogicalProcessorNumber),
+      CpuMpData->CpuCount
+      ));
+  }
+
   if (CpuMpData->CpuCount > 255) {
     //
     // If there are more than 255 processor found, force to enable X2APIC
@@ -994,6 +1023,7 @@ WakeUpAP (
   CPU_AP_DATA                      *CpuData;
   BOOLEAN                          ResetVectorRequired;
   CPU_INFO_IN_HOB                  *CpuInfoInHob;
+  UINT32                           ApLimit;
 
   CpuMpData->FinishedCount = 0;
   ResetVectorRequired = FALSE;
@@ -1096,12 +1126,35 @@ WakeUpAP (
         //     at timeout. APs that miss the time-out may cause undefined
         //     behavior.
         //
+        // In both cases, a platform that knows how many CPUs to expect (for
+        // example from the previous boot) can set
+        // PcdCpuExpectedLogicalProcessorNumber, so that the wait ends as soon
+        // as all of them have checked in rather than at the timeout.
+        //
+        ApLimit = PcdGet32 (PcdCpuMaxLogicalProcessorNumber);
+        if (PcdGet32 (PcdCpuExpectedLogicalProcessorNumber) > 0) {
+          ApLimit = MIN (ApLimit, PcdGet32 (PcdCpuExpectedLogicalProcessorNumber));
+        }
         TimedWaitForApFinish (
           CpuMpData,
-          PcdGet32 (PcdCpuMaxLogicalProcessorNumber) - 1,
+          ApLimit - 1,
           PcdGet32 (PcdCpuApInitTimeOutInMicroSeconds)
           );
 
+        if ((PcdGet32 (PcdCpuExpectedLogicalProcessorNumber) > 0) &&
+            (CpuMpData->FinishedCount < ApLimit - 1)) {
+          //
+          // The expected CPU count overstates the CPUs present, the wait only
+          // ended at the time-out.
+          //
+          DEBUG ((
+            DEBUG_WARN,
+            "MpInitLib: Only %d of the %d expected APs checked in, AP detection waited for the time-out.\n",
+            CpuMpData->FinishedCount,
+            ApLimit - 1
+            ));
+        }
+
         while (CpuMpData->MpCpuExchangeInfo->NumApsExecuting != 0) {
           CpuPause();
         }
@@ -1695,9 +1748,17 @@ MpInitLibInitialize (
         );
       CpuMpData->MicrocodePatchAddress = (UINTN)MicrocodePatchInRam;
     }
+    //
+    // Index the microcode patches once so that processors do not walk the
+    // whole microcode patch region.
+    //
+    BuildMicrocodePatchIndex (CpuMpData);
   }else {
-    CpuMpData->MicrocodePatchRegionSize = OldCpuMpData->MicrocodePatchRegionSize;
-    CpuMpData->MicrocodePatchAddress    = OldCpuMpData->MicrocodePatchAddress;
+    CpuMpData->MicrocodePatchRegionSize     = OldCpuMpData->MicrocodePatchRegionSize;
+    CpuMpData->MicrocodePatchAddress        = OldCpuMpData->MicrocodePatchAddress;
+    CpuMpData->MicrocodePatchIndex          = OldCpuMpData->MicrocodePatchIndex;
+    CpuMpData->MicrocodePatchIndexCount     = OldCpuMpData->MicrocodePatchIndexCount;
+    CpuMpData->MicrocodePatchIndexBuildTime = OldCpuMpData->MicrocodePatchIndexBuildTime;
   }
   InitializeSpinLock(&CpuMpData->MpLock);
 
@@ -1798,6 +1859,19 @@ MpInitLibInitialize (
     }
   }
 
+  if (CpuMpData->MicrocodePatchIndexLookups != 0) {
+    //
+    // Lookups run on APs, which are not timed. Report the lookup count and the
+    // measured time spent by BSP to build the index.
+    //
+    DEBUG ((
+      DEBUG_INFO,
+      "MpInitLib: Microcode patch index served %d lookups, index built in %Lu microseconds.\n",
+      CpuMpData->MicrocodePatchIndexLookups,
+      DivU64x32 (CpuMpData->MicrocodePatchIndexBuildTime, 1000)
+      ));
+  }
+
   //
   // Initialize global data for MP support
   //
@@ -153,6 +153,20 @@ typedef struct {
   UINTN             ModeTransitionOffset;
 } MP_ASSEMBLY_ADDRESS_MAP;
 
+//
+// One checksum-verified (signature, platform flags) -> microcode patch mapping.
+// The index is built once by the BSP so that processors do not have to walk
+// and checksum the whole microcode region. The layout is architecture
+// independent because the index is inherited from PEI by DXE.
+//
+typedef struct {
+  UINT32            ProcessorSignature;
+  UINT32            ProcessorFlags;
+  UINT32            UpdateRevision;
+  UINT32            Reserved;
+  UINT64            MicrocodeData;
+} MICROCODE_PATCH_INDEX_ENTRY;
+
 typedef struct _CPU_MP_DATA  CPU_MP_DATA;
 
 #pragma pack(1)
@@ -246,6 +260,14 @@ struct _CPU_MP_DATA {
   BOOLEAN                        TimerInterruptState;
   UINT64                         MicrocodePatchAddress;
   UINT64                         MicrocodePatchRegionSize;
+  //
+  // Microcode patch index (MICROCODE_PATCH_INDEX_ENTRY array) built by BSP,
+  // time taken to build it and the number of lookups it has served.
+  //
+  UINT64                         MicrocodePatchIndex;
+  UINT32                         MicrocodePatchIndexCount;
+  UINT32                         MicrocodePatchIndexLookups;
+  UINT64                         MicrocodePatchIndexBuildTime;
 
   UINT32                         ProcessorSignature;
   UINT32                         ProcessorFlags;
@@ -562,6 +584,16 @@ CheckAndUpdateApsStatus (
   VOID
   );
 
+/**
+  Build the microcode patch index from the microcode patch region.
+
+  @param[in, out]  CpuMpData    The pointer to CPU MP Data structure.
+**/
+VOID
+BuildMicrocodePatchIndex (
+  IN OUT CPU_MP_DATA         *CpuMpData
+  );
+
 /**
   Detect whether specified processor can find matching microcode patch and load it.
 
@@ -516,6 +516,265 @@ BiggestDep (
   return MAX(Bigger, NoneNeibAfterDep);
 }
 
+/**
+  Drop MSR writes that are superseded by the neighbouring write to the same MSR.
+
+  Two neighbouring Msr entries with no entry between them, which target the same
+  MSR and do not use TestThenWrite, are folded only when one of them makes the
+  other redundant:
+  - The later entry covers every bit of the earlier one, so the earlier value
+    never survives.
+  - The earlier entry covers every bit of the later one with the same value, so
+    the later write changes nothing.
+  Writes to different bits of the same MSR are kept apart, because features rely
+  on their order, for example setting an enable bit before the lock bit.
+
+  @param[in, out]  RegisterTable  The register table to compact.
+
+  @return  The number of entries removed from the register table.
+**/
+UINT32
+CoalesceMsrEntries (
+  IN OUT CPU_REGISTER_TABLE     *RegisterTable
+  )
+{
+  CPU_REGISTER_TABLE_ENTRY  *RegisterTableEntry;
+  CPU_REGISTER_TABLE_ENTRY  *Last;
+  CPU_REGISTER_TABLE_ENTRY  *Current;
+  UINT32                    Index;
+  UINT32                    Length;
+  UINT32                    LastStart;
+  UINT32                    LastEnd;
+  UINT32                    CurrentStart;
+  UINT32                    CurrentEnd;
+
+  if (RegisterTable->TableLength < 2) {
+    return 0;
+  }
+
+  RegisterTableEntry = (CPU_REGISTER_TABLE_ENTRY *) (UINTN) RegisterTable->RegisterTableEntry;
+  Length = 1;
+  for (Index = 1; Index < RegisterTable->TableLength; Index++) {
+    Last    = &RegisterTableEntry[Length - 1];
+    Current = &RegisterTableEntry[Index];
+
+    if (Last->RegisterType == Msr && Current->RegisterType == Msr &&
+        Last->Index == Current->Index &&
+        !Last->TestThenWrite && !Current->TestThenWrite &&
+        Last->ValidBitLength != 0 && Current->ValidBitLength != 0) {
+      //
+      // Bit ranges below are [Start, End).
+      //
+      LastStart    = Last->ValidBitStart;
+      LastEnd      = MIN (LastStart + Last->ValidBitLength, 64);
+      CurrentStart = Current->ValidBitStart;
+      CurrentEnd   = MIN (CurrentStart + Current->ValidBitLength, 64);
+      if (CurrentStart <= LastStart && LastEnd <= CurrentEnd) {
+        CopyMem (Last, Current, sizeof (CPU_REGISTER_TABLE_ENTRY));
+        continue;
+      }
+      if (LastStart <= CurrentStart && CurrentEnd <= LastEnd &&
+          BitFieldRead64 (Last->Value, CurrentStart - LastStart, CurrentEnd - LastStart - 1) ==
+          BitFieldRead64 (Current->Value, 0, CurrentEnd - CurrentStart - 1)) {
+        continue;
+      }
+    }
+
+    if (Index != Length) {
+      CopyMem (&RegisterTableEntry[Length], Current, sizeof (CPU_REGISTER_TABLE_ENTRY));
+    }
+    Length++;
+  }
+
+  Index = RegisterTable->TableLength - Length;
+  RegisterTable->TableLength = Length;
+  return Index;
+}
+
+/**
+  Remove semaphore entries that do not order any register programming.
+
+  A semaphore with no register entry before it, or no register entry after it,
+  on every processor only makes the threads wait for each other. Consecutive
+  semaphores with nothing between them on every processor are folded into one
+  using the biggest dependence type.
+
+  Semaphores must stay paired across all threads of a core or package, so the
+  tables are only changed when every processor carries the same semaphore
+  sequence and each decision is made for all processors at once.
+
+  @param[in]  RegisterTables  The register tables of all processors.
+  @param[in]  NumberOfCpus    Number of processor in system.
+
+  @return  The number of semaphores removed from each register table.
+**/
+UINT32
+RemoveRedundantSemaphores (
+  IN CPU_REGISTER_TABLE         *RegisterTables,
+  IN UINTN                      NumberOfCpus
+  )
+{
+  CPU_REGISTER_TABLE_ENTRY  *RegisterTableEntry;
+  UINTN                     ProcessorNumber;
+  UINT32                    Index;
+  UINT32                    Length;
+  UINT32                    SemaphoreCount;
+  UINT32                    SemaphoreIndex;
+  UINT32                    Kept;
+  UINT32                    Removed;
+  UINT64                    *SemaphoreType;
+  BOOLEAN                   *GapUsed;
+
+  //
+  // Collect the semaphore sequence of the first processor.
+  //
+  RegisterTableEntry = (CPU_REGISTER_TABLE_ENTRY *) (UINTN) RegisterTables[0].RegisterTableEntry;
+  SemaphoreCount = 0;
+  for (Index = 0; Index < RegisterTables[0].TableLength; Index++) {
+    if (RegisterTableEntry[Index].RegisterType == Semaphore) {
+      SemaphoreCount++;
+    }
+  }
+  if (SemaphoreCount == 0) {
+    return 0;
+  }
+
+  SemaphoreType = AllocatePool (SemaphoreCount * sizeof (UINT64));
+  GapUsed       = AllocateZeroPool ((SemaphoreCount + 1) * sizeof (BOOLEAN));
+  if (SemaphoreType == NULL || GapUsed == NULL) {
+    Removed = 0;
+    goto Done;
+  }
+  SemaphoreIndex = 0;
+  for (Index = 0; Index < RegisterTables[0].TableLength; Index++) {
+    if (RegisterTableEntry[Index].RegisterType == Semaphore) {
+      SemaphoreType[SemaphoreIndex++] = RegisterTableEntry[Index].Value;
+    }
+  }
+
+  //
+  // GapUsed[N] records whether any processor programs a register between
+  // semaphore N - 1 and semaphore N. GapUsed[SemaphoreCount] covers the
+  // entries after the last semaphore.
+  //
+  for (ProcessorNumber = 0; ProcessorNumber < NumberOfCpus; ProcessorNumber++) {
+    RegisterTableEntry = (CPU_REGISTER_TABLE_ENTRY *) (UINTN) RegisterTables[ProcessorNumber].RegisterTableEntry;
+    SemaphoreIndex = 0;
+    for (Index = 0; Index < RegisterTables[ProcessorNumber].TableLength; Index++) {
+      if (RegisterTableEntry[Index].RegisterType != Semaphore) {
+        GapUsed[SemaphoreIndex] = TRUE;
+        continue;
+      }
+      if (SemaphoreIndex == SemaphoreCount ||
+          SemaphoreType[SemaphoreIndex] != RegisterTableEntry[Index].Value) {
+        Removed = 0;
+        goto Done;
+      }
+      SemaphoreIndex++;
+    }
+    if (SemaphoreIndex != SemaphoreCount) {
+      Removed = 0;
+      goto Done;
+    }
+  }
+
+  //
+  // Decide which semaphores survive. A removed semaphore has type NoneDepType.
+  //
+  Kept = MAX_UINT32;
+  for (SemaphoreIndex = 0; SemaphoreIndex < SemaphoreCount; SemaphoreIndex++) {
+    if (GapUsed[SemaphoreIndex]) {
+      Kept = SemaphoreIndex;
+      continue;
+    }
+    if (Kept != MAX_UINT32) {
+      SemaphoreType[Kept] = MAX (SemaphoreType[Kept], SemaphoreType[SemaphoreIndex]);
+    }
+    SemaphoreType[SemaphoreIndex] = NoneDepType;
+  }
+  if (!GapUsed[SemaphoreCount] && Kept != MAX_UINT32) {
+    SemaphoreType[Kept] = NoneDepType;
+  }
+
+  Removed = 0;
+  for (SemaphoreIndex = 0; SemaphoreIndex < SemaphoreCount; SemaphoreIndex++) {
+    if (SemaphoreType[SemaphoreIndex] == NoneDepType) {
+      Removed++;
+    }
+  }
+  if (Removed == 0) {
+    goto Done;
+  }
+
+  for (ProcessorNumber = 0; ProcessorNumber < NumberOfCpus; ProcessorNumber++) {
+    RegisterTableEntry = (CPU_REGISTER_TABLE_ENTRY *) (UINTN) RegisterTables[ProcessorNumber].RegisterTableEntry;
+    SemaphoreIndex = 0;
+    Length = 0;
+    for (Index = 0; Index < RegisterTables[ProcessorNumber].TableLength; Index++) {
+      if (RegisterTableEntry[Index].RegisterType == Semaphore) {
+        if (SemaphoreType[SemaphoreIndex] == NoneDepType) {
+          SemaphoreIndex++;
+          continue;
+        }
+        RegisterTableEntry[Index].Value = SemaphoreType[SemaphoreIndex];
+        SemaphoreIndex++;
+      }
+      if (Index != Length) {
+        CopyMem (&RegisterTableEntry[Length], &RegisterTableEntry[Index], sizeof (CPU_REGISTER_TABLE_ENTRY));
+      }
+      Length++;
+    }
+    RegisterTables[ProcessorNumber].TableLength = Length;
+  }
+
+Done:
+  if (SemaphoreType != NULL) {
+    FreePool (SemaphoreType);
+  }
+  if (GapUsed != NULL) {
+    FreePool (GapUsed);
+  }
+  return Removed;
+}
+
+/**
+  Compile the register tables of all processors into their final form.
+
+  The tables produced by the feature initialize functions are programmed
+  verbatim on every boot and replayed on S3 resume, so redundant MSR accesses
+  and synchronization points are removed once here.
+
+  @param[in]  NumberOfCpus  Number of processor in system
+
+**/
+VOID
+CompileRegisterTables (
+  IN UINTN                             NumberOfCpus
+  )
+{
+  CPU_FEATURES_DATA                    *CpuFeaturesData;
+  CPU_REGISTER_TABLE                   *RegisterTables;
+  UINTN                                ProcessorNumber;
+  UINT32                               CoalescedCount;
+  UINT32                               SemaphoreCount;
+
+  CpuFeaturesData = GetCpuFeaturesData ();
+  RegisterTables  = (CPU_REGISTER_TABLE *) (UINTN) CpuFeaturesData->AcpiCpuData->RegisterTable;
+
+  CoalescedCount = 0;
+  for (ProcessorNumber = 0; ProcessorNumber < NumberOfCpus; ProcessorNumber++) {
+    CoalescedCount += CoalesceMsrEntries (&RegisterTables[ProcessorNumber]);
+  }
+  SemaphoreCount = RemoveRedundantSemaphores (RegisterTables, NumberOfCpus);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Register tables compiled: %d redundant MSR entries removed, %d semaphores removed per processor\n",
+    CoalescedCount,
+    SemaphoreCount
+    ));
+}
+
 /**
   Analysis register CPU features on each processor and save CPU setting in CPU register table.
 
@@ -542,6 +801,12 @@ AnalysisProcessorFeatures (
   CPU_FEATURE_DEPENDENCE_TYPE          AfterDep;
   CPU_FEATURE_DEPENDENCE_TYPE          NoneNeibBeforeDep;
   CPU_FEATURE_DEPENDENCE_TYPE          NoneNeibAfterDep;
+  CPU_REGISTER_TABLE                   *RegisterTable;
+  UINTN                                FeatureIndex;
+  UINT64                               *FeatureTime;
+  UINT32                               *FeatureEntryCount;
+  UINT64                               StartTime;
+  UINT32                               TableLength;
 
   CpuFeaturesData = GetCpuFeaturesData ();
   CpuFeaturesData->CapabilityPcd = AllocatePool (CpuFeaturesData->BitMaskSize);
@@ -595,8 +860,17 @@ AnalysisProcessorFeatures (
   SetCapabilityPcd (CpuFeaturesData->CapabilityPcd, CpuFeaturesData->BitMaskSize);
   SetSettingPcd (CpuFeaturesData->SettingPcd, CpuFeaturesData->BitMaskSize);
 
+  //
+  // Every processor gets the same ordered feature list because it is filtered
+  // by the common capability, so the position in the list identifies a feature.
+  //
+  FeatureTime       = AllocateZeroPool (CpuFeaturesData->FeaturesCount * sizeof (UINT64));
+  FeatureEntryCount = AllocateZeroPool (CpuFeaturesData->FeaturesCount * sizeof (UINT32));
+  ASSERT (FeatureTime != NULL && FeatureEntryCount != NULL);
+
   for (ProcessorNumber = 0; ProcessorNumber < NumberOfCpus; ProcessorNumber++) {
     CpuInitOrder = &CpuFeaturesData->InitOrder[ProcessorNumber];
+    RegisterTable = (CPU_REGISTER_TABLE *) (UINTN) CpuFeaturesData->AcpiCpuData->RegisterTable + ProcessorNumber;
     Entry = GetFirstNode (&CpuFeaturesData->FeatureList);
     while (!IsNull (&CpuFeaturesData->FeatureList, Entry)) {
       //
@@ -614,9 +888,13 @@ AnalysisProcessorFeatures (
     // Go through ordered feature list to initialize CPU features
     //
     CpuInfo = &CpuFeaturesData->InitOrder[ProcessorNumber].CpuInfo;
+    FeatureIndex = 0;
     Entry = GetFirstNode (&CpuInitOrder->OrderList);
     while (!IsNull (&CpuInitOrder->OrderList, Entry)) {
       CpuFeatureInOrder = CPU_FEATURE_ENTRY_FROM_LINK (Entry);
+      ASSERT (FeatureIndex < CpuFeaturesData->FeaturesCount);
+      StartTime   = GetPerformanceCounter ();
+      TableLength = RegisterTable->TableLength;
 
       Success = FALSE;
       if (IsBitMaskMatch (CpuFeatureInOrder->FeatureMask, CpuFeaturesData->SettingPcd, CpuFeaturesData->BitMaskSize)) {
@@ -649,6 +927,10 @@ AnalysisProcessorFeatures (
         }
       }
 
+      FeatureTime[FeatureIndex]       += GetPerformanceCounter () - StartTime;
+      FeatureEntryCount[FeatureIndex] += RegisterTable->TableLength - TableLength;
+      FeatureIndex++;
+
       if (Success) {
         NextEntry = Entry->ForwardLink;
         if (!IsNull (&CpuInitOrder->OrderList, NextEntry)) {
@@ -695,10 +977,36 @@ AnalysisProcessorFeatures (
     //
     DEBUG ((DEBUG_INFO, "Dump final value for PcdCpuFeaturesSetting:\n"));
     DumpCpuFeatureMask (CpuFeaturesData->SettingPcd, CpuFeaturesData->BitMaskSize);
+  }
 
-    //
-    // Dump the RegisterTable
-    //
+  //
+  // Report the time each feature's initialize function took to build its
+  // register table entries for all processors. Nothing is programmed yet.
+  //
+  DEBUG ((DEBUG_INFO, "CPU features register table build time for %d processors:\n", (UINT32) NumberOfCpus));
+  FeatureIndex = 0;
+  Entry = GetFirstNode (&CpuFeaturesData->InitOrder[0].OrderList);
+  while (!IsNull (&CpuFeaturesData->InitOrder[0].OrderList, Entry)) {
+    CpuFeatureInOrder = CPU_FEATURE_ENTRY_FROM_LINK (Entry);
+    DEBUG ((
+      DEBUG_INFO,
+      "  %8ld ns %6d entries  ",
+      GetTimeInNanoSecond (FeatureTime[FeatureIndex]),
+      FeatureEntryCount[FeatureIndex]
+      ));
+    DumpCpuFeature (CpuFeatureInOrder, CpuFeaturesData->BitMaskSize);
+    FeatureIndex++;
+    Entry = Entry->ForwardLink;
+  }
+  FreePool (FeatureTime);
+  FreePool (FeatureEntryCount);
+
+  CompileRegisterTables (NumberOfCpus);
+
+  //
+  // Dump the RegisterTable
+  //
+  for (ProcessorNumber = 0; ProcessorNumber < NumberOfCpus; ProcessorNumber++) {
     DumpRegisterTableOnProcessor (ProcessorNumber);
   }
 }
@@ -223,6 +223,7 @@ CpuFeaturesInitialize (
   UINTN                      OldBspNumber;
   EFI_EVENT                  MpEvent;
   EFI_STATUS                 Status;
+  UINT64                     StartTime;
 
   CpuFeaturesData = GetCpuFeaturesData ();
 
@@ -235,6 +236,7 @@ CpuFeaturesInitialize (
   //
   MpEvent = NULL;
 
+  StartTime = GetPerformanceCounter ();
   if (CpuFeaturesData->NumberOfCpus > 1) {
     Status = gBS->CreateEvent (
                     EVT_NOTIFY_WAIT,
@@ -266,6 +268,17 @@ CpuFeaturesInitialize (
     ASSERT_EFI_ERROR (Status);
   }
 
+  //
+  // Only BSP reads the performance counter. The time covers all processors
+  // programming their register tables in parallel.
+  //
+  DEBUG ((
+    DEBUG_INFO,
+    "CPU register programming on %d processors took %ld ns\n",
+    (UINT32) CpuFeaturesData->NumberOfCpus,
+    GetTimeInNanoSecond (GetPerformanceCounter () - StartTime)
+    ));
+
   //
   // Switch to new BSP if required
   //
@@ -303,6 +303,7 @@ CpuFeaturesInitialize (
 {
   CPU_FEATURES_DATA          *CpuFeaturesData;
   UINTN                      OldBspNumber;
+  UINT64                     StartTime;
 
   CpuFeaturesData = GetCpuFeaturesData ();
 
@@ -312,8 +313,20 @@ CpuFeaturesInitialize (
   //
   // Start to program register for all CPUs.
   //
+  StartTime = GetPerformanceCounter ();
   StartupAllCPUsWorker (SetProcessorRegister);
 
+  //
+  // Only BSP reads the performance counter. The time covers all processors
+  // programming their register tables in parallel.
+  //
+  DEBUG ((
+    DEBUG_INFO,
+    "CPU register programming on %d processors took %ld ns\n",
+    (UINT32) CpuFeaturesData->NumberOfCpus,
+    GetTimeInNanoSecond (GetPerformanceCounter () - StartTime)
+    ));
+
   //
   // Switch to new BSP if required
   //
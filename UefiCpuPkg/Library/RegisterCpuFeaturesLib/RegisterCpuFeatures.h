@@ -22,6 +22,7 @@
 #include <Library/SynchronizationLib.h>
 #include <Library/IoLib.h>
 #include <Library/LocalApicLib.h>
+#include <Library/TimerLib.h>
 
 #include <AcpiCpuData.h>
 
@@ -646,7 +646,10 @@ InitializeCpuAfterRebase (
   VOID
   )
 {
+  UINT64                    StartTime;
+
   mNumberToFinish = mAcpiCpuData.NumberOfCpus - 1;
+  StartTime       = GetPerformanceCounter ();
 
   //
   // Signal that SMM base relocation is complete and to continue initialization for all APs.
@@ -667,6 +670,17 @@ InitializeCpuAfterRebase (
   while (mNumberToFinish > 0) {
     CpuPause ();
   }
+
+  //
+  // Only BSP reads the performance counter. The time covers all processors
+  // replaying their register tables in parallel.
+  //
+  DEBUG ((
+    DEBUG_INFO,
+    "S3: CPU register programming on %d processors took %ld ns\n",
+    (UINT32) mAcpiCpuData.NumberOfCpus,
+    GetTimeInNanoSecond (GetPerformanceCounter () - StartTime)
+    ));
 }
 
 /**
@@ -20,6 +20,10 @@ EFI_SMM_CPU_SERVICE_PROTOCOL  mSmmCpuService = {
   SmmRegisterExceptionHandler
 };
 
+EDKII_SMM_CPU_SYNC_MODE_PROTOCOL  mSmmCpuSyncMode = {
+  SmmSetSyncMode
+};
+
 /**
   Gets processor information on the requested processor at the instant this call is made.
 
@@ -338,6 +342,35 @@ SmmRegisterExceptionHandler (
   return RegisterCpuInterruptHandler (ExceptionType, InterruptHandler);
 }
 
+/**
+  Select the method used to synchronize the processors on subsequent SMIs.
+
+  @param  This                  A pointer to the EDKII_SMM_CPU_SYNC_MODE_PROTOCOL instance.
+  @param  SyncMode              The synchronization method, encoded as PcdCpuSmmSyncMode.
+
+  @retval EFI_SUCCESS           The synchronization method was selected.
+  @retval EFI_INVALID_PARAMETER SyncMode is not a supported synchronization method.
+
+**/
+EFI_STATUS
+EFIAPI
+SmmSetSyncMode (
+  IN CONST EDKII_SMM_CPU_SYNC_MODE_PROTOCOL  *This,
+  IN       UINT8                             SyncMode
+  )
+{
+  if (SyncMode >= SmmCpuSyncModeMax) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // BSP applies it to mSmmMpSyncData->EffectiveSyncMode once all processors
+  // have left the current SMI run.
+  //
+  mCpuSmmSyncMode = (SMM_CPU_SYNC_MODE)SyncMode;
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize SMM CPU Services.
 
@@ -361,6 +394,17 @@ InitializeSmmCpuServices (
                     &mSmmCpuService
                     );
   ASSERT_EFI_ERROR (Status);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gSmst->SmmInstallProtocolInterface (
+                    &Handle,
+                    &gEdkiiSmmCpuSyncModeProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &mSmmCpuSyncMode
+                    );
+  ASSERT_EFI_ERROR (Status);
   return Status;
 }
 
@@ -144,6 +144,23 @@ SmmRegisterExceptionHandler (
   IN EFI_CPU_INTERRUPT_HANDLER     InterruptHandler
   );
 
+/**
+  Select the method used to synchronize the processors on subsequent SMIs.
+
+  @param  This                  A pointer to the EDKII_SMM_CPU_SYNC_MODE_PROTOCOL instance.
+  @param  SyncMode              The synchronization method, encoded as PcdCpuSmmSyncMode.
+
+  @retval EFI_SUCCESS           The synchronization method was selected.
+  @retval EFI_INVALID_PARAMETER SyncMode is not a supported synchronization method.
+
+**/
+EFI_STATUS
+EFIAPI
+SmmSetSyncMode (
+  IN CONST EDKII_SMM_CPU_SYNC_MODE_PROTOCOL  *This,
+  IN       UINT8                             SyncMode
+  );
+
 //
 // Internal function prototypes
 //
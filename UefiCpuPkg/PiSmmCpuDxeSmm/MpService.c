@@ -19,9 +19,11 @@ SMM_DISPATCHER_MP_SYNC_DATA                 *mSmmMpSyncData = NULL;
 UINTN                                       mSmmMpSyncDataSize;
 SMM_CPU_SEMAPHORES                          mSmmCpuSemaphores;
 UINTN                                       mSemaphoreSize;
+UINTN                                       mSmmCpuPackageCount;
 SPIN_LOCK                                   *mPFLock = NULL;
 SMM_CPU_SYNC_MODE                           mCpuSmmSyncMode;
 BOOLEAN                                     mMachineCheckSupported = FALSE;
+BOOLEAN                                     mMonitorMwaitSupported = FALSE;
 
 /**
   Performs an atomic compare exchange operation to get semaphore.
@@ -52,6 +54,48 @@ WaitForSemaphore (
 }
 
 
+/**
+  Waits in a low overhead loop until the semaphore is non-zero, then performs
+  an atomic compare exchange operation to get semaphore.
+
+  Used by the APs in lazy sync mode, which spend most of the SMI run waiting
+  for the BSP. The loop only reads the semaphore, which has its own cache line,
+  and sleeps in MWAIT on it when the processor supports MONITOR/MWAIT.
+
+  @param      Sem        IN:  32-bit unsigned integer
+                         OUT: original integer - 1
+  @return     Original integer - 1
+
+**/
+UINT32
+WaitForSemaphoreLazy (
+  IN OUT  volatile UINT32           *Sem
+  )
+{
+  UINT32                            Value;
+
+  do {
+    while (*Sem == 0) {
+      if (mMonitorMwaitSupported) {
+        AsmMonitor ((UINTN)Sem, 0, 0);
+        if (*Sem != 0) {
+          break;
+        }
+        AsmMwait (0, 0);
+      } else {
+        CpuPause ();
+      }
+    }
+    Value = *Sem;
+  } while (Value == 0 ||
+           InterlockedCompareExchange32 (
+             (UINT32*)Sem,
+             Value,
+             Value - 1
+             ) != Value);
+  return Value - 1;
+}
+
 /**
   Performs an atomic compare exchange operation to release semaphore.
   The compare exchange operation must be performed using
@@ -106,6 +150,95 @@ LockdownSemaphore (
   return Value;
 }
 
+/**
+  Return the arrival counter of the package that the processor belongs to.
+
+  Processors check in on the counter of their own package, so that the atomic
+  updates of the SMI rendezvous stay within the package instead of all the
+  processors of the system contending for a single cache line.
+
+  @param   CpuIndex   Processor index.
+
+  @return  Pointer to the arrival counter.
+
+**/
+volatile UINT32 *
+GetArrivalCounter (
+  IN      UINTN                     CpuIndex
+  )
+{
+  UINTN                             Package;
+
+  //
+  // A hot added processor may belong to a package unknown at initialization
+  // time, it then shares the counter of another package.
+  //
+  Package = gSmmCpuPrivate->ProcessorInfo[CpuIndex].Location.Package % mSmmCpuPackageCount;
+  return (volatile UINT32 *)((UINTN)mSmmMpSyncData->Counter + mSemaphoreSize * Package);
+}
+
+/**
+  Return the number of processors that have checked in for this SMI run.
+
+  @return  The sum of all package arrival counters.
+
+**/
+UINTN
+GetArrivedCpuCount (
+  VOID
+  )
+{
+  UINTN                             Package;
+  UINTN                             Count;
+
+  Count = 0;
+  for (Package = 0; Package < mSmmCpuPackageCount; Package++) {
+    Count += *(volatile UINT32 *)((UINTN)mSmmMpSyncData->Counter + mSemaphoreSize * Package);
+  }
+  return Count;
+}
+
+/**
+  Lock down all package arrival counters so that no processor can check in
+  any more, and return the number of processors that have checked in.
+
+  A processor either has been counted by its package counter before the
+  lockdown, or finds it locked down and leaves SMM without waiting for BSP.
+
+  @return  The number of processors that have checked in, including BSP.
+
+**/
+UINTN
+LockdownArrivalCounters (
+  VOID
+  )
+{
+  UINTN                             Package;
+  UINTN                             Count;
+
+  Count = 0;
+  for (Package = 0; Package < mSmmCpuPackageCount; Package++) {
+    Count += LockdownSemaphore ((volatile UINT32 *)((UINTN)mSmmMpSyncData->Counter + mSemaphoreSize * Package));
+  }
+  return Count;
+}
+
+/**
+  Reset all package arrival counters to allow processors to check in again.
+
+**/
+VOID
+ResetArrivalCounters (
+  VOID
+  )
+{
+  UINTN                             Package;
+
+  for (Package = 0; Package < mSmmCpuPackageCount; Package++) {
+    *(volatile UINT32 *)((UINTN)mSmmMpSyncData->Counter + mSemaphoreSize * Package) = 0;
+  }
+}
+
 /**
   Wait all APs to performs an atomic compare exchange operation to release semaphore.
 
@@ -161,10 +294,12 @@ AllCpusInSmmWithExceptions (
   UINTN                             Index;
   SMM_CPU_DATA_BLOCK                *CpuData;
   EFI_PROCESSOR_INFORMATION         *ProcessorInfo;
+  UINTN                             ArrivedCount;
 
-  ASSERT (*mSmmMpSyncData->Counter <= mNumberOfCpus);
+  ArrivedCount = GetArrivedCpuCount ();
+  ASSERT (ArrivedCount <= mNumberOfCpus);
 
-  if (*mSmmMpSyncData->Counter == mNumberOfCpus) {
+  if (ArrivedCount == mNumberOfCpus) {
     return TRUE;
   }
 
@@ -255,7 +390,7 @@ SmmWaitForApArrival (
   BOOLEAN                           LmceEn;
   BOOLEAN                           LmceSignal;
 
-  ASSERT (*mSmmMpSyncData->Counter <= mNumberOfCpus);
+  ASSERT (GetArrivedCpuCount () <= mNumberOfCpus);
 
   LmceEn     = FALSE;
   LmceSignal = FALSE;
@@ -301,7 +436,7 @@ SmmWaitForApArrival (
   //    - In relaxed flow, CheckApArrival() will check SMI disabling status before calling this function.
   //    In both cases, adding SMI-disabling checking code increases overhead.
   //
-  if (*mSmmMpSyncData->Counter < mNumberOfCpus) {
+  if (GetArrivedCpuCount () < mNumberOfCpus) {
     //
     // Send SMI IPIs to bring outside processors in
     //
@@ -522,9 +657,14 @@ BSPHandler (
   UINTN                             ApCount;
   BOOLEAN                           ClearTopLevelSmiResult;
   UINTN                             PresentCount;
+  UINT64                            ArrivalTimer;
 
   ASSERT (CpuIndex == mSmmMpSyncData->BspIndex);
   ApCount = 0;
+  ArrivalTimer = 0;
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    ArrivalTimer = StartSyncTimer ();
+  }
 
   //
   // Flag BSP's presence
@@ -565,10 +705,14 @@ BSPHandler (
     SmmWaitForApArrival();
 
     //
-    // Lock the counter down and retrieve the number of APs
+    // Lock the counters down and retrieve the number of APs
     //
     *mSmmMpSyncData->AllCpusInSync = TRUE;
-    ApCount = LockdownSemaphore (mSmmMpSyncData->Counter) - 1;
+    ApCount = LockdownArrivalCounters () - 1;
+
+    if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+      SmmProfileRecordRendezvousLatency (GetSyncTimerElapsed (ArrivalTimer));
+    }
 
     //
     // Wait for all APs to get ready for programming MTRRs
@@ -648,10 +792,10 @@ BSPHandler (
   if (SyncMode != SmmCpuSyncModeTradition && !SmmCpuFeaturesNeedConfigureMtrrs()) {
 
     //
-    // Lock the counter down and retrieve the number of APs
+    // Lock the counters down and retrieve the number of APs
     //
     *mSmmMpSyncData->AllCpusInSync = TRUE;
-    ApCount = LockdownSemaphore (mSmmMpSyncData->Counter) - 1;
+    ApCount = LockdownArrivalCounters () - 1;
     //
     // Make sure all APs have their Present flag set
     //
@@ -736,10 +880,16 @@ BSPHandler (
     mSmmMpSyncData->BspIndex = (UINT32)-1;
   }
 
+  //
+  // Apply the sync mode selected by SmmSetSyncMode(). No processor is using
+  // the current one any more.
+  //
+  mSmmMpSyncData->EffectiveSyncMode = mCpuSmmSyncMode;
+
   //
   // Allow APs to check in from this point on
   //
-  *mSmmMpSyncData->Counter = 0;
+  ResetArrivalCounters ();
   *mSmmMpSyncData->AllCpusInSync = FALSE;
 }
 
@@ -803,14 +953,14 @@ APHandler (
         //
         // Give up since BSP is unable to enter SMM
         // and signal the completion of this AP
-        WaitForSemaphore (mSmmMpSyncData->Counter);
+        WaitForSemaphore (GetArrivalCounter (CpuIndex));
         return;
       }
     } else {
       //
       // Don't know BSP index. Give up without sending IPI to BSP.
       //
-      WaitForSemaphore (mSmmMpSyncData->Counter);
+      WaitForSemaphore (GetArrivalCounter (CpuIndex));
       return;
     }
   }
@@ -869,7 +1019,11 @@ APHandler (
     //
     // Wait for something to happen
     //
-    WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    if (SyncMode == SmmCpuSyncModeLazyAp) {
+      WaitForSemaphoreLazy (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    } else {
+      WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    }
 
     //
     // Check if BSP wants to exit SMM
@@ -1562,9 +1716,15 @@ SmiRendezvous (
   BOOLEAN                        BspInProgress;
   UINTN                          Index;
   UINTN                          Cr2;
+  UINT64                         ResidencyTimer;
 
   ASSERT(CpuIndex < mMaxNumberOfCpus);
 
+  ResidencyTimer = 0;
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    ResidencyTimer = StartSyncTimer ();
+  }
+
   //
   // Save Cr2 because Page Fault exception in SMM may override its value,
   // when using on-demand paging for above 4G memory.
@@ -1608,7 +1768,7 @@ SmiRendezvous (
     //
     // Signal presence of this processor
     //
-    if (ReleaseSemaphore (mSmmMpSyncData->Counter) == 0) {
+    if (ReleaseSemaphore (GetArrivalCounter (CpuIndex)) == 0) {
       //
       // BSP has already ended the synchronization, so QUIT!!!
       //
@@ -1717,6 +1877,10 @@ SmiRendezvous (
 Exit:
   SmmCpuFeaturesRendezvousExit (CpuIndex);
 
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    SmmProfileRecordResidency (CpuIndex, GetSyncTimerElapsed (ResidencyTimer));
+  }
+
   //
   // Restore Cr2
   //
@@ -1751,16 +1915,34 @@ InitializeSmmCpuSemaphores (
   UINTN                      TotalSize;
   UINTN                      GlobalSemaphoresSize;
   UINTN                      CpuSemaphoresSize;
+  UINTN                      PackageSemaphoresSize;
   UINTN                      SemaphoreSize;
   UINTN                      Pages;
   UINTN                      *SemaphoreBlock;
   UINTN                      SemaphoreAddr;
+  UINTN                      PackageCount;
+  UINTN                      Index;
 
   SemaphoreSize   = GetSpinLockProperties ();
   ProcessorCount = gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
-  GlobalSemaphoresSize = (sizeof (SMM_CPU_SEMAPHORE_GLOBAL) / sizeof (VOID *)) * SemaphoreSize;
-  CpuSemaphoresSize    = (sizeof (SMM_CPU_SEMAPHORE_CPU) / sizeof (VOID *)) * ProcessorCount * SemaphoreSize;
-  TotalSize = GlobalSemaphoresSize + CpuSemaphoresSize;
+
+  //
+  // Package numbers are dense in practice, size the per package semaphores
+  // by the largest one present, but never more than one per processor.
+  //
+  PackageCount = 1;
+  for (Index = 0; Index < ProcessorCount; Index++) {
+    if (gSmmCpuPrivate->ProcessorInfo[Index].ProcessorId != INVALID_APIC_ID &&
+        gSmmCpuPrivate->ProcessorInfo[Index].Location.Package >= PackageCount) {
+      PackageCount = gSmmCpuPrivate->ProcessorInfo[Index].Location.Package + 1;
+    }
+  }
+  PackageCount = MIN (PackageCount, ProcessorCount);
+
+  GlobalSemaphoresSize  = (sizeof (SMM_CPU_SEMAPHORE_GLOBAL) / sizeof (VOID *)) * SemaphoreSize;
+  CpuSemaphoresSize     = (sizeof (SMM_CPU_SEMAPHORE_CPU) / sizeof (VOID *)) * ProcessorCount * SemaphoreSize;
+  PackageSemaphoresSize = (sizeof (SMM_CPU_SEMAPHORE_PACKAGE) / sizeof (VOID *)) * PackageCount * SemaphoreSize;
+  TotalSize = GlobalSemaphoresSize + CpuSemaphoresSize + PackageSemaphoresSize;
   DEBUG((EFI_D_INFO, "One Semaphore Size    = 0x%x\n", SemaphoreSize));
   DEBUG((EFI_D_INFO, "Total Semaphores Size = 0x%x\n", TotalSize));
   Pages = EFI_SIZE_TO_PAGES (TotalSize);
@@ -1769,8 +1951,6 @@ InitializeSmmCpuSemaphores (
   ZeroMem (SemaphoreBlock, TotalSize);
 
   SemaphoreAddr = (UINTN)SemaphoreBlock;
-  mSmmCpuSemaphores.SemaphoreGlobal.Counter       = (UINT32 *)SemaphoreAddr;
-  SemaphoreAddr += SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreGlobal.InsideSmm     = (BOOLEAN *)SemaphoreAddr;
   SemaphoreAddr += SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreGlobal.AllCpusInSync = (BOOLEAN *)SemaphoreAddr;
@@ -1788,10 +1968,14 @@ InitializeSmmCpuSemaphores (
   SemaphoreAddr += ProcessorCount * SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreCpu.Present = (BOOLEAN *)SemaphoreAddr;
 
+  SemaphoreAddr = (UINTN)SemaphoreBlock + GlobalSemaphoresSize + CpuSemaphoresSize;
+  mSmmCpuSemaphores.SemaphorePackage.Counter = (UINT32 *)SemaphoreAddr;
+
   mPFLock                       = mSmmCpuSemaphores.SemaphoreGlobal.PFLock;
   mConfigSmmCodeAccessCheckLock = mSmmCpuSemaphores.SemaphoreGlobal.CodeAccessCheckLock;
 
   mSemaphoreSize = SemaphoreSize;
+  mSmmCpuPackageCount = PackageCount;
 }
 
 /**
@@ -1822,12 +2006,12 @@ InitializeMpSyncData (
     }
     mSmmMpSyncData->EffectiveSyncMode = mCpuSmmSyncMode;
 
-    mSmmMpSyncData->Counter       = mSmmCpuSemaphores.SemaphoreGlobal.Counter;
+    mSmmMpSyncData->Counter       = mSmmCpuSemaphores.SemaphorePackage.Counter;
     mSmmMpSyncData->InsideSmm     = mSmmCpuSemaphores.SemaphoreGlobal.InsideSmm;
     mSmmMpSyncData->AllCpusInSync = mSmmCpuSemaphores.SemaphoreGlobal.AllCpusInSync;
     ASSERT (mSmmMpSyncData->Counter != NULL && mSmmMpSyncData->InsideSmm != NULL &&
             mSmmMpSyncData->AllCpusInSync != NULL);
-    *mSmmMpSyncData->Counter       = 0;
+    ResetArrivalCounters ();
     *mSmmMpSyncData->InsideSmm     = FALSE;
     *mSmmMpSyncData->AllCpusInSync = FALSE;
 
@@ -1864,13 +2048,15 @@ InitializeMpServiceData (
   UINTN                     Index;
   UINT8                     *GdtTssTables;
   UINTN                     GdtTableStepSize;
+  CPUID_VERSION_INFO_ECX    RegEcx;
   CPUID_VERSION_INFO_EDX    RegEdx;
 
   //
-  // Determine if this CPU supports machine check
+  // Determine if this CPU supports machine check and MONITOR/MWAIT
   //
-  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, NULL, &RegEdx.Uint32);
+  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &RegEcx.Uint32, &RegEdx.Uint32);
   mMachineCheckSupported = (BOOLEAN)(RegEdx.Bits.MCA == 1);
+  mMonitorMwaitSupported = (BOOLEAN)(RegEcx.Bits.MONITOR == 1);
 
   //
   // Allocate memory for all locks and semaphores
@@ -19,6 +19,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmAccess2.h>
 #include <Protocol/SmmReadyToLock.h>
 #include <Protocol/SmmCpuService.h>
+#include <Protocol/SmmCpuSyncMode.h>
 #include <Protocol/SmmMemoryAttribute.h>
 #include <Protocol/MmMp.h>
 
@@ -399,6 +400,7 @@ typedef struct {
 typedef enum {
   SmmCpuSyncModeTradition,
   SmmCpuSyncModeRelaxedAp,
+  SmmCpuSyncModeLazyAp,
   SmmCpuSyncModeMax
 } SMM_CPU_SYNC_MODE;
 
@@ -408,6 +410,10 @@ typedef struct {
   // so that UC cache-ability can be set together.
   //
   SMM_CPU_DATA_BLOCK            *CpuData;
+  //
+  // Arrival counters, one per processor package, mSemaphoreSize apart.
+  // See GetArrivalCounter().
+  //
   volatile UINT32               *Counter;
   volatile UINT32               BspIndex;
   volatile BOOLEAN              *InsideSmm;
@@ -425,7 +431,6 @@ typedef struct {
 /// All global semaphores' pointer
 ///
 typedef struct {
-  volatile UINT32      *Counter;
   volatile BOOLEAN     *InsideSmm;
   volatile BOOLEAN     *AllCpusInSync;
   SPIN_LOCK            *PFLock;
@@ -442,12 +447,20 @@ typedef struct {
   SPIN_LOCK                         *Token;
 } SMM_CPU_SEMAPHORE_CPU;
 
+///
+/// All semaphores for each processor package
+///
+typedef struct {
+  volatile UINT32                   *Counter;
+} SMM_CPU_SEMAPHORE_PACKAGE;
+
 ///
 /// All semaphores' information
 ///
 typedef struct {
   SMM_CPU_SEMAPHORE_GLOBAL          SemaphoreGlobal;
   SMM_CPU_SEMAPHORE_CPU             SemaphoreCpu;
+  SMM_CPU_SEMAPHORE_PACKAGE         SemaphorePackage;
 } SMM_CPU_SEMAPHORES;
 
 extern IA32_DESCRIPTOR                     gcSmiGdtr;
@@ -464,6 +477,8 @@ extern EFI_SMM_CPU_SERVICE_PROTOCOL        mSmmCpuService;
 extern IA32_DESCRIPTOR                     gcSmiInitGdtr;
 extern SMM_CPU_SEMAPHORES                  mSmmCpuSemaphores;
 extern UINTN                               mSemaphoreSize;
+extern UINTN                               mSmmCpuPackageCount;
+extern SMM_CPU_SYNC_MODE                   mCpuSmmSyncMode;
 extern SPIN_LOCK                           *mPFLock;
 extern SPIN_LOCK                           *mConfigSmmCodeAccessCheckLock;
 extern EFI_SMRAM_DESCRIPTOR                *mSmmCpuSmramRanges;
@@ -522,6 +537,21 @@ StartSyncTimer (
   VOID
   );
 
+/**
+  Get the number of performance counter ticks elapsed since the SMM AP Sync
+  timer was started.
+
+  @param Timer  The start timer from the begin.
+
+  @return The elapsed ticks.
+
+**/
+UINT64
+EFIAPI
+GetSyncTimerElapsed (
+  IN      UINT64                    Timer
+  );
+
 /**
   Check if the SMM AP Sync timer is timeout.
 
@@ -14,6 +14,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 UINT32                    mSmmProfileCr3;
 
 SMM_PROFILE_HEADER        *mSmmProfileBase;
+SMM_PROFILE_STATISTICS    *mSmmProfileStatistics;
 MSR_DS_AREA_STRUCT        *mMsrDsAreaBase;
 //
 // The buffer to store SMM profile data.
@@ -836,6 +837,14 @@ InitSmmProfileCallBack (
          &mSmmProfileBase
          );
 
+  gRT->SetVariable (
+         SMM_PROFILE_STATISTICS_NAME,
+         &gEfiCallerIdGuid,
+         EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+         sizeof(mSmmProfileStatistics),
+         &mSmmProfileStatistics
+         );
+
   //
   // Get Software SMI from FADT
   //
@@ -864,6 +873,7 @@ InitSmmProfileInternal (
   UINTN                      Index;
   UINTN                      MsrDsAreaSizePerCpu;
   UINTN                      TotalSize;
+  UINTN                      StatisticsSize;
 
   mPFEntryCount = (UINTN *)AllocateZeroPool (sizeof (UINTN) * mMaxNumberOfCpus);
   ASSERT (mPFEntryCount != NULL);
@@ -887,6 +897,12 @@ InitSmmProfileInternal (
     TotalSize = mSmmProfileSize;
   }
 
+  //
+  // The SMI synchronization statistics follow.
+  //
+  StatisticsSize = sizeof (SMM_PROFILE_STATISTICS) + sizeof (SMM_PROFILE_CPU_RESIDENCY) * mMaxNumberOfCpus;
+  TotalSize     += StatisticsSize;
+
   Base = 0xFFFFFFFF;
   Status = gBS->AllocatePages (
                   AllocateMaxAddress,
@@ -911,6 +927,12 @@ InitSmmProfileInternal (
   mSmmProfileBase->NumSmis        = 0;
   mSmmProfileBase->NumCpus        = gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
 
+  mSmmProfileStatistics = (SMM_PROFILE_STATISTICS *)(UINTN)(Base + TotalSize - StatisticsSize);
+  mSmmProfileStatistics->Signature = SMM_PROFILE_STATISTICS_SIGNATURE;
+  mSmmProfileStatistics->Revision  = SMM_PROFILE_STATISTICS_REVISION;
+  mSmmProfileStatistics->Size      = StatisticsSize;
+  mSmmProfileStatistics->NumCpus   = mMaxNumberOfCpus;
+
   if (mBtsSupported) {
     mMsrDsArea = (MSR_DS_AREA_STRUCT **)AllocateZeroPool (sizeof (MSR_DS_AREA_STRUCT *) * mMaxNumberOfCpus);
     ASSERT (mMsrDsArea != NULL);
@@ -1117,6 +1139,68 @@ SmmProfileRecordSmiNum (
   }
 }
 
+/**
+  Record the time the BSP waited for the APs to arrive in the SMI rendezvous
+  latency histogram.
+
+  @param  Ticks  The elapsed performance counter ticks.
+
+**/
+VOID
+SmmProfileRecordRendezvousLatency (
+  IN UINT64  Ticks
+  )
+{
+  UINT64  Latency;
+  UINTN   Bucket;
+
+  if (!mSmmProfileStart) {
+    return;
+  }
+
+  Latency = DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+  Bucket  = 0;
+  if (Latency != 0) {
+    Bucket = MIN ((UINTN)HighBitSet64 (Latency) + 1, SMM_PROFILE_LATENCY_BUCKET_COUNT - 1);
+  }
+  mSmmProfileStatistics->RendezvousLatency[Bucket]++;
+  if (Latency > mSmmProfileStatistics->MaxRendezvousLatency) {
+    mSmmProfileStatistics->MaxRendezvousLatency = Latency;
+  }
+}
+
+/**
+  Record the time a processor spent in an SMI.
+
+  @param  CpuIndex  The index of the processor.
+  @param  Ticks     The elapsed performance counter ticks.
+
+**/
+VOID
+SmmProfileRecordResidency (
+  IN UINTN   CpuIndex,
+  IN UINT64  Ticks
+  )
+{
+  SMM_PROFILE_CPU_RESIDENCY  *CpuResidency;
+  UINT64                     Residency;
+
+  if (!mSmmProfileStart) {
+    return;
+  }
+
+  //
+  // Each processor only updates its own record.
+  //
+  CpuResidency = (SMM_PROFILE_CPU_RESIDENCY *)(mSmmProfileStatistics + 1) + CpuIndex;
+  Residency    = GetTimeInNanoSecond (Ticks);
+  CpuResidency->NumSmis++;
+  CpuResidency->Residency += Residency;
+  if (Residency > CpuResidency->MaxResidency) {
+    CpuResidency->MaxResidency = Residency;
+  }
+}
+
 /**
   Initialize processor environment for SMM profile.
 
@@ -46,6 +46,31 @@ SmmProfileRecordSmiNum (
   VOID
   );
 
+/**
+  Record the time the BSP waited for the APs to arrive in the SMI rendezvous
+  latency histogram.
+
+  @param  Ticks  The elapsed performance counter ticks.
+
+**/
+VOID
+SmmProfileRecordRendezvousLatency (
+  IN UINT64  Ticks
+  );
+
+/**
+  Record the time a processor spent in an SMI.
+
+  @param  CpuIndex  The index of the processor.
+  @param  Ticks     The elapsed performance counter ticks.
+
+**/
+VOID
+SmmProfileRecordResidency (
+  IN UINTN   CpuIndex,
+  IN UINT64  Ticks
+  );
+
 /**
   The Page fault handler to save SMM profile data.
 
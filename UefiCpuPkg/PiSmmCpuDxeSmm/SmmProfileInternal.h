@@ -28,6 +28,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define MAX_PF_ENTRY_COUNT          10
 
+//
+// Bucket N of the SMI rendezvous latency histogram counts the SMIs whose
+// rendezvous took [2^(N-1), 2^N) microseconds, bucket 0 counts those
+// below 1 microsecond. The last bucket also holds all longer ones.
+//
+#define SMM_PROFILE_LATENCY_BUCKET_COUNT  24
+
 //
 // This MACRO just enable unit test for the profile
 // Please disable it.
@@ -36,6 +43,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define IA32_PF_EC_ID               (1u << 4)
 
 #define SMM_PROFILE_NAME            L"SmmProfileData"
+#define SMM_PROFILE_STATISTICS_NAME L"SmmProfileStatistics"
+
+#define SMM_PROFILE_STATISTICS_SIGNATURE  SIGNATURE_32 ('S', 'P', 'S', 'T')
+#define SMM_PROFILE_STATISTICS_REVISION   0x0001
 
 //
 // CPU generic definition
@@ -85,6 +96,30 @@ typedef struct {
   UINT64  NumCpus;
 } SMM_PROFILE_HEADER;
 
+//
+// SMI synchronization statistics. They are kept after the SMM profile data
+// and the DS area, so that the layout of the SMM profile data is unchanged,
+// and their address is saved in the SMM_PROFILE_STATISTICS_NAME variable.
+//
+typedef struct {
+  UINT32  Signature;
+  UINT32  Revision;
+  UINT64  Size;                   // Size of the statistics in bytes
+  UINT64  MaxRendezvousLatency;   // In microseconds
+  UINT64  RendezvousLatency[SMM_PROFILE_LATENCY_BUCKET_COUNT];
+  UINT64  NumCpus;                // Number of SMM_PROFILE_CPU_RESIDENCY records
+} SMM_PROFILE_STATISTICS;
+
+//
+// SMI residency of one processor. SMM_PROFILE_STATISTICS is followed by one
+// of them for each possible processor.
+//
+typedef struct {
+  UINT64  NumSmis;
+  UINT64  Residency;              // In nanoseconds
+  UINT64  MaxResidency;           // In nanoseconds
+} SMM_PROFILE_CPU_RESIDENCY;
+
 typedef struct {
   UINT64  SmiNum;
   UINT64  CpuNum;